@@ -90,6 +90,10 @@
 #include "jsiter.h"
 #endif
 
+#ifdef JS_THREADSAFE
+#include "prsystem.h"
+#endif
+
 #ifdef HAVE_VA_LIST_AS_ARRAY
 #define JS_ADDRESSOF_VA_LIST(ap) ((va_list *)(ap))
 #else
@@ -729,6 +733,10 @@ JS_NewRuntime(uint32 maxbytes)
     if (!rt->scopeSharingDone)
         goto bad;
     rt->scopeSharingTodo = NO_SCOPE_SHARING_TODO;
+    rt->gcHelperWakeup = JS_NEW_CONDVAR(rt->gcLock);
+    if (!rt->gcHelperWakeup)
+        goto bad;
+    rt->gcHelperThreads = (PR_GetNumberOfProcessors() > 1) ? 1 : 0;
 #endif
     rt->propertyCache.empty = JS_TRUE;
     if (!js_InitPropertyTree(rt))
@@ -776,6 +784,8 @@ JS_DestroyRuntime(JSRuntime *rt)
         JS_DESTROY_CONDVAR(rt->setSlotDone);
     if (rt->scopeSharingDone)
         JS_DESTROY_CONDVAR(rt->scopeSharingDone);
+    if (rt->gcHelperWakeup)
+        JS_DESTROY_CONDVAR(rt->gcHelperWakeup);
 #else
     GSN_CACHE_CLEAR(&rt->gsnCache);
 #endif
@@ -872,7 +882,7 @@ JS_EndRequest(JSContext *cx)
                 nshares++;
             }
         }
-        if (nshares)
+        if (nshares || rt->arrayClaimWaiters)
             JS_NOTIFY_ALL_CONDVAR(rt->scopeSharingDone);
 
         /* Give the GC a chance to run if this was the last request running. */
@@ -1896,8 +1906,8 @@ JS_MaybeGC(JSContext *cx)
     /*
      * We run the GC if we used all available free GC cells and had to
      * allocate extra 1/5 of GC arenas since the last run of GC, or if
-     * we have malloc'd more bytes through JS_malloc than we were told
-     * to allocate by JS_NewRuntime.
+     * we have malloc'd more bytes through JS_malloc than the adaptive
+     * trigger set by the last GC allows, see SetGCTriggers in jsgc.c.
      *
      * The reason for
      *   bytes > 6/5 lastBytes
@@ -1941,7 +1951,7 @@ JS_MaybeGC(JSContext *cx)
      * F == 0 && B > 3/2 Bl(1-0.8) or just B > 6/5 Bl.
      */
     if ((bytes > 8192 && bytes > lastBytes + lastBytes / 5) ||
-        rt->gcMallocBytes >= rt->gcMaxMallocBytes) {
+        rt->gcMallocBytes >= rt->gcMallocTrigger) {
         JS_GC(cx);
     }
 #if JS_HAS_GENERATORS
@@ -1953,6 +1963,50 @@ JS_MaybeGC(JSContext *cx)
 #endif
 }
 
+JS_PUBLIC_API(JSBool)
+JS_WantIdleGC(JSContext *cx, uint32 budget)
+{
+    JSRuntime *rt;
+
+    rt = cx->runtime;
+
+    /*
+     * A quarter of the heap or malloc trigger is enough garbage to be worth
+     * an early collection without running the GC on every idle moment.
+     */
+    if (rt->gcAllocBytes < rt->gcTriggerBytes / 4 &&
+        rt->gcMallocBytes < rt->gcMallocTrigger / 4) {
+        return JS_FALSE;
+    }
+
+    /* Only a guess, the next collection can take longer than the last. */
+    return rt->gcLastDuration / 1000 <= budget;
+}
+
+JS_PUBLIC_API(JSBool)
+JS_MaybeIdleGC(JSContext *cx, uint32 budget)
+{
+    if (!JS_WantIdleGC(cx, budget))
+        return JS_FALSE;
+    JS_GC(cx);
+    return JS_TRUE;
+}
+
+JS_PUBLIC_API(int32)
+JS_DecommitGCChunks(JSContext *cx)
+{
+    JSRuntime *rt;
+    int32 next;
+
+    rt = cx->runtime;
+    JS_LOCK_GC(rt);
+
+    /* Another thread is collecting and decommits when done, look again later. */
+    next = rt->gcRunning ? 100 : js_DecommitGCChunks(rt);
+    JS_UNLOCK_GC(rt);
+    return next;
+}
+
 JS_PUBLIC_API(JSGCCallback)
 JS_SetGCCallback(JSContext *cx, JSGCCallback cb)
 {
@@ -1982,13 +2036,32 @@ JS_SetGCParameter(JSRuntime *rt, JSGCParamKey key, uint32 value)
     switch (key) {
       case JSGC_MAX_BYTES:
         rt->gcMaxBytes = value;
+        if (rt->gcTriggerBytes > value)
+            rt->gcTriggerBytes = value;
         break;
       case JSGC_MAX_MALLOC_BYTES:
-        rt->gcMaxMallocBytes = value;
+        rt->gcMaxMallocBytes = rt->gcMallocTrigger = value;
+        break;
+      case JSGC_DECOMMIT_DELAY:
+        rt->gcDecommitDelay = value;
+        break;
+      case JSGC_TRIGGER_FACTOR:
+        rt->gcTriggerFactor = JS_MAX(value, 100);
+        break;
+      case JSGC_HELPER_THREADS:
+#ifdef JS_THREADSAFE
+        rt->gcHelperThreads = JS_MIN(value, 1);
+#endif
         break;
     }
 }
 
+JS_PUBLIC_API(void)
+JS_GetGCInfo(JSRuntime *rt, JSGCInfo *info)
+{
+    js_GetGCInfo(rt, info);
+}
+
 JS_PUBLIC_API(intN)
 JS_AddExternalStringFinalizer(JSStringFinalizeOp finalizer)
 {
@@ -2244,6 +2317,12 @@ bad:
     goto out;
 }
 
+JS_PUBLIC_API(const JSObjectOps *)
+JS_GetNativeObjectOps(void)
+{
+    return &js_ObjectOps;
+}
+
 #ifdef JS_THREADSAFE
 JS_PUBLIC_API(JSClass *)
 JS_GetClass(JSContext *cx, JSObject *obj)
@@ -3678,6 +3757,37 @@ js_generic_native_method_dispatcher(JSContext *cx, JSObject *obj,
     return fs->call(cx, JSVAL_TO_OBJECT(argv[-1]), argc - 1, argv, rval);
 }
 
+/*
+ * The JSFUN_FAST_NATIVE counterpart of js_generic_native_method_dispatcher:
+ * shift the arguments down over vp[1] and call the prototype method with the
+ * first of them as its 'this' parameter.
+ */
+JS_STATIC_DLL_CALLBACK(JSBool)
+js_generic_fast_native_method_dispatcher(JSContext *cx, uintN argc, jsval *vp)
+{
+    jsval fsv;
+    JSFunctionSpec *fs;
+    JSObject *tmp;
+
+    if (!JS_GetReservedSlot(cx, JSVAL_TO_OBJECT(vp[0]), 0, &fsv))
+        return JS_FALSE;
+    fs = (JSFunctionSpec *) JSVAL_TO_PRIVATE(fsv);
+
+    /* As above, vp[2] is valid because we require at least one argument. */
+    if (JSVAL_IS_PRIMITIVE(vp[2])) {
+        if (!js_ValueToObject(cx, vp[2], &tmp))
+            return JS_FALSE;
+        vp[2] = OBJECT_TO_JSVAL(tmp);
+    }
+    memmove(vp + 1, vp + 2, JS_MAX(fs->nargs + 1U, argc) * sizeof(jsval));
+    if (!js_ComputeThis(cx, JSVAL_TO_OBJECT(vp[1]), vp + 2))
+        return JS_FALSE;
+    if (argc == 0)
+        argc = 1;
+
+    return ((JSFastNative) fs->call)(cx, argc - 1, vp);
+}
+
 JS_PUBLIC_API(JSBool)
 JS_DefineFunctions(JSContext *cx, JSObject *obj, JSFunctionSpec *fs)
 {
@@ -3706,7 +3816,10 @@ JS_DefineFunctions(JSContext *cx, JSObject *obj, JSFunctionSpec *fs)
 
             flags &= ~JSFUN_GENERIC_NATIVE;
             fun = JS_DefineFunction(cx, ctor, fs->name,
-                                    js_generic_native_method_dispatcher,
+                                    (flags & JSFUN_FAST_NATIVE)
+                                    ? (JSNative)
+                                      js_generic_fast_native_method_dispatcher
+                                    : js_generic_native_method_dispatcher,
                                     fs->nargs + 1, flags);
             if (!fun)
                 return JS_FALSE;
@@ -3774,6 +3887,9 @@ CompileTokenStream(JSContext *cx, JSObject *obj, JSTokenStream *ts,
     } else if (!js_CompileTokenStream(cx, obj, ts, &cg)) {
         script = NULL;
         eof = (ts->flags & TSF_EOF) != 0;
+    } else if (ts->flags & TSF_ERROR) {
+        /* Input that couldn't be inflated ends the stream early. */
+        script = NULL;
     } else {
         script = js_NewScriptFromCG(cx, &cg, NULL);
     }
@@ -3966,6 +4082,25 @@ JS_CompileFileHandleForPrincipals(JSContext *cx, JSObject *obj,
     return script;
 }
 
+JS_PUBLIC_API(JSScript *)
+JS_CompileBytes(JSContext *cx, JSObject *obj,
+                const char *bytes, size_t length,
+                const char *filename, uintN lineno)
+{
+    void *mark;
+    JSTokenStream *ts;
+    JSScript *script;
+
+    CHECK_REQUEST(cx);
+    mark = JS_ARENA_MARK(&cx->tempPool);
+    ts = js_NewBytesTokenStream(cx, bytes, length, filename, lineno, NULL);
+    if (!ts)
+        return NULL;
+    script = CompileTokenStream(cx, obj, ts, mark, NULL);
+    LAST_FRAME_CHECKS(cx, script);
+    return script;
+}
+
 JS_PUBLIC_API(JSObject *)
 JS_NewScriptObject(JSContext *cx, JSScript *script)
 {
@@ -4573,7 +4708,9 @@ JS_GetStringChars(JSString *str)
     jschar *chars;
 
     chars = js_GetStringChars(str);
-    return chars ? chars : JSSTRING_CHARS(str);
+    if (!chars && !JSSTRING_IS_ROPE(str))
+        chars = JSSTRING_CHARS(str);
+    return chars;
 }
 
 JS_PUBLIC_API(size_t)
@@ -4606,8 +4743,13 @@ JS_NewDependentString(JSContext *cx, JSString *str, size_t start,
 JS_PUBLIC_API(JSString *)
 JS_ConcatStrings(JSContext *cx, JSString *left, JSString *right)
 {
+    JSString *str;
+
     CHECK_REQUEST(cx);
-    return js_ConcatStrings(cx, left, right);
+    str = js_ConcatStrings(cx, left, right);
+    if (str && !JSSTRING_FLATTEN(cx, str))
+        return NULL;
+    return str;
 }
 
 JS_PUBLIC_API(const jschar *)
@@ -179,7 +179,9 @@ JS_BEGIN_EXTERN_C
 #define JSFUN_THISP_BOOLEAN   0x0400    /* |this| may be a primitive boolean */
 #define JSFUN_THISP_PRIMITIVE 0x0700    /* |this| may be any primitive value */
 
-#define JSFUN_FLAGS_MASK      0x07f8    /* overlay JSFUN_* attributes --
+#define JSFUN_FAST_NATIVE     0x0800    /* JSFastNative needs no JSStackFrame */
+
+#define JSFUN_FLAGS_MASK      0x0ff8    /* overlay JSFUN_* attributes --
                                            note that bit #15 is used internally
                                            to flag interpreted functions */
 
@@ -563,6 +565,9 @@ JS_StringToVersion(const char *string);
                                                    uncaught exceptions from
                                                    being converted to error
                                                    reports */
+#define JSOPTION_JIT            JS_BIT(9)       /* compile hot scripts to
+                                                   native code, where the
+                                                   engine can */
 
 extern JS_PUBLIC_API(uint32)
 JS_GetOptions(JSContext *cx);
@@ -863,6 +868,33 @@ JS_GC(JSContext *cx);
 extern JS_PUBLIC_API(void)
 JS_MaybeGC(JSContext *cx);
 
+/*
+ * For embeddings with idle moments, e.g. an event loop about to block: tell
+ * whether a good part of what would force a last ditch GC has been allocated
+ * since the last GC, and the last GC took no longer than budget milliseconds.
+ * Pass (uint32)-1 when there is no deadline.  The collection this asks for is
+ * a full, non-incremental JS_GC, the budget only predicts its length from the
+ * last one and doesn't bound it, so it can run past the deadline.  Running it
+ * while idle just keeps the pause out of the next piece of work.
+ */
+extern JS_PUBLIC_API(JSBool)
+JS_WantIdleGC(JSContext *cx, uint32 budget);
+
+/*
+ * Run JS_GC if JS_WantIdleGC says so and return true if it ran.
+ */
+extern JS_PUBLIC_API(JSBool)
+JS_MaybeIdleGC(JSContext *cx, uint32 budget);
+
+/*
+ * Give heap chunks left empty for JSGC_DECOMMIT_DELAY back to the system and
+ * return the milliseconds until the next empty chunk is due, or -1 if none is
+ * waiting.  An embedding about to block can sleep at most that long and call
+ * this again, so an idle process returns its memory too.
+ */
+extern JS_PUBLIC_API(int32)
+JS_DecommitGCChunks(JSContext *cx);
+
 extern JS_PUBLIC_API(JSGCCallback)
 JS_SetGCCallback(JSContext *cx, JSGCCallback cb);
 
@@ -874,12 +906,56 @@ JS_IsAboutToBeFinalized(JSContext *cx, void *thing);
 
 typedef enum JSGCParamKey {
     JSGC_MAX_BYTES        = 0,  /* maximum nominal heap before last ditch GC */
-    JSGC_MAX_MALLOC_BYTES = 1   /* # of JS_malloc bytes before last ditch GC */
+    JSGC_MAX_MALLOC_BYTES = 1,  /* # of JS_malloc bytes before last ditch GC */
+    JSGC_DECOMMIT_DELAY   = 2,  /* ms before an empty chunk is decommitted */
+    JSGC_TRIGGER_FACTOR   = 3,  /* heap growth over what survived the last
+                                   GC before the next one, in percent */
+    JSGC_HELPER_THREADS   = 4   /* threads freeing memory released by the
+                                   GC, 0 or 1, by default 1 on SMP only */
 } JSGCParamKey;
 
 extern JS_PUBLIC_API(void)
 JS_SetGCParameter(JSRuntime *rt, JSGCParamKey key, uint32 value);
 
+/*
+ * GC statistics kept whether or not the engine is built with JS_GCMETER, see
+ * JS_GetGCInfo.  Times are in microseconds.  The per-type arrays are indexed
+ * by GC thing type: object, string, double, mutable string, private,
+ * Namespace, QName, XML and external string (of any finalizer).  They count
+ * the bytes of the GC things only, not of the memory the things own.
+ */
+#define JSGC_INFO_NTYPES        9
+#define JSGC_INFO_NKINDS        3
+#define JSGC_PAUSE_LOG          256
+
+typedef struct JSGCInfo {
+    uint32      number;         /* GCs run so far */
+    uint32      kinds[JSGC_INFO_NKINDS];
+                                /* of them normal ones (JS_GC, JS_MaybeGC),
+                                   on the last context and by the allocator */
+    uint32      lastKind;       /* index in kinds of the last GC */
+    uint32      lastPause;      /* pause of the last GC */
+    uint32      pauseMedian;    /* pause percentiles over the last */
+    uint32      pause90;        /*   JSGC_PAUSE_LOG GCs */
+    uint32      pause99;
+    uint32      pauseMax;       /* longest pause so far */
+    jsdouble    pauseTotal;     /* sum of all pauses */
+    jsdouble    allocBytes[JSGC_INFO_NTYPES];
+                                /* allocated before the last GC */
+    jsdouble    freedBytes[JSGC_INFO_NTYPES];
+                                /* finalized so far */
+    uint32      liveBytes[JSGC_INFO_NTYPES];
+                                /* alive after the last GC */
+    uint32      arenas;         /* arenas holding GC things */
+    uint32      heapBytes;      /* heap counted toward JSGC_MAX_BYTES */
+    uint32      triggerBytes;   /* heap size that triggers the next GC */
+    uint32      mallocBytes;    /* JS_malloc bytes counted since the last GC */
+    uint32      mallocTrigger;  /* JS_malloc bytes that trigger the next GC */
+} JSGCInfo;
+
+extern JS_PUBLIC_API(void)
+JS_GetGCInfo(JSRuntime *rt, JSGCInfo *info);
+
 /*
  * Add a finalizer for external strings created by JS_NewExternalString (see
  * below) using a type-code returned from this function, and that understands
@@ -1082,6 +1158,14 @@ struct JSXMLObjectOps {
     JSConcatenateOp     concatenate;
 };
 
+/*
+ * The object ops of ordinary native objects.  A class whose getObjectOps hook
+ * overrides only some ops can copy these, keep the native map layout and call
+ * the originals for everything it doesn't handle itself.
+ */
+extern JS_PUBLIC_API(const JSObjectOps *)
+JS_GetNativeObjectOps(void);
+
 /*
  * Classes that expose JSObjectOps via a non-null getObjectOps class hook may
  * derive a property structure from this struct, return a pointer to it from
@@ -1178,6 +1262,25 @@ struct JSFunctionSpec {
 #endif
 };
 
+#ifndef MOZILLA_1_8_BRANCH
+/*
+ * Define a JSFastNative in a JSFunctionSpec array, and access its callee,
+ * 'this', arguments and return value from its vp parameter.  See the
+ * JSFastNative typedef in jspubtd.h.  JS_THIS_OBJECT casts like the obj
+ * parameter of a JSNative does, so a primitive 'this' allowed by the
+ * JSFUN_THISP_* flags is still tested with JSVAL_IS_STRING((jsval)obj) etc.
+ */
+#define JS_FN(name,fastcall,nargs,flags,extra)                                \
+    {name, (JSNative)(fastcall), nargs, (flags) | JSFUN_FAST_NATIVE, extra}
+
+#define JS_CALLEE(cx,vp)        ((vp)[0])
+#define JS_THIS(cx,vp)          ((vp)[1])
+#define JS_THIS_OBJECT(cx,vp)   ((JSObject *) JS_THIS(cx,vp))
+#define JS_ARGV(cx,vp)          ((vp) + 2)
+#define JS_RVAL(cx,vp)          (*(vp))
+#define JS_SET_RVAL(cx,vp,v)    (*(vp) = (v))
+#endif
+
 extern JS_PUBLIC_API(JSObject *)
 JS_InitClass(JSContext *cx, JSObject *obj, JSObject *parent_proto,
              JSClass *clasp, JSNative constructor, uintN nargs,
@@ -1647,6 +1750,17 @@ JS_CompileFileHandleForPrincipals(JSContext *cx, JSObject *obj,
                                   const char *filename, FILE *fh,
                                   JSPrincipals *principals);
 
+/*
+ * Like JS_CompileScript, but the bytes are inflated a line at a time as the
+ * scanner consumes them instead of all at once, so compiling a large source,
+ * e.g. a mapped file, doesn't need a jschar copy of all of it.  The bytes
+ * only need to stay valid until JS_CompileBytes returns.
+ */
+extern JS_PUBLIC_API(JSScript *)
+JS_CompileBytes(JSContext *cx, JSObject *obj,
+                const char *bytes, size_t length,
+                const char *filename, uintN lineno);
+
 /*
  * NB: you must use JS_NewScriptObject and root a pointer to its return value
  * in order to keep a JSScript and its atoms safe from garbage collection after
@@ -1892,6 +2006,15 @@ JS_InternUCString(JSContext *cx, const jschar *s);
 extern JS_PUBLIC_API(char *)
 JS_GetStringBytes(JSString *str);
 
+/*
+ * A string taken straight from a jsval may be a rope, a lazy concatenation
+ * that only gets its characters when first read.  JS_GetStringChars makes
+ * them without a cx to report failure with, so it returns null if that runs
+ * out of memory, and JS_GetStringBytes returns "".  Use JS_UndependString
+ * first where out of memory should be reported.  JS_CompareStrings needs
+ * strings that are not ropes, as returned by JS_ValueToString or passed to
+ * JS_UndependString.
+ */
 extern JS_PUBLIC_API(jschar *)
 JS_GetStringChars(JSString *str);
 
@@ -1943,7 +2066,8 @@ extern JS_PUBLIC_API(JSString *)
 JS_ConcatStrings(JSContext *cx, JSString *left, JSString *right);
 
 /*
- * Convert a dependent string into an independent one.  This function does not
+ * Convert a dependent string or a rope into an independent, flat one, and
+ * return its characters or null on out of memory.  This function does not
  * change the string's mutability, so the thread safety comments above apply.
  */
 extern JS_PUBLIC_API(const jschar *)
@@ -58,6 +58,7 @@
 #include "jslock.h"
 #include "jsnum.h"
 #include "jsobj.h"
+#include "jsscope.h"
 #include "jsstr.h"
 
 /* 2^32 - 1 as a number and a string */
@@ -169,6 +170,11 @@ js_GetLengthProperty(JSContext *cx, JSObject *obj, jsuint *lengthp)
     JSBool ok;
     jsint i;
 
+    if (OBJ_IS_DENSE_ARRAY(cx, obj)) {
+        *lengthp = ARRAY_DENSE_LENGTH(obj);
+        return JS_TRUE;
+    }
+
     JS_PUSH_SINGLE_TEMP_ROOT(cx, JSVAL_NULL, &tvr);
     id = ATOM_TO_JSID(cx->runtime->atomState.lengthAtom);
     ok = OBJ_GET_PROPERTY(cx, obj, id, &tvr.u.value);
@@ -241,6 +247,137 @@ BigIndexToId(JSContext *cx, JSObject *obj, jsuint index, JSBool createAtom,
     return JS_TRUE;
 }
 
+/*
+ * A dense array keeps an element in its vector only if doing so would not
+ * leave a run of holes longer than the vector itself (or ARRAY_SPARSE_GAP,
+ * for small arrays) in front of it.  Stores further out make the array slow.
+ */
+#define ARRAY_SPARSE_GAP        256
+
+#define DENSE_ELEMENT(obj,index) ((obj)->slots[JSSLOT_ARRAY_ELEMENTS + (index)])
+
+static JSBool
+IdToDenseIndex(jsid id, jsuint *indexp)
+{
+    jsint i;
+
+    if (JSID_IS_INT(id)) {
+        i = JSID_TO_INT(id);
+        if (i < 0)
+            return JS_FALSE;
+        *indexp = (jsuint) i;
+        return JS_TRUE;
+    }
+    return JSID_IS_ATOM(id) &&
+           js_IdIsIndex(ATOM_KEY(JSID_TO_ATOM(id)), indexp) &&
+           *indexp <= JSVAL_INT_MAX;
+}
+
+static JSBool
+IsDenseIndex(JSObject *obj, jsuint index)
+{
+    jsuint extent;
+
+    extent = ARRAY_DENSE_EXTENT(obj);
+    if (index < extent)
+        return JS_TRUE;
+    return index < (jsuint) JSVAL_INT_MAX &&
+           index - extent <= JS_MAX(extent, ARRAY_SPARSE_GAP);
+}
+
+/*
+ * Whether any object on obj's prototype chain might have an indexed setter,
+ * getter or read-only element, in which case a store to a hole or past the
+ * end of a dense array has to go through js_SetProperty.
+ */
+JSBool
+js_PrototypeHasIndexedProperties(JSContext *cx, JSObject *obj)
+{
+    while ((obj = JSVAL_TO_OBJECT(obj->slots[JSSLOT_PROTO])) != NULL) {
+        if (obj->map->ops == &js_ArrayObjectOps) {
+            if (ARRAY_DENSE_EXTENT(obj) != 0)
+                return JS_TRUE;
+        } else if (!OBJ_IS_NATIVE(obj) ||
+                   SCOPE_HAS_INDEXED_PROPERTIES(OBJ_SCOPE(obj))) {
+            return JS_TRUE;
+        }
+    }
+    return JS_FALSE;
+}
+
+/*
+ * Whether v can be stored at index straight into the dense array obj, which
+ * is so unless index is a hole or past the end of the vector and one of the
+ * prototypes might have something to say about it.
+ */
+static JSBool
+CanSetDenseElement(JSContext *cx, JSObject *obj, jsuint index)
+{
+    if (!IsDenseIndex(obj, index))
+        return JS_FALSE;
+    if (index < ARRAY_DENSE_EXTENT(obj) &&
+        DENSE_ELEMENT(obj, index) != JSVAL_HOLE) {
+        return JS_TRUE;
+    }
+    return !js_PrototypeHasIndexedProperties(cx, obj);
+}
+
+static JSBool
+EnsureDenseCapacity(JSContext *cx, JSObject *obj, jsuint capacity)
+{
+    uint32 nslots, grown;
+
+    nslots = JSSLOT_ARRAY_ELEMENTS + capacity;
+    if (nslots <= obj->map->nslots)
+        return JS_TRUE;
+
+    /* Grow geometrically so that pushing n elements is O(n) overall. */
+    grown = obj->map->nslots + obj->map->nslots / 2;
+    if (nslots < grown)
+        nslots = grown;
+    return js_ReallocSlots(cx, obj, nslots);
+}
+
+/*
+ * Store v, which must be rooted, at index in the dense array obj.  The caller
+ * must have checked IsDenseIndex(obj, index).
+ */
+static JSBool
+SetDenseElement(JSContext *cx, JSObject *obj, jsuint index, jsval v)
+{
+    jsuint extent, i;
+
+    extent = ARRAY_DENSE_EXTENT(obj);
+    if (index >= extent) {
+        if (!EnsureDenseCapacity(cx, obj, index + 1))
+            return JS_FALSE;
+        for (i = extent; i < index; i++)
+            DENSE_ELEMENT(obj, i) = JSVAL_HOLE;
+        DENSE_ELEMENT(obj, index) = v;
+        obj->map->freeslot = JSSLOT_ARRAY_ELEMENTS + index + 1;
+        if (index >= ARRAY_DENSE_LENGTH(obj))
+            obj->slots[JSSLOT_ARRAY_LENGTH] = INT_TO_JSVAL(index + 1);
+        return JS_TRUE;
+    }
+    DENSE_ELEMENT(obj, index) = v;
+    return JS_TRUE;
+}
+
+/* Turn index into a hole, trimming any holes left at the end of the vector. */
+static void
+DeleteDenseElement(JSObject *obj, jsuint index)
+{
+    jsuint extent;
+
+    extent = ARRAY_DENSE_EXTENT(obj);
+    if (index >= extent)
+        return;
+    DENSE_ELEMENT(obj, index) = JSVAL_HOLE;
+    while (extent != 0 && DENSE_ELEMENT(obj, extent - 1) == JSVAL_HOLE)
+        --extent;
+    obj->map->freeslot = JSSLOT_ARRAY_ELEMENTS + extent;
+}
+
 /*
  * If the property at the given index exists, get its value into location
  * pointed by vp and set *hole to false. Otherwise set *hole to true and *vp
@@ -255,6 +392,13 @@ GetArrayElement(JSContext *cx, JSObject *obj, jsuint index, JSBool *hole,
     JSObject *obj2;
     JSProperty *prop;
 
+    if (OBJ_IS_DENSE_ARRAY(cx, obj) && index < ARRAY_DENSE_EXTENT(obj) &&
+        DENSE_ELEMENT(obj, index) != JSVAL_HOLE) {
+        *vp = DENSE_ELEMENT(obj, index);
+        *hole = JS_FALSE;
+        return JS_TRUE;
+    }
+
     if (index <= JSVAL_INT_MAX) {
         id = INT_TO_JSID(index);
     } else {
@@ -289,6 +433,9 @@ SetArrayElement(JSContext *cx, JSObject *obj, jsuint index, jsval v)
 {
     jsid id;
 
+    if (OBJ_IS_DENSE_ARRAY(cx, obj) && CanSetDenseElement(cx, obj, index))
+        return SetDenseElement(cx, obj, index, v);
+
     if (index <= JSVAL_INT_MAX) {
         id = INT_TO_JSID(index);
     } else {
@@ -305,6 +452,11 @@ DeleteArrayElement(JSContext *cx, JSObject *obj, jsuint index)
     jsid id;
     jsval junk;
 
+    if (OBJ_IS_DENSE_ARRAY(cx, obj)) {
+        DeleteDenseElement(obj, index);
+        return JS_TRUE;
+    }
+
     if (index <= JSVAL_INT_MAX) {
         id = INT_TO_JSID(index);
     } else {
@@ -467,12 +619,488 @@ array_convert(JSContext *cx, JSObject *obj, JSType type, jsval *vp)
     return js_TryValueOf(cx, obj, type, vp);
 }
 
+static JSObjectOps *
+array_getObjectOps(JSContext *cx, JSClass *clasp)
+{
+    return &js_ArrayObjectOps;
+}
+
 JSClass js_ArrayClass = {
     "Array",
-    JSCLASS_HAS_CACHED_PROTO(JSProto_Array),
+    JSCLASS_HAS_RESERVED_SLOTS(1) | JSCLASS_HAS_CACHED_PROTO(JSProto_Array),
     array_addProperty, JS_PropertyStub,   JS_PropertyStub,   JS_PropertyStub,
     JS_EnumerateStub,  JS_ResolveStub,    array_convert,     JS_FinalizeStub,
-    JSCLASS_NO_OPTIONAL_MEMBERS
+    array_getObjectOps, NULL,             NULL,              NULL,
+    NULL,              NULL,              NULL,              NULL
+};
+
+#ifdef JS_THREADSAFE
+/*
+ * Make cx the owner of the dense array obj, so that no other thread is using
+ * its elements while it is converted.  As in ClaimScope, another context's
+ * array is taken over at once if that context is gone, outside of a request
+ * or on our thread; otherwise we suspend our request and wait for the next
+ * JS_EndRequest.  Returns with obj no longer dense if the owner made it slow
+ * meanwhile.
+ */
+static void
+ClaimDenseArray(JSContext *cx, JSObject *obj)
+{
+    JSRuntime *rt;
+    JSArrayMap *map;
+    JSContext *ownercx;
+    jsrefcount saveDepth;
+
+    rt = cx->runtime;
+    JS_LOCK_GC(rt);
+    while (obj->map->ops == &js_ArrayObjectOps) {
+        map = (JSArrayMap *) obj->map;
+        ownercx = map->ownercx;
+        if (ownercx == cx)
+            break;
+
+        /*
+         * While the GC runs on our thread no request is running anywhere
+         * else, so the owner can't be in the middle of using obj either.
+         */
+        if (!js_ValidContextPointer(rt, ownercx) ||
+            !ownercx->requestDepth ||
+            ownercx->thread == cx->thread ||
+            rt->gcThread == cx->thread) {
+            map->ownercx = cx;
+            break;
+        }
+
+        /*
+         * Inline JS_SuspendRequest as ClaimScope does, so that the GC can run
+         * and an owner waiting for one of our arrays can take it.
+         */
+        saveDepth = cx->requestDepth;
+        if (saveDepth) {
+            cx->requestDepth = 0;
+            JS_ASSERT(rt->requestCount > 0);
+            rt->requestCount--;
+            if (rt->requestCount == 0)
+                JS_NOTIFY_REQUEST_DONE(rt);
+        }
+
+        rt->arrayClaimWaiters++;
+        JS_WAIT_CONDVAR(rt->scopeSharingDone, JS_NO_TIMEOUT);
+        rt->arrayClaimWaiters--;
+
+        if (saveDepth) {
+            while (rt->gcLevel > 0)
+                JS_AWAIT_GC_DONE(rt);
+            rt->requestCount++;
+            cx->requestDepth = saveDepth;
+        }
+    }
+    JS_UNLOCK_GC(rt);
+}
+#endif
+
+/*
+ * Convert the dense array obj into a native object with a property for each
+ * element.  The elements stay in the slots they already occupy.
+ */
+JSBool
+js_MakeArraySlow(JSContext *cx, JSObject *obj)
+{
+    JSObjectMap *map;
+    JSScope *scope;
+    jsuint extent, i;
+
+#ifdef JS_THREADSAFE
+    if (((JSArrayMap *) obj->map)->ownercx != cx) {
+        ClaimDenseArray(cx, obj);
+
+        /* The owner may have made obj slow while we waited. */
+        if (obj->map->ops != &js_ArrayObjectOps)
+            return JS_TRUE;
+    }
+#endif
+
+    map = obj->map;
+    JS_ASSERT(map->ops == &js_ArrayObjectOps);
+    scope = js_NewScope(cx, 1, &js_SlowArrayObjectOps, &js_ArrayClass, obj);
+    if (!scope)
+        return JS_FALSE;
+
+    if (!js_AddScopeProperty(cx, scope,
+                             ATOM_TO_JSID(cx->runtime->atomState.lengthAtom),
+                             array_length_getter, array_length_setter,
+                             JSSLOT_ARRAY_LENGTH, JSPROP_PERMANENT, 0, 0)) {
+        goto bad;
+    }
+
+    extent = ARRAY_DENSE_EXTENT(obj);
+    for (i = 0; i < extent; i++) {
+        if (DENSE_ELEMENT(obj, i) == JSVAL_HOLE)
+            continue;
+        if (!js_AddScopeProperty(cx, scope, INT_TO_JSID(i), NULL, NULL,
+                                 JSSLOT_ARRAY_ELEMENTS + i, JSPROP_ENUMERATE,
+                                 0, 0)) {
+            goto bad;
+        }
+    }
+
+    /* Holes have no property now, so their slots are simply unused. */
+    for (i = 0; i < extent; i++) {
+        if (DENSE_ELEMENT(obj, i) == JSVAL_HOLE)
+            DENSE_ELEMENT(obj, i) = JSVAL_VOID;
+    }
+
+    scope->map.nslots = map->nslots;
+    scope->map.freeslot = map->freeslot;
+    obj->map = &scope->map;
+    js_DropObjectMap(cx, map, obj);
+    return JS_TRUE;
+
+  bad:
+    js_DestroyScope(cx, scope);
+    return JS_FALSE;
+}
+
+/*
+ * JSObjectOps for dense arrays.  The length and the elements are answered
+ * from obj->slots; everything else either goes to the prototype or makes the
+ * array slow and hands over to the native implementation in jsobj.c.  The
+ * JSProperty returned for an own property is just its id.
+ */
+static JSBool
+array_lookupProperty(JSContext *cx, JSObject *obj, jsid id, JSObject **objp,
+                     JSProperty **propp)
+{
+    jsuint i;
+    JSObject *proto;
+
+    if (!OBJ_IS_DENSE_ARRAY(cx, obj)) {
+        return js_MakeArraySlow(cx, obj) &&
+               js_LookupProperty(cx, obj, id, objp, propp);
+    }
+    if (id == ATOM_TO_JSID(cx->runtime->atomState.lengthAtom) ||
+        (IdToDenseIndex(id, &i) && i < ARRAY_DENSE_EXTENT(obj) &&
+         DENSE_ELEMENT(obj, i) != JSVAL_HOLE)) {
+        *objp = obj;
+        *propp = (JSProperty *) id;
+        return JS_TRUE;
+    }
+
+    proto = JSVAL_TO_OBJECT(obj->slots[JSSLOT_PROTO]);
+    if (!proto) {
+        *objp = NULL;
+        *propp = NULL;
+        return JS_TRUE;
+    }
+    return OBJ_LOOKUP_PROPERTY(cx, proto, id, objp, propp);
+}
+
+static JSBool
+array_defineProperty(JSContext *cx, JSObject *obj, jsid id, jsval value,
+                     JSPropertyOp getter, JSPropertyOp setter, uintN attrs,
+                     JSProperty **propp)
+{
+    jsuint i;
+
+    if (OBJ_IS_DENSE_ARRAY(cx, obj) &&
+        attrs == JSPROP_ENUMERATE &&
+        (!getter || getter == JS_PropertyStub) &&
+        (!setter || setter == JS_PropertyStub) &&
+        IdToDenseIndex(id, &i) && IsDenseIndex(obj, i)) {
+        if (!SetDenseElement(cx, obj, i, value))
+            return JS_FALSE;
+        if (propp)
+            *propp = (JSProperty *) id;
+        return JS_TRUE;
+    }
+
+    if (!js_MakeArraySlow(cx, obj))
+        return JS_FALSE;
+    return js_DefineProperty(cx, obj, id, value, getter, setter, attrs, propp);
+}
+
+static JSBool
+array_getProperty(JSContext *cx, JSObject *obj, jsid id, jsval *vp)
+{
+    jsuint i;
+    JSObject *obj2;
+    JSProperty *prop;
+
+    if (!OBJ_IS_DENSE_ARRAY(cx, obj))
+        return js_MakeArraySlow(cx, obj) && js_GetProperty(cx, obj, id, vp);
+    if (id == ATOM_TO_JSID(cx->runtime->atomState.lengthAtom)) {
+        *vp = obj->slots[JSSLOT_ARRAY_LENGTH];
+        return JS_TRUE;
+    }
+    if (IdToDenseIndex(id, &i) && i < ARRAY_DENSE_EXTENT(obj) &&
+        DENSE_ELEMENT(obj, i) != JSVAL_HOLE) {
+        *vp = DENSE_ELEMENT(obj, i);
+        return JS_TRUE;
+    }
+
+    obj2 = JSVAL_TO_OBJECT(obj->slots[JSSLOT_PROTO]);
+    if (!obj2) {
+        *vp = JSVAL_VOID;
+        return JS_TRUE;
+    }
+    if (!OBJ_LOOKUP_PROPERTY(cx, obj2, id, &obj2, &prop))
+        return JS_FALSE;
+    if (!prop) {
+        *vp = JSVAL_VOID;
+        return JS_TRUE;
+    }
+    if (!OBJ_IS_NATIVE(obj2)) {
+        OBJ_DROP_PROPERTY(cx, obj2, prop);
+        return OBJ_GET_PROPERTY(cx, obj2, id, vp);
+    }
+
+    /* Call any getter found on the prototype with obj as this. */
+    if (!js_NativeGet(cx, obj, obj2, (JSScopeProperty *) prop, vp))
+        return JS_FALSE;
+    OBJ_DROP_PROPERTY(cx, obj2, prop);
+    return JS_TRUE;
+}
+
+static JSBool
+array_setProperty(JSContext *cx, JSObject *obj, jsid id, jsval *vp)
+{
+    jsuint i;
+
+    if (OBJ_IS_DENSE_ARRAY(cx, obj)) {
+        if (id == ATOM_TO_JSID(cx->runtime->atomState.lengthAtom)) {
+            if (!ValueIsLength(cx, *vp, &i))
+                return JS_FALSE;
+            if (i <= JSVAL_INT_MAX) {
+                if (i < ARRAY_DENSE_EXTENT(obj))
+                    obj->map->freeslot = JSSLOT_ARRAY_ELEMENTS + i;
+                *vp = INT_TO_JSVAL(i);
+                obj->slots[JSSLOT_ARRAY_LENGTH] = *vp;
+                return JS_TRUE;
+            }
+        } else if (IdToDenseIndex(id, &i) && CanSetDenseElement(cx, obj, i)) {
+            return SetDenseElement(cx, obj, i, *vp);
+        }
+    }
+
+    if (!js_MakeArraySlow(cx, obj))
+        return JS_FALSE;
+    return js_SetProperty(cx, obj, id, vp);
+}
+
+static JSBool
+array_getAttributes(JSContext *cx, JSObject *obj, jsid id, JSProperty *prop,
+                    uintN *attrsp)
+{
+    jsuint i;
+    JSObject *obj2;
+    JSBool ok;
+
+    if (!OBJ_IS_DENSE_ARRAY(cx, obj)) {
+        return js_MakeArraySlow(cx, obj) &&
+               js_GetAttributes(cx, obj, id, NULL, attrsp);
+    }
+    if (id == ATOM_TO_JSID(cx->runtime->atomState.lengthAtom)) {
+        *attrsp = JSPROP_PERMANENT;
+        return JS_TRUE;
+    }
+    if (IdToDenseIndex(id, &i) && i < ARRAY_DENSE_EXTENT(obj) &&
+        DENSE_ELEMENT(obj, i) != JSVAL_HOLE) {
+        *attrsp = JSPROP_ENUMERATE;
+        return JS_TRUE;
+    }
+
+    if (!array_lookupProperty(cx, obj, id, &obj2, &prop))
+        return JS_FALSE;
+    if (!prop) {
+        *attrsp = 0;
+        return JS_TRUE;
+    }
+    ok = OBJ_GET_ATTRIBUTES(cx, obj2, id, prop, attrsp);
+    OBJ_DROP_PROPERTY(cx, obj2, prop);
+    return ok;
+}
+
+static JSBool
+array_setAttributes(JSContext *cx, JSObject *obj, jsid id, JSProperty *prop,
+                    uintN *attrsp)
+{
+    if (!js_MakeArraySlow(cx, obj))
+        return JS_FALSE;
+    return js_SetAttributes(cx, obj, id, NULL, attrsp);
+}
+
+static JSBool
+array_deleteProperty(JSContext *cx, JSObject *obj, jsid id, jsval *rval)
+{
+    jsuint i;
+
+    if (!OBJ_IS_DENSE_ARRAY(cx, obj))
+        return js_MakeArraySlow(cx, obj) && js_DeleteProperty(cx, obj, id, rval);
+    if (id == ATOM_TO_JSID(cx->runtime->atomState.lengthAtom)) {
+        *rval = JSVAL_FALSE;
+        return JS_TRUE;
+    }
+    if (IdToDenseIndex(id, &i))
+        DeleteDenseElement(obj, i);
+    *rval = JSVAL_TRUE;
+    return JS_TRUE;
+}
+
+static JSBool
+slowarray_enumerate(JSContext *cx, JSObject *obj, JSIterateOp enum_op,
+                    jsval *statep, jsid *idp)
+{
+    jsuint length, i;
+
+    if (enum_op == JSENUMERATE_INIT || !JSVAL_IS_BOOLEAN(*statep))
+        return js_Enumerate(cx, obj, enum_op, statep, idp);
+
+    /*
+     * obj went slow in the middle of a dense enumeration.  Finish it by index;
+     * the iterator skips any index that turns out to have no element.
+     */
+    if (enum_op == JSENUMERATE_NEXT) {
+        i = (jsuint) JSVAL_TO_BOOLEAN(*statep);
+        if (!js_GetLengthProperty(cx, obj, &length))
+            return JS_FALSE;
+        if (i < length && i <= JSVAL_INT_MAX) {
+            *idp = INT_TO_JSID(i);
+            *statep = BOOLEAN_TO_JSVAL(i + 1);
+            return JS_TRUE;
+        }
+    }
+    *statep = JSVAL_NULL;
+    return JS_TRUE;
+}
+
+/*
+ * The enumeration state of a dense array is the next index to look at, kept
+ * in a boolean jsval so that slowarray_enumerate can tell it apart from the
+ * state of js_Enumerate if the array goes slow while being enumerated.
+ */
+static JSBool
+array_enumerate(JSContext *cx, JSObject *obj, JSIterateOp enum_op,
+                jsval *statep, jsid *idp)
+{
+    jsuint extent, i, n;
+
+    if (!OBJ_IS_DENSE_ARRAY(cx, obj)) {
+        return js_MakeArraySlow(cx, obj) &&
+               slowarray_enumerate(cx, obj, enum_op, statep, idp);
+    }
+    extent = ARRAY_DENSE_EXTENT(obj);
+    switch (enum_op) {
+      case JSENUMERATE_INIT:
+        *statep = BOOLEAN_TO_JSVAL(0);
+        if (idp) {
+            for (i = n = 0; i < extent; i++) {
+                if (DENSE_ELEMENT(obj, i) != JSVAL_HOLE)
+                    n++;
+            }
+            *idp = INT_TO_JSID(n);
+        }
+        break;
+
+      case JSENUMERATE_NEXT:
+        i = (jsuint) JSVAL_TO_BOOLEAN(*statep);
+        while (i < extent && DENSE_ELEMENT(obj, i) == JSVAL_HOLE)
+            i++;
+        if (i < extent) {
+            *idp = INT_TO_JSID(i);
+            *statep = BOOLEAN_TO_JSVAL(i + 1);
+            break;
+        }
+        /* FALL THROUGH */
+
+      case JSENUMERATE_DESTROY:
+        *statep = JSVAL_NULL;
+        break;
+    }
+    return JS_TRUE;
+}
+
+static JSBool
+array_checkAccess(JSContext *cx, JSObject *obj, jsid id, JSAccessMode mode,
+                  jsval *vp, uintN *attrsp)
+{
+    switch (mode & JSACC_TYPEMASK) {
+      case JSACC_PROTO:
+      case JSACC_PARENT:
+        break;
+      default:
+        if (!js_MakeArraySlow(cx, obj))
+            return JS_FALSE;
+        break;
+    }
+    return js_CheckAccess(cx, obj, id, mode, vp, attrsp);
+}
+
+static JSObjectMap *
+array_newObjectMap(JSContext *cx, jsrefcount nrefs, JSObjectOps *ops,
+                   JSClass *clasp, JSObject *obj)
+{
+    JSObjectMap *map;
+
+    map = (JSObjectMap *) JS_malloc(cx, sizeof(JSArrayMap));
+    if (!map)
+        return NULL;
+    js_InitObjectMap(map, nrefs, ops, clasp);
+    JS_ASSERT(map->freeslot == JSSLOT_ARRAY_ELEMENTS);
+#ifdef JS_THREADSAFE
+    ((JSArrayMap *) map)->ownercx = cx;
+#endif
+    return map;
+}
+
+static void
+array_destroyObjectMap(JSContext *cx, JSObjectMap *map)
+{
+    JS_free(cx, map);
+}
+
+/* Dense arrays are never shared between threads, so don't lock them. */
+static jsval
+array_getRequiredSlot(JSContext *cx, JSObject *obj, uint32 slot)
+{
+    return (slot < (uint32) obj->slots[-1]) ? obj->slots[slot] : JSVAL_VOID;
+}
+
+static JSBool
+array_setRequiredSlot(JSContext *cx, JSObject *obj, uint32 slot, jsval v)
+{
+    JS_ASSERT(slot < JSSLOT_ARRAY_ELEMENTS);
+    obj->slots[slot] = v;
+    return JS_TRUE;
+}
+
+JSObjectOps js_ArrayObjectOps = {
+    array_newObjectMap,     array_destroyObjectMap,
+    array_lookupProperty,   array_defineProperty,
+    array_getProperty,      array_setProperty,
+    array_getAttributes,    array_setAttributes,
+    array_deleteProperty,   js_DefaultValue,
+    array_enumerate,        array_checkAccess,
+    NULL,                   NULL,
+    NULL,                   NULL,
+    NULL,                   js_HasInstance,
+    js_SetProtoOrParent,    js_SetProtoOrParent,
+    NULL,                   NULL,
+    array_getRequiredSlot,  array_setRequiredSlot
+};
+
+JSObjectOps js_SlowArrayObjectOps = {
+    js_NewObjectMap,        js_DestroyObjectMap,
+    js_LookupProperty,      js_DefineProperty,
+    js_GetProperty,         js_SetProperty,
+    js_GetAttributes,       js_SetAttributes,
+    js_DeleteProperty,      js_DefaultValue,
+    slowarray_enumerate,    js_CheckAccess,
+    NULL,                   NATIVE_DROP_PROPERTY,
+    js_Call,                js_Construct,
+    NULL,                   js_HasInstance,
+    js_SetProtoOrParent,    js_SetProtoOrParent,
+    js_Mark,                js_Clear,
+    js_GetRequiredSlot,     js_SetRequiredSlot
 };
 
 enum ArrayToStringOp {
@@ -700,29 +1328,27 @@ array_join_sub(JSContext *cx, JSObject *obj, enum ArrayToStringOp op,
 
 #if JS_HAS_TOSOURCE
 static JSBool
-array_toSource(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-               jsval *rval)
+array_toSource(JSContext *cx, uintN argc, jsval *vp)
 {
-    return array_join_sub(cx, obj, TO_SOURCE, NULL, rval);
+    return array_join_sub(cx, JS_THIS_OBJECT(cx, vp), TO_SOURCE, NULL, vp);
 }
 #endif
 
 static JSBool
-array_toString(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-               jsval *rval)
+array_toString(JSContext *cx, uintN argc, jsval *vp)
 {
-    return array_join_sub(cx, obj, TO_STRING, NULL, rval);
+    return array_join_sub(cx, JS_THIS_OBJECT(cx, vp), TO_STRING, NULL, vp);
 }
 
 static JSBool
-array_toLocaleString(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-               jsval *rval)
+array_toLocaleString(JSContext *cx, uintN argc, jsval *vp)
 {
     /*
      *  Passing comma here as the separator. Need a way to get a
      *  locale-specific version.
      */
-    return array_join_sub(cx, obj, TO_LOCALE_STRING, NULL, rval);
+    return array_join_sub(cx, JS_THIS_OBJECT(cx, vp), TO_LOCALE_STRING, NULL,
+                          vp);
 }
 
 static JSBool
@@ -739,18 +1365,24 @@ InitArrayElements(JSContext *cx, JSObject *obj, jsuint start, jsuint end,
 static JSBool
 InitArrayObject(JSContext *cx, JSObject *obj, jsuint length, jsval *vector)
 {
-    jsval v;
-    jsid id;
+    if (OBJ_IS_DENSE_ARRAY(cx, obj)) {
+        if (length <= JSVAL_INT_MAX) {
+            if (vector) {
+                if (!EnsureDenseCapacity(cx, obj, length))
+                    return JS_FALSE;
+                memcpy(&DENSE_ELEMENT(obj, 0), vector, length * sizeof(jsval));
+                obj->map->freeslot = JSSLOT_ARRAY_ELEMENTS + length;
+            }
+            obj->slots[JSSLOT_ARRAY_LENGTH] = INT_TO_JSVAL(length);
+            return JS_TRUE;
+        }
+        if (!js_MakeArraySlow(cx, obj))
+            return JS_FALSE;
+    }
 
-    if (!IndexToValue(cx, length, &v))
+    /* A slow array already has its length property, see js_MakeArraySlow. */
+    if (!js_SetLengthProperty(cx, obj, length))
         return JS_FALSE;
-    id = ATOM_TO_JSID(cx->runtime->atomState.lengthAtom);
-    if (!OBJ_DEFINE_PROPERTY(cx, obj, id, v,
-                             array_length_getter, array_length_setter,
-                             JSPROP_PERMANENT,
-                             NULL)) {
-          return JS_FALSE;
-    }
     if (!vector)
         return JS_TRUE;
     return InitArrayElements(cx, obj, 0, length, vector);
@@ -760,9 +1392,14 @@ InitArrayObject(JSContext *cx, JSObject *obj, jsuint length, jsval *vector)
  * Perl-inspired join, reverse, and sort.
  */
 static JSBool
-array_join(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+array_join(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     if (JSVAL_IS_VOID(argv[0])) {
         str = NULL;
@@ -772,16 +1409,20 @@ array_join(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
             return JS_FALSE;
         argv[0] = STRING_TO_JSVAL(str);
     }
-    return array_join_sub(cx, obj, TO_STRING, str, rval);
+    return array_join_sub(cx, obj, TO_STRING, str, vp);
 }
 
 static JSBool
-array_reverse(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-              jsval *rval)
+array_reverse(JSContext *cx, uintN argc, jsval *vp)
 {
     jsuint len, half, i;
     JSBool hole, hole2;
     jsval *tmproot, *tmproot2;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     if (!js_GetLengthProperty(cx, obj, &len))
         return JS_FALSE;
@@ -801,7 +1442,7 @@ array_reverse(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
             return JS_FALSE;
         }
     }
-    *rval = OBJECT_TO_JSVAL(obj);
+    *vp = OBJECT_TO_JSVAL(obj);
     return JS_TRUE;
 }
 
@@ -975,6 +1616,22 @@ sort_compare(void *arg, const void *a, const void *b, int *result)
     } else {
         jsdouble cmp;
         jsval argv[2];
+        JSObject *funobj;
+
+        /*
+         * Sort is a fast native without a frame of its own, so js_Invoke
+         * would find fval among the caller's operands and decompile only
+         * it.  Report a non-callable fval from here, off the stack, so the
+         * message names the whole sort call as it did before.
+         */
+        funobj = JSVAL_TO_OBJECT(fval);
+        if (!VALUE_IS_FUNCTION(cx, fval) &&
+            !((funobj->map->ops == &js_ObjectOps)
+              ? OBJ_GET_CLASS(cx, funobj)->call
+              : funobj->map->ops->call)) {
+            js_ReportIsNotFunction(cx, &fval, 0);
+            return JS_FALSE;
+        }
 
         argv[0] = av;
         argv[1] = bv;
@@ -1012,13 +1669,18 @@ sort_compare_strings(void *arg, const void *a, const void *b, int *result)
 }
 
 static JSBool
-array_sort(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+array_sort(JSContext *cx, uintN argc, jsval *vp)
 {
     jsval fval, *vec, *pivotroot;
     CompareArgs ca;
     jsuint len, newlen, i, undefs;
     JSTempValueRooter tvr;
     JSBool hole, ok;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     /*
      * Optimize the default compare function case if all of obj's elements
@@ -1042,7 +1704,7 @@ array_sort(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     if (!js_GetLengthProperty(cx, obj, &len))
         return JS_FALSE;
     if (len == 0) {
-        *rval = OBJECT_TO_JSVAL(obj);
+        *vp = OBJECT_TO_JSVAL(obj);
         return JS_TRUE;
     }
 
@@ -1102,6 +1764,13 @@ array_sort(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         /* We know JSVAL_IS_STRING yields 0 or 1, so avoid a branch via &=. */
         all_strings &= JSVAL_IS_STRING(vec[newlen]);
 
+        /* sort_compare_strings has no cx to flatten ropes with. */
+        if (all_strings &&
+            !JSSTRING_FLATTEN(cx, JSVAL_TO_STRING(vec[newlen]))) {
+            ok = JS_FALSE;
+            goto out;
+        }
+
         ++newlen;
     }
 
@@ -1138,7 +1807,7 @@ array_sort(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         if (!DeleteArrayElement(cx, obj, --len))
             return JS_FALSE;
     }
-    *rval = OBJECT_TO_JSVAL(obj);
+    *vp = OBJECT_TO_JSVAL(obj);
     return JS_TRUE;
 }
 
@@ -1146,9 +1815,27 @@ array_sort(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
  * Perl-inspired push, pop, shift, unshift, and splice methods.
  */
 static JSBool
-array_push(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+array_push(JSContext *cx, uintN argc, jsval *vp)
 {
     jsuint length, newlength;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
+
+    if (OBJ_IS_DENSE_ARRAY(cx, obj) &&
+        (length = ARRAY_DENSE_LENGTH(obj)) == ARRAY_DENSE_EXTENT(obj) &&
+        argc <= (jsuint) JSVAL_INT_MAX - length) {
+        newlength = length + argc;
+        if (!EnsureDenseCapacity(cx, obj, newlength))
+            return JS_FALSE;
+        memcpy(&DENSE_ELEMENT(obj, length), argv, argc * sizeof(jsval));
+        obj->map->freeslot = JSSLOT_ARRAY_ELEMENTS + newlength;
+        *vp = INT_TO_JSVAL(newlength);
+        obj->slots[JSSLOT_ARRAY_LENGTH] = *vp;
+        return JS_TRUE;
+    }
 
     if (!js_GetLengthProperty(cx, obj, &length))
         return JS_FALSE;
@@ -1157,16 +1844,31 @@ array_push(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         return JS_FALSE;
 
     /* Per ECMA-262, return the new array length. */
-    if (!IndexToValue(cx, newlength, rval))
+    if (!IndexToValue(cx, newlength, vp))
         return JS_FALSE;
     return js_SetLengthProperty(cx, obj, newlength);
 }
 
 static JSBool
-array_pop(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+array_pop(JSContext *cx, uintN argc, jsval *vp)
 {
     jsuint index;
     JSBool hole;
+    JSObject *obj;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+
+    if (OBJ_IS_DENSE_ARRAY(cx, obj) &&
+        (index = ARRAY_DENSE_LENGTH(obj)) != 0 &&
+        index == ARRAY_DENSE_EXTENT(obj)) {
+        *vp = DENSE_ELEMENT(obj, index - 1);
+        if (*vp != JSVAL_HOLE) {
+            DeleteDenseElement(obj, index - 1);
+            obj->slots[JSSLOT_ARRAY_LENGTH] = INT_TO_JSVAL(index - 1);
+            return JS_TRUE;
+        }
+        *vp = JSVAL_VOID;
+    }
 
     if (!js_GetLengthProperty(cx, obj, &index))
         return JS_FALSE;
@@ -1174,29 +1876,49 @@ array_pop(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         index--;
 
         /* Get the to-be-deleted property's value into rval. */
-        if (!GetArrayElement(cx, obj, index, &hole, rval))
+        if (!GetArrayElement(cx, obj, index, &hole, vp))
             return JS_FALSE;
         if (!hole && !DeleteArrayElement(cx, obj, index))
             return JS_FALSE;
+    } else {
+        *vp = JSVAL_VOID;
     }
     return js_SetLengthProperty(cx, obj, index);
 }
 
 static JSBool
-array_shift(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+array_shift(JSContext *cx, uintN argc, jsval *vp)
 {
     jsuint length, i;
     JSBool hole;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
+
+    if (OBJ_IS_DENSE_ARRAY(cx, obj) &&
+        (length = ARRAY_DENSE_LENGTH(obj)) != 0 &&
+        length == ARRAY_DENSE_EXTENT(obj) &&
+        DENSE_ELEMENT(obj, 0) != JSVAL_HOLE) {
+        *vp = DENSE_ELEMENT(obj, 0);
+        length--;
+        memmove(&DENSE_ELEMENT(obj, 0), &DENSE_ELEMENT(obj, 1),
+                length * sizeof(jsval));
+        DeleteDenseElement(obj, length);
+        obj->slots[JSSLOT_ARRAY_LENGTH] = INT_TO_JSVAL(length);
+        return JS_TRUE;
+    }
 
     if (!js_GetLengthProperty(cx, obj, &length))
         return JS_FALSE;
     if (length == 0) {
-        *rval = JSVAL_VOID;
+        *vp = JSVAL_VOID;
     } else {
         length--;
 
         /* Get the to-be-deleted property's value into rval ASAP. */
-        if (!GetArrayElement(cx, obj, 0, &hole, rval))
+        if (!GetArrayElement(cx, obj, 0, &hole, vp))
             return JS_FALSE;
 
         /*
@@ -1217,12 +1939,33 @@ array_shift(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
 }
 
 static JSBool
-array_unshift(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-              jsval *rval)
+array_unshift(JSContext *cx, uintN argc, jsval *vp)
 {
     jsuint length, last;
-    jsval *vp;
+    jsval *tvp;
     JSBool hole;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
+
+    if (OBJ_IS_DENSE_ARRAY(cx, obj) &&
+        (length = ARRAY_DENSE_LENGTH(obj)) == ARRAY_DENSE_EXTENT(obj) &&
+        argc <= (jsuint) JSVAL_INT_MAX - length) {
+        if (argc > 0) {
+            if (!EnsureDenseCapacity(cx, obj, length + argc))
+                return JS_FALSE;
+            memmove(&DENSE_ELEMENT(obj, argc), &DENSE_ELEMENT(obj, 0),
+                    length * sizeof(jsval));
+            memcpy(&DENSE_ELEMENT(obj, 0), argv, argc * sizeof(jsval));
+            length += argc;
+            obj->map->freeslot = JSSLOT_ARRAY_ELEMENTS + length;
+            obj->slots[JSSLOT_ARRAY_LENGTH] = INT_TO_JSVAL(length);
+        }
+        *vp = INT_TO_JSVAL(length);
+        return JS_TRUE;
+    }
 
     if (!js_GetLengthProperty(cx, obj, &length))
         return JS_FALSE;
@@ -1230,11 +1973,12 @@ array_unshift(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
         /* Slide up the array to make room for argc at the bottom. */
         if (length > 0) {
             last = length;
-            vp = argv + argc;   /* local root */
+            tvp = argv + argc;   /* local root */
             do {
                 --last;
-                if (!GetArrayElement(cx, obj, last, &hole, vp) ||
-                    !SetOrDeleteArrayElement(cx, obj, last + argc, hole, *vp)) {
+                if (!GetArrayElement(cx, obj, last, &hole, tvp) ||
+                    !SetOrDeleteArrayElement(cx, obj, last + argc, hole,
+                                             *tvp)) {
                     return JS_FALSE;
                 }
             } while (last != 0);
@@ -1250,25 +1994,31 @@ array_unshift(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
     }
 
     /* Follow Perl by returning the new array length. */
-    return IndexToValue(cx, length, rval);
+    return IndexToValue(cx, length, vp);
 }
 
 static JSBool
-array_splice(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+array_splice(JSContext *cx, uintN argc, jsval *vp)
 {
-    jsval *vp;
+    jsval *tvp;
     jsuint length, begin, end, count, delta, last;
     jsdouble d;
     JSBool hole;
-    JSObject *obj2;
+    JSObject *obj, *obj2;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     /*
-     * Nothing to do if no args.  Otherwise point vp at our one explicit local
+     * Nothing to do if no args.  Otherwise point tvp at our one explicit local
      * root and get length.
      */
-    if (argc == 0)
+    if (argc == 0) {
+        *vp = JSVAL_VOID;
         return JS_TRUE;
-    vp = argv + argc;
+    }
+    tvp = argv + argc;
     if (!js_GetLengthProperty(cx, obj, &length))
         return JS_FALSE;
 
@@ -1316,16 +2066,16 @@ array_splice(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     obj2 = js_NewArrayObject(cx, 0, NULL);
     if (!obj2)
         return JS_FALSE;
-    *rval = OBJECT_TO_JSVAL(obj2);
+    *vp = OBJECT_TO_JSVAL(obj2);
 
     /* If there are elements to remove, put them into the return value. */
     if (count > 0) {
         for (last = begin; last < end; last++) {
-            if (!GetArrayElement(cx, obj, last, &hole, vp))
+            if (!GetArrayElement(cx, obj, last, &hole, tvp))
                 return JS_FALSE;
 
-            /* Copy *vp to new array unless it's a hole. */
-            if (!hole && !SetArrayElement(cx, obj2, last - begin, *vp))
+            /* Copy *tvp to new array unless it's a hole. */
+            if (!hole && !SetArrayElement(cx, obj2, last - begin, *tvp))
                 return JS_FALSE;
         }
 
@@ -1339,8 +2089,8 @@ array_splice(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         last = length;
         /* (uint) end could be 0, so can't use vanilla >= test */
         while (last-- > end) {
-            if (!GetArrayElement(cx, obj, last, &hole, vp) ||
-                !SetOrDeleteArrayElement(cx, obj, last + delta, hole, *vp)) {
+            if (!GetArrayElement(cx, obj, last, &hole, tvp) ||
+                !SetOrDeleteArrayElement(cx, obj, last + delta, hole, *tvp)) {
                 return JS_FALSE;
             }
         }
@@ -1348,8 +2098,8 @@ array_splice(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     } else if (argc < count) {
         delta = count - (jsuint)argc;
         for (last = end; last < length; last++) {
-            if (!GetArrayElement(cx, obj, last, &hole, vp) ||
-                !SetOrDeleteArrayElement(cx, obj, last - delta, hole, *vp)) {
+            if (!GetArrayElement(cx, obj, last, &hole, tvp) ||
+                !SetOrDeleteArrayElement(cx, obj, last - delta, hole, *tvp)) {
                 return JS_FALSE;
             }
         }
@@ -1368,26 +2118,28 @@ array_splice(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
  * Python-esque sequence operations.
  */
 static JSBool
-array_concat(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+array_concat(JSContext *cx, uintN argc, jsval *vp)
 {
-    jsval *vp, v;
+    jsval *argv, *tvp, v;
     JSObject *nobj, *aobj;
     jsuint length, alength, slot;
     uintN i;
     JSBool hole;
 
+    argv = JS_ARGV(cx, vp);
+
     /* Hoist the explicit local root address computation. */
-    vp = argv + argc;
+    tvp = argv + argc;
 
     /* Treat obj as the first argument; see ECMA 15.4.4.4. */
     --argv;
-    JS_ASSERT(obj == JSVAL_TO_OBJECT(argv[0]));
+    JS_ASSERT(JSVAL_IS_OBJECT(argv[0]));
 
     /* Create a new Array object and store it in the rval local root. */
     nobj = js_NewArrayObject(cx, 0, NULL);
     if (!nobj)
         return JS_FALSE;
-    *rval = OBJECT_TO_JSVAL(nobj);
+    *vp = OBJECT_TO_JSVAL(nobj);
 
     /* Loop over [0, argc] to concat args into nobj, expanding all Arrays. */
     length = 0;
@@ -1395,25 +2147,43 @@ array_concat(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         v = argv[i];
         if (JSVAL_IS_OBJECT(v)) {
             aobj = JSVAL_TO_OBJECT(v);
+            if (aobj && OBJ_IS_DENSE_ARRAY(cx, aobj) &&
+                OBJ_IS_DENSE_ARRAY(cx, nobj) &&
+                length == ARRAY_DENSE_LENGTH(nobj) &&
+                length == ARRAY_DENSE_EXTENT(nobj) &&
+                ARRAY_DENSE_LENGTH(aobj) <= (jsuint) JSVAL_INT_MAX - length) {
+                /* Append aobj's vector, holes and all, to nobj's. */
+                alength = ARRAY_DENSE_EXTENT(aobj);
+                if (!EnsureDenseCapacity(cx, nobj, length + alength))
+                    return JS_FALSE;
+                memcpy(&DENSE_ELEMENT(nobj, length), &DENSE_ELEMENT(aobj, 0),
+                       alength * sizeof(jsval));
+                nobj->map->freeslot = JSSLOT_ARRAY_ELEMENTS + length + alength;
+                length += ARRAY_DENSE_LENGTH(aobj);
+                nobj->slots[JSSLOT_ARRAY_LENGTH] = INT_TO_JSVAL(length);
+                continue;
+            }
             if (aobj && OBJ_GET_CLASS(cx, aobj) == &js_ArrayClass) {
                 if (!OBJ_GET_PROPERTY(cx, aobj,
                                       ATOM_TO_JSID(cx->runtime->atomState
                                                    .lengthAtom),
-                                      vp)) {
+                                      tvp)) {
                     return JS_FALSE;
                 }
-                if (!ValueIsLength(cx, *vp, &alength))
+                if (!ValueIsLength(cx, *tvp, &alength))
                     return JS_FALSE;
                 for (slot = 0; slot < alength; slot++) {
-                    if (!GetArrayElement(cx, aobj, slot, &hole, vp))
+                    if (!GetArrayElement(cx, aobj, slot, &hole, tvp))
                         return JS_FALSE;
 
                     /*
                      * Per ECMA 262, 15.4.4.4, step 9, ignore non-existent
                      * properties.
                      */
-                    if (!hole && !SetArrayElement(cx, nobj, length + slot, *vp))
+                    if (!hole &&
+                        !SetArrayElement(cx, nobj, length + slot, *tvp)) {
                         return JS_FALSE;
+                    }
                 }
                 length += alength;
                 continue;
@@ -1429,22 +2199,20 @@ array_concat(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
 }
 
 static JSBool
-array_slice(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+array_slice(JSContext *cx, uintN argc, jsval *vp)
 {
-    jsval *vp;
-    JSObject *nobj;
+    jsval *tvp;
+    JSObject *obj, *nobj;
     jsuint length, begin, end, slot;
     jsdouble d;
     JSBool hole;
+    jsval *argv;
 
-    /* Hoist the explicit local root address computation. */
-    vp = argv + argc;
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
-    /* Create a new Array object and store it in the rval local root. */
-    nobj = js_NewArrayObject(cx, 0, NULL);
-    if (!nobj)
-        return JS_FALSE;
-    *rval = OBJECT_TO_JSVAL(nobj);
+    /* Hoist the explicit local root address computation. */
+    tvp = argv + argc;
 
     if (!js_GetLengthProperty(cx, obj, &length))
         return JS_FALSE;
@@ -1482,10 +2250,25 @@ array_slice(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     if (begin > end)
         begin = end;
 
+    /* Copy the slice of a dense array's vector, holes and all. */
+    if (OBJ_IS_DENSE_ARRAY(cx, obj) && end <= ARRAY_DENSE_EXTENT(obj)) {
+        nobj = js_NewArrayObject(cx, end - begin, &DENSE_ELEMENT(obj, begin));
+        if (!nobj)
+            return JS_FALSE;
+        *vp = OBJECT_TO_JSVAL(nobj);
+        return JS_TRUE;
+    }
+
+    /* Create a new Array object and store it in the rval local root. */
+    nobj = js_NewArrayObject(cx, 0, NULL);
+    if (!nobj)
+        return JS_FALSE;
+    *vp = OBJECT_TO_JSVAL(nobj);
+
     for (slot = begin; slot < end; slot++) {
-        if (!GetArrayElement(cx, obj, slot, &hole, vp))
+        if (!GetArrayElement(cx, obj, slot, &hole, tvp))
             return JS_FALSE;
-        if (!hole && !SetArrayElement(cx, nobj, slot - begin, *vp))
+        if (!hole && !SetArrayElement(cx, nobj, slot - begin, *tvp))
             return JS_FALSE;
     }
     return js_SetLengthProperty(cx, nobj, end - begin);
@@ -1494,13 +2277,16 @@ array_slice(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
 #if JS_HAS_ARRAY_EXTRAS
 
 static JSBool
-array_indexOfHelper(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-                    jsval *rval, JSBool isLast)
+array_indexOfHelper(JSContext *cx, uintN argc, jsval *vp, JSBool isLast)
 {
+    JSObject *obj;
+    jsval *argv;
     jsuint length, i, stop;
     jsint direction;
     JSBool hole;
 
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
     if (!js_GetLengthProperty(cx, obj, &length))
         return JS_FALSE;
     if (length == 0)
@@ -1541,32 +2327,35 @@ array_indexOfHelper(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
     }
 
     for (;;) {
-        if (!GetArrayElement(cx, obj, (jsuint)i, &hole, rval))
+        if (!GetArrayElement(cx, obj, (jsuint)i, &hole, vp))
+            return JS_FALSE;
+        if (!hole && JSVAL_IS_STRING(*vp) && JSVAL_IS_STRING(argv[0]) &&
+            (!JSSTRING_FLATTEN(cx, JSVAL_TO_STRING(*vp)) ||
+             !JSSTRING_FLATTEN(cx, JSVAL_TO_STRING(argv[0])))) {
             return JS_FALSE;
-        if (!hole && js_StrictlyEqual(*rval, argv[0]))
-            return js_NewNumberValue(cx, i, rval);
+        }
+        if (!hole && js_StrictlyEqual(*vp, argv[0]))
+            return js_NewNumberValue(cx, i, vp);
         if (i == stop)
             goto not_found;
         i += direction;
     }
 
   not_found:
-    *rval = INT_TO_JSVAL(-1);
+    *vp = INT_TO_JSVAL(-1);
     return JS_TRUE;
 }
 
 static JSBool
-array_indexOf(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-              jsval *rval)
+array_indexOf(JSContext *cx, uintN argc, jsval *vp)
 {
-    return array_indexOfHelper(cx, obj, argc, argv, rval, JS_FALSE);
+    return array_indexOfHelper(cx, argc, vp, JS_FALSE);
 }
 
 static JSBool
-array_lastIndexOf(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-                  jsval *rval)
+array_lastIndexOf(JSContext *cx, uintN argc, jsval *vp)
 {
-    return array_indexOfHelper(cx, obj, argc, argv, rval, JS_TRUE);
+    return array_indexOfHelper(cx, argc, vp, JS_TRUE);
 }
 
 /* Order is important; extras that use a caller's predicate must follow MAP. */
@@ -1579,18 +2368,20 @@ typedef enum ArrayExtraMode {
 } ArrayExtraMode;
 
 static JSBool
-array_extra(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval,
-            ArrayExtraMode mode)
+array_extra(JSContext *cx, uintN argc, jsval *vp, ArrayExtraMode mode)
 {
-    jsval *vp, *sp, *origsp, *oldsp;
+    jsval *argv, *tvp, *sp, *origsp, *oldsp;
     jsuint length, newlen, i;
-    JSObject *callable, *thisp, *newarr;
+    JSObject *obj, *callable, *thisp, *newarr;
     void *mark;
     JSStackFrame *fp;
     JSBool ok, cond, hole;
 
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
+
     /* Hoist the explicit local root address computation. */
-    vp = argv + argc;
+    tvp = argv + argc;
 
     if (!js_GetLengthProperty(cx, obj, &length))
         return JS_FALSE;
@@ -1619,15 +2410,16 @@ array_extra(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval,
         newarr = js_NewArrayObject(cx, newlen, NULL);
         if (!newarr)
             return JS_FALSE;
-        *rval = OBJECT_TO_JSVAL(newarr);
+        *vp = OBJECT_TO_JSVAL(newarr);
         break;
       case SOME:
-        *rval = JSVAL_FALSE;
+        *vp = JSVAL_FALSE;
         break;
       case EVERY:
-        *rval = JSVAL_TRUE;
+        *vp = JSVAL_TRUE;
         break;
       case FOREACH:
+        *vp = JSVAL_VOID;
         break;
     }
 
@@ -1652,7 +2444,7 @@ array_extra(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval,
     oldsp = fp->sp;
 
     for (i = 0; i < length; i++) {
-        ok = GetArrayElement(cx, obj, i, &hole, vp);
+        ok = GetArrayElement(cx, obj, i, &hole, tvp);
         if (!ok)
             break;
         if (hole)
@@ -1666,25 +2458,25 @@ array_extra(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval,
         sp = origsp;
         *sp++ = OBJECT_TO_JSVAL(callable);
         *sp++ = OBJECT_TO_JSVAL(thisp);
-        *sp++ = *vp;
+        *sp++ = *tvp;
         *sp++ = INT_TO_JSVAL(i);
         *sp++ = OBJECT_TO_JSVAL(obj);
 
         /* Do the call. */
         fp->sp = sp;
         ok = js_Invoke(cx, 3, JSINVOKE_INTERNAL);
-        vp[1] = fp->sp[-1];
+        tvp[1] = fp->sp[-1];
         fp->sp = oldsp;
         if (!ok)
             break;
 
         if (mode > MAP) {
-            if (vp[1] == JSVAL_NULL) {
+            if (tvp[1] == JSVAL_NULL) {
                 cond = JS_FALSE;
-            } else if (JSVAL_IS_BOOLEAN(vp[1])) {
-                cond = JSVAL_TO_BOOLEAN(vp[1]);
+            } else if (JSVAL_IS_BOOLEAN(tvp[1])) {
+                cond = JSVAL_TO_BOOLEAN(tvp[1]);
             } else {
-                ok = js_ValueToBoolean(cx, vp[1], &cond);
+                ok = js_ValueToBoolean(cx, tvp[1], &cond);
                 if (!ok)
                     goto out;
             }
@@ -1694,7 +2486,7 @@ array_extra(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval,
           case FOREACH:
             break;
           case MAP:
-            ok = SetArrayElement(cx, newarr, i, vp[1]);
+            ok = SetArrayElement(cx, newarr, i, tvp[1]);
             if (!ok)
                 goto out;
             break;
@@ -1702,19 +2494,19 @@ array_extra(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval,
             if (!cond)
                 break;
             /* Filter passed *vp, push as result. */
-            ok = SetArrayElement(cx, newarr, newlen++, *vp);
+            ok = SetArrayElement(cx, newarr, newlen++, *tvp);
             if (!ok)
                 goto out;
             break;
           case SOME:
             if (cond) {
-                *rval = JSVAL_TRUE;
+                *vp = JSVAL_TRUE;
                 goto out;
             }
             break;
           case EVERY:
             if (!cond) {
-                *rval = JSVAL_FALSE;
+                *vp = JSVAL_FALSE;
                 goto out;
             }
             break;
@@ -1729,70 +2521,65 @@ array_extra(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval,
 }
 
 static JSBool
-array_forEach(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-              jsval *rval)
+array_forEach(JSContext *cx, uintN argc, jsval *vp)
 {
-    return array_extra(cx, obj, argc, argv, rval, FOREACH);
+    return array_extra(cx, argc, vp, FOREACH);
 }
 
 static JSBool
-array_map(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-          jsval *rval)
+array_map(JSContext *cx, uintN argc, jsval *vp)
 {
-    return array_extra(cx, obj, argc, argv, rval, MAP);
+    return array_extra(cx, argc, vp, MAP);
 }
 
 static JSBool
-array_filter(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-             jsval *rval)
+array_filter(JSContext *cx, uintN argc, jsval *vp)
 {
-    return array_extra(cx, obj, argc, argv, rval, FILTER);
+    return array_extra(cx, argc, vp, FILTER);
 }
 
 static JSBool
-array_some(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-           jsval *rval)
+array_some(JSContext *cx, uintN argc, jsval *vp)
 {
-    return array_extra(cx, obj, argc, argv, rval, SOME);
+    return array_extra(cx, argc, vp, SOME);
 }
 
 static JSBool
-array_every(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-           jsval *rval)
+array_every(JSContext *cx, uintN argc, jsval *vp)
 {
-    return array_extra(cx, obj, argc, argv, rval, EVERY);
+    return array_extra(cx, argc, vp, EVERY);
 }
 #endif
 
 static JSFunctionSpec array_methods[] = {
 #if JS_HAS_TOSOURCE
-    {js_toSource_str,       array_toSource,         0,0,0},
+    JS_FN(js_toSource_str,      array_toSource,       0,0,0),
 #endif
-    {js_toString_str,       array_toString,         0,0,0},
-    {js_toLocaleString_str, array_toLocaleString,   0,0,0},
+    JS_FN(js_toString_str,      array_toString,       0,0,0),
+    JS_FN(js_toLocaleString_str, array_toLocaleString, 0,0,0),
 
     /* Perl-ish methods. */
-    {"join",                array_join,             1,JSFUN_GENERIC_NATIVE,0},
-    {"reverse",             array_reverse,          0,JSFUN_GENERIC_NATIVE,2},
-    {"sort",                array_sort,             1,JSFUN_GENERIC_NATIVE,2},
-    {"push",                array_push,             1,JSFUN_GENERIC_NATIVE,0},
-    {"pop",                 array_pop,              0,JSFUN_GENERIC_NATIVE,0},
-    {"shift",               array_shift,            0,JSFUN_GENERIC_NATIVE,1},
-    {"unshift",             array_unshift,          1,JSFUN_GENERIC_NATIVE,1},
-    {"splice",              array_splice,           2,JSFUN_GENERIC_NATIVE,1},
+    JS_FN("join",               array_join,           1,JSFUN_GENERIC_NATIVE,0),
+    JS_FN("reverse",            array_reverse,        0,JSFUN_GENERIC_NATIVE,2),
+    JS_FN("sort",               array_sort,           1,JSFUN_GENERIC_NATIVE,2),
+    JS_FN("push",               array_push,           1,JSFUN_GENERIC_NATIVE,0),
+    JS_FN("pop",                array_pop,            0,JSFUN_GENERIC_NATIVE,0),
+    JS_FN("shift",              array_shift,          0,JSFUN_GENERIC_NATIVE,1),
+    JS_FN("unshift",            array_unshift,        1,JSFUN_GENERIC_NATIVE,1),
+    JS_FN("splice",             array_splice,         2,JSFUN_GENERIC_NATIVE,1),
 
     /* Python-esque sequence methods. */
-    {"concat",              array_concat,           1,JSFUN_GENERIC_NATIVE,1},
-    {"slice",               array_slice,            2,JSFUN_GENERIC_NATIVE,1},
+    JS_FN("concat",             array_concat,         1,JSFUN_GENERIC_NATIVE,1),
+    JS_FN("slice",              array_slice,          2,JSFUN_GENERIC_NATIVE,1),
 
 #if JS_HAS_ARRAY_EXTRAS
-    {"indexOf",             array_indexOf,          1,JSFUN_GENERIC_NATIVE,0},
-    {"lastIndexOf",         array_lastIndexOf,      1,JSFUN_GENERIC_NATIVE,0},
-    {"forEach",             array_forEach,          1,JSFUN_GENERIC_NATIVE,2},
-    {"map",                 array_map,              1,JSFUN_GENERIC_NATIVE,2},
-    {"filter",              array_filter,           1,JSFUN_GENERIC_NATIVE,2},
-    {"some",                array_some,             1,JSFUN_GENERIC_NATIVE,2},
-    {"every",               array_every,            1,JSFUN_GENERIC_NATIVE,2},
+    JS_FN("indexOf",            array_indexOf,        1,JSFUN_GENERIC_NATIVE,0),
+    JS_FN("lastIndexOf",        array_lastIndexOf,    1,JSFUN_GENERIC_NATIVE,0),
+    JS_FN("forEach",            array_forEach,        1,JSFUN_GENERIC_NATIVE,2),
+    JS_FN("map",                array_map,            1,JSFUN_GENERIC_NATIVE,2),
+    JS_FN("filter",             array_filter,         1,JSFUN_GENERIC_NATIVE,2),
+    JS_FN("some",               array_some,           1,JSFUN_GENERIC_NATIVE,2),
+    JS_FN("every",              array_every,          1,JSFUN_GENERIC_NATIVE,2),
 #endif
 
     {0,0,0,0,0}
@@ -1829,6 +2616,16 @@ Array(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     return InitArrayObject(cx, obj, length, vector);
 }
 
+JSBool
+js_ArrayCompPush(JSContext *cx, JSObject *obj, jsval v)
+{
+    jsuint length;
+
+    if (!js_GetLengthProperty(cx, obj, &length))
+        return JS_FALSE;
+    return SetArrayElement(cx, obj, length, v);
+}
+
 JSObject *
 js_InitArrayClass(JSContext *cx, JSObject *obj)
 {
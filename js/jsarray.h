@@ -44,6 +44,7 @@
  */
 #include "jsprvtd.h"
 #include "jspubtd.h"
+#include "jsobj.h"
 
 JS_BEGIN_EXTERN_C
 
@@ -55,6 +56,53 @@ js_IdIsIndex(jsval id, jsuint *indexp);
 
 extern JSClass js_ArrayClass;
 
+/*
+ * Arrays start out dense: their elements live in obj->slots from
+ * JSSLOT_ARRAY_ELEMENTS on, with JSVAL_HOLE marking missing ones, and they
+ * use js_ArrayObjectOps with a map of their own whose freeslot ends the part
+ * of the vector in use.  The length is kept as an int jsval in the class's
+ * reserved slot, indexes between the end of the vector and the length are
+ * holes too.
+ *
+ * An array becomes sparse (a native object using js_SlowArrayObjectOps, with
+ * an id per element) when it gets a named property, a getter, a setter or
+ * non-default attributes, or an index too far past the end of the vector.
+ * Dense arrays aren't locked, so if thread-safe one also goes sparse as soon
+ * as a context other than the one that created it uses it.  That context
+ * first waits, like ClaimScope in jslock.c, until the owner is outside of
+ * its request or runs on the same thread, and takes the array over.
+ */
+#define JSSLOT_ARRAY_LENGTH     JSSLOT_PRIVATE
+#define JSSLOT_ARRAY_ELEMENTS   (JSSLOT_PRIVATE + 1)
+
+typedef struct JSArrayMap {
+    JSObjectMap map;
+#ifdef JS_THREADSAFE
+    JSContext   *ownercx;
+#endif
+} JSArrayMap;
+
+extern JSObjectOps js_ArrayObjectOps;
+extern JSObjectOps js_SlowArrayObjectOps;
+
+#ifdef JS_THREADSAFE
+#define OBJ_IS_DENSE_ARRAY(cx,obj)                                            \
+    ((obj)->map->ops == &js_ArrayObjectOps &&                                 \
+     ((JSArrayMap *) (obj)->map)->ownercx == (cx))
+#else
+#define OBJ_IS_DENSE_ARRAY(cx,obj)  ((obj)->map->ops == &js_ArrayObjectOps)
+#endif
+#define ARRAY_DENSE_LENGTH(obj)                                               \
+    ((jsuint) JSVAL_TO_INT((obj)->slots[JSSLOT_ARRAY_LENGTH]))
+#define ARRAY_DENSE_EXTENT(obj)                                               \
+    ((jsuint) ((obj)->map->freeslot - JSSLOT_ARRAY_ELEMENTS))
+
+extern JSBool
+js_MakeArraySlow(JSContext *cx, JSObject *obj);
+
+extern JSBool
+js_PrototypeHasIndexedProperties(JSContext *cx, JSObject *obj);
+
 extern JSObject *
 js_InitArrayClass(JSContext *cx, JSObject *obj);
 
@@ -70,6 +118,10 @@ js_SetLengthProperty(JSContext *cx, JSObject *obj, jsuint length);
 extern JSBool
 js_HasLengthProperty(JSContext *cx, JSObject *obj, jsuint *lengthp);
 
+/* Append v to obj, an array being built by an array comprehension. */
+extern JSBool
+js_ArrayCompPush(JSContext *cx, JSObject *obj, jsval v);
+
 /*
  * Test whether an object is "array-like".  Currently this means whether obj
  * is an Array or an arguments object.  We would like an API, and probably a
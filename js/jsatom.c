@@ -642,6 +642,10 @@ js_AtomizeString(JSContext *cx, JSString *str, uintN flags)
     JSHashEntry *he, **hep;
     JSAtom *atom;
 
+    /* Flatten now so out of memory is reported rather than hashed over. */
+    if (!JSSTRING_FLATTEN(cx, str))
+        return NULL;
+
     keyHash = js_HashString(str);
     if (flags & ATOM_HIDDEN)
         keyHash ^= HIDDEN_ATOM_SUBSPACE_KEYHASH;
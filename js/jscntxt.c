@@ -143,11 +143,15 @@ js_SetContextThread(JSContext *cx)
     }
 
     /*
-     * Clear gcFreeLists on each transition from 0 to 1 context active on the
-     * current thread. See bug 351602.
+     * Clear gcFreeLists, gcSpans and the property inline caches on each
+     * transition from 0 to 1 context active on the current thread, as a GC
+     * may have run since. See bug 351602.
      */
-    if (JS_CLIST_IS_EMPTY(&thread->contextList))
+    if (JS_CLIST_IS_EMPTY(&thread->contextList)) {
         memset(thread->gcFreeLists, 0, sizeof(thread->gcFreeLists));
+        memset(thread->gcSpans, 0, sizeof(thread->gcSpans));
+        js_FlushPropertyIC(&thread->propertyIC);
+    }
 
     cx->thread = thread;
     JS_REMOVE_LINK(&cx->threadLinks);
@@ -107,6 +107,9 @@ struct JSThread {
     /* Thread-local gc free lists array. */
     JSGCThing           *gcFreeLists[GC_NUM_FREELISTS];
 
+    /* Thread-local bump allocation spans, one per free list. */
+    JSGCSpan            gcSpans[GC_NUM_FREELISTS];
+
     /*
      * Thread-local version of JSRuntime.gcMallocBytes to avoid taking
      * locks on each JS_malloc.
@@ -126,9 +129,13 @@ struct JSThread {
      * among two or more contexts running script in one thread.
      */
     JSGSNCache          gsnCache;
+
+    /* Inline caches of the interpreter's property access sites. */
+    JSPropertyIC        propertyIC;
 };
 
 #define JS_GSN_CACHE(cx) ((cx)->thread->gsnCache)
+#define JS_PROPERTY_IC(cx) ((cx)->thread->propertyIC)
 
 extern void JS_DLL_CALLBACK
 js_ThreadDestructorCB(void *ptr);
@@ -177,6 +184,9 @@ struct JSRuntime {
 
     /* Garbage collector state, used by jsgc.c. */
     JSGCArenaList       gcArenaList[GC_NUM_FREELISTS];
+    JSGCChunk           *gcChunkList;
+    JSGCChunk           *gcEmptyChunks;
+    uint32              gcDecommitDelay;
     JSDHashTable        gcRootsHash;
     JSDHashTable        *gcLocksHash;
     jsrefcount          gcKeepAtoms;
@@ -184,6 +194,18 @@ struct JSRuntime {
     uint32              gcLastBytes;
     uint32              gcMaxBytes;
     uint32              gcMaxMallocBytes;
+
+    /*
+     * GC once gcBytes reaches gcTriggerBytes or gcMallocBytes reaches
+     * gcMallocTrigger.  Both are set after every GC from how much survived
+     * it and gcTriggerFactor, see SetGCTriggers in jsgc.c.  gcMallocLive
+     * estimates how many of the JS_malloc bytes counted so far are still in
+     * use.
+     */
+    uint32              gcTriggerBytes;
+    uint32              gcMallocTrigger;
+    uint32              gcMallocLive;
+    uint32              gcTriggerFactor;
     uint32              gcLevel;
     uint32              gcNumber;
 
@@ -199,6 +221,20 @@ struct JSRuntime {
 
     JSGCCallback        gcCallback;
     uint32              gcMallocBytes;
+
+    /*
+     * Bytes of GC things handed out since the last GC, counted when the
+     * allocator takes rt->gcLock, and how long the last GC took in
+     * microseconds.  See JS_WantIdleGC.
+     */
+    uint32              gcAllocBytes;
+    uint32              gcLastDuration;
+    JSGCHistory         gcHistory;
+
+    /* Memory released during the sweep, see js_FreeLater. */
+    JSFreeLaterChunk    *gcFreeLater;
+
+    JSGCMarkStack       gcMarkStack;
     JSGCArena           *gcUnscannedArenaStackTop;
 #ifdef DEBUG
     size_t              gcUnscannedBagSize;
@@ -331,6 +367,23 @@ struct JSRuntime {
     PRCondVar           *scopeSharingDone;
     JSScope             *scopeSharingTodo;
 
+    /*
+     * Contexts waiting on scopeSharingDone for another context's request to
+     * end so that they can make one of its dense arrays slow, see jsarray.c.
+     */
+    uint32              arrayClaimWaiters;
+
+    /*
+     * The GC helper thread frees the batch of memory in gcHelperBatch that
+     * the last GC released, it waits on gcHelperWakeup under gcLock.  It is
+     * only used when gcHelperThreads is not 0.
+     */
+    struct PRThread     *gcHelperThread;
+    PRCondVar           *gcHelperWakeup;
+    JSFreeLaterChunk    *gcHelperBatch;
+    JSBool              gcHelperShutdown;
+    uint32              gcHelperThreads;
+
 /*
  * Magic terminator for the rt->scopeSharingTodo linked list, threaded through
  * scope->u.link.  This hack allows us to test whether a scope is on the list
@@ -409,6 +462,11 @@ struct JSRuntime {
     JSGSNCache          gsnCache;
 
 #define JS_GSN_CACHE(cx) ((cx)->runtime->gsnCache)
+
+    /* Inline caches of the interpreter's property access sites. */
+    JSPropertyIC        propertyIC;
+
+#define JS_PROPERTY_IC(cx) ((cx)->runtime->propertyIC)
 #endif
 
 #ifdef DEBUG
@@ -6402,6 +6402,123 @@ js_EmitTree(JSContext *cx, JSCodeGenerator *cg, JSParseNode *pn)
     return ok;
 }
 
+void
+js_FuseBytecode(JSScript *script)
+{
+    jsbytecode *pc, *end, *pc2;
+    JSOp op, op2, fused;
+    const JSCodeSpec *cs;
+    uint32 type;
+    ptrdiff_t len, jmplen;
+    jsint low, high;
+    jsatomid npairs;
+
+    end = script->code + script->length;
+    for (pc = script->code; pc < end; pc += len) {
+        op = (JSOp) *pc;
+        JS_ASSERT(op != JSOP_TRAP && !JSOP_IS_FUSED(op));
+        cs = &js_CodeSpec[op];
+        len = cs->length;
+        type = cs->format & JOF_TYPEMASK;
+        switch (type) {
+          case JOF_TABLESWITCH:
+          case JOF_TABLESWITCHX:
+            jmplen = (type == JOF_TABLESWITCH) ? JUMP_OFFSET_LEN
+                                               : JUMPX_OFFSET_LEN;
+            pc2 = pc + jmplen;
+            low = GET_JUMP_OFFSET(pc2);
+            pc2 += JUMP_OFFSET_LEN;
+            high = GET_JUMP_OFFSET(pc2);
+            pc2 += JUMP_OFFSET_LEN;
+            len = 1 + PTRDIFF(pc2, pc, jsbytecode) + (high - low + 1) * jmplen;
+            continue;
+
+          case JOF_LOOKUPSWITCH:
+          case JOF_LOOKUPSWITCHX:
+            jmplen = (type == JOF_LOOKUPSWITCH) ? JUMP_OFFSET_LEN
+                                                : JUMPX_OFFSET_LEN;
+            pc2 = pc + jmplen;
+            npairs = GET_ATOM_INDEX(pc2);
+            pc2 += ATOM_INDEX_LEN;
+            len = 1 + PTRDIFF(pc2, pc, jsbytecode) +
+                  npairs * (ATOM_INDEX_LEN + jmplen);
+            continue;
+
+          case JOF_LITOPX:
+            /* Don't fuse the op following the 24-bit literal index. */
+            len += js_CodeSpec[pc[1 + LITERAL_INDEX_LEN]].length -
+                   (1 + ATOM_INDEX_LEN);
+            continue;
+        }
+
+        if (pc + len >= end)
+            break;
+        op2 = (JSOp) pc[len];
+        fused = JSOP_NOP;
+        switch (op) {
+          case JSOP_SETVAR:
+            if (op2 == JSOP_POP)
+                fused = JSOP_SETVARPOP;
+            break;
+          case JSOP_INCVAR:
+            if (op2 == JSOP_POP)
+                fused = JSOP_INCVARPOP;
+            break;
+          case JSOP_DECVAR:
+            if (op2 == JSOP_POP)
+                fused = JSOP_DECVARPOP;
+            break;
+          case JSOP_VARINC:
+            if (op2 == JSOP_POP)
+                fused = JSOP_VARINCPOP;
+            break;
+          case JSOP_VARDEC:
+            if (op2 == JSOP_POP)
+                fused = JSOP_VARDECPOP;
+            break;
+          case JSOP_EQ:
+          case JSOP_NE:
+          case JSOP_LT:
+          case JSOP_LE:
+          case JSOP_GT:
+          case JSOP_GE:
+            if (op2 == JSOP_IFEQ || op2 == JSOP_IFNE)
+                fused = (JSOp) (JSOP_EQBRANCH + (op - JSOP_EQ));
+            break;
+          case JSOP_NEW_EQ:
+          case JSOP_NEW_NE:
+            if (op2 == JSOP_IFEQ || op2 == JSOP_IFNE)
+                fused = (JSOp) (JSOP_NEW_EQBRANCH + (op - JSOP_NEW_EQ));
+            break;
+          case JSOP_GETARG:
+            if (op2 == JSOP_GETPROP)
+                fused = JSOP_GETARGPROP;
+            break;
+          case JSOP_GETVAR:
+            if (op2 == JSOP_GETPROP)
+                fused = JSOP_GETVARPROP;
+            break;
+          case JSOP_THIS:
+            if (op2 == JSOP_GETPROP)
+                fused = JSOP_GETTHISPROP;
+            break;
+          case JSOP_NAME:
+            if (op2 == JSOP_PUSHOBJ)
+                fused = JSOP_CALLNAME;
+            break;
+          case JSOP_GETMETHOD:
+            if (op2 == JSOP_PUSHOBJ)
+                fused = JSOP_CALLMETHOD;
+            break;
+          default:;
+        }
+        if (fused != JSOP_NOP) {
+            JS_ASSERT(js_UnfusedOp[fused - JSOP_FUSED_FIRST] == op);
+            *pc = (jsbytecode) fused;
+        }
+    }
+}
+
 /* XXX get rid of offsetBias, it's used only by SRC_FOR and SRC_DECL */
 JS_FRIEND_DATA(JSSrcNoteSpec) js_SrcNoteSpec[] = {
     {"null",            0,      0,      0},
@@ -492,6 +492,16 @@ extern JSBool
 js_EmitFunctionBody(JSContext *cx, JSCodeGenerator *cg, JSParseNode *body,
                     JSFunction *fun);
 
+/*
+ * Peephole pass over the finished bytecode of script, overlaying the first op
+ * of each hot pair of ops (a variable store and a pop, a comparison and the
+ * branch testing it, a variable or this and a property get, a name or method
+ * get and the JSOP_PUSHOBJ for the call) with a superinstruction.  The ops
+ * stay in place, so jump offsets and source notes are not changed.
+ */
+extern void
+js_FuseBytecode(JSScript *script);
+
 /*
  * Source notes generated along with bytecode for decompiling and debugging.
  * A source note is a uint8 with 5 bits of type and 3 of offset from the pc of
@@ -848,6 +848,9 @@ exn_toString(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
                                  : cx->runtime->emptyString;
 
     if (JSSTRING_LENGTH(message) != 0) {
+        if (!JSSTRING_FLATTEN(cx, name) || !JSSTRING_FLATTEN(cx, message))
+            return JS_FALSE;
+
         name_length = JSSTRING_LENGTH(name);
         message_length = JSSTRING_LENGTH(message);
         length = (name_length ? name_length + 2 : 0) + message_length;
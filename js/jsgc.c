@@ -51,6 +51,10 @@
 #include "jsstddef.h"
 #include <stdlib.h>     /* for free */
 #include <string.h>     /* for memset used when DEBUG */
+#ifdef XP_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include "jstypes.h"
 #include "jsutil.h" /* Added by JSIFY */
 #include "jshash.h" /* Added by JSIFY */
@@ -72,6 +76,11 @@
 #include "jsscope.h"
 #include "jsscript.h"
 #include "jsstr.h"
+#include "prmjtime.h"
+
+#ifdef JS_THREADSAFE
+#include "prthread.h"
+#endif
 
 #if JS_HAS_XML_SUPPORT
 #include "jsxml.h"
@@ -189,6 +198,10 @@ struct JSGCArena {
     jsuword             unscannedPages; /* bitset for fast search of pages
                                            with marked but not yet scanned
                                            things */
+    JSGCArena           *prevRecycled;  /* link field for the list of arenas
+                                           with free things */
+    JSGCThing           *freeList;      /* free things found by the last GC */
+    uint32              nfree;          /* number of things on freeList */
     uint8               base[1];        /* things+flags allocation area */
 };
 
@@ -220,18 +233,6 @@ struct JSGCArena {
  */
 #define PAGE_THING_GAP(n) (((n) & ((n) - 1)) ? (GC_PAGE_SIZE % (n)) : (n))
 
-#ifdef JS_THREADSAFE
-/*
- * The maximum number of things to put to the local free list by taking
- * several things from the global free list or from the tail of the last
- * allocated arena to amortize the cost of rt->gcLock.
- *
- * We use number 8 based on benchmarks from bug 312238.
- */
-#define MAX_THREAD_LOCAL_THINGS 8
-
-#endif
-
 JS_STATIC_ASSERT(sizeof(JSGCThing) == sizeof(JSGCPageInfo));
 JS_STATIC_ASSERT(sizeof(JSGCThing) >= sizeof(JSObject));
 JS_STATIC_ASSERT(sizeof(JSGCThing) >= sizeof(JSString));
@@ -375,6 +376,331 @@ ShrinkPtrTable(JSPtrTable *table, const JSPtrTableInfo *info,
 #endif
 }
 
+/*
+ * Memory that finalizers release is queued in rt->gcFreeLater during the
+ * sweep and handed to a helper thread at the end of the GC, so the free calls
+ * for string chars, slot vectors and scope tables overlap with the mutator
+ * instead of lengthening the pause.  A batch that the helper hasn't picked up
+ * yet when the next GC ends is joined with that GC's batch.  This is deferred
+ * freeing only: the sweep itself, finalizers included, still runs on the GC's
+ * thread within the pause.
+ *
+ * Small blocks are cheaper to free in place than to queue, malloc recycles
+ * them from a per-thread cache, so only blocks of FREE_LATER_MIN_BYTES or more
+ * are deferred.  Empty arenas are freed in place too, the allocator reuses
+ * them right after the GC.  rt->gcHelperThreads defaults to 0 when there is
+ * only one processor, where the helper would just compete with the mutator
+ * and the next GC, so there nothing is deferred unless the embedding asks for
+ * it with JSGC_HELPER_THREADS.
+ */
+#define FREE_LATER_CHUNK_LENGTH 1022
+#define FREE_LATER_MIN_BYTES    512
+
+struct JSFreeLaterChunk {
+    JSFreeLaterChunk    *next;
+    size_t              count;
+    void                *ptrs[FREE_LATER_CHUNK_LENGTH];
+};
+
+static void
+FreeLaterChunks(JSFreeLaterChunk *chunk)
+{
+    JSFreeLaterChunk *next;
+    size_t i;
+
+    for (; chunk; chunk = next) {
+        next = chunk->next;
+        for (i = 0; i < chunk->count; i++)
+            free(chunk->ptrs[i]);
+        free(chunk);
+    }
+}
+
+void
+js_FreeLater(JSRuntime *rt, void *p, size_t nbytes)
+{
+#ifdef JS_THREADSAFE
+    JSFreeLaterChunk *chunk;
+
+    if (rt->gcRunning && rt->gcHelperThreads != 0 &&
+        nbytes >= FREE_LATER_MIN_BYTES) {
+        chunk = rt->gcFreeLater;
+        if (!chunk || chunk->count == FREE_LATER_CHUNK_LENGTH) {
+            chunk = (JSFreeLaterChunk *) malloc(sizeof *chunk);
+            if (chunk) {
+                chunk->next = rt->gcFreeLater;
+                chunk->count = 0;
+                rt->gcFreeLater = chunk;
+            }
+        }
+        if (chunk) {
+            chunk->ptrs[chunk->count++] = p;
+            return;
+        }
+    }
+#endif
+    free(p);
+}
+
+#ifdef JS_THREADSAFE
+static void
+GCHelperThreadMain(void *arg)
+{
+    JSRuntime *rt;
+    JSFreeLaterChunk *batch;
+
+    rt = (JSRuntime *) arg;
+    JS_LOCK_GC(rt);
+    for (;;) {
+        while (!rt->gcHelperBatch && !rt->gcHelperShutdown)
+            JS_WAIT_CONDVAR(rt->gcHelperWakeup, JS_NO_TIMEOUT);
+        batch = rt->gcHelperBatch;
+        if (!batch)
+            break;
+        rt->gcHelperBatch = NULL;
+        JS_UNLOCK_GC(rt);
+        FreeLaterChunks(batch);
+        JS_LOCK_GC(rt);
+    }
+    JS_UNLOCK_GC(rt);
+}
+
+static void
+StartGCHelperThread(JSRuntime *rt)
+{
+    rt->gcHelperThread = PR_CreateThread(PR_SYSTEM_THREAD, GCHelperThreadMain,
+                                         rt, PR_PRIORITY_NORMAL,
+                                         PR_GLOBAL_THREAD, PR_JOINABLE_THREAD,
+                                         0);
+}
+
+static void
+StopGCHelperThread(JSRuntime *rt)
+{
+    if (!rt->gcHelperThread)
+        return;
+    JS_LOCK_GC(rt);
+    rt->gcHelperShutdown = JS_TRUE;
+    JS_NOTIFY_CONDVAR(rt->gcHelperWakeup);
+    JS_UNLOCK_GC(rt);
+    PR_JoinThread(rt->gcHelperThread);
+    rt->gcHelperThread = NULL;
+    JS_ASSERT(!rt->gcHelperBatch);
+}
+#endif
+
+/*
+ * Arenas are carved from GC_CHUNK_SIZE chunks mapped on a GC_CHUNK_SIZE
+ * boundary, so ARENA_TO_CHUNK finds the chunk of an arena by masking its
+ * address.  A chunk hands out the arenas it has never used in address order,
+ * so the pages of a fresh chunk are only touched as the heap grows into them,
+ * and recycles freed arenas through its freeArenas list (linked by prev).
+ *
+ * Chunks with both used and free arenas are on rt->gcChunkList, which new
+ * arenas come from first, chunks without used arenas are on rt->gcEmptyChunks
+ * and full chunks are on neither.  An empty chunk that nobody needed for
+ * rt->gcDecommitDelay milliseconds gives its pages back to the system, see
+ * js_DecommitGCChunks, and later starts over as a fresh chunk.
+ */
+#define GC_CHUNK_SHIFT          20
+#define GC_CHUNK_SIZE           JS_BIT(GC_CHUNK_SHIFT)
+#define GC_CHUNK_MASK           ((jsuword) JS_BITMASK(GC_CHUNK_SHIFT))
+#define GC_DECOMMIT_DELAY       5000
+
+struct JSGCChunk {
+    JSGCChunk           *next;          /* link in rt->gcChunkList or
+                                           rt->gcEmptyChunks */
+    JSGCChunk           **prevp;        /* address of the link to this */
+    JSGCArena           *freeArenas;    /* freed arenas, linked by prev */
+    uint32              nfree;          /* free arenas, used or not */
+    uint32              nfresh;         /* arenas never used since the chunk
+                                           was mapped or decommitted */
+    int64               emptySince;     /* when the last arena was freed */
+    void                *mapping;       /* start of the allocation */
+};
+
+#define GC_CHUNK_ARENAS                                                       \
+    ((GC_CHUNK_SIZE - JS_ROUNDUP(sizeof(JSGCChunk), sizeof(jsdouble)))        \
+     / GC_ARENA_SIZE)
+
+#define CHUNK_ARENA(chunk, i)                                                 \
+    ((JSGCArena *) ((jsuword)(chunk)                                          \
+                    + JS_ROUNDUP(sizeof(JSGCChunk), sizeof(jsdouble))         \
+                    + (i) * GC_ARENA_SIZE))
+
+#define ARENA_TO_CHUNK(a)       ((JSGCChunk *) ((jsuword)(a) & ~GC_CHUNK_MASK))
+
+static void
+LinkGCChunk(JSGCChunk **listp, JSGCChunk *chunk)
+{
+    chunk->next = *listp;
+    if (chunk->next)
+        chunk->next->prevp = &chunk->next;
+    chunk->prevp = listp;
+    *listp = chunk;
+}
+
+static void
+UnlinkGCChunk(JSGCChunk *chunk)
+{
+    *chunk->prevp = chunk->next;
+    if (chunk->next)
+        chunk->next->prevp = chunk->prevp;
+}
+
+static JSGCChunk *
+NewGCChunk(JSRuntime *rt)
+{
+    void *p;
+    jsuword aligned;
+    JSGCChunk *chunk;
+
+#ifdef XP_UNIX
+    /*
+     * The system usually places a new mapping next to the previous chunk, so
+     * it is aligned.  If not, map twice the size and unmap what sticks out of
+     * the aligned chunk on either side.
+     */
+    p = mmap(NULL, GC_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+    aligned = (jsuword)p;
+    if (aligned & GC_CHUNK_MASK) {
+        munmap(p, GC_CHUNK_SIZE);
+        p = mmap(NULL, 2 * GC_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANON, -1, 0);
+        if (p == MAP_FAILED)
+            return NULL;
+        aligned = ((jsuword)p + GC_CHUNK_MASK) & ~GC_CHUNK_MASK;
+        if (aligned != (jsuword)p)
+            munmap(p, aligned - (jsuword)p);
+        munmap((void *) (aligned + GC_CHUNK_SIZE),
+               (jsuword)p + GC_CHUNK_SIZE - aligned);
+        p = (void *) aligned;
+    }
+#else
+    p = malloc(2 * GC_CHUNK_SIZE - 1);
+    if (!p)
+        return NULL;
+    aligned = ((jsuword)p + GC_CHUNK_MASK) & ~GC_CHUNK_MASK;
+#endif
+    chunk = (JSGCChunk *) aligned;
+    chunk->freeArenas = NULL;
+    chunk->nfree = GC_CHUNK_ARENAS;
+    chunk->nfresh = GC_CHUNK_ARENAS;
+    chunk->emptySince = PRMJ_Now();
+    chunk->mapping = p;
+    LinkGCChunk(&rt->gcEmptyChunks, chunk);
+    return chunk;
+}
+
+static void
+DestroyGCChunk(JSGCChunk *chunk)
+{
+    JS_ASSERT(chunk->nfree == GC_CHUNK_ARENAS);
+    UnlinkGCChunk(chunk);
+#ifdef XP_UNIX
+    munmap(chunk->mapping, GC_CHUNK_SIZE);
+#else
+    free(chunk->mapping);
+#endif
+}
+
+static JSGCArena *
+NewGCChunkArena(JSRuntime *rt)
+{
+    JSGCChunk *chunk;
+    JSGCArena *a;
+
+    chunk = rt->gcChunkList;
+    if (!chunk) {
+        /* Prefer an empty chunk whose pages are still committed. */
+        for (chunk = rt->gcEmptyChunks; chunk; chunk = chunk->next) {
+            if (chunk->nfresh != GC_CHUNK_ARENAS)
+                break;
+        }
+        if (!chunk) {
+            chunk = rt->gcEmptyChunks;
+            if (!chunk) {
+                chunk = NewGCChunk(rt);
+                if (!chunk)
+                    return NULL;
+            }
+        }
+        UnlinkGCChunk(chunk);
+        LinkGCChunk(&rt->gcChunkList, chunk);
+    }
+
+    JS_ASSERT(chunk->nfree != 0);
+    if (chunk->freeArenas) {
+        a = chunk->freeArenas;
+        chunk->freeArenas = a->prev;
+    } else {
+        JS_ASSERT(chunk->nfresh != 0);
+        a = CHUNK_ARENA(chunk, GC_CHUNK_ARENAS - chunk->nfresh);
+        chunk->nfresh--;
+    }
+    if (--chunk->nfree == 0)
+        UnlinkGCChunk(chunk);
+    return a;
+}
+
+static void
+DestroyGCChunkArena(JSRuntime *rt, JSGCArena *a)
+{
+    JSGCChunk *chunk;
+
+    chunk = ARENA_TO_CHUNK(a);
+    JS_ASSERT(chunk->nfree < GC_CHUNK_ARENAS);
+    a->prev = chunk->freeArenas;
+    chunk->freeArenas = a;
+    if (chunk->nfree++ == 0)
+        LinkGCChunk(&rt->gcChunkList, chunk);
+    if (chunk->nfree == GC_CHUNK_ARENAS) {
+        UnlinkGCChunk(chunk);
+        LinkGCChunk(&rt->gcEmptyChunks, chunk);
+        chunk->emptySince = PRMJ_Now();
+    }
+}
+
+int32
+js_DecommitGCChunks(JSRuntime *rt)
+{
+    int64 now, delay, left, next;
+    JSGCChunk *chunk;
+#ifdef XP_UNIX
+    jsuword pageSize, start;
+#endif
+
+    now = PRMJ_Now();
+    delay = (int64) rt->gcDecommitDelay * 1000;
+    next = -1;
+    for (chunk = rt->gcEmptyChunks; chunk; chunk = chunk->next) {
+        if (chunk->nfresh == GC_CHUNK_ARENAS)
+            continue;
+        left = chunk->emptySince + delay - now;
+        if (left > 0) {
+            if (next < 0 || left < next)
+                next = left;
+            continue;
+        }
+#ifdef XP_UNIX
+        /* Keep the page with the chunk header, drop the rest. */
+        pageSize = (jsuword) sysconf(_SC_PAGESIZE);
+        start = ((jsuword)chunk + sizeof(JSGCChunk) + pageSize - 1)
+                & ~(pageSize - 1);
+        madvise((void *) start, (jsuword)chunk + GC_CHUNK_SIZE - start,
+                MADV_DONTNEED);
+#endif
+        chunk->freeArenas = NULL;
+        chunk->nfresh = GC_CHUNK_ARENAS;
+    }
+
+    /* Round up so the caller doesn't wake up just before the deadline. */
+    return (next < 0) ? -1 : (int32) ((next + 999) / 1000);
+}
+
 #ifdef JS_GCMETER
 # define METER(x) x
 #else
@@ -392,7 +718,7 @@ NewGCArena(JSRuntime *rt, JSGCArenaList *arenaList)
     /* Check if we are allowed and can allocate a new arena. */
     if (rt->gcBytes >= rt->gcMaxBytes)
         return JS_FALSE;
-    a = (JSGCArena *)malloc(GC_ARENA_SIZE);
+    a = NewGCChunkArena(rt);
     if (!a)
         return JS_FALSE;
 
@@ -414,6 +740,9 @@ NewGCArena(JSRuntime *rt, JSGCArenaList *arenaList)
     a->prev = arenaList->last;
     a->prevUnscanned = NULL;
     a->unscannedPages = 0;
+    a->prevRecycled = NULL;
+    a->freeList = NULL;
+    a->nfree = 0;
     arenaList->last = a;
     arenaList->lastLimit = 0;
 
@@ -447,7 +776,7 @@ DestroyGCArena(JSRuntime *rt, JSGCArenaList *arenaList, JSGCArena **ap)
 #ifdef DEBUG
     memset(a, JS_FREE_PATTERN, GC_ARENA_SIZE);
 #endif
-    free(a);
+    DestroyGCChunkArena(rt, a);
 }
 
 static void
@@ -463,7 +792,7 @@ InitGCArenaLists(JSRuntime *rt)
         arenaList->last = NULL;
         arenaList->lastLimit = 0;
         arenaList->thingSize = (uint16)thingSize;
-        arenaList->freeList = NULL;
+        arenaList->recycled = NULL;
         METER(memset(&arenaList->stats, 0, sizeof arenaList->stats));
     }
 }
@@ -478,8 +807,11 @@ FinishGCArenaLists(JSRuntime *rt)
         arenaList = &rt->gcArenaList[i];
         while (arenaList->last)
             DestroyGCArena(rt, arenaList, &arenaList->last);
-        arenaList->freeList = NULL;
+        arenaList->recycled = NULL;
     }
+    JS_ASSERT(!rt->gcChunkList);
+    while (rt->gcEmptyChunks)
+        DestroyGCChunk(rt->gcEmptyChunks);
 }
 
 uint8 *
@@ -602,6 +934,13 @@ typedef struct JSGCRootHashEntry {
 #define GC_ROOTS_SIZE   256
 #define GC_FINALIZE_LEN 1024
 
+/*
+ * Default heap growth over what survived the last GC, in percent, and the
+ * smallest heap worth collecting.  See SetGCTriggers.
+ */
+#define GC_TRIGGER_FACTOR       300
+#define GC_TRIGGER_MIN_BYTES    JS_BIT(22)
+
 JSBool
 js_InitGC(JSRuntime *rt, uint32 maxbytes)
 {
@@ -618,6 +957,11 @@ js_InitGC(JSRuntime *rt, uint32 maxbytes)
      * for default backward API compatibility.
      */
     rt->gcMaxBytes = rt->gcMaxMallocBytes = maxbytes;
+    rt->gcDecommitDelay = GC_DECOMMIT_DELAY;
+    rt->gcTriggerFactor = GC_TRIGGER_FACTOR;
+    rt->gcTriggerBytes = JS_MIN(maxbytes, GC_TRIGGER_MIN_BYTES);
+    rt->gcMallocTrigger = maxbytes;
+    rt->gcMallocLive = 0;
 
     return JS_TRUE;
 }
@@ -684,10 +1028,8 @@ js_DumpGCStats(JSRuntime *rt, FILE *fp)
     fprintf(fp, "         things born locked: %lu\n", ULSTAT(lockborn));
     fprintf(fp, "           valid lock calls: %lu\n", ULSTAT(lock));
     fprintf(fp, "         valid unlock calls: %lu\n", ULSTAT(unlock));
-    fprintf(fp, "       mark recursion depth: %lu\n", ULSTAT(depth));
-    fprintf(fp, "     maximum mark recursion: %lu\n", ULSTAT(maxdepth));
-    fprintf(fp, "     mark C recursion depth: %lu\n", ULSTAT(cdepth));
-    fprintf(fp, "   maximum mark C recursion: %lu\n", ULSTAT(maxcdepth));
+    fprintf(fp, "             things scanned: %lu\n", ULSTAT(depth));
+    fprintf(fp, "   maximum mark stack depth: %lu\n", ULSTAT(maxdepth));
     fprintf(fp, "      delayed scan bag adds: %lu\n", ULSTAT(unscanned));
 #ifdef DEBUG
     fprintf(fp, "  max delayed scan bag size: %lu\n", ULSTAT(maxunscanned));
@@ -727,6 +1069,14 @@ js_FinishGC(JSRuntime *rt)
 #endif
 
     FreePtrTable(&rt->gcIteratorTable, &iteratorTableInfo);
+#ifdef JS_THREADSAFE
+    StopGCHelperThread(rt);
+#endif
+    FreeLaterChunks(rt->gcFreeLater);
+    rt->gcFreeLater = NULL;
+    free(rt->gcMarkStack.things);
+    rt->gcMarkStack.things = NULL;
+    rt->gcMarkStack.capacity = 0;
 #if JS_HAS_GENERATORS
     rt->gcCloseState.reachableList = NULL;
     METER(rt->gcStats.nclose = 0);
@@ -1331,12 +1681,40 @@ js_RunCloseHooks(JSContext *cx)
 
 static struct GCHist {
     JSBool      lastDitch;
-    JSGCThing   *freeList;
+    JSGCArena   *recycled;
 } gchist[NGCHIST];
 
 unsigned gchpos;
 #endif
 
+#ifdef JS_THREADSAFE
+/*
+ * Bump-allocate the next thing from span, returning null if it is empty.
+ */
+static JSGCThing *
+SpanAlloc(JSGCSpan *span, size_t nbytes, uint8 **flagpp)
+{
+    jsuword offset;
+    uint8 *firstPage, *flagp;
+
+    offset = span->offset;
+    if (offset == span->limit)
+        return NULL;
+    if ((offset & GC_PAGE_MASK) == 0)
+        offset += PAGE_THING_GAP(nbytes);
+    JS_ASSERT(offset + nbytes <= span->limit);
+    span->offset = (uint16)(offset + nbytes);
+
+    firstPage = (uint8 *)FIRST_THING_PAGE(span->arena);
+    flagp = span->arena->base + offset / sizeof(JSGCThing);
+    if (flagp >= firstPage)
+        flagp += GC_THINGS_SIZE;
+    JS_ASSERT(*flagp == GCF_FINAL);
+    *flagpp = flagp;
+    return (JSGCThing *)(firstPage + offset);
+}
+#endif
+
 void *
 js_NewGCThing(JSContext *cx, uintN flags, size_t nbytes)
 {
@@ -1352,10 +1730,9 @@ js_NewGCThing(JSContext *cx, uintN flags, size_t nbytes)
 #ifdef JS_THREADSAFE
     JSBool gcLocked;
     uintN localMallocBytes;
-    JSGCThing **flbase, **lastptr;
-    JSGCThing *tmpthing;
+    JSGCThing **flbase;
     uint8 *tmpflagp;
-    uintN maxFreeThings;         /* max to take from the global free list */
+    JSGCSpan *span;
     METER(size_t nfree);
 #endif
 
@@ -1369,13 +1746,20 @@ js_NewGCThing(JSContext *cx, uintN flags, size_t nbytes)
     JS_ASSERT(cx->thread);
     flbase = cx->thread->gcFreeLists;
     JS_ASSERT(flbase);
-    thing = flbase[flindex];
     localMallocBytes = cx->thread->gcMallocBytes;
-    if (thing && rt->gcMaxMallocBytes - rt->gcMallocBytes > localMallocBytes) {
-        flagp = thing->flagp;
-        flbase[flindex] = thing->next;
-        METER(rt->gcStats.localalloc++);  /* this is not thread-safe */
-        goto success;
+    if (rt->gcMallocTrigger - rt->gcMallocBytes > localMallocBytes) {
+        thing = flbase[flindex];
+        if (thing) {
+            flagp = thing->flagp;
+            flbase[flindex] = thing->next;
+            METER(rt->gcStats.localalloc++);  /* this is not thread-safe */
+            goto success;
+        }
+        thing = SpanAlloc(&cx->thread->gcSpans[flindex], nbytes, &flagp);
+        if (thing) {
+            METER(rt->gcStats.localalloc++);  /* this is not thread-safe */
+            goto success;
+        }
     }
 
     JS_LOCK_GC(rt);
@@ -1384,8 +1768,8 @@ js_NewGCThing(JSContext *cx, uintN flags, size_t nbytes)
     /* Transfer thread-local counter to global one. */
     if (localMallocBytes != 0) {
         cx->thread->gcMallocBytes = 0;
-        if (rt->gcMaxMallocBytes - rt->gcMallocBytes < localMallocBytes)
-            rt->gcMallocBytes = rt->gcMaxMallocBytes;
+        if (rt->gcMallocTrigger - rt->gcMallocBytes < localMallocBytes)
+            rt->gcMallocBytes = rt->gcMallocTrigger;
         else
             rt->gcMallocBytes += localMallocBytes;
     }
@@ -1403,7 +1787,7 @@ js_NewGCThing(JSContext *cx, uintN flags, size_t nbytes)
 #endif
     doGC = JS_TRUE;
 #else
-    doGC = (rt->gcMallocBytes >= rt->gcMaxMallocBytes);
+    doGC = (rt->gcMallocBytes >= rt->gcMallocTrigger);
 #endif
 
     arenaList = &rt->gcArenaList[flindex];
@@ -1421,46 +1805,108 @@ js_NewGCThing(JSContext *cx, uintN flags, size_t nbytes)
             METER(rt->gcStats.retry++);
         }
 
-        /* Try to get thing from the free list. */
-        thing = arenaList->freeList;
-        if (thing) {
-            arenaList->freeList = thing->next;
+        /*
+         * Try to get thing from the free list of the first arena that the
+         * last GC left free things in.
+         */
+        a = arenaList->recycled;
+        if (a) {
+            thing = a->freeList;
+            JS_ASSERT(thing && a->nfree != 0);
             flagp = thing->flagp;
             JS_ASSERT(*flagp & GCF_FINAL);
-            METER(arenaList->stats.freelen--);
             METER(arenaList->stats.recycle++);
 
 #ifdef JS_THREADSAFE
             /*
-             * Refill the local free list by taking several things from the
-             * global free list unless we are still at rt->gcMaxMallocBytes
-             * barrier or the free list is already populated. The former
-             * happens when GC is canceled due to !gcCallback(cx, JSGC_BEGIN)
-             * or no gcPoke. The latter is caused via allocating new things
-             * in gcCallback(cx, JSGC_END).
+             * Take the whole free list of the arena as the local free list
+             * unless we are still at rt->gcMallocTrigger barrier or the local
+             * list is already populated. The former happens when GC is
+             * canceled due to !gcCallback(cx, JSGC_BEGIN) or no gcPoke. The
+             * latter is caused via allocating new things in gcCallback(cx,
+             * JSGC_END).  The thread then allocates the rest of the arena's
+             * free things without taking rt->gcLock.
              */
-            if (rt->gcMallocBytes >= rt->gcMaxMallocBytes || flbase[flindex])
-                break;
-            tmpthing = arenaList->freeList;
-            if (tmpthing) {
-                maxFreeThings = MAX_THREAD_LOCAL_THINGS;
-                do {
-                    if (!tmpthing->next)
-                        break;
-                    tmpthing = tmpthing->next;
-                } while (--maxFreeThings != 0);
-
-                flbase[flindex] = arenaList->freeList;
-                arenaList->freeList = tmpthing->next;
-                tmpthing->next = NULL;
+            if (rt->gcMallocBytes < rt->gcMallocTrigger && !flbase[flindex]) {
+                flbase[flindex] = thing->next;
+                rt->gcAllocBytes += a->nfree * nbytes;
+                METER(arenaList->stats.freelen -= a->nfree);
+                a->freeList = NULL;
+                a->nfree = 0;
+            } else
+#endif
+            {
+                a->freeList = thing->next;
+                a->nfree--;
+                rt->gcAllocBytes += nbytes;
+                METER(arenaList->stats.freelen--);
+            }
+            if (!a->freeList) {
+                arenaList->recycled = a->prevRecycled;
+                a->prevRecycled = NULL;
             }
-#endif
             break;
         }
 
-        /* Allocate from the tail of last arena or from new arena if we can. */
+        /*
+         * Allocate from the tail of last arena or from new arena if we can.
+         * Once the heap has grown to rt->gcTriggerBytes, collect before adding
+         * arenas.  When that GC frees too little, the heap keeps growing up to
+         * rt->gcMaxBytes.
+         */
         if ((arenaList->last && arenaList->lastLimit != GC_THINGS_SIZE) ||
-            NewGCArena(rt, arenaList)) {
+            ((doGC || rt->gcBytes < rt->gcTriggerBytes) &&
+             NewGCArena(rt, arenaList))) {
+
+#ifdef JS_THREADSAFE
+            /*
+             * Unless we are still at the rt->gcMallocTrigger barrier, the
+             * thread takes the whole tail of the last arena as its span and
+             * allocates thing as its first element.  Another thread that
+             * needs things of this size gets an arena of its own, so the
+             * threads bump-allocate the rest of their spans without taking
+             * rt->gcLock.
+             */
+            if (rt->gcMallocBytes < rt->gcMallocTrigger) {
+                a = arenaList->last;
+                span = &cx->thread->gcSpans[flindex];
+                span->arena = a;
+                span->offset = arenaList->lastLimit;
+                span->limit = GC_THINGS_SIZE;
+                rt->gcAllocBytes += GC_THINGS_SIZE - arenaList->lastLimit;
+                arenaList->lastLimit = GC_THINGS_SIZE;
+                METER(++arenaList->stats.nthings);
+                METER(arenaList->stats.maxthings =
+                      JS_MAX(arenaList->stats.nthings,
+                             arenaList->stats.maxthings));
+
+                /*
+                 * The span is ours now, and as we are in a request no GC can
+                 * look at it before we return, so preset the flags of its
+                 * things to GCF_FINAL outside the lock.
+                 */
+                JS_UNLOCK_GC(rt);
+                gcLocked = JS_FALSE;
+                firstPage = (uint8 *)FIRST_THING_PAGE(a);
+                METER(nfree = 0);
+                for (offset = span->offset; offset != GC_THINGS_SIZE;
+                     offset += nbytes) {
+                    if ((offset & GC_PAGE_MASK) == 0)
+                        offset += PAGE_THING_GAP(nbytes);
+                    JS_ASSERT(offset + nbytes <= GC_THINGS_SIZE);
+                    tmpflagp = a->base + offset / sizeof(JSGCThing);
+                    if (tmpflagp >= firstPage)
+                        tmpflagp += GC_THINGS_SIZE;
+                    *tmpflagp = GCF_FINAL;    /* signifying that thing is free */
+                    METER(++nfree);
+                }
+                METER(arenaList->stats.freelen += nfree - 1);
+
+                thing = SpanAlloc(span, nbytes, &flagp);
+                JS_ASSERT(thing);
+                break;
+            }
+#endif
 
             offset = arenaList->lastLimit;
             if ((offset & GC_PAGE_MASK) == 0) {
@@ -1471,6 +1917,7 @@ js_NewGCThing(JSContext *cx, uintN flags, size_t nbytes)
             }
             JS_ASSERT(offset + nbytes <= GC_THINGS_SIZE);
             arenaList->lastLimit = (uint16)(offset + nbytes);
+            rt->gcAllocBytes += nbytes;
             a = arenaList->last;
             firstPage = (uint8 *)FIRST_THING_PAGE(a);
             thing = (JSGCThing *)(firstPage + offset);
@@ -1482,39 +1929,6 @@ js_NewGCThing(JSContext *cx, uintN flags, size_t nbytes)
                   JS_MAX(arenaList->stats.nthings,
                          arenaList->stats.maxthings));
 
-#ifdef JS_THREADSAFE
-            /*
-             * Refill the local free list by taking free things from the last
-             * arena. Prefer to order free things by ascending address in the
-             * (unscientific) hope of better cache locality.
-             */
-            if (rt->gcMallocBytes >= rt->gcMaxMallocBytes || flbase[flindex])
-                break;
-            METER(nfree = 0);
-            lastptr = &flbase[flindex];
-            maxFreeThings = MAX_THREAD_LOCAL_THINGS;
-            for (offset = arenaList->lastLimit;
-                 offset != GC_THINGS_SIZE && maxFreeThings-- != 0;
-                 offset += nbytes) {
-                if ((offset & GC_PAGE_MASK) == 0)
-                    offset += PAGE_THING_GAP(nbytes);
-                JS_ASSERT(offset + nbytes <= GC_THINGS_SIZE);
-                tmpflagp = a->base + offset / sizeof(JSGCThing);
-                if (tmpflagp >= firstPage)
-                    tmpflagp += GC_THINGS_SIZE;
-
-                tmpthing = (JSGCThing *)(firstPage + offset);
-                tmpthing->flagp = tmpflagp;
-                *tmpflagp = GCF_FINAL;    /* signifying that thing is free */
-
-                *lastptr = tmpthing;
-                lastptr = &tmpthing->next;
-                METER(++nfree);
-            }
-            arenaList->lastLimit = offset;
-            *lastptr = NULL;
-            METER(arenaList->stats.freelen += nfree);
-#endif
             break;
         }
 
@@ -1567,7 +1981,7 @@ js_NewGCThing(JSContext *cx, uintN flags, size_t nbytes)
     thing->flagp = NULL;
 #ifdef DEBUG_gchist
     gchist[gchpos].lastDitch = doGC;
-    gchist[gchpos].freeList = rt->gcArenaList[flindex].freeList;
+    gchist[gchpos].recycled = rt->gcArenaList[flindex].recycled;
     if (++gchpos == NGCHIST)
         gchpos = 0;
 #endif
@@ -1612,7 +2026,8 @@ js_LockGCThing(JSContext *cx, void *thing)
 #define GC_TYPE_IS_DEEP(t)      ((t) == GCX_OBJECT || GC_TYPE_IS_XML(t))
 
 #define IS_DEEP_STRING(t,o)     (GC_TYPE_IS_STRING(t) &&                      \
-                                 JSSTRING_IS_DEPENDENT((JSString *)(o)))
+                                 (JSSTRING_IS_DEPENDENT((JSString *)(o)) ||   \
+                                  JSSTRING_IS_ROPE((JSString *)(o))))
 
 #define GC_THING_IS_DEEP(t,o)   (GC_TYPE_IS_DEEP(t) || IS_DEEP_STRING(t, o))
 
@@ -1840,6 +2255,10 @@ gc_object_class_name(void* thing)
             JS_snprintf(depbuf, sizeof depbuf, "start:%u, length:%u",
                         JSSTRDEP_START(str), JSSTRDEP_LENGTH(str));
             className = depbuf;
+        } else if (JSSTRING_IS_ROPE(str)) {
+            JS_snprintf(depbuf, sizeof depbuf, "rope, length:%u",
+                        JSSTRROPE_LENGTH(str));
+            className = depbuf;
         } else {
             className = "string";
         }
@@ -2003,9 +2422,71 @@ js_MarkAtom(JSContext *cx, JSAtom *atom)
 static void
 AddThingToUnscannedBag(JSRuntime *rt, void *thing, uint8 *flagp);
 
+/*
+ * The mark phase doesn't recurse on the C stack.  A marked thing whose
+ * children still have to be scanned waits on rt->gcMarkStack.
+ * MarkGCThingChildren scans one thing, marks its children and pushes the ones
+ * that have children of their own, except the last that it continues with.
+ * Things marked while the stack is being drained, through the mark hooks of
+ * objects, scopes and XML, are pushed as well.  When the stack can't grow the
+ * thing goes to the unscanned bag instead, see ScanDelayedChildren.
+ *
+ * With GC_MARK_DEBUG every child is marked through js_MarkNamedGCThing and
+ * scanned before its siblings, so the dump shows the path to each thing.
+ */
+#define GC_MARK_STACK_MIN       1024
+#define GC_MARK_STACK_MAX_KEEP  65536
+
+#define GCX_SCANNED_TYPES       (JS_BIT(GCX_OBJECT) |                         \
+                                 JS_BIT(GCX_MUTABLE_STRING) |                 \
+                                 JS_BIT(GCX_NAMESPACE) |                      \
+                                 JS_BIT(GCX_QNAME) |                          \
+                                 JS_BIT(GCX_XML))
+#define GC_THING_IS_SCANNED(flags)                                            \
+    ((GCX_SCANNED_TYPES & JS_BIT((flags) & GCF_TYPEMASK)) != 0)
+
+static void
+GrowMarkStack(JSRuntime *rt, void *thing, uint8 *flagp)
+{
+    JSGCMarkStack *stack;
+    size_t capacity;
+    void **things;
+
+    stack = &rt->gcMarkStack;
+    JS_ASSERT(stack->count == stack->capacity);
+    capacity = stack->capacity ? stack->capacity * 2 : GC_MARK_STACK_MIN;
+    things = (void **) realloc(stack->things, capacity * sizeof(void *));
+    if (!things) {
+        AddThingToUnscannedBag(rt, thing, flagp);
+        return;
+    }
+    stack->things = things;
+    stack->capacity = capacity;
+    stack->things[stack->count++] = thing;
+}
+
+#define PUSH_MARK_STACK(rt, thing, flagp)                                     \
+    JS_BEGIN_MACRO                                                            \
+        JSGCMarkStack *stack_ = &(rt)->gcMarkStack;                           \
+        if (stack_->count != stack_->capacity)                                \
+            stack_->things[stack_->count++] = (thing);                        \
+        else                                                                  \
+            GrowMarkStack(rt, thing, flagp);                                  \
+        METER(if (stack_->count > (rt)->gcStats.maxdepth)                     \
+                  (rt)->gcStats.maxdepth = stack_->count);                    \
+    JS_END_MACRO
+
+static void
+FinishMarkStack(JSGCMarkStack *stack)
+{
+    JS_ASSERT(stack->count == 0);
+    free(stack->things);
+    stack->things = NULL;
+    stack->capacity = 0;
+}
+
 static void
-MarkGCThingChildren(JSContext *cx, void *thing, uint8 *flagp,
-                    JSBool shouldCheckRecursion)
+MarkGCThingChildren(JSContext *cx, void *thing, uint8 *flagp)
 {
     JSRuntime *rt;
     JSObject *obj;
@@ -2013,39 +2494,17 @@ MarkGCThingChildren(JSContext *cx, void *thing, uint8 *flagp,
     void *next_thing;
     uint8 *next_flagp;
     JSString *str;
-#ifdef JS_GCMETER
-    uint32 tailCallNesting;
-#endif
 #ifdef GC_MARK_DEBUG
     JSScope *scope;
     char name[32];
 #endif
 
-    /*
-     * With JS_GC_ASSUME_LOW_C_STACK defined the mark phase of GC always
-     * uses the non-recursive code that otherwise would be called only on
-     * a low C stack condition.
-     */
-#ifdef JS_GC_ASSUME_LOW_C_STACK
-# define RECURSION_TOO_DEEP() shouldCheckRecursion
-#else
-    int stackDummy;
-# define RECURSION_TOO_DEEP() (shouldCheckRecursion &&                        \
-                               !JS_CHECK_STACK_SIZE(cx, stackDummy))
-#endif
-
     rt = cx->runtime;
-    METER(tailCallNesting = 0);
-    METER(if (++rt->gcStats.cdepth > rt->gcStats.maxcdepth)
-              rt->gcStats.maxcdepth = rt->gcStats.cdepth);
 
-#ifndef GC_MARK_DEBUG
   start:
-#endif
     JS_ASSERT(flagp);
     JS_ASSERT(*flagp & GCF_MARK); /* the caller must already mark the thing */
-    METER(if (++rt->gcStats.depth > rt->gcStats.maxdepth)
-              rt->gcStats.maxdepth = rt->gcStats.depth);
+    METER(rt->gcStats.depth++);
 #ifdef GC_MARK_DEBUG
     if (js_DumpGCHeap)
         gc_dump_thing(cx, thing, js_DumpGCHeap);
@@ -2053,8 +2512,6 @@ MarkGCThingChildren(JSContext *cx, void *thing, uint8 *flagp,
 
     switch (*flagp & GCF_TYPEMASK) {
       case GCX_OBJECT:
-        if (RECURSION_TOO_DEEP())
-            goto add_to_unscanned_bag;
         /* If obj->slots is null, obj must be a newborn. */
         obj = (JSObject *) thing;
         vp = obj->slots;
@@ -2079,46 +2536,25 @@ MarkGCThingChildren(JSContext *cx, void *thing, uint8 *flagp,
             if (!JSVAL_IS_GCTHING(v) || v == JSVAL_NULL)
                 continue;
             next_thing = JSVAL_TO_GCTHING(v);
-            if (next_thing == thing)
-                continue;
             next_flagp = js_GetGCThingFlags(next_thing);
             if (*next_flagp & GCF_MARK)
                 continue;
             JS_ASSERT(*next_flagp != GCF_FINAL);
-            if (thing) {
-#ifdef GC_MARK_DEBUG
-                GC_MARK(cx, thing, name);
-#else
-                *flagp |= GCF_MARK;
-                MarkGCThingChildren(cx, thing, flagp, JS_TRUE);
-#endif
-                if (*next_flagp & GCF_MARK) {
-                    /*
-                     * This happens when recursive MarkGCThingChildren marks
-                     * the thing with flags referred by *next_flagp.
-                     */
-                    thing = NULL;
-                    continue;
-                }
-            }
 #ifdef GC_MARK_DEBUG
             GetObjSlotName(scope, obj, vp - obj->slots, name, sizeof name);
-#endif
+            GC_MARK(cx, next_thing, name);
+#else
+            *next_flagp |= GCF_MARK;
+            if (!GC_THING_IS_SCANNED(*next_flagp))
+                continue;
+            if (thing)
+                PUSH_MARK_STACK(rt, thing, flagp);
             thing = next_thing;
             flagp = next_flagp;
+#endif
         }
-        if (thing) {
-            /*
-             * thing came from the last unmarked GC-thing slot and we
-             * can optimize tail recursion.
-             *
-             * Since we already know that there is enough C stack space,
-             * we clear shouldCheckRecursion to avoid extra checking in
-             * RECURSION_TOO_DEEP.
-             */
-            shouldCheckRecursion = JS_FALSE;
-            goto on_tail_recursion;
-        }
+        if (thing)
+            goto start;
         break;
 
 #ifdef DEBUG
@@ -2130,62 +2566,72 @@ MarkGCThingChildren(JSContext *cx, void *thing, uint8 *flagp,
 
       case GCX_MUTABLE_STRING:
         str = (JSString *)thing;
-        if (!JSSTRING_IS_DEPENDENT(str))
+        if (JSSTRING_IS_ROPE(str)) {
+            /*
+             * Mark both operands and continue with the left one, ropes made
+             * by += nest on the left.
+             */
+            GC_MARK(cx, JSSTRROPE_RIGHT(str), "right");
+            thing = JSSTRROPE_LEFT(str);
+#ifdef GC_MARK_DEBUG
+            strcpy(name, "left");
+#endif
+        } else if (JSSTRING_IS_DEPENDENT(str)) {
+            thing = JSSTRDEP_BASE(str);
+#ifdef GC_MARK_DEBUG
+            strcpy(name, "base");
+#endif
+        } else {
             break;
-        thing = JSSTRDEP_BASE(str);
+        }
         flagp = js_GetGCThingFlags(thing);
         if (*flagp & GCF_MARK)
             break;
 #ifdef GC_MARK_DEBUG
-        strcpy(name, "base");
-#endif
-        /* Fallthrough to code to deal with the tail recursion. */
-
-      on_tail_recursion:
-#ifdef GC_MARK_DEBUG
-        /*
-         * Do not eliminate C recursion when debugging to allow
-         * js_MarkNamedGCThing to build a full dump of live GC
-         * things.
-         */
         GC_MARK(cx, thing, name);
         break;
 #else
-        /* Eliminate tail recursion for the last unmarked child. */
         JS_ASSERT(*flagp != GCF_FINAL);
-        METER(++tailCallNesting);
         *flagp |= GCF_MARK;
         goto start;
 #endif
 
 #if JS_HAS_XML_SUPPORT
       case GCX_NAMESPACE:
-        if (RECURSION_TOO_DEEP())
-            goto add_to_unscanned_bag;
         js_MarkXMLNamespace(cx, (JSXMLNamespace *)thing);
         break;
 
       case GCX_QNAME:
-        if (RECURSION_TOO_DEEP())
-            goto add_to_unscanned_bag;
         js_MarkXMLQName(cx, (JSXMLQName *)thing);
         break;
 
       case GCX_XML:
-        if (RECURSION_TOO_DEEP())
-            goto add_to_unscanned_bag;
         js_MarkXML(cx, (JSXML *)thing);
         break;
 #endif
-      add_to_unscanned_bag:
-        AddThingToUnscannedBag(cx->runtime, thing, flagp);
-        break;
     }
+}
 
-#undef RECURSION_TOO_DEEP
+/*
+ * Scan thing, which must be marked, and everything it leaves on the mark
+ * stack.
+ */
+static void
+ScanGCThing(JSContext *cx, void *thing, uint8 *flagp)
+{
+    JSGCMarkStack *stack;
 
-    METER(rt->gcStats.depth -= 1 + tailCallNesting);
-    METER(rt->gcStats.cdepth--);
+    stack = &cx->runtime->gcMarkStack;
+    JS_ASSERT(!stack->draining);
+    stack->draining = JS_TRUE;
+    for (;;) {
+        MarkGCThingChildren(cx, thing, flagp);
+        if (stack->count == 0)
+            break;
+        thing = stack->things[--stack->count];
+        flagp = js_GetGCThingFlags(thing);
+    }
+    stack->draining = JS_FALSE;
 }
 
 /*
@@ -2389,6 +2835,7 @@ ScanDelayedChildren(JSContext *cx)
                  */
                 switch (*flagp & GCF_TYPEMASK) {
                   case GCX_OBJECT:
+                  case GCX_MUTABLE_STRING:
 # if JS_HAS_XML_SUPPORT
                   case GCX_NAMESPACE:
                   case GCX_QNAME:
@@ -2399,7 +2846,7 @@ ScanDelayedChildren(JSContext *cx)
                     JS_ASSERT(0);
                 }
 #endif
-                MarkGCThingChildren(cx, thing, flagp, JS_FALSE);
+                ScanGCThing(cx, thing, flagp);
             }
         }
         /*
@@ -2448,8 +2895,22 @@ js_MarkGCThing(JSContext *cx, void *thing)
         return;
     *flagp |= GCF_MARK;
 
+#ifdef GC_MARK_DEBUG
+    if (cx->runtime->gcMarkStack.draining) {
+        MarkGCThingChildren(cx, thing, flagp);
+        return;
+    }
+#else
+    if (!GC_THING_IS_SCANNED(*flagp))
+        return;
+    if (cx->runtime->gcMarkStack.draining) {
+        PUSH_MARK_STACK(cx->runtime, thing, flagp);
+        return;
+    }
+#endif
+
     if (!cx->insideGCMarkCallback) {
-        MarkGCThingChildren(cx, thing, flagp, JS_TRUE);
+        ScanGCThing(cx, thing, flagp);
     } else {
         /*
          * For API compatibility we allow for the callback to assume that
@@ -2458,17 +2919,12 @@ js_MarkGCThing(JSContext *cx, void *thing)
          * by unmarked GC things.
          *
          * Since we do not know which call from inside the callback is the
-         * last, we ensure that the unscanned bag is always empty when we
-         * return to the callback and all marked things are scanned.
-         *
-         * As an optimization we do not check for the stack size here and
-         * pass JS_FALSE as the last argument to MarkGCThingChildren.
-         * Otherwise with low C stack the thing would be pushed to the bag
-         * just to be feed to MarkGCThingChildren from inside
-         * ScanDelayedChildren.
+         * last, we ensure that the mark stack and the unscanned bag are
+         * always empty when we return to the callback and all marked things
+         * are scanned.
          */
         cx->insideGCMarkCallback = JS_FALSE;
-        MarkGCThingChildren(cx, thing, flagp, JS_FALSE);
+        ScanGCThing(cx, thing, flagp);
         ScanDelayedChildren(cx);
         cx->insideGCMarkCallback = JS_TRUE;
     }
@@ -2634,6 +3090,126 @@ MarkWeakRoots(JSContext *cx, JSWeakRoots *wr)
     }
 }
 
+/*
+ * Set the heap size and the JS_malloc count that trigger the next GC from
+ * what survived this one.  A program with a small live set gets small heaps
+ * that stay in cache, one with a large live set is not collected over and
+ * over while most of the heap survives.
+ *
+ * The GC-thing heap grows to rt->gcTriggerFactor percent of the bytes of
+ * live things, but at least by a quarter of its current size so that a heap
+ * of mostly free cells is not collected on every new arena, and never past
+ * rt->gcMaxBytes.  JS_malloc memory is only seen as it is allocated, so we
+ * estimate how much of it is still live from the fraction of GC-things that
+ * survived and allow the same relative growth over that, but never less
+ * than rt->gcMaxMallocBytes.
+ */
+static void
+SetGCTriggers(JSRuntime *rt, size_t thingBytes, size_t liveBytes,
+              size_t deadBytes, uint32 mallocBytes)
+{
+    uint64 trigger;
+
+    trigger = (uint64) thingBytes * rt->gcTriggerFactor / 100;
+    trigger = JS_MAX(trigger, (uint64) rt->gcBytes + rt->gcBytes / 4);
+    trigger = JS_MAX(trigger, GC_TRIGGER_MIN_BYTES);
+    rt->gcTriggerBytes = (uint32) JS_MIN(trigger, rt->gcMaxBytes);
+
+    trigger = (uint64) rt->gcMallocLive + mallocBytes;
+    if (liveBytes + deadBytes != 0)
+        trigger = trigger * liveBytes / (liveBytes + deadBytes);
+    rt->gcMallocLive = (uint32) JS_MIN(trigger, (uint32) -1);
+    trigger = trigger * (rt->gcTriggerFactor - 100) / 100;
+    trigger = JS_MAX(trigger, rt->gcMaxMallocBytes);
+    rt->gcMallocTrigger = (uint32) JS_MIN(trigger, (uint32) -1);
+}
+
+/*
+ * Update rt->gcHistory from what the sweep found alive and dead per type.
+ * Every thing allocated since the last GC is one or the other now, as is
+ * every thing that was alive after the last GC.
+ */
+static void
+RecordGC(JSRuntime *rt, JSGCInvocationKind gckind, size_t *typeLive,
+         size_t *typeDead)
+{
+    JSGCHistory *h;
+    uintN i;
+    size_t seen;
+
+    h = &rt->gcHistory;
+    h->pauses[h->number % JSGC_PAUSE_LOG] = rt->gcLastDuration;
+    h->number++;
+    h->kinds[gckind]++;
+    h->lastKind = gckind;
+    h->pauseMax = JS_MAX(h->pauseMax, rt->gcLastDuration);
+    h->pauseTotal += rt->gcLastDuration;
+    for (i = 0; i < GCX_NTYPES; i++) {
+        seen = typeLive[i] + typeDead[i];
+        if (seen > h->liveBytes[i])
+            h->allocBytes[i] += seen - h->liveBytes[i];
+        h->freedBytes[i] += typeDead[i];
+        h->liveBytes[i] = (uint32) typeLive[i];
+    }
+}
+
+JS_STATIC_ASSERT(GC_LAST_DITCH + 1 == JSGC_INFO_NKINDS);
+
+static int
+ComparePauses(const void *a, const void *b)
+{
+    uint32 pa, pb;
+
+    pa = *(const uint32 *) a;
+    pb = *(const uint32 *) b;
+    return (pa > pb) - (pa < pb);
+}
+
+void
+js_GetGCInfo(JSRuntime *rt, JSGCInfo *info)
+{
+    JSGCHistory *h;
+    uint32 pauses[JSGC_PAUSE_LOG];
+    uintN i, j, n;
+
+    memset(info, 0, sizeof *info);
+    JS_LOCK_GC(rt);
+    h = &rt->gcHistory;
+    info->number = h->number;
+    for (i = 0; i < JSGC_INFO_NKINDS; i++)
+        info->kinds[i] = h->kinds[i];
+    info->lastKind = h->lastKind;
+    info->pauseMax = h->pauseMax;
+    info->pauseTotal = h->pauseTotal;
+
+    /* External strings of all finalizers go in the last type. */
+    for (i = 0; i < GCX_NTYPES; i++) {
+        j = JS_MIN(i, GCX_EXTERNAL_STRING);
+        info->allocBytes[j] += h->allocBytes[i];
+        info->freedBytes[j] += h->freedBytes[i];
+        info->liveBytes[j] += h->liveBytes[i];
+    }
+
+    info->arenas = (rt->gcBytes + rt->gcPrivateBytes) / GC_ARENA_SIZE;
+    info->heapBytes = rt->gcBytes;
+    info->triggerBytes = rt->gcTriggerBytes;
+    info->mallocBytes = rt->gcMallocBytes;
+    info->mallocTrigger = rt->gcMallocTrigger;
+
+    n = JS_MIN(h->number, JSGC_PAUSE_LOG);
+    memcpy(pauses, h->pauses, n * sizeof(uint32));
+    if (n != 0)
+        info->lastPause = h->pauses[(h->number - 1) % JSGC_PAUSE_LOG];
+    JS_UNLOCK_GC(rt);
+
+    if (n != 0) {
+        qsort(pauses, n, sizeof(uint32), ComparePauses);
+        info->pauseMedian = pauses[n / 2];
+        info->pause90 = pauses[n * 90 / 100];
+        info->pause99 = pauses[n * 99 / 100];
+    }
+}
+
 /*
  * When gckind is GC_LAST_DITCH, it indicates a call from js_NewGCThing with
  * rt->gcLock already held and when the lock should be kept on return.
@@ -2658,6 +3234,10 @@ js_GC(JSContext *cx, JSGCInvocationKind gckind)
     JSGCArenaList *arenaList;
     GCFinalizeOp finalizer;
     JSBool allClear;
+    int64 startTime;
+    uint32 mallocBytes, nlive, ndead, nfree;
+    size_t thingBytes, liveBytes, deadBytes;
+    size_t typeLive[GCX_NTYPES], typeDead[GCX_NTYPES];
 #ifdef JS_THREADSAFE
     uint32 requestDebit;
 #endif
@@ -2813,9 +3393,14 @@ js_GC(JSContext *cx, JSGCInvocationKind gckind)
      */
     rt->gcRunning = JS_TRUE;
     JS_UNLOCK_GC(rt);
+    startTime = PRMJ_Now();
 
-    /* Reset malloc counter. */
+    /* Reset malloc and allocation counters, see SetGCTriggers. */
+    mallocBytes = rt->gcMallocBytes;
     rt->gcMallocBytes = 0;
+    rt->gcAllocBytes = 0;
+    deadBytes = 0;
+    memset(typeDead, 0, sizeof typeDead);
 
     /* Drop atoms held by the property cache, and clear property weak links. */
     js_DisablePropertyCache(cx);
@@ -2828,9 +3413,12 @@ js_GC(JSContext *cx, JSGCInvocationKind gckind)
 
 #ifdef JS_THREADSAFE
     /*
-     * Set all thread local freelists to NULL. We may visit a thread's
-     * freelist more than once. To avoid redundant clearing we unroll the
-     * current thread's step.
+     * Set all thread local freelists to NULL and drop allocation spans, the
+     * sweep below puts their unallocated things back on the arena lists' free
+     * lists.  Flush the threads' property inline caches, which refer to
+     * objects and property tree nodes the GC may free.  We may visit a
+     * thread's freelist more than once.  To avoid redundant clearing we
+     * unroll the current thread's step.
      *
      * Also, in case a JSScript wrapped within an object was finalized, we
      * null acx->thread->gsnCache.script and finish the cache's hashtable.
@@ -2839,16 +3427,24 @@ js_GC(JSContext *cx, JSGCInvocationKind gckind)
      * don't have to here.
      */
     memset(cx->thread->gcFreeLists, 0, sizeof cx->thread->gcFreeLists);
+    memset(cx->thread->gcSpans, 0, sizeof cx->thread->gcSpans);
+    js_FlushPropertyIC(&cx->thread->propertyIC);
     iter = NULL;
     while ((acx = js_ContextIterator(rt, JS_FALSE, &iter)) != NULL) {
         if (!acx->thread || acx->thread == cx->thread)
             continue;
         memset(acx->thread->gcFreeLists, 0, sizeof acx->thread->gcFreeLists);
+        memset(acx->thread->gcSpans, 0, sizeof acx->thread->gcSpans);
+        js_FlushPropertyIC(&acx->thread->propertyIC);
         GSN_CACHE_CLEAR(&acx->thread->gsnCache);
     }
 #else
-    /* The thread-unsafe case just has to clear the runtime's GSN cache. */
+    /*
+     * The thread-unsafe case just has to clear the runtime's GSN cache and
+     * property inline caches.
+     */
     GSN_CACHE_CLEAR(&rt->gsnCache);
+    js_FlushPropertyIC(&rt->propertyIC);
 #endif
 
 restart:
@@ -2954,8 +3550,8 @@ restart:
 #endif
 
     /*
-     * Mark children of things that caused too deep recursion during above
-     * marking phase.
+     * Mark children of things that didn't fit on the mark stack during the
+     * above marking phase.
      */
     ScanDelayedChildren(cx);
 
@@ -2967,7 +3563,7 @@ restart:
     FindAndMarkObjectsToClose(cx, gckind, genTodoTail);
 
     /*
-     * Mark children of things that caused too deep recursion during the
+     * Mark children of things that didn't fit on the mark stack during the
      * just-completed marking part of the close phase.
      */
     ScanDelayedChildren(cx);
@@ -2981,6 +3577,11 @@ restart:
         cx->insideGCMarkCallback = JS_FALSE;
     }
     JS_ASSERT(rt->gcUnscannedBagSize == 0);
+    JS_ASSERT(rt->gcMarkStack.count == 0);
+
+    /* Keep a stack of the usual size for the next GC. */
+    if (rt->gcMarkStack.capacity > GC_MARK_STACK_MAX_KEEP)
+        FinishMarkStack(&rt->gcMarkStack);
 
     /* Finalize iterator states before the objects they iterate over. */
     CloseIteratorStates(cx);
@@ -2994,11 +3595,17 @@ restart:
      *
      * Finalize smaller objects before larger, to guarantee finalization of
      * GC-allocated obj->slots after obj.  See FreeSlots in jsobj.c.
+     *
+     * Count the bytes of things that survive and die for SetGCTriggers and
+     * RecordGC.
      */
+    thingBytes = liveBytes = 0;
+    memset(typeLive, 0, sizeof typeLive);
     for (i = 0; i < GC_NUM_FREELISTS; i++) {
         arenaList = &rt->gcArenaList[i];
         nbytes = GC_FREELIST_NBYTES(i);
         limit = arenaList->lastLimit;
+        nlive = ndead = 0;
         for (a = arenaList->last; a; a = a->prev) {
             JS_ASSERT(!a->prevUnscanned);
             JS_ASSERT(a->unscannedPages == 0);
@@ -3016,9 +3623,12 @@ restart:
                 flags = *flagp;
                 if (flags & GCF_MARK) {
                     *flagp &= ~GCF_MARK;
+                    nlive++;
+                    typeLive[flags & GCF_TYPEMASK] += nbytes;
                 } else if (!(flags & (GCF_LOCK | GCF_FINAL))) {
                     /* Call the finalizer with GCF_FINAL ORed into flags. */
                     type = flags & GCF_TYPEMASK;
+                    typeDead[type] += nbytes;
                     finalizer = gc_finalizers[type];
                     if (finalizer) {
                         thing = (JSGCThing *)(firstPage + offset);
@@ -3030,10 +3640,17 @@ restart:
 
                     /* Set flags to GCF_FINAL, signifying that thing is free. */
                     *flagp = GCF_FINAL;
+                    ndead++;
                 }
             }
             limit = GC_THINGS_SIZE;
         }
+
+        /* Only the first list counts toward rt->gcBytes, see NewGCArena. */
+        if (i == 0)
+            thingBytes = nlive * nbytes;
+        liveBytes += nlive * nbytes;
+        deadBytes += ndead * nbytes;
     }
 
     /*
@@ -3054,7 +3671,9 @@ restart:
 
     /*
      * Free phase.
-     * Free any unused arenas and rebuild the JSGCThing freelist.
+     * Free any unused arenas and rebuild the JSGCThing freelists of the others.
+     * Arenas with free things are chained oldest first, so new things fill
+     * the old arenas and the newer ones have a chance to empty and be freed.
      */
     for (i = 0; i < GC_NUM_FREELISTS; i++) {
         arenaList = &rt->gcArenaList[i];
@@ -3064,15 +3683,15 @@ restart:
             continue;
 
         allClear = JS_TRUE;
-        arenaList->freeList = NULL;
-        freeList = NULL;
+        arenaList->recycled = NULL;
         METER(arenaList->stats.nthings = 0);
         METER(arenaList->stats.freelen = 0);
 
         nbytes = GC_FREELIST_NBYTES(i);
         limit = arenaList->lastLimit;
         do {
-            METER(size_t nfree = 0);
+            freeList = NULL;
+            nfree = 0;
             firstPage = (uint8 *) FIRST_THING_PAGE(a);
             for (offset = 0; offset != limit; offset += nbytes) {
                 if ((offset & GC_PAGE_MASK) == 0)
@@ -3090,19 +3709,25 @@ restart:
                     thing->flagp = flagp;
                     thing->next = freeList;
                     freeList = thing;
-                    METER(++nfree);
+                    nfree++;
                 }
             }
             if (allClear) {
                 /*
-                 * Forget just assembled free list head for the arena
-                 * and destroy the arena itself.
+                 * Forget just assembled free list for the arena and destroy
+                 * the arena itself.
                  */
-                freeList = arenaList->freeList;
                 DestroyGCArena(rt, arenaList, ap);
             } else {
                 allClear = JS_TRUE;
-                arenaList->freeList = freeList;
+                a->freeList = freeList;
+                a->nfree = nfree;
+                if (freeList) {
+                    a->prevRecycled = arenaList->recycled;
+                    arenaList->recycled = a;
+                } else {
+                    a->prevRecycled = NULL;
+                }
                 ap = &a->prev;
                 METER(arenaList->stats.freelen += nfree);
                 METER(arenaList->stats.totalfreelen += nfree);
@@ -3114,6 +3739,29 @@ restart:
 
     if (rt->gcCallback)
         (void) rt->gcCallback(cx, JSGC_FINALIZE_END);
+
+    (void) js_DecommitGCChunks(rt);
+
+    if (rt->gcFreeLater) {
+#ifdef JS_THREADSAFE
+        if (!rt->gcHelperThread)
+            StartGCHelperThread(rt);
+        if (rt->gcHelperThread) {
+            JSFreeLaterChunk *last;
+
+            for (last = rt->gcFreeLater; last->next; last = last->next)
+                continue;
+            JS_LOCK_GC(rt);
+            last->next = rt->gcHelperBatch;
+            rt->gcHelperBatch = rt->gcFreeLater;
+            rt->gcFreeLater = NULL;
+            JS_NOTIFY_CONDVAR(rt->gcHelperWakeup);
+            JS_UNLOCK_GC(rt);
+        }
+#endif
+        FreeLaterChunks(rt->gcFreeLater);
+        rt->gcFreeLater = NULL;
+    }
 #ifdef DEBUG_srcnotesize
   { extern void DumpSrcNoteSizeHist();
     DumpSrcNoteSizeHist();
@@ -3137,6 +3785,9 @@ restart:
     js_EnablePropertyCache(cx);
     rt->gcLevel = 0;
     rt->gcLastBytes = rt->gcBytes;
+    SetGCTriggers(rt, thingBytes, liveBytes, deadBytes, mallocBytes);
+    rt->gcLastDuration = (uint32) (PRMJ_Now() - startTime);
+    RecordGC(rt, gckind, typeLive, typeDead);
     rt->gcRunning = JS_FALSE;
 
 #ifdef JS_THREADSAFE
@@ -79,6 +79,10 @@ JS_BEGIN_EXTERN_C
 # error "mutable string type index botch!"
 #endif
 
+#if GCX_EXTERNAL_STRING + 1 != JSGC_INFO_NTYPES
+# error "JSGCInfo type count botch!"
+#endif
+
 extern uint8 *
 js_GetGCThingFlags(void *thing);
 
@@ -135,9 +139,26 @@ typedef struct JSPtrTable {
     void        **array;
 } JSPtrTable;
 
+/* Marked GC things whose children are not scanned yet, see jsgc.c. */
+typedef struct JSGCMarkStack {
+    void        **things;
+    size_t      count;
+    size_t      capacity;
+    JSBool      draining;
+} JSGCMarkStack;
+
 extern JSBool
 js_RegisterCloseableIterator(JSContext *cx, JSObject *obj);
 
+/*
+ * Free p, a malloc'ed block of nbytes, once the GC is over, on the GC helper
+ * thread, when called from a finalizer.  Outside the GC, if the block is
+ * smaller than 512 bytes or if the runtime has no helper thread (the default
+ * on one processor), p is freed right away.
+ */
+extern void
+js_FreeLater(JSRuntime *rt, void *p, size_t nbytes);
+
 #if JS_HAS_GENERATORS
 
 /*
@@ -261,6 +282,35 @@ typedef enum JSGCInvocationKind {
 extern void
 js_GC(JSContext *cx, JSGCInvocationKind gckind);
 
+/*
+ * Always-on statistics behind JS_GetGCInfo, updated at the end of every GC
+ * under rt->gcLock.  Allocated bytes are derived from what the sweep finds
+ * alive and dead, so the allocator doesn't count anything.
+ */
+typedef struct JSGCHistory {
+    uint32      number;
+    uint32      kinds[GC_LAST_DITCH + 1];
+    uint32      lastKind;
+    uint32      pauses[JSGC_PAUSE_LOG];     /* ring of the last pauses */
+    uint32      pauseMax;
+    jsdouble    pauseTotal;
+    jsdouble    allocBytes[GCX_NTYPES];
+    jsdouble    freedBytes[GCX_NTYPES];
+    uint32      liveBytes[GCX_NTYPES];
+} JSGCHistory;
+
+extern void
+js_GetGCInfo(JSRuntime *rt, JSGCInfo *info);
+
+/*
+ * Give the pages of GC chunks that have been empty for rt->gcDecommitDelay
+ * milliseconds back to the system and return the milliseconds until the next
+ * empty chunk is due, or -1 if none is waiting.  The caller must hold
+ * rt->gcLock or be the GC.
+ */
+extern int32
+js_DecommitGCChunks(JSRuntime *rt);
+
 /* Call this after succesful malloc of memory for GC-related things. */
 extern void
 js_UpdateMallocCounter(JSContext *cx, size_t nbytes);
@@ -283,11 +333,9 @@ typedef struct JSGCStats {
     uint32  lockborn;   /* things born locked */
     uint32  lock;       /* valid lock calls */
     uint32  unlock;     /* valid unlock calls */
-    uint32  depth;      /* mark tail recursion depth */
-    uint32  maxdepth;   /* maximum mark tail recursion depth */
-    uint32  cdepth;     /* mark recursion depth of C functions */
-    uint32  maxcdepth;  /* maximum mark recursion depth of C functions */
-    uint32  unscanned;  /* mark C stack overflows or number of times
+    uint32  depth;      /* things scanned by the mark phase */
+    uint32  maxdepth;   /* maximum mark stack depth */
+    uint32  unscanned;  /* mark stack overflows or number of times
                            GC things were put in unscanned bag */
 #ifdef DEBUG
     uint32  maxunscanned;       /* maximum size of unscanned bag */
@@ -311,6 +359,8 @@ js_DumpGCStats(JSRuntime *rt, FILE *fp);
 
 typedef struct JSGCArena JSGCArena;
 typedef struct JSGCArenaList JSGCArenaList;
+typedef struct JSFreeLaterChunk JSFreeLaterChunk;
+typedef struct JSGCChunk JSGCChunk;
 
 #ifdef JS_GCMETER
 typedef struct JSGCArenaStats JSGCArenaStats;
@@ -335,12 +385,30 @@ struct JSGCArenaList {
     uint16      lastLimit;      /* end offset of allocated so far things in
                                    the last arena */
     uint16      thingSize;      /* size of things to allocate on this list */
-    JSGCThing   *freeList;      /* list of free GC things */
+    JSGCArena   *recycled;      /* arenas with free things, each with its own
+                                   free list */
 #ifdef JS_GCMETER
     JSGCArenaStats stats;
 #endif
 };
 
+#ifdef JS_THREADSAFE
+/*
+ * The tail of an arena list's last arena that a thread takes as a whole and
+ * bump-allocates from without taking rt->gcLock.  Things between offset and
+ * limit have their flags preset to GCF_FINAL, so until they are handed out
+ * the GC sees them as free, exactly like things on a thread-local free list.
+ * Like the free lists, spans are dropped at the start of each GC.  A span
+ * only makes allocation cheaper: it is not a nursery, what is allocated from
+ * it is never moved and only a full GC frees it.
+ */
+typedef struct JSGCSpan {
+    JSGCArena   *arena;         /* arena the span was carved from */
+    uint16      offset;         /* end offset of things allocated so far */
+    uint16      limit;          /* end offset of the last thing in the span */
+} JSGCSpan;
+#endif
+
 typedef struct JSWeakRoots {
     /* Most recently created things by type, members of the GC's root set. */
     JSGCThing           *newborn[GCX_NTYPES];
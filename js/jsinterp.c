@@ -60,6 +60,7 @@
 #include "jsgc.h"
 #include "jsinterp.h"
 #include "jsiter.h"
+#include "jsjit.h"
 #include "jslock.h"
 #include "jsnum.h"
 #include "jsobj.h"
@@ -122,6 +123,109 @@ js_EnablePropertyCache(JSContext *cx)
     cx->runtime->propertyCache.disabled = JS_FALSE;
 }
 
+/*
+ * Whether obj's properties are looked up, got and set by the native code in
+ * jsobj.c, so a cached slot can stand for the property.
+ */
+#define OBJ_HAS_NATIVE_PROPS(obj)                                             \
+    (OBJ_IS_NATIVE(obj) &&                                                    \
+     (obj)->map->ops->lookupProperty == js_LookupProperty &&                  \
+     (obj)->map->ops->getProperty == js_GetProperty &&                        \
+     (obj)->map->ops->setProperty == js_SetProperty)
+
+void
+js_FillPropertyIC(JSContext *cx, jsbytecode *pc, JSObject *obj, jsid id)
+{
+    JSPropertyIC *cache;
+    JSBool setting;
+    JSClass *clasp;
+    JSObject *holder;
+    JSScope *scope;
+    JSScopeProperty *shape, *holderShape, *sprop;
+    jsuint index;
+    JSPropertyICEntry *pce;
+
+    setting = (*pc == JSOP_SETPROP || *pc == JSOP_SETNAME);
+    holderShape = NULL;
+    sprop = NULL;
+    if (OBJ_IS_DENSE_ARRAY(cx, obj)) {
+        /* Dense arrays get anything but length and elements from proto. */
+        if (setting ||
+            id == ATOM_TO_JSID(cx->runtime->atomState.lengthAtom) ||
+            js_IdIsIndex(id, &index)) {
+            return;
+        }
+        shape = PROPERTY_IC_DENSE_SHAPE;
+        clasp = LOCKED_OBJ_GET_CLASS(obj);
+        holder = LOCKED_OBJ_GET_PROTO(obj);
+    } else {
+        if (!OBJ_HAS_NATIVE_PROPS(obj))
+            return;
+        JS_LOCK_OBJ(cx, obj);
+        scope = OBJ_SCOPE(obj);
+        shape = PROPERTY_IC_SHAPE(obj, scope);
+        if (shape && shape != PROPERTY_IC_NO_SHAPE)
+            sprop = SCOPE_GET_PROPERTY(scope, id);
+        clasp = LOCKED_OBJ_GET_CLASS(obj);
+        holder = LOCKED_OBJ_GET_PROTO(obj);
+        JS_UNLOCK_OBJ(cx, obj);
+        if (shape == PROPERTY_IC_NO_SHAPE)
+            return;
+
+        /*
+         * Only properties of obj itself can be set through the cache.  If obj
+         * has a resolve hook, it might define the property on obj itself next
+         * time, so don't cache a property found on its prototype.
+         */
+        if (sprop)
+            holder = NULL;
+        else if (setting || clasp->resolve != JS_ResolveStub)
+            return;
+    }
+
+    if (holder) {
+        if (!OBJ_HAS_NATIVE_PROPS(holder))
+            return;
+        JS_LOCK_OBJ(cx, holder);
+        scope = OBJ_SCOPE(holder);
+        holderShape = PROPERTY_IC_SHAPE(holder, scope);
+        if (holderShape && holderShape != PROPERTY_IC_NO_SHAPE)
+            sprop = SCOPE_GET_PROPERTY(scope, id);
+        JS_UNLOCK_OBJ(cx, holder);
+    }
+
+    if (!sprop ||
+        !SPROP_HAS_STUB_GETTER(sprop) ||
+        sprop->slot == SPROP_INVALID_SLOT) {
+        return;
+    }
+    if (setting &&
+        (!SPROP_HAS_STUB_SETTER(sprop) || (sprop->attrs & JSPROP_READONLY))) {
+        return;
+    }
+
+    cache = &JS_PROPERTY_IC(cx);
+    pce = &cache->table[PROPERTY_IC_HASH(pc, shape)];
+    pce->pc = pc;
+    pce->shape = shape;
+    pce->clasp = clasp;
+    pce->holder = holder;
+    pce->holderShape = holderShape;
+    pce->sprop = sprop;
+    cache->empty = JS_FALSE;
+    PCMETER(cache->fills++);
+}
+
+void
+js_FlushPropertyIC(JSPropertyIC *cache)
+{
+    if (cache->empty)
+        return;
+    memset(cache->table, 0, sizeof cache->table);
+    cache->empty = JS_TRUE;
+    PCMETER(cache->flushes++);
+}
+
 /*
  * Stack macros and functions.  These all use a local variable, jsval *sp, to
  * point to the next free stack slot.  SAVE_SP must be called before any call
@@ -180,6 +284,133 @@ js_EnablePropertyCache(JSContext *cx)
         STORE_OPND(n, v_);                                                    \
     JS_END_MACRO
 
+/*
+ * Return the double in *vp if it's a temporary that the arithmetic op at pc,
+ * which pops it, may overwrite with its result instead of allocating one.
+ *
+ * That's the case when the op just before, which can only be followed by the
+ * one at pc, pushed it as a new double.  Nothing else refers to it then: the
+ * ops that copy a value either leave it on the stack with its generating pc
+ * (SETVAR and the like), or push the copy with a later pc (DUP), and POS,
+ * which returns its operand, isn't one of the ops below.  GROUP ops in
+ * between don't touch the stack.  The shared NaN and infinities that DIV and
+ * MOD return mustn't be overwritten.
+ */
+static jsdouble *
+RecyclableDouble(JSRuntime *rt, jsbytecode *pc, jsval *vp, jsint depth)
+{
+    jsbytecode *genpc;
+    jsdouble *dp;
+
+    if (!JSVAL_IS_DOUBLE(*vp))
+        return NULL;
+    genpc = (jsbytecode *) vp[-depth];
+    for (pc--; pc != genpc; pc--) {
+        if (*pc != JSOP_GROUP)
+            return NULL;
+    }
+    switch (*genpc) {
+      case JSOP_BITOR:
+      case JSOP_BITXOR:
+      case JSOP_BITAND:
+      case JSOP_LSH:
+      case JSOP_RSH:
+      case JSOP_URSH:
+      case JSOP_ADD:
+      case JSOP_SUB:
+      case JSOP_MUL:
+      case JSOP_DIV:
+      case JSOP_MOD:
+      case JSOP_BITNOT:
+      case JSOP_NEG:
+        break;
+      default:
+        return NULL;
+    }
+    dp = JSVAL_TO_DOUBLE(*vp);
+    if (dp == rt->jsNaN || dp == rt->jsNegativeInfinity ||
+        dp == rt->jsPositiveInfinity) {
+        return NULL;
+    }
+    return dp;
+}
+
+/*
+ * Return a double that the binary arithmetic op at pc, which popped its
+ * operands from sp[-1] and sp[0], may overwrite with its result: sp[0] if
+ * RecyclableDouble allows, or else sp[-1] if it allows for the op before and
+ * that op pushed sp[0] from a variable or a literal, not looking at sp[-1].
+ */
+static jsdouble *
+RecyclableOperand(JSRuntime *rt, jsbytecode *pc, jsval *sp, jsint depth)
+{
+    jsdouble *dp;
+    jsbytecode *pc2;
+
+    dp = RecyclableDouble(rt, pc, sp, depth);
+    if (dp || !JSVAL_IS_DOUBLE(sp[-1]))
+        return dp;
+    pc2 = (jsbytecode *) sp[-depth];
+    if (pc2 >= pc || pc2 < pc - JSOP_UINT24_LENGTH)
+        return NULL;
+    switch (*pc2) {
+      case JSOP_GETARG:
+      case JSOP_GETVAR:
+      case JSOP_GETGVAR:
+      case JSOP_NUMBER:
+      case JSOP_ZERO:
+      case JSOP_ONE:
+      case JSOP_UINT16:
+      case JSOP_UINT24:
+        break;
+      default:
+        return NULL;
+    }
+    if (pc2 + js_CodeSpec[*pc2].length != pc)
+        return NULL;
+    return RecyclableDouble(rt, pc2, sp - 1, depth);
+}
+
+/*
+ * Make the double result d of the arithmetic op at pc, which popped its top
+ * operand from vp and, if binary, the other one from vp[-1].  Store it in one
+ * of them if allowed, else in a new double.
+ */
+static JSBool
+NewArithmeticDouble(JSContext *cx, jsbytecode *pc, jsval *vp, jsint depth,
+                    JSBool binary, jsdouble d, jsval *rval)
+{
+    jsdouble *dp;
+
+    dp = binary
+         ? RecyclableOperand(cx->runtime, pc, vp, depth)
+         : RecyclableDouble(cx->runtime, pc, vp, depth);
+    if (!dp)
+        return js_NewDoubleValue(cx, d, rval);
+    *dp = d;
+    *rval = DOUBLE_TO_JSVAL(dp);
+    return JS_TRUE;
+}
+
+/*
+ * Like STORE_NUMBER, for the result of an arithmetic op as NewArithmeticDouble
+ * makes it.
+ */
+#define STORE_ARITHMETIC_NUMBER(cx, n, d, vp, binary)                         \
+    JS_BEGIN_MACRO                                                            \
+        jsint i_;                                                             \
+        jsval v_;                                                             \
+                                                                              \
+        if (JSDOUBLE_IS_INT(d, i_) && INT_FITS_IN_JSVAL(i_)) {                \
+            v_ = INT_TO_JSVAL(i_);                                            \
+        } else {                                                              \
+            ok = NewArithmeticDouble(cx, pc, vp, depth, binary, d, &v_);      \
+            if (!ok)                                                          \
+                goto out;                                                     \
+        }                                                                     \
+        STORE_OPND(n, v_);                                                    \
+    JS_END_MACRO
+
 #define STORE_INT(cx, n, i)                                                   \
     JS_BEGIN_MACRO                                                            \
         jsval v_;                                                             \
@@ -317,6 +548,73 @@ js_EnablePropertyCache(JSContext *cx)
         STORE_OPND(n, OBJECT_TO_JSVAL(obj));                                  \
     JS_END_MACRO
 
+/*
+ * Find the prototype of the wrapper object that the string, number or boolean
+ * v would get, so that its properties can be looked up without the wrapper.
+ */
+static JSBool
+GetPrimitivePrototype(JSContext *cx, jsval v, JSObject **protop)
+{
+    JSProtoKey key;
+
+    if (JSVAL_IS_STRING(v)) {
+        key = JSProto_String;
+    } else if (JSVAL_IS_NUMBER(v)) {
+        key = JSProto_Number;
+    } else {
+        JS_ASSERT(JSVAL_IS_BOOLEAN(v));
+        key = JSProto_Boolean;
+    }
+    if (!js_GetClassPrototype(cx, NULL, INT_TO_JSID(key), protop))
+        return JS_FALSE;
+    JS_ASSERT(*protop);
+    return JS_TRUE;
+}
+
+/*
+ * Get the property id of the primitive v, whose class prototype is proto.  A
+ * slot property with a stub getter is read from the object on proto's chain
+ * that holds it.  Otherwise v gets its wrapper after all, as a getter must
+ * see the wrapper as its this, and a missing property is reported on it.
+ */
+static JSBool
+GetPrimitiveProperty(JSContext *cx, jsval v, JSObject *proto, jsid id,
+                     jsval *vp)
+{
+    JSObject *obj;
+    JSProperty *prop;
+    JSScopeProperty *sprop;
+
+    if (!OBJ_LOOKUP_PROPERTY(cx, proto, id, &obj, &prop))
+        return JS_FALSE;
+    if (prop) {
+        if (OBJ_IS_NATIVE(obj)) {
+            sprop = (JSScopeProperty *) prop;
+            if (SPROP_HAS_STUB_GETTER(sprop) &&
+                SPROP_HAS_VALID_SLOT(sprop, OBJ_SCOPE(obj))) {
+                *vp = LOCKED_OBJ_GET_SLOT(obj, sprop->slot);
+                OBJ_DROP_PROPERTY(cx, obj, prop);
+                return JS_TRUE;
+            }
+        }
+        OBJ_DROP_PROPERTY(cx, obj, prop);
+    }
+
+    obj = js_ValueToNonNullObject(cx, v);
+    if (!obj)
+        return JS_FALSE;
+    return OBJ_GET_PROPERTY(cx, obj, id, vp);
+}
+
+/* Comparing strings reads their characters, so ropes are flattened first. */
+#define FLATTEN_STRING(cx, str)                                               \
+    JS_BEGIN_MACRO                                                            \
+        if (!JSSTRING_FLATTEN(cx, str)) {                                     \
+            ok = JS_FALSE;                                                    \
+            goto out;                                                         \
+        }                                                                     \
+    JS_END_MACRO
+
 #define VALUE_TO_PRIMITIVE(cx, v, hint, vp)                                   \
     JS_BEGIN_MACRO                                                            \
         if (JSVAL_IS_PRIMITIVE(v)) {                                          \
@@ -690,7 +988,7 @@ NoSuchMethod(JSContext *cx, JSStackFrame *fp, jsval *vp, uint32 flags,
         goto not_function;
 
     pc = (jsbytecode *) vp[-(intN)fp->script->depth];
-    switch ((JSOp) *pc) {
+    switch (JS_UNFUSED_OP(*pc)) {
       case JSOP_NAME:
       case JSOP_GETPROP:
 #if JS_HAS_XML_SUPPORT
@@ -1069,6 +1367,64 @@ LogCall(JSContext *cx, jsval callee, uintN argc, jsval *argv)
 # define ASSERT_NOT_THROWING(cx) /* nothing */
 #endif
 
+/*
+ * Call the JSFUN_FAST_NATIVE function fun on the [callee, this, args] at vp,
+ * with 'this' already computed, without pushing a frame.  The actuals are
+ * rooted by whoever pushed them, but missing formals and local root slots
+ * (JSFunctionSpec.extra) must follow them and be rooted too.  Push those on
+ * the caller's operand stack if its depth budget has room, which is where
+ * the interpreter's calls have their arguments, else copy everything to a
+ * segment that cx->stackHeaders roots and copy the result back.
+ */
+static JSBool
+CallFastNative(JSContext *cx, JSFunction *fun, uintN argc, jsval *vp)
+{
+    JSStackFrame *fp;
+    uintN nslots;
+    jsval *sp, *oldsp, *newvp;
+    void *mark;
+    JSBool ok;
+
+#if JS_HAS_LVALUE_RETURN
+    /* Set by JS_SetCallReturnValue2, used to return reference types. */
+    cx->rval2set = JS_FALSE;
+#endif
+
+    nslots = fun->u.n.extra;
+    if (fun->nargs > argc)
+        nslots += fun->nargs - argc;
+    if (nslots == 0) {
+        ok = ((JSFastNative) fun->u.n.native)(cx, argc, vp);
+    } else {
+        fp = cx->fp;
+        sp = vp + 2 + argc;
+        if (fp->script && fp->spbase && fp->sp == sp && fp->spbase <= sp &&
+            sp + nslots <= fp->spbase + fp->script->depth) {
+            oldsp = sp;
+            do {
+                PUSH(JSVAL_VOID);
+            } while (--nslots != 0);
+            SAVE_SP(fp);
+            ok = ((JSFastNative) fun->u.n.native)(cx, argc, vp);
+            fp->sp = oldsp;
+        } else {
+            newvp = js_AllocStack(cx, 2 + argc + nslots, &mark);
+            if (!newvp)
+                return JS_FALSE;
+            memcpy(newvp, vp, (2 + argc) * sizeof(jsval));
+            sp = newvp + 2 + argc;
+            do {
+                PUSH(JSVAL_VOID);
+            } while (--nslots != 0);
+            ok = ((JSFastNative) fun->u.n.native)(cx, argc, newvp);
+            *vp = *newvp;
+            js_FreeStack(cx, mark);
+        }
+    }
+    JS_RUNTIME_METER(cx->runtime, nativeCalls);
+    return ok;
+}
+
 /*
  * Find a function reference and its 'this' object implicit first parameter
  * under argc arguments on cx's stack, and call the function.  Push missing
@@ -1251,6 +1607,14 @@ have_fun:
     }
 
   init_frame:
+    if (native && fun && (fun->flags & JSFUN_FAST_NATIVE)) {
+        /* No frame, no hooks: the native finds 'this' in vp[1]. */
+        vp[1] = OBJECT_TO_JSVAL(thisp);
+        ok = CallFastNative(cx, fun, argc, vp);
+        frame.rval = *vp;
+        goto out2;
+    }
+
     /* Initialize the rest of frame, except for sp (set by SAVE_SP later). */
     frame.thisp = thisp;
     frame.varobj = NULL;
@@ -2034,6 +2398,11 @@ InternNonIntElementId(JSContext *cx, jsval idval, jsid *idp)
 # undef JS_THREADED_INTERP
 #endif
 
+/* Native code returns to the interpreter through its jump tables. */
+#if JS_HAS_JIT && !defined JS_THREADED_INTERP
+# error "JS_HAS_JIT requires JS_THREADED_INTERP"
+#endif
+
 JSBool
 js_Interpret(JSContext *cx, jsbytecode *pc, jsval *result)
 {
@@ -2050,6 +2419,9 @@ js_Interpret(JSContext *cx, jsbytecode *pc, jsval *result)
     jsval *sp, *newsp;
     void *mark;
     jsbytecode *endpc, *pc2;
+#if JS_HAS_JIT
+    jsbytecode *jitpc;
+#endif
     JSOp op, op2;
     jsatomid atomIndex;
     JSAtom *atom;
@@ -2103,6 +2475,15 @@ js_Interpret(JSContext *cx, jsbytecode *pc, jsval *result)
 # undef OPDEF
     };
 
+# if JS_HAS_JIT
+    static void *jitJumpTable[] = {
+# define OPDEF(op,val,name,token,length,nuses,ndefs,prec,format)              \
+        JS_EXTENSION &&jit,
+# include "jsopcode.tbl"
+# undef OPDEF
+    };
+# endif
+
     register void **jumpTable = normalJumpTable;
 
 # define DO_OP()            JS_EXTENSION_(goto *jumpTable[op])
@@ -2160,10 +2541,13 @@ js_Interpret(JSContext *cx, jsbytecode *pc, jsval *result)
     LOAD_BRANCH_CALLBACK(cx);
 #define CHECK_BRANCH(len)                                                     \
     JS_BEGIN_MACRO                                                            \
-        if (len <= 0 && onbranch) {                                           \
-            SAVE_SP_AND_PC(fp);                                               \
-            if (!(ok = (*onbranch)(cx, script)))                              \
-                goto out;                                                     \
+        if (len <= 0) {                                                       \
+            if (onbranch) {                                                   \
+                SAVE_SP_AND_PC(fp);                                           \
+                if (!(ok = (*onbranch)(cx, script)))                          \
+                    goto out;                                                 \
+            }                                                                 \
+            JIT_COUNT();                                                      \
         }                                                                     \
     JS_END_MACRO
 
@@ -2173,11 +2557,35 @@ js_Interpret(JSContext *cx, jsbytecode *pc, jsval *result)
      * not have to reload it each time through the interpreter loop -- we hope
      * the compiler can keep it in a register when it is non-null.
      */
-#ifdef JS_THREADED_INTERP
+#if JS_HAS_JIT
+# define LOAD_JUMP_TABLE()                                                    \
+    (jumpTable = interruptHandler ? interruptJumpTable                        \
+                 : script->jit ? jitJumpTable                                 \
+                 : normalJumpTable)
+#elif defined JS_THREADED_INTERP
 # define LOAD_JUMP_TABLE()                                                    \
     (jumpTable = interruptHandler ? interruptJumpTable : normalJumpTable)
 #else
 # define LOAD_JUMP_TABLE()      /* nothing */
+#endif
+
+    /*
+     * Count calls and backward branches of the script, to compile it once
+     * they show it's hot.  Reload the jump table after switching scripts, in
+     * case one of them has native code.
+     */
+#if JS_HAS_JIT
+# define JIT_COUNT()                                                          \
+    JS_BEGIN_MACRO                                                            \
+        if (script->jitCount < JIT_HOT_COUNT &&                               \
+            (cx->options & JSOPTION_JIT) &&                                   \
+            ++script->jitCount == JIT_HOT_COUNT) {                            \
+            js_CompileJit(cx, script);                                        \
+            LOAD_JUMP_TABLE();                                                \
+        }                                                                     \
+    JS_END_MACRO
+#else
+# define JIT_COUNT()            ((void) 0)
 #endif
 
 #define LOAD_INTERRUPT_HANDLER(rt)                                            \
@@ -2187,6 +2595,10 @@ js_Interpret(JSContext *cx, jsbytecode *pc, jsval *result)
     JS_END_MACRO
 
     LOAD_INTERRUPT_HANDLER(rt);
+#if JS_HAS_JIT
+    jitpc = NULL;
+#endif
+    JIT_COUNT();
 
     /* Check for too much js_Interpret nesting, or too deep a C stack. */
     if (++cx->interpLevel == MAX_INTERP_LEVEL ||
@@ -2270,11 +2682,37 @@ interrupt:
           default:;
         }
         LOAD_INTERRUPT_HANDLER(rt);
+
+        /* Run a superinstruction as its ops, so the handler sees each one. */
+        op = JS_UNFUSED_OP(op);
     }
 
     JS_ASSERT((uintN)op < (uintN)JSOP_LIMIT);
     JS_EXTENSION_(goto *normalJumpTable[op]);
 
+#if JS_HAS_JIT
+    /*
+     * While the script has native code, jitJumpTable brings every op here to
+     * run native code from it, unless native code just returned there as it
+     * can't run the op.  Then normalJumpTable runs the op.  Native code can
+     * leave obj stale, null it as the ops pushing a value do for PUSHOBJ.
+     */
+  jit:
+    if (!script->jit) {
+        LOAD_JUMP_TABLE();
+    } else if (pc != jitpc && !onbranch &&
+               JS_CLIST_IS_EMPTY(&rt->trapList) &&
+               script->jit->entry[pc - script->code] != 0) {
+        SAVE_SP(fp);
+        pc = JS_RUN_JIT(script->jit, fp, pc - script->code);
+        RESTORE_SP(fp);
+        jitpc = pc;
+        obj = NULL;
+        op = (JSOp) *pc;
+    }
+    JS_EXTENSION_(goto *normalJumpTable[op]);
+#endif
+
 #else  /* !JS_THREADED_INTERP */
 
     for (;;) {
@@ -2327,6 +2765,7 @@ interrupt:
               default:;
             }
             LOAD_INTERRUPT_HANDLER(rt);
+            op = JS_UNFUSED_OP(op);
         }
 
         switch (op) {
@@ -2482,6 +2921,7 @@ interrupt:
 
                 /* Resume execution in the calling frame. */
                 inlineCallCount--;
+                LOAD_JUMP_TABLE();
                 if (JS_LIKELY(ok)) {
                     JS_ASSERT(js_CodeSpec[*pc].length == JSOP_CALL_LENGTH);
                     len = JSOP_CALL_LENGTH;
@@ -2896,6 +3336,87 @@ interrupt:
         }                                                                     \
     JS_END_MACRO
 
+/*
+ * PROPERTY_IC_GET and PROPERTY_IC_SET use cx, pc, sprop and rval from their
+ * callers' environments.  On a hit in the inline cache entry for pc and the
+ * shape of obj, they get the property id into rval or set it to rval, and
+ * leave the cached property in sprop.  On a miss, they set sprop to null.
+ */
+#define PROPERTY_IC_GET(obj, id)                                              \
+    JS_BEGIN_MACRO                                                            \
+        JSPropertyIC *cache_ = &JS_PROPERTY_IC(cx);                           \
+        JSPropertyICEntry *pce_;                                              \
+        JSScopeProperty *shape_;                                              \
+        JSScope *scope_;                                                      \
+        JSObject *holder_;                                                    \
+                                                                              \
+        PCMETER(cache_->tests++);                                             \
+        sprop = NULL;                                                         \
+        pce_ = NULL;                                                          \
+        holder_ = NULL;                                                       \
+        if (OBJ_IS_NATIVE(obj)) {                                             \
+            JS_LOCK_OBJ(cx, obj);                                             \
+            scope_ = OBJ_SCOPE(obj);                                          \
+            shape_ = PROPERTY_IC_SHAPE(obj, scope_);                          \
+            pce_ = &cache_->table[PROPERTY_IC_HASH(pc, shape_)];              \
+            if (pce_->pc == pc && pce_->shape == shape_ &&                    \
+                pce_->clasp == LOCKED_OBJ_GET_CLASS(obj) &&                   \
+                pce_->sprop->id == (id)) {                                    \
+                if (!pce_->holder) {                                          \
+                    sprop = pce_->sprop;                                      \
+                    rval = LOCKED_OBJ_GET_SLOT(obj, sprop->slot);             \
+                } else if (pce_->holder == LOCKED_OBJ_GET_PROTO(obj)) {       \
+                    holder_ = pce_->holder;                                   \
+                }                                                             \
+            }                                                                 \
+            JS_UNLOCK_OBJ(cx, obj);                                           \
+        } else if (OBJ_IS_DENSE_ARRAY(cx, obj)) {                             \
+            pce_ = &cache_->table[PROPERTY_IC_HASH(pc,                        \
+                                                   PROPERTY_IC_DENSE_SHAPE)]; \
+            if (pce_->pc == pc && pce_->shape == PROPERTY_IC_DENSE_SHAPE &&   \
+                pce_->sprop->id == (id) &&                                    \
+                pce_->holder == LOCKED_OBJ_GET_PROTO(obj)) {                  \
+                holder_ = pce_->holder;                                       \
+            }                                                                 \
+        }                                                                     \
+        if (holder_) {                                                        \
+            JS_LOCK_OBJ(cx, holder_);                                         \
+            scope_ = OBJ_SCOPE(holder_);                                      \
+            if (PROPERTY_IC_SHAPE(holder_, scope_) == pce_->holderShape) {    \
+                sprop = pce_->sprop;                                          \
+                rval = LOCKED_OBJ_GET_SLOT(holder_, sprop->slot);             \
+            }                                                                 \
+            JS_UNLOCK_OBJ(cx, holder_);                                       \
+        }                                                                     \
+        PCMETER(if (!sprop) cache_->misses++);                                \
+    JS_END_MACRO
+
+#define PROPERTY_IC_SET(obj, id)                                              \
+    JS_BEGIN_MACRO                                                            \
+        JSPropertyIC *cache_ = &JS_PROPERTY_IC(cx);                           \
+        JSPropertyICEntry *pce_;                                              \
+        JSScopeProperty *shape_;                                              \
+        JSScope *scope_;                                                      \
+                                                                              \
+        PCMETER(cache_->tests++);                                             \
+        sprop = NULL;                                                         \
+        if (OBJ_IS_NATIVE(obj)) {                                             \
+            JS_LOCK_OBJ(cx, obj);                                             \
+            scope_ = OBJ_SCOPE(obj);                                          \
+            shape_ = PROPERTY_IC_SHAPE(obj, scope_);                          \
+            pce_ = &cache_->table[PROPERTY_IC_HASH(pc, shape_)];              \
+            if (pce_->pc == pc && pce_->shape == shape_ &&                    \
+                pce_->clasp == LOCKED_OBJ_GET_CLASS(obj) &&                   \
+                pce_->sprop->id == (id) &&                                    \
+                !pce_->holder && !SCOPE_IS_SEALED(scope_)) {                  \
+                sprop = pce_->sprop;                                          \
+                LOCKED_OBJ_SET_SLOT(obj, sprop->slot, rval);                  \
+            }                                                                 \
+            JS_UNLOCK_OBJ(cx, obj);                                           \
+        }                                                                     \
+        PCMETER(if (!sprop) cache_->misses++);                                \
+    JS_END_MACRO
+
 #define BEGIN_LITOPX_CASE(OP,PCOFF)                                           \
           BEGIN_CASE(OP)                                                      \
             pc2 = pc;                                                         \
@@ -2954,10 +3475,14 @@ interrupt:
             lval = FETCH_OPND(-2);
             JS_ASSERT(!JSVAL_IS_PRIMITIVE(lval));
             obj  = JSVAL_TO_OBJECT(lval);
-            SAVE_SP_AND_PC(fp);
-            CACHED_SET(OBJ_SET_PROPERTY(cx, obj, id, &rval));
-            if (!ok)
-                goto out;
+            PROPERTY_IC_SET(obj, id);
+            if (!sprop) {
+                js_FillPropertyIC(cx, pc, obj, id);
+                SAVE_SP_AND_PC(fp);
+                CACHED_SET(OBJ_SET_PROPERTY(cx, obj, id, &rval));
+                if (!ok)
+                    goto out;
+            }
             sp--;
             STORE_OPND(-1, rval);
             obj = NULL;
@@ -3010,6 +3535,8 @@ interrupt:
             if (JSVAL_IS_STRING(lval) && JSVAL_IS_STRING(rval)) {             \
                 str  = JSVAL_TO_STRING(lval);                                 \
                 str2 = JSVAL_TO_STRING(rval);                                 \
+                FLATTEN_STRING(cx, str);                                      \
+                FLATTEN_STRING(cx, str2);                                     \
                 cond = js_CompareStrings(str, str2) OP 0;                     \
             } else {                                                          \
                 VALUE_TO_NUMBER(cx, lval, d);                                 \
@@ -3075,6 +3602,8 @@ interrupt:
             if (ltmp == JSVAL_STRING) {                                       \
                 str  = JSVAL_TO_STRING(lval);                                 \
                 str2 = JSVAL_TO_STRING(rval);                                 \
+                FLATTEN_STRING(cx, str);                                      \
+                FLATTEN_STRING(cx, str2);                                     \
                 cond = js_EqualStrings(str, str2) OP JS_TRUE;                 \
             } else if (ltmp == JSVAL_DOUBLE) {                                \
                 d  = *JSVAL_TO_DOUBLE(lval);                                  \
@@ -3103,6 +3632,8 @@ interrupt:
                 if (ltmp == JSVAL_STRING && rtmp == JSVAL_STRING) {           \
                     str  = JSVAL_TO_STRING(lval);                             \
                     str2 = JSVAL_TO_STRING(rval);                             \
+                    FLATTEN_STRING(cx, str);                                  \
+                    FLATTEN_STRING(cx, str2);                                 \
                     cond = js_EqualStrings(str, str2) OP JS_TRUE;             \
                 } else {                                                      \
                     VALUE_TO_NUMBER(cx, lval, d);                             \
@@ -3127,6 +3658,12 @@ interrupt:
     JS_BEGIN_MACRO                                                            \
         rval = FETCH_OPND(-1);                                                \
         lval = FETCH_OPND(-2);                                                \
+        if (JSVAL_IS_STRING(lval) && JSVAL_IS_STRING(rval)) {                 \
+            str  = JSVAL_TO_STRING(lval);                                     \
+            str2 = JSVAL_TO_STRING(rval);                                     \
+            FLATTEN_STRING(cx, str);                                          \
+            FLATTEN_STRING(cx, str2);                                         \
+        }                                                                     \
         cond = js_StrictlyEqual(lval, rval) OP JS_TRUE;                       \
         sp--;                                                                 \
         STORE_OPND(-1, BOOLEAN_TO_JSVAL(cond));                               \
@@ -3182,6 +3719,67 @@ interrupt:
             RELATIONAL_OP(>=);
           END_CASE(JSOP_GE)
 
+/*
+ * Superinstructions for a comparison followed by JSOP_IFEQ or JSOP_IFNE take
+ * the branch on cond right away, instead of pushing it for the branch op.
+ */
+#define BRANCH_ON_COND()                                                      \
+    JS_BEGIN_MACRO                                                            \
+        op2 = (JSOp) pc[1];                                                   \
+        if (op2 == JSOP_IFEQ || op2 == JSOP_IFNE) {                           \
+            sp--;                                                             \
+            pc++;                                                             \
+            if (cond == (op2 == JSOP_IFNE)) {                                 \
+                len = GET_JUMP_OFFSET(pc);                                    \
+                CHECK_BRANCH(len);                                            \
+                DO_NEXT_OP(len);                                              \
+            }                                                                 \
+            len = JSOP_IFEQ_LENGTH;                                           \
+            DO_NEXT_OP(len);                                                  \
+        }                                                                     \
+    JS_END_MACRO
+
+          BEGIN_CASE(JSOP_EQBRANCH)
+            EQUALITY_OP(==, JS_FALSE);
+            BRANCH_ON_COND();
+          END_CASE(JSOP_EQBRANCH)
+
+          BEGIN_CASE(JSOP_NEBRANCH)
+            EQUALITY_OP(!=, JS_TRUE);
+            BRANCH_ON_COND();
+          END_CASE(JSOP_NEBRANCH)
+
+          BEGIN_CASE(JSOP_NEW_EQBRANCH)
+            NEW_EQUALITY_OP(==);
+            BRANCH_ON_COND();
+          END_CASE(JSOP_NEW_EQBRANCH)
+
+          BEGIN_CASE(JSOP_NEW_NEBRANCH)
+            NEW_EQUALITY_OP(!=);
+            BRANCH_ON_COND();
+          END_CASE(JSOP_NEW_NEBRANCH)
+
+          BEGIN_CASE(JSOP_LTBRANCH)
+            RELATIONAL_OP(<);
+            BRANCH_ON_COND();
+          END_CASE(JSOP_LTBRANCH)
+
+          BEGIN_CASE(JSOP_LEBRANCH)
+            RELATIONAL_OP(<=);
+            BRANCH_ON_COND();
+          END_CASE(JSOP_LEBRANCH)
+
+          BEGIN_CASE(JSOP_GTBRANCH)
+            RELATIONAL_OP(>);
+            BRANCH_ON_COND();
+          END_CASE(JSOP_GTBRANCH)
+
+          BEGIN_CASE(JSOP_GEBRANCH)
+            RELATIONAL_OP(>=);
+            BRANCH_ON_COND();
+          END_CASE(JSOP_GEBRANCH)
+
+#undef BRANCH_ON_COND
 #undef EQUALITY_OP
 #undef RELATIONAL_OP
 
@@ -3259,7 +3857,7 @@ interrupt:
                     VALUE_TO_NUMBER(cx, rval, d2);
                     d += d2;
                     sp--;
-                    STORE_NUMBER(cx, -1, d);
+                    STORE_ARITHMETIC_NUMBER(cx, -1, d, sp, JS_TRUE);
                 }
             }
           END_CASE(JSOP_ADD)
@@ -3270,7 +3868,7 @@ interrupt:
         FETCH_NUMBER(cx, -2, d);                                              \
         d = d OP d2;                                                          \
         sp--;                                                                 \
-        STORE_NUMBER(cx, -1, d);                                              \
+        STORE_ARITHMETIC_NUMBER(cx, -1, d, sp, JS_TRUE);                      \
     JS_END_MACRO
 
           BEGIN_CASE(JSOP_SUB)
@@ -3301,7 +3899,7 @@ interrupt:
                 STORE_OPND(-1, rval);
             } else {
                 d /= d2;
-                STORE_NUMBER(cx, -1, d);
+                STORE_ARITHMETIC_NUMBER(cx, -1, d, sp, JS_TRUE);
             }
           END_CASE(JSOP_DIV)
 
@@ -3317,7 +3915,7 @@ interrupt:
               if (!(JSDOUBLE_IS_FINITE(d) && JSDOUBLE_IS_INFINITE(d2)))
 #endif
                 d = fmod(d, d2);
-                STORE_NUMBER(cx, -1, d);
+                STORE_ARITHMETIC_NUMBER(cx, -1, d, sp, JS_TRUE);
             }
           END_CASE(JSOP_MOD)
 
@@ -3342,7 +3940,7 @@ interrupt:
             if (JSVAL_IS_INT(rval) && (i = JSVAL_TO_INT(rval)) != 0) {
                 i = -i;
                 JS_ASSERT(INT_FITS_IN_JSVAL(i));
-                rval = INT_TO_JSVAL(i);
+                STORE_OPND(-1, INT_TO_JSVAL(i));
             } else {
                 if (JSVAL_IS_DOUBLE(rval)) {
                     d = *JSVAL_TO_DOUBLE(rval);
@@ -3362,11 +3960,8 @@ interrupt:
 #else
                 d = -d;
 #endif
-                ok = js_NewNumberValue(cx, d, &rval);
-                if (!ok)
-                    goto out;
+                STORE_ARITHMETIC_NUMBER(cx, -1, d, sp - 1, JS_FALSE);
             }
-            STORE_OPND(-1, rval);
           END_CASE(JSOP_NEG)
 
           BEGIN_CASE(JSOP_POS)
@@ -3625,6 +4220,34 @@ interrupt:
             DO_NEXT_OP(len);
           }
 
+/*
+ * The result of the increment or decrement is popped right away, so its pre
+ * or post value doesn't matter and only an int variable needs updating.
+ */
+#define FAST_INCREMENT_POP_OP(OP,MINMAX)                                      \
+    slot = GET_VARNO(pc);                                                     \
+    JS_ASSERT(slot < fp->fun->u.i.nvars);                                     \
+    vp = fp->vars + slot;                                                     \
+    rval = *vp;                                                               \
+    if (pc[JSOP_INCVAR_LENGTH] != JSOP_POP ||                                 \
+        !JSVAL_IS_INT(rval) || rval == INT_TO_JSVAL(JSVAL_INT_##MINMAX)) {    \
+        op = JS_UNFUSED_OP(op);                                               \
+        DO_OP();                                                              \
+    }                                                                         \
+    *vp = rval OP 2;                                                          \
+    len = JSOP_INCVAR_LENGTH + JSOP_POP_LENGTH;                               \
+    DO_NEXT_OP(len);
+
+          BEGIN_CASE(JSOP_INCVARPOP)
+          BEGIN_CASE(JSOP_VARINCPOP)
+            FAST_INCREMENT_POP_OP(+, MAX);
+
+          BEGIN_CASE(JSOP_DECVARPOP)
+          BEGIN_CASE(JSOP_VARDECPOP)
+            FAST_INCREMENT_POP_OP(-, MIN);
+
+#undef FAST_INCREMENT_POP_OP
+
 /* NB: This macro doesn't use JS_BEGIN_MACRO/JS_END_MACRO around its body. */
 #define FAST_GLOBAL_INCREMENT_OP(SLOWOP,PRE,OPEQ,MINMAX)                      \
     slot = GET_VARNO(pc);                                                     \
@@ -3676,6 +4299,7 @@ interrupt:
 
           BEGIN_CASE(JSOP_GETPROP)
           BEGIN_CASE(JSOP_GETXPROP)
+          do_getprop:
             /* Get an immediate atom naming the property. */
             atom = GET_ATOM(cx, script, pc);
             lval = FETCH_OPND(-1);
@@ -3683,14 +4307,40 @@ interrupt:
                 atom == cx->runtime->atomState.lengthAtom) {
                 rval = INT_TO_JSVAL(JSSTRING_LENGTH(JSVAL_TO_STRING(lval)));
                 obj = NULL;
+            } else if (JSVAL_IS_PRIMITIVE(lval) &&
+                       !JSVAL_IS_NULL(lval) && !JSVAL_IS_VOID(lval)) {
+                /*
+                 * Look up a property of a string, number or boolean on its
+                 * class prototype, through the inline cache when it can, to
+                 * spare a wrapper object.  Leave lval tagged as non-object
+                 * in obj for a JSOP_PUSHOBJ, as JSOP_GETMETHOD does.
+                 */
+                id = ATOM_TO_JSID(atom);
+                SAVE_SP_AND_PC(fp);
+                if (!GetPrimitivePrototype(cx, lval, &obj)) {
+                    ok = JS_FALSE;
+                    goto out;
+                }
+                PROPERTY_IC_GET(obj, id);
+                if (!sprop) {
+                    ok = GetPrimitiveProperty(cx, lval, obj, id, &rval);
+                    if (!ok)
+                        goto out;
+                    js_FillPropertyIC(cx, pc, obj, id);
+                }
+                obj = (JSObject *) lval;
             } else {
                 id = ATOM_TO_JSID(atom);
                 VALUE_TO_OBJECT(cx, lval, obj);
                 STORE_OPND(-1, OBJECT_TO_JSVAL(obj));
-                SAVE_SP_AND_PC(fp);
-                CACHED_GET(OBJ_GET_PROPERTY(cx, obj, id, &rval));
-                if (!ok)
-                    goto out;
+                PROPERTY_IC_GET(obj, id);
+                if (!sprop) {
+                    SAVE_SP_AND_PC(fp);
+                    CACHED_GET(OBJ_GET_PROPERTY(cx, obj, id, &rval));
+                    if (!ok)
+                        goto out;
+                    js_FillPropertyIC(cx, pc, obj, id);
+                }
             }
             STORE_OPND(-1, rval);
           END_CASE(JSOP_GETPROP)
@@ -3702,7 +4352,15 @@ interrupt:
             /* Get an immediate atom naming the property. */
             atom = GET_ATOM(cx, script, pc);
             id   = ATOM_TO_JSID(atom);
-            PROPERTY_OP(-2, CACHED_SET(OBJ_SET_PROPERTY(cx, obj, id, &rval)));
+            FETCH_OBJECT(cx, -2, lval, obj);
+            PROPERTY_IC_SET(obj, id);
+            if (!sprop) {
+                js_FillPropertyIC(cx, pc, obj, id);
+                SAVE_SP_AND_PC(fp);
+                CACHED_SET(OBJ_SET_PROPERTY(cx, obj, id, &rval));
+                if (!ok)
+                    goto out;
+            }
             sp--;
             STORE_OPND(-1, rval);
             obj = NULL;
@@ -3710,6 +4368,33 @@ interrupt:
 
           BEGIN_CASE(JSOP_GETELEM)
           BEGIN_CASE(JSOP_GETXELEM)
+            /* Fast path for an element in a dense array's vector. */
+            lval = FETCH_OPND(-2);
+            rval = FETCH_OPND(-1);
+            if (JSVAL_IS_INT(rval) && !JSVAL_IS_PRIMITIVE(lval) &&
+                (obj = JSVAL_TO_OBJECT(lval), OBJ_IS_DENSE_ARRAY(cx, obj)) &&
+                (jsuint) (i = JSVAL_TO_INT(rval)) < ARRAY_DENSE_EXTENT(obj) &&
+                (rval = obj->slots[JSSLOT_ARRAY_ELEMENTS + i]) != JSVAL_HOLE) {
+                sp--;
+                STORE_OPND(-1, rval);
+                DO_NEXT_OP(JSOP_GETELEM_LENGTH);
+            }
+
+            /* Index a string directly instead of resolving on a wrapper. */
+            if (JSVAL_IS_STRING(lval) && JSVAL_IS_INT(rval) &&
+                (jsuint) (i = JSVAL_TO_INT(rval)) <
+                JSSTRING_LENGTH(JSVAL_TO_STRING(lval))) {
+                SAVE_SP_AND_PC(fp);
+                str = js_NewDependentString(cx, JSVAL_TO_STRING(lval),
+                                            (size_t) i, 1, 0);
+                if (!str) {
+                    ok = JS_FALSE;
+                    goto out;
+                }
+                sp--;
+                STORE_OPND(-1, STRING_TO_JSVAL(str));
+                DO_NEXT_OP(JSOP_GETELEM_LENGTH);
+            }
             ELEMENT_OP(-1, CACHED_GET(OBJ_GET_PROPERTY(cx, obj, id, &rval)));
             sp--;
             STORE_OPND(-1, rval);
@@ -3717,6 +4402,24 @@ interrupt:
 
           BEGIN_CASE(JSOP_SETELEM)
             rval = FETCH_OPND(-1);
+
+            /*
+             * Fast path for overwriting an element of a dense array.  Filling
+             * a hole has to look for indexed setters on the prototypes.
+             */
+            lval = FETCH_OPND(-3);
+            if (JSVAL_IS_INT(FETCH_OPND(-2)) && !JSVAL_IS_PRIMITIVE(lval) &&
+                (obj = JSVAL_TO_OBJECT(lval), OBJ_IS_DENSE_ARRAY(cx, obj)) &&
+                (jsuint) (i = JSVAL_TO_INT(FETCH_OPND(-2))) <
+                ARRAY_DENSE_EXTENT(obj) &&
+                (obj->slots[JSSLOT_ARRAY_ELEMENTS + i] != JSVAL_HOLE ||
+                 !js_PrototypeHasIndexedProperties(cx, obj))) {
+                obj->slots[JSSLOT_ARRAY_ELEMENTS + i] = rval;
+                sp -= 2;
+                STORE_OPND(-1, rval);
+                obj = NULL;
+                DO_NEXT_OP(JSOP_SETELEM_LENGTH);
+            }
             ELEMENT_OP(-2, CACHED_SET(OBJ_SET_PROPERTY(cx, obj, id, &rval)));
             sp -= 2;
             STORE_OPND(-1, rval);
@@ -3926,6 +4629,8 @@ interrupt:
                 obj = NULL;
                 inlineCallCount++;
                 JS_RUNTIME_METER(rt, inlineCalls);
+                LOAD_JUMP_TABLE();
+                JIT_COUNT();
 
                 /* Load first opcode and dispatch it (safe since JSOP_STOP). */
                 op = *pc;
@@ -3941,7 +4646,32 @@ interrupt:
                 goto out;
             }
 
-            ok = js_Invoke(cx, argc, 0);
+            /*
+             * Call fast natives here rather than through js_Invoke, unless
+             * 'this' needs a wrapper object or binding, which it handles.
+             */
+            if (VALUE_IS_FUNCTION(cx, lval) &&
+                (fun = (JSFunction *) JS_GetPrivate(cx, JSVAL_TO_OBJECT(lval)),
+                 fun->flags & JSFUN_FAST_NATIVE) &&
+                !JSFUN_BOUND_METHOD_TEST(fun->flags) &&
+                (JSVAL_IS_OBJECT(vp[1]) ||
+                 (JSVAL_IS_STRING(vp[1])
+                  ? JSFUN_THISP_TEST(JSFUN_THISP_FLAGS(fun->flags),
+                                     JSFUN_THISP_STRING)
+                  : JSVAL_IS_NUMBER(vp[1]) &&
+                    JSFUN_THISP_TEST(JSFUN_THISP_FLAGS(fun->flags),
+                                     JSFUN_THISP_NUMBER)))) {
+                if (JSVAL_IS_OBJECT(vp[1]) &&
+                    !js_ComputeThis(cx, JSVAL_TO_OBJECT(vp[1]), vp + 2)) {
+                    ok = JS_FALSE;
+                    goto out;
+                }
+                ok = CallFastNative(cx, fun, argc, vp);
+                fp->sp = vp + 1;
+                vp[-depth] = (jsval) pc;
+            } else {
+                ok = js_Invoke(cx, argc, 0);
+            }
             RESTORE_SP(fp);
             LOAD_BRANCH_CALLBACK(cx);
             LOAD_INTERRUPT_HANDLER(rt);
@@ -4001,6 +4731,19 @@ interrupt:
             atom = GET_ATOM(cx, script, pc);
             id   = ATOM_TO_JSID(atom);
 
+            /*
+             * When the scope chain is just the global object, look the name
+             * up in the inline cache as a property of the global object.
+             */
+            obj = fp->scopeChain;
+            if (!OBJ_GET_PARENT(cx, obj)) {
+                PROPERTY_IC_GET(obj, id);
+                if (sprop) {
+                    PUSH_OPND(rval);
+                    DO_NEXT_OP(JSOP_NAME_LENGTH);
+                }
+            }
+
             SAVE_SP_AND_PC(fp);
             ok = js_FindProperty(cx, id, &obj, &obj2, &prop);
             if (!ok)
@@ -4031,10 +4774,34 @@ interrupt:
                 sprop = (JSScopeProperty *)prop;
                 NATIVE_GET(cx, obj, obj2, sprop, &rval);
                 OBJ_DROP_PROPERTY(cx, obj2, prop);
+                if (obj == fp->scopeChain && !OBJ_GET_PARENT(cx, obj))
+                    js_FillPropertyIC(cx, pc, obj, id);
             }
             PUSH_OPND(rval);
           END_CASE(JSOP_NAME)
 
+          BEGIN_CASE(JSOP_CALLNAME)
+            /*
+             * Push a global function found in the inline cache, and the
+             * global object for JSOP_PUSHOBJ.
+             */
+            obj = fp->scopeChain;
+            if (pc[JSOP_NAME_LENGTH] == JSOP_PUSHOBJ &&
+                !OBJ_GET_PARENT(cx, obj)) {
+                atom = GET_ATOM(cx, script, pc);
+                id = ATOM_TO_JSID(atom);
+                PROPERTY_IC_GET(obj, id);
+                if (sprop) {
+                    PUSH_OPND(rval);
+                    pc += JSOP_NAME_LENGTH;
+                    PUSH_OPND(OBJECT_TO_JSVAL(obj));
+                    len = JSOP_PUSHOBJ_LENGTH;
+                    DO_NEXT_OP(len);
+                }
+            }
+            op = JSOP_NAME;
+            DO_OP();
+
           BEGIN_CASE(JSOP_UINT16)
             i = (jsint) GET_ATOM_INDEX(pc);
             rval = INT_TO_JSVAL(i);
@@ -4295,6 +5062,18 @@ interrupt:
             obj = NULL;
           END_CASE(JSOP_THIS)
 
+          BEGIN_CASE(JSOP_GETTHISPROP)
+            obj = fp->thisp;
+            if (pc[JSOP_THIS_LENGTH] != JSOP_GETPROP ||
+                (OBJ_GET_CLASS(cx, obj)->flags & JSCLASS_IS_EXTENDED)) {
+                op = JSOP_THIS;
+                DO_OP();
+            }
+            PUSH_OPND(OBJECT_TO_JSVAL(obj));
+            pc += JSOP_THIS_LENGTH;
+            len = JSOP_GETPROP_LENGTH;
+            goto do_getprop;
+
           BEGIN_CASE(JSOP_FALSE)
             PUSH_OPND(JSVAL_FALSE);
             obj = NULL;
@@ -4363,6 +5142,7 @@ interrupt:
     }
             if (JSVAL_IS_STRING(lval)) {
                 str  = JSVAL_TO_STRING(lval);
+                FLATTEN_STRING(cx, str);
                 SEARCH_PAIRS(
                     match = (JSVAL_IS_STRING(rval) &&
                              ((str2 = JSVAL_TO_STRING(rval)) == str ||
@@ -4440,6 +5220,7 @@ interrupt:
     }
             if (JSVAL_IS_STRING(lval)) {
                 str  = JSVAL_TO_STRING(lval);
+                FLATTEN_STRING(cx, str);
                 SEARCH_EXTENDED_PAIRS(
                     match = (JSVAL_IS_STRING(rval) &&
                              ((str2 = JSVAL_TO_STRING(rval)) == str ||
@@ -4603,6 +5384,18 @@ interrupt:
             obj = NULL;
           END_CASE(JSOP_GETARG)
 
+          BEGIN_CASE(JSOP_GETARGPROP)
+            if (pc[JSOP_GETARG_LENGTH] != JSOP_GETPROP) {
+                op = JSOP_GETARG;
+                DO_OP();
+            }
+            slot = GET_ARGNO(pc);
+            JS_ASSERT(slot < fp->fun->nargs);
+            PUSH_OPND(fp->argv[slot]);
+            pc += JSOP_GETARG_LENGTH;
+            len = JSOP_GETPROP_LENGTH;
+            goto do_getprop;
+
           BEGIN_CASE(JSOP_SETARG)
             slot = GET_ARGNO(pc);
             JS_ASSERT(slot < fp->fun->nargs);
@@ -4619,6 +5412,18 @@ interrupt:
             obj = NULL;
           END_CASE(JSOP_GETVAR)
 
+          BEGIN_CASE(JSOP_GETVARPROP)
+            if (pc[JSOP_GETVAR_LENGTH] != JSOP_GETPROP) {
+                op = JSOP_GETVAR;
+                DO_OP();
+            }
+            slot = GET_VARNO(pc);
+            JS_ASSERT(slot < fp->fun->u.i.nvars);
+            PUSH_OPND(fp->vars[slot]);
+            pc += JSOP_GETVAR_LENGTH;
+            len = JSOP_GETPROP_LENGTH;
+            goto do_getprop;
+
           BEGIN_CASE(JSOP_SETVAR)
             slot = GET_VARNO(pc);
             JS_ASSERT(slot < fp->fun->u.i.nvars);
@@ -4628,6 +5433,20 @@ interrupt:
             obj = NULL;
           END_CASE(JSOP_SETVAR)
 
+          BEGIN_CASE(JSOP_SETVARPOP)
+            if (pc[JSOP_SETVAR_LENGTH] != JSOP_POP) {
+                op = JSOP_SETVAR;
+                DO_OP();
+            }
+            slot = GET_VARNO(pc);
+            JS_ASSERT(slot < fp->fun->u.i.nvars);
+            vp = &fp->vars[slot];
+            GC_POKE(cx, *vp);
+            *vp = POP_OPND();
+            obj = NULL;
+            len = JSOP_SETVAR_LENGTH + JSOP_POP_LENGTH;
+          END_VARLEN_CASE
+
           BEGIN_CASE(JSOP_GETGVAR)
             slot = GET_VARNO(pc);
             JS_ASSERT(slot < fp->nvars);
@@ -5748,17 +6567,15 @@ interrupt:
                     if (!obj)
                         ok = JS_FALSE;
                 } else {
-                    CACHED_GET(OBJ_GET_PROPERTY(cx, obj, id, &rval));
+                    PROPERTY_IC_GET(obj, id);
+                    if (!sprop) {
+                        CACHED_GET(OBJ_GET_PROPERTY(cx, obj, id, &rval));
+                        if (ok)
+                            js_FillPropertyIC(cx, pc, obj, id);
+                    }
                 }
             } else {
-                if (JSVAL_IS_STRING(lval)) {
-                    i = JSProto_String;
-                } else if (JSVAL_IS_NUMBER(lval)) {
-                    i = JSProto_Number;
-                } else if (JSVAL_IS_BOOLEAN(lval)) {
-                    i = JSProto_Boolean;
-                } else {
-                    JS_ASSERT(JSVAL_IS_NULL(lval) || JSVAL_IS_VOID(lval));
+                if (JSVAL_IS_NULL(lval) || JSVAL_IS_VOID(lval)) {
                     str = js_DecompileValueGenerator(cx, JSDVG_SEARCH_STACK,
                                                      lval, NULL);
                     if (str) {
@@ -5769,12 +6586,16 @@ interrupt:
                     ok = JS_FALSE;
                     goto out;
                 }
-                ok = js_GetClassPrototype(cx, NULL, INT_TO_JSID(i), &obj);
+                ok = GetPrimitivePrototype(cx, lval, &obj);
                 if (!ok)
                     goto out;
-                JS_ASSERT(obj);
                 STORE_OPND(-1, OBJECT_TO_JSVAL(obj));
-                CACHED_GET(OBJ_GET_PROPERTY(cx, obj, id, &rval));
+                PROPERTY_IC_GET(obj, id);
+                if (!sprop) {
+                    CACHED_GET(OBJ_GET_PROPERTY(cx, obj, id, &rval));
+                    if (ok)
+                        js_FillPropertyIC(cx, pc, obj, id);
+                }
                 obj = (JSObject *) lval; /* keep tagged as non-object */
             }
             if (!ok)
@@ -5782,6 +6603,29 @@ interrupt:
             STORE_OPND(-1, rval);
           END_LITOPX_CASE(JSOP_GETMETHOD)
 
+          BEGIN_CASE(JSOP_CALLMETHOD)
+            /*
+             * Replace an object with its method found in the inline cache,
+             * and push the object for JSOP_PUSHOBJ.
+             */
+            lval = FETCH_OPND(-1);
+            if (pc[JSOP_GETMETHOD_LENGTH] == JSOP_PUSHOBJ &&
+                !JSVAL_IS_PRIMITIVE(lval)) {
+                obj = JSVAL_TO_OBJECT(lval);
+                atom = GET_ATOM(cx, script, pc);
+                id = ATOM_TO_JSID(atom);
+                PROPERTY_IC_GET(obj, id);
+                if (sprop) {
+                    STORE_OPND(-1, rval);
+                    pc += JSOP_GETMETHOD_LENGTH;
+                    PUSH_OPND(lval);
+                    len = JSOP_PUSHOBJ_LENGTH;
+                    DO_NEXT_OP(len);
+                }
+            }
+            op = JSOP_GETMETHOD;
+            DO_OP();
+
           BEGIN_LITOPX_CASE(JSOP_SETMETHOD, 0)
             /* Get an immediate atom naming the property. */
             id   = ATOM_TO_JSID(atom);
@@ -6013,13 +6857,8 @@ interrupt:
             obj  = JSVAL_TO_OBJECT(lval);
             JS_ASSERT(OBJ_GET_CLASS(cx, obj) == &js_ArrayClass);
             rval = FETCH_OPND(-1);
-
-            /* We know that the array is created with only a 'length' slot. */
-            i = obj->map->freeslot - (JSSLOT_FREE(&js_ArrayClass) + 1);
-            id = INT_TO_JSID(i);
-
             SAVE_SP_AND_PC(fp);
-            ok = OBJ_SET_PROPERTY(cx, obj, id, &rval);
+            ok = js_ArrayCompPush(cx, obj, rval);
             if (!ok)
                 goto out;
             --sp;
@@ -234,6 +234,73 @@ typedef struct JSPropertyCache {
         }                                                                     \
     JS_END_MACRO
 
+/*
+ * Inline caches for the JSOP_GETPROP, JSOP_GETMETHOD, JSOP_SETPROP, JSOP_SETNAME
+ * and JSOP_NAME sites of the interpreter.  An entry is keyed by the site's bytecode address
+ * and the shape of the object the site saw: the last property added to the
+ * object's own scope, which names the whole ordered set of its properties in
+ * the property tree, or null when the object has no own properties.  A site
+ * that sees objects of several shapes gets one entry per shape.
+ *
+ * An entry caches either a slot property of the object itself, or one of its
+ * prototype (the holder), in which case a hit also requires the object's
+ * prototype to be the holder and the holder's shape to be unchanged.  Dense
+ * arrays have no own named properties but length, so they use their own
+ * shape that only caches prototype properties.
+ *
+ * Each thread has its own cache, so entries are filled and tested without
+ * locking the cache.  The GC flushes all caches, as it may free the objects
+ * and property tree nodes the entries point to.
+ */
+#define PROPERTY_IC_LOG2        10
+#define PROPERTY_IC_SIZE        JS_BIT(PROPERTY_IC_LOG2)
+#define PROPERTY_IC_MASK        JS_BITMASK(PROPERTY_IC_LOG2)
+
+#define PROPERTY_IC_HASH(pc, shape) \
+    (((jsuword)(pc) ^ ((jsuword)(shape) >> JSVAL_TAGBITS)) & PROPERTY_IC_MASK)
+
+/* Shapes that are not property tree nodes; the former is never cached. */
+#define PROPERTY_IC_NO_SHAPE    ((JSScopeProperty *) 1)
+#define PROPERTY_IC_DENSE_SHAPE ((JSScopeProperty *) 2)
+
+/* The shape of the native object obj whose scope is scope. */
+#define PROPERTY_IC_SHAPE(obj, scope)                                         \
+    ((scope)->object != (obj)                                                 \
+     ? NULL                                                                   \
+     : SCOPE_HAD_MIDDLE_DELETE(scope)                                         \
+     ? PROPERTY_IC_NO_SHAPE                                                   \
+     : SCOPE_LAST_PROP(scope))
+
+typedef struct JSPropertyICEntry {
+    jsbytecode          *pc;            /* site of the lookup */
+    JSScopeProperty     *shape;         /* shape of the object */
+    JSClass             *clasp;         /* class of the object */
+    JSObject            *holder;        /* prototype holding sprop, or null */
+    JSScopeProperty     *holderShape;   /* shape of holder */
+    JSScopeProperty     *sprop;         /* slot property found */
+} JSPropertyICEntry;
+
+typedef struct JSPropertyIC {
+    JSPropertyICEntry   table[PROPERTY_IC_SIZE];
+    JSBool              empty;
+#ifdef JS_PROPERTY_CACHE_METERING
+    uint32              fills;
+    uint32              tests;
+    uint32              misses;
+    uint32              flushes;
+#endif
+} JSPropertyIC;
+
+/*
+ * Fill the inline cache entry for the property id of obj at pc, if the
+ * property is a slot property of obj or of its prototype.
+ */
+extern void
+js_FillPropertyIC(JSContext *cx, jsbytecode *pc, JSObject *obj, jsid id);
+
+extern void
+js_FlushPropertyIC(JSPropertyIC *cache);
+
 extern void
 js_FlushPropertyCache(JSContext *cx);
 
@@ -347,6 +414,9 @@ extern JSBool
 js_CheckRedeclaration(JSContext *cx, JSObject *obj, jsid id, uintN attrs,
                       JSObject **objp, JSProperty **propp);
 
+/*
+ * String operands must be flat, see JSSTRING_FLATTEN.
+ */
 extern JSBool
 js_StrictlyEqual(jsval lval, jsval rval);
 
@@ -0,0 +1,1082 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim: set ts=8 sw=4 et tw=78:
+ *
+ * ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is Mozilla Communicator client code, released
+ * March 31, 1998.
+ *
+ * The Initial Developer of the Original Code is
+ * Netscape Communications Corporation.
+ * Portions created by the Initial Developer are Copyright (C) 1998
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either of the GNU General Public License Version 2 or later (the "GPL"),
+ * or the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+/*
+ * Baseline compiler from JS bytecode to x86-64 machine code.
+ *
+ * Each op compiles to a template running it on the interpreter's operand
+ * stack in memory, for int and boolean operands.  Anything else returns to
+ * the interpreter at the op, which runs it and enters native code again at
+ * the next op with an entry point, see the jit label in js_Interpret.
+ * Native code doesn't allocate, call out or throw, so it needs no GC or
+ * exception bookkeeping, and it leaves the stack as the interpreter would
+ * have, including the pc of every operand that the decompiler reads.
+ *
+ * Registers, the callee-saved ones keep their value in all of native code:
+ *
+ *     rbx  operand stack pointer, fp->sp outside of native code
+ *     rbp  the runtime
+ *     r12  fp->vars
+ *     r13  fp->argv
+ *     r14  script->code, to make pcs from
+ *     r15  fp
+ *     rax, rcx, rdx, r11  scratch
+ */
+#include "jsstddef.h"
+#include <stdlib.h>
+#include <string.h>
+#include "jstypes.h"
+#include "jsutil.h"
+#include "jsapi.h"
+#include "jsatom.h"
+#include "jscntxt.h"
+#include "jsinterp.h"
+#include "jsjit.h"
+#include "jslock.h"
+#include "jsopcode.h"
+#include "jsscript.h"
+
+#if JS_HAS_JIT
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+enum {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+#define SP      RBX
+#define RT      RBP
+#define VARS    R12
+#define ARGV    R13
+#define CODE    R14
+#define FP      R15
+
+/* Condition codes, one is negated by flipping its low bit. */
+enum {
+    CC_O, CC_NO, CC_B, CC_AE, CC_E, CC_NE, CC_BE, CC_A,
+    CC_S, CC_NS, CC_P, CC_NP, CC_L, CC_GE, CC_LE, CC_G
+};
+#define CC_ALWAYS       (-1)
+
+/*
+ * Opcodes of the ALU ops with a register source operand.  Shifted right by
+ * 3, they are the opcode extensions of the same ops with an immediate.
+ */
+#define ALU_ADD         0x01
+#define ALU_OR          0x09
+#define ALU_AND         0x21
+#define ALU_SUB         0x29
+#define ALU_XOR         0x31
+#define ALU_CMP         0x39
+
+/* Opcode extensions of the shift (0xc1, 0xd1, 0xd3) and 0xf7 groups. */
+#define EXT_SHL         4
+#define EXT_SHR         5
+#define EXT_SAR         7
+#define EXT_NOT         2
+#define EXT_NEG         3
+#define EXT_DIV         6
+
+/*
+ * The low 32 bits of an int jsval hold it tagged, sign-extended to 64 bits.
+ * JSVAL_VOID looks like the int -2^30 there, which doesn't fit in a jsval.
+ */
+#define VOID32          ((int32) JSVAL_VOID)
+
+typedef struct JitFixup {
+    uint32          at;             /* code offset of the rel32 to patch */
+    uint32          target;         /* bytecode offset of the destination */
+    JSBool          exit;           /* to the destination's exit stub */
+} JitFixup;
+
+typedef struct JitCompiler {
+    JSContext       *cx;
+    JSScript        *script;
+    uint8           *code;          /* machine code generated so far */
+    uint32          length;         /* bytes of code */
+    uint32          capacity;       /* bytes allocated at code */
+    uint32          *labels;        /* code offsets by bytecode offset */
+    uint32          *exits;         /* exit stubs by bytecode offset */
+    JitFixup        *fixups;        /* rel32 jumps to patch */
+    uint32          nfixups;
+    uint32          maxfixups;
+    uint32          epilogue;       /* code offset returning rax */
+    uint32          off;            /* bytecode offset of the current op */
+    int32           pcdisp;         /* from an operand to its pc */
+    JSBool          ok;             /* false once out of memory */
+} JitCompiler;
+
+static void
+EmitByte(JitCompiler *jc, uint8 b)
+{
+    uint8 *code;
+
+    if (!jc->ok)
+        return;
+    if (jc->length == jc->capacity) {
+        code = (uint8 *) realloc(jc->code, 2 * jc->capacity);
+        if (!code) {
+            jc->ok = JS_FALSE;
+            return;
+        }
+        jc->code = code;
+        jc->capacity *= 2;
+    }
+    jc->code[jc->length++] = b;
+}
+
+static void
+EmitInt32(JitCompiler *jc, int32 i)
+{
+    EmitByte(jc, (uint8) i);
+    EmitByte(jc, (uint8) (i >> 8));
+    EmitByte(jc, (uint8) (i >> 16));
+    EmitByte(jc, (uint8) (i >> 24));
+}
+
+/*
+ * Emit opcode, a byte or 0x0f and a byte, after the REX prefix making it a
+ * 64-bit op if w and extending reg and rm to r8-r15.  The prefix is left out
+ * when it would be 0x40.
+ */
+static void
+EmitOpcode(JitCompiler *jc, JSBool w, uintN opcode, uintN reg, uintN rm)
+{
+    uintN rex;
+
+    rex = (w ? 8 : 0) | ((reg & 8) >> 1) | ((rm & 8) >> 3);
+    if (rex)
+        EmitByte(jc, (uint8) (0x40 | rex));
+    if (opcode > 0xff)
+        EmitByte(jc, (uint8) (opcode >> 8));
+    EmitByte(jc, (uint8) opcode);
+}
+
+/* Emit opcode with reg, a register or an opcode extension, and register rm. */
+static void
+EmitReg(JitCompiler *jc, JSBool w, uintN opcode, uintN reg, uintN rm)
+{
+    EmitOpcode(jc, w, opcode, reg, rm);
+    EmitByte(jc, (uint8) (0xc0 | (reg & 7) << 3 | (rm & 7)));
+}
+
+/* Emit opcode with reg and the memory operand [base + disp]. */
+static void
+EmitMem(JitCompiler *jc, JSBool w, uintN opcode, uintN reg, uintN base,
+        int32 disp)
+{
+    uintN mod;
+
+    EmitOpcode(jc, w, opcode, reg, base);
+    if (disp == 0 && (base & 7) != RBP)
+        mod = 0;
+    else if (disp == (int8) disp)
+        mod = 1;
+    else
+        mod = 2;
+    EmitByte(jc, (uint8) (mod << 6 | (reg & 7) << 3 | (base & 7)));
+    if ((base & 7) == RSP)
+        EmitByte(jc, 0x24);
+    if (mod == 1)
+        EmitByte(jc, (uint8) disp);
+    else if (mod == 2)
+        EmitInt32(jc, disp);
+}
+
+#define LOAD(jc,reg,base,disp)      EmitMem(jc, JS_TRUE, 0x8b, reg, base, disp)
+#define STORE(jc,base,disp,reg)     EmitMem(jc, JS_TRUE, 0x89, reg, base, disp)
+#define LEA(jc,reg,base,disp)       EmitMem(jc, JS_TRUE, 0x8d, reg, base, disp)
+#define MOV64(jc,dst,src)           EmitReg(jc, JS_TRUE, 0x89, src, dst)
+#define MOV32(jc,dst,src)           EmitReg(jc, JS_FALSE, 0x89, src, dst)
+#define ALU32(jc,op,dst,src)        EmitReg(jc, JS_FALSE, op, src, dst)
+#define CMP64(jc,a,b)               EmitReg(jc, JS_TRUE, ALU_CMP, b, a)
+#define TEST32(jc,a,b)              EmitReg(jc, JS_FALSE, 0x85, b, a)
+#define TEST64(jc,a,b)              EmitReg(jc, JS_TRUE, 0x85, b, a)
+#define UNARY32(jc,ext,reg)         EmitReg(jc, JS_FALSE, 0xf7, ext, reg)
+#define SHIFT32_1(jc,ext,reg)       EmitReg(jc, JS_FALSE, 0xd1, ext, reg)
+#define SHIFT32_CL(jc,ext,reg)      EmitReg(jc, JS_FALSE, 0xd3, ext, reg)
+#define IMUL32(jc,dst,src)          EmitReg(jc, JS_FALSE, 0x0faf, dst, src)
+#define MOVSXD(jc,dst,src)          EmitReg(jc, JS_TRUE, 0x63, dst, src)
+#define MOVZX8(jc,dst,src)          EmitReg(jc, JS_FALSE, 0x0fb6, dst, src)
+#define SETCC(jc,cc,reg)            EmitReg(jc, JS_FALSE, 0x0f90 | (cc), 0, reg)
+
+/* Emit the ALU op with an immediate, on 64 bits if w. */
+static void
+EmitAluImm(JitCompiler *jc, JSBool w, uintN op, uintN reg, int32 imm)
+{
+    if (imm == (int8) imm) {
+        EmitReg(jc, w, 0x83, op >> 3, reg);
+        EmitByte(jc, (uint8) imm);
+    } else {
+        EmitReg(jc, w, 0x81, op >> 3, reg);
+        EmitInt32(jc, imm);
+    }
+}
+
+/* Test the low byte of rax, rcx or rdx against imm. */
+static void
+EmitTestByte(JitCompiler *jc, uintN reg, uint8 imm)
+{
+    JS_ASSERT(reg <= RDX);
+    EmitReg(jc, JS_FALSE, 0xf6, 0, reg);
+    EmitByte(jc, imm);
+}
+
+static void
+EmitLoadImm(JitCompiler *jc, uintN reg, jsword imm)
+{
+    if (imm == (int32) imm) {
+        EmitReg(jc, JS_TRUE, 0xc7, 0, reg);
+        EmitInt32(jc, (int32) imm);
+    } else {
+        EmitOpcode(jc, JS_TRUE, 0xb8 + (reg & 7), 0, reg);
+        EmitInt32(jc, (int32) imm);
+        EmitInt32(jc, (int32) (imm >> 32));
+    }
+}
+
+/* Store imm, sign-extended to 64 bits, at [base + disp]. */
+static void
+EmitStoreImm(JitCompiler *jc, uintN base, int32 disp, int32 imm)
+{
+    EmitMem(jc, JS_TRUE, 0xc7, 0, base, disp);
+    EmitInt32(jc, imm);
+}
+
+/*
+ * Jump, on condition cc unless it's CC_ALWAYS, to the code of the op at
+ * bytecode offset target, or to its exit stub if exit.  The rel32 is patched
+ * once all ops are compiled.
+ */
+static void
+EmitJump(JitCompiler *jc, intN cc, uint32 target, JSBool exit)
+{
+    JitFixup *fixups, *fixup;
+
+    if (cc == CC_ALWAYS) {
+        EmitByte(jc, 0xe9);
+    } else {
+        EmitByte(jc, 0x0f);
+        EmitByte(jc, (uint8) (0x80 | cc));
+    }
+    if (jc->nfixups == jc->maxfixups) {
+        fixups = (JitFixup *)
+                 realloc(jc->fixups, 2 * jc->maxfixups * sizeof(JitFixup));
+        if (!fixups) {
+            jc->ok = JS_FALSE;
+            return;
+        }
+        jc->fixups = fixups;
+        jc->maxfixups *= 2;
+    }
+    fixup = &jc->fixups[jc->nfixups++];
+    fixup->at = jc->length;
+    fixup->target = target;
+    fixup->exit = exit;
+    EmitInt32(jc, 0);
+}
+
+/* Return to the interpreter at the current op, which it runs instead. */
+#define EXIT_IF(jc,cc)              EmitJump(jc, cc, (jc)->off, JS_TRUE)
+#define JUMP_TO(jc,cc,target)       EmitJump(jc, cc, target, JS_FALSE)
+
+/*
+ * Short forward jumps within the code of an op, bound to the code emitted
+ * next by BindShortJump.
+ */
+static uint32
+EmitShortJump(JitCompiler *jc, intN cc)
+{
+    EmitByte(jc, (uint8) (cc == CC_ALWAYS ? 0xeb : 0x70 | cc));
+    EmitByte(jc, 0);
+    return jc->length;
+}
+
+static void
+BindShortJump(JitCompiler *jc, uint32 at)
+{
+    if (!jc->ok)
+        return;
+    JS_ASSERT(jc->length - at < 0x80);
+    jc->code[at - 1] = (uint8) (jc->length - at);
+}
+
+/* Return to the interpreter at bytecode offset off. */
+static void
+EmitExit(JitCompiler *jc, uint32 off)
+{
+    LEA(jc, RAX, CODE, (int32) off);
+    EmitByte(jc, 0xe9);
+    EmitInt32(jc, (int32) (jc->epilogue - (jc->length + 4)));
+}
+
+/* Set the current op as the one that pushed the operand at sp[n]. */
+static void
+EmitStorePc(JitCompiler *jc, intN n)
+{
+    LEA(jc, R11, CODE, (int32) jc->off);
+    STORE(jc, SP, n * (int32) sizeof(jsval) + jc->pcdisp, R11);
+}
+
+static void
+EmitPush(JitCompiler *jc, uintN reg)
+{
+    STORE(jc, SP, 0, reg);
+    EmitStorePc(jc, 0);
+    LEA(jc, SP, SP, sizeof(jsval));
+}
+
+static void
+EmitPushImm(JitCompiler *jc, jsval v)
+{
+    if (v == (jsval) (int32) v) {
+        EmitStoreImm(jc, SP, 0, (int32) v);
+    } else {
+        EmitLoadImm(jc, RAX, (jsword) v);
+        STORE(jc, SP, 0, RAX);
+    }
+    EmitStorePc(jc, 0);
+    LEA(jc, SP, SP, sizeof(jsval));
+}
+
+/* Exit unless reg holds an int jsval, which JSVAL_VOID isn't. */
+static void
+EmitGuardInt(JitCompiler *jc, uintN reg)
+{
+    EmitTestByte(jc, reg, JSVAL_INT);
+    EXIT_IF(jc, CC_E);
+    EmitAluImm(jc, JS_TRUE, ALU_CMP, reg, VOID32);
+    EXIT_IF(jc, CC_E);
+}
+
+/*
+ * Load the operands of a binary op, sp[-2] into rax and sp[-1] into rcx, and
+ * exit unless both are ints.
+ */
+static void
+EmitLoadInts(JitCompiler *jc)
+{
+    LOAD(jc, RAX, SP, -2 * (int32) sizeof(jsval));
+    LOAD(jc, RCX, SP, -1 * (int32) sizeof(jsval));
+    MOV32(jc, RDX, RAX);
+    ALU32(jc, ALU_AND, RDX, RCX);
+    EmitTestByte(jc, RDX, JSVAL_INT);
+    EXIT_IF(jc, CC_E);
+    EmitAluImm(jc, JS_TRUE, ALU_CMP, RAX, VOID32);
+    EXIT_IF(jc, CC_E);
+    EmitAluImm(jc, JS_TRUE, ALU_CMP, RCX, VOID32);
+    EXIT_IF(jc, CC_E);
+}
+
+/*
+ * Store the tagged int in eax as the result at sp[n] of an op with -n
+ * operands.  The int -2^30 doesn't fit in a jsval and must be a double, so
+ * exit for the interpreter to make it.
+ */
+static void
+EmitIntResult(JitCompiler *jc, intN n)
+{
+    EmitAluImm(jc, JS_FALSE, ALU_CMP, RAX, VOID32);
+    EXIT_IF(jc, CC_E);
+    MOVSXD(jc, RAX, RAX);
+    STORE(jc, SP, n * (int32) sizeof(jsval), RAX);
+    EmitStorePc(jc, n);
+    if (n < -1)
+        LEA(jc, SP, SP, (n + 1) * (int32) sizeof(jsval));
+}
+
+/* Store the boolean for condition cc as the result of a binary op. */
+static void
+EmitBooleanResult(JitCompiler *jc, intN cc)
+{
+    SETCC(jc, cc, RDX);
+    MOVZX8(jc, RDX, RDX);
+    EmitReg(jc, JS_FALSE, 0xc1, EXT_SHL, RDX);
+    EmitByte(jc, JSVAL_TAGBITS);
+    EmitAluImm(jc, JS_FALSE, ALU_OR, RDX, JSVAL_BOOLEAN);
+    STORE(jc, SP, -2 * (int32) sizeof(jsval), RDX);
+    EmitStorePc(jc, -2);
+    LEA(jc, SP, SP, -1 * (int32) sizeof(jsval));
+}
+
+static uint32
+OpLength(jsbytecode *pc)
+{
+    const JSCodeSpec *cs;
+    uint32 type;
+    ptrdiff_t jmplen;
+    jsbytecode *pc2;
+    jsint low, high;
+    jsatomid npairs;
+
+    cs = &js_CodeSpec[*pc];
+    type = cs->format & JOF_TYPEMASK;
+    switch (type) {
+      case JOF_TABLESWITCH:
+      case JOF_TABLESWITCHX:
+        jmplen = (type == JOF_TABLESWITCH) ? JUMP_OFFSET_LEN
+                                           : JUMPX_OFFSET_LEN;
+        pc2 = pc + jmplen;
+        low = GET_JUMP_OFFSET(pc2);
+        pc2 += JUMP_OFFSET_LEN;
+        high = GET_JUMP_OFFSET(pc2);
+        pc2 += JUMP_OFFSET_LEN;
+        return 1 + PTRDIFF(pc2, pc, jsbytecode) + (high - low + 1) * jmplen;
+
+      case JOF_LOOKUPSWITCH:
+      case JOF_LOOKUPSWITCHX:
+        jmplen = (type == JOF_LOOKUPSWITCH) ? JUMP_OFFSET_LEN
+                                            : JUMPX_OFFSET_LEN;
+        pc2 = pc + jmplen;
+        npairs = GET_ATOM_INDEX(pc2);
+        pc2 += ATOM_INDEX_LEN;
+        return 1 + PTRDIFF(pc2, pc, jsbytecode) +
+               npairs * (ATOM_INDEX_LEN + jmplen);
+
+      case JOF_LITOPX:
+        /* The interpreter runs both ops, compile them as one. */
+        return cs->length + js_CodeSpec[pc[1 + LITERAL_INDEX_LEN]].length -
+               (1 + ATOM_INDEX_LEN);
+    }
+    return cs->length;
+}
+
+static uint32
+JumpTarget(JitCompiler *jc, jsbytecode *pc)
+{
+    JSOp op;
+
+    op = (JSOp) *pc;
+    return PTRDIFF(pc, jc->script->code, jsbytecode) +
+           ((op == JSOP_IFEQX || op == JSOP_IFNEX || op == JSOP_GOTOX)
+            ? GET_JUMPX_OFFSET(pc)
+            : GET_JUMP_OFFSET(pc));
+}
+
+/*
+ * Test the truth of the value in rax, exiting unless it's a boolean, null or
+ * an int.  Control falls through if it's true, and takes the short jumps
+ * returned in falses if it's false.
+ */
+static void
+EmitTruth(JitCompiler *jc, uint32 falses[4])
+{
+    uint32 truth;
+
+    EmitAluImm(jc, JS_TRUE, ALU_CMP, RAX, (int32) JSVAL_TRUE);
+    truth = EmitShortJump(jc, CC_E);
+    EmitAluImm(jc, JS_TRUE, ALU_CMP, RAX, (int32) JSVAL_FALSE);
+    falses[0] = EmitShortJump(jc, CC_E);
+    TEST64(jc, RAX, RAX);
+    falses[1] = EmitShortJump(jc, CC_E);
+    EmitTestByte(jc, RAX, JSVAL_INT);
+    EXIT_IF(jc, CC_E);
+    EmitAluImm(jc, JS_TRUE, ALU_CMP, RAX, (int32) JSVAL_ZERO);
+    falses[2] = EmitShortJump(jc, CC_E);
+    EmitAluImm(jc, JS_TRUE, ALU_CMP, RAX, VOID32);
+    falses[3] = EmitShortJump(jc, CC_E);
+    BindShortJump(jc, truth);
+}
+
+static void
+BindShortJumps(JitCompiler *jc, uint32 at[4])
+{
+    uintN i;
+
+    for (i = 0; i < 4; i++)
+        BindShortJump(jc, at[i]);
+}
+
+/*
+ * Finish a compare op whose result is condition cc.  When an IFEQ or IFNE
+ * consumes the result, branch on the condition and skip the IF's code,
+ * which is still compiled for jumps to it.
+ */
+static void
+EmitCompareResult(JitCompiler *jc, jsbytecode *pc, intN cc)
+{
+    jsbytecode *pc2;
+    JSOp op2;
+
+    pc2 = pc + js_CodeSpec[*pc].length;
+    op2 = (JSOp) *pc2;
+    if (op2 != JSOP_IFEQ && op2 != JSOP_IFNE &&
+        op2 != JSOP_IFEQX && op2 != JSOP_IFNEX) {
+        EmitBooleanResult(jc, cc);
+        return;
+    }
+
+    /* lea leaves the flags alone. */
+    LEA(jc, SP, SP, -2 * (int32) sizeof(jsval));
+    if (op2 == JSOP_IFEQ || op2 == JSOP_IFEQX)
+        cc ^= 1;
+    JUMP_TO(jc, cc, JumpTarget(jc, pc2));
+    JUMP_TO(jc, CC_ALWAYS,
+            PTRDIFF(pc2, jc->script->code, jsbytecode) +
+            js_CodeSpec[op2].length);
+}
+
+/*
+ * Increment or decrement the int variable or argument at [base + disp], and
+ * push its old value if post or else its new one.
+ */
+static void
+EmitIncOp(JitCompiler *jc, uintN base, int32 disp, JSBool inc, JSBool post)
+{
+    LOAD(jc, RAX, base, disp);
+    EmitGuardInt(jc, RAX);
+    EmitAluImm(jc, JS_TRUE, ALU_CMP, RAX,
+               inc ? (int32) INT_TO_JSVAL(JSVAL_INT_MAX)
+                   : (int32) INT_TO_JSVAL(JSVAL_INT_MIN));
+    EXIT_IF(jc, CC_E);
+    LEA(jc, RCX, RAX, inc ? 2 : -2);
+    STORE(jc, base, disp, RCX);
+    EmitPush(jc, post ? RAX : RCX);
+}
+
+/* Store sp[-1] in the variable or argument at [base + disp]. */
+static void
+EmitSetOp(JitCompiler *jc, uintN base, int32 disp)
+{
+    LOAD(jc, RAX, SP, -1 * (int32) sizeof(jsval));
+
+    /* GC_POKE, always as the DEBUG version does to save a test. */
+    EmitMem(jc, JS_FALSE, 0xc6, 0, RT, offsetof(JSRuntime, gcPoke));
+    EmitByte(jc, 1);
+    STORE(jc, base, disp, RAX);
+}
+
+/*
+ * Compile the op at pc, or return false to leave it to the interpreter.
+ * Exits must come before the op changes anything, for the interpreter to
+ * run it from the start.
+ */
+static JSBool
+CompileOp(JitCompiler *jc, jsbytecode *pc)
+{
+    JSOp op;
+    JSAtom *atom;
+    uint32 at, falses[4];
+    intN cc;
+
+    op = (JSOp) *pc;
+
+    /*
+     * Superinstructions fusing a pop or a branch compile as their first op,
+     * the second one has its own code.  The ones getting a property or a
+     * callee are left to the interpreter.
+     */
+    if (op < JSOP_GETARGPROP)
+        op = JS_UNFUSED_OP(op);
+
+    switch (op) {
+      case JSOP_NOP:
+      case JSOP_GROUP:
+        break;
+
+      case JSOP_PUSH:
+        EmitPushImm(jc, JSVAL_VOID);
+        break;
+
+      case JSOP_POP:
+        LEA(jc, SP, SP, -1 * (int32) sizeof(jsval));
+        break;
+
+      case JSOP_POP2:
+        LEA(jc, SP, SP, -2 * (int32) sizeof(jsval));
+        break;
+
+      case JSOP_DUP:
+        LOAD(jc, RAX, SP, -1 * (int32) sizeof(jsval));
+        STORE(jc, SP, 0, RAX);
+        LOAD(jc, R11, SP, -1 * (int32) sizeof(jsval) + jc->pcdisp);
+        STORE(jc, SP, jc->pcdisp, R11);
+        LEA(jc, SP, SP, sizeof(jsval));
+        break;
+
+      case JSOP_DUP2:
+        LOAD(jc, RAX, SP, -2 * (int32) sizeof(jsval));
+        LOAD(jc, RCX, SP, -1 * (int32) sizeof(jsval));
+        STORE(jc, SP, 0, RAX);
+        STORE(jc, SP, sizeof(jsval), RCX);
+        LOAD(jc, R11, SP, -1 * (int32) sizeof(jsval) + jc->pcdisp);
+        STORE(jc, SP, jc->pcdisp, R11);
+        STORE(jc, SP, sizeof(jsval) + jc->pcdisp, R11);
+        LEA(jc, SP, SP, 2 * sizeof(jsval));
+        break;
+
+      case JSOP_ZERO:
+        EmitPushImm(jc, JSVAL_ZERO);
+        break;
+
+      case JSOP_ONE:
+        EmitPushImm(jc, JSVAL_ONE);
+        break;
+
+      case JSOP_NULL:
+        EmitPushImm(jc, JSVAL_NULL);
+        break;
+
+      case JSOP_FALSE:
+        EmitPushImm(jc, JSVAL_FALSE);
+        break;
+
+      case JSOP_TRUE:
+        EmitPushImm(jc, JSVAL_TRUE);
+        break;
+
+      case JSOP_UINT16:
+        EmitPushImm(jc, INT_TO_JSVAL((jsint) GET_ATOM_INDEX(pc)));
+        break;
+
+      case JSOP_UINT24:
+        EmitPushImm(jc, INT_TO_JSVAL((jsint) GET_LITERAL_INDEX(pc)));
+        break;
+
+      case JSOP_NUMBER:
+      case JSOP_STRING:
+        atom = js_GetAtom(jc->cx, &jc->script->atomMap, GET_ATOM_INDEX(pc));
+        EmitLoadImm(jc, RAX, (jsword) ATOM_KEY(atom));
+        EmitPush(jc, RAX);
+        break;
+
+      case JSOP_GETVAR:
+        LOAD(jc, RAX, VARS, GET_VARNO(pc) * sizeof(jsval));
+        EmitPush(jc, RAX);
+        break;
+
+      case JSOP_GETARG:
+        LOAD(jc, RAX, ARGV, GET_ARGNO(pc) * sizeof(jsval));
+        EmitPush(jc, RAX);
+        break;
+
+      case JSOP_SETVAR:
+        EmitSetOp(jc, VARS, GET_VARNO(pc) * sizeof(jsval));
+        break;
+
+      case JSOP_SETARG:
+        EmitSetOp(jc, ARGV, GET_ARGNO(pc) * sizeof(jsval));
+        break;
+
+      case JSOP_INCVAR:
+      case JSOP_DECVAR:
+      case JSOP_VARINC:
+      case JSOP_VARDEC:
+        EmitIncOp(jc, VARS, GET_VARNO(pc) * sizeof(jsval),
+                  op == JSOP_INCVAR || op == JSOP_VARINC,
+                  op == JSOP_VARINC || op == JSOP_VARDEC);
+        break;
+
+      case JSOP_INCARG:
+      case JSOP_DECARG:
+      case JSOP_ARGINC:
+      case JSOP_ARGDEC:
+        EmitIncOp(jc, ARGV, GET_ARGNO(pc) * sizeof(jsval),
+                  op == JSOP_INCARG || op == JSOP_ARGINC,
+                  op == JSOP_ARGINC || op == JSOP_ARGDEC);
+        break;
+
+      case JSOP_ADD:
+        EmitLoadInts(jc);
+        EmitAluImm(jc, JS_FALSE, ALU_SUB, RAX, 1);
+        ALU32(jc, ALU_ADD, RAX, RCX);
+        EXIT_IF(jc, CC_O);
+        EmitIntResult(jc, -2);
+        break;
+
+      case JSOP_SUB:
+        EmitLoadInts(jc);
+        ALU32(jc, ALU_SUB, RAX, RCX);
+        EXIT_IF(jc, CC_O);
+        EmitAluImm(jc, JS_FALSE, ALU_OR, RAX, 1);
+        EmitIntResult(jc, -2);
+        break;
+
+      case JSOP_MUL:
+        /* A zero product is -0 if either factor is negative. */
+        EmitLoadInts(jc);
+        MOV32(jc, RDX, RAX);
+        ALU32(jc, ALU_OR, RDX, RCX);
+        SHIFT32_1(jc, EXT_SAR, RAX);
+        EmitAluImm(jc, JS_FALSE, ALU_SUB, RCX, 1);
+        IMUL32(jc, RAX, RCX);
+        EXIT_IF(jc, CC_O);
+        TEST32(jc, RAX, RAX);
+        at = EmitShortJump(jc, CC_NE);
+        TEST32(jc, RDX, RDX);
+        EXIT_IF(jc, CC_S);
+        BindShortJump(jc, at);
+        EmitAluImm(jc, JS_FALSE, ALU_OR, RAX, 1);
+        EmitIntResult(jc, -2);
+        break;
+
+      case JSOP_MOD:
+        /* Only x % y for x >= 0 and y > 0, the others may give -0 or NaN. */
+        EmitLoadInts(jc);
+        SHIFT32_1(jc, EXT_SAR, RAX);
+        SHIFT32_1(jc, EXT_SAR, RCX);
+        TEST32(jc, RAX, RAX);
+        EXIT_IF(jc, CC_S);
+        TEST32(jc, RCX, RCX);
+        EXIT_IF(jc, CC_LE);
+        ALU32(jc, ALU_XOR, RDX, RDX);
+        UNARY32(jc, EXT_DIV, RCX);
+        MOV32(jc, RAX, RDX);
+        ALU32(jc, ALU_ADD, RAX, RAX);
+        EmitAluImm(jc, JS_FALSE, ALU_OR, RAX, 1);
+        EmitIntResult(jc, -2);
+        break;
+
+      case JSOP_BITAND:
+      case JSOP_BITOR:
+        EmitLoadInts(jc);
+        ALU32(jc, op == JSOP_BITAND ? ALU_AND : ALU_OR, RAX, RCX);
+        EmitIntResult(jc, -2);
+        break;
+
+      case JSOP_BITXOR:
+        EmitLoadInts(jc);
+        ALU32(jc, ALU_XOR, RAX, RCX);
+        EmitAluImm(jc, JS_FALSE, ALU_OR, RAX, 1);
+        EmitIntResult(jc, -2);
+        break;
+
+      case JSOP_LSH:
+      case JSOP_RSH:
+      case JSOP_URSH:
+        /* The shift count is masked to 5 bits like (j & 31). */
+        EmitLoadInts(jc);
+        SHIFT32_1(jc, EXT_SAR, RAX);
+        SHIFT32_1(jc, EXT_SAR, RCX);
+        SHIFT32_CL(jc,
+                   op == JSOP_LSH ? EXT_SHL : op == JSOP_RSH ? EXT_SAR : EXT_SHR,
+                   RAX);
+        if (op == JSOP_URSH) {
+            EmitAluImm(jc, JS_FALSE, ALU_CMP, RAX, JSVAL_INT_MAX);
+            EXIT_IF(jc, CC_A);
+        }
+        ALU32(jc, ALU_ADD, RAX, RAX);
+        if (op == JSOP_LSH)
+            EXIT_IF(jc, CC_O);
+        EmitAluImm(jc, JS_FALSE, ALU_OR, RAX, 1);
+        EmitIntResult(jc, -2);
+        break;
+
+      case JSOP_NEG:
+        /* -(2i + 1) + 2 is the tagged -i, for i != 0 as -0 is a double. */
+        LOAD(jc, RAX, SP, -1 * (int32) sizeof(jsval));
+        EmitGuardInt(jc, RAX);
+        EmitAluImm(jc, JS_TRUE, ALU_CMP, RAX, (int32) JSVAL_ZERO);
+        EXIT_IF(jc, CC_E);
+        UNARY32(jc, EXT_NEG, RAX);
+        EmitAluImm(jc, JS_FALSE, ALU_ADD, RAX, 2);
+        EmitIntResult(jc, -1);
+        break;
+
+      case JSOP_POS:
+        LOAD(jc, RAX, SP, -1 * (int32) sizeof(jsval));
+        EmitGuardInt(jc, RAX);
+        EmitStorePc(jc, -1);
+        break;
+
+      case JSOP_BITNOT:
+        /* ~(2i + 1) | 1 is the tagged ~i. */
+        LOAD(jc, RAX, SP, -1 * (int32) sizeof(jsval));
+        EmitGuardInt(jc, RAX);
+        UNARY32(jc, EXT_NOT, RAX);
+        EmitAluImm(jc, JS_FALSE, ALU_OR, RAX, 1);
+        EmitIntResult(jc, -1);
+        break;
+
+      case JSOP_NOT:
+        LOAD(jc, RAX, SP, -1 * (int32) sizeof(jsval));
+        EmitTruth(jc, falses);
+        EmitStoreImm(jc, SP, -1 * (int32) sizeof(jsval), (int32) JSVAL_FALSE);
+        at = EmitShortJump(jc, CC_ALWAYS);
+        BindShortJumps(jc, falses);
+        EmitStoreImm(jc, SP, -1 * (int32) sizeof(jsval), (int32) JSVAL_TRUE);
+        BindShortJump(jc, at);
+        EmitStorePc(jc, -1);
+        break;
+
+      case JSOP_LT:
+      case JSOP_LE:
+      case JSOP_GT:
+      case JSOP_GE:
+        EmitLoadInts(jc);
+        ALU32(jc, ALU_CMP, RAX, RCX);
+        cc = (op == JSOP_LT) ? CC_L
+           : (op == JSOP_LE) ? CC_LE
+           : (op == JSOP_GT) ? CC_G
+           : CC_GE;
+        EmitCompareResult(jc, pc, cc);
+        break;
+
+      case JSOP_EQ:
+      case JSOP_NE:
+      case JSOP_NEW_EQ:
+      case JSOP_NEW_NE:
+        /*
+         * Two ints, void included, or two booleans are equal if their jsvals
+         * are, with or without conversions.
+         */
+        LOAD(jc, RAX, SP, -2 * (int32) sizeof(jsval));
+        LOAD(jc, RCX, SP, -1 * (int32) sizeof(jsval));
+        MOV32(jc, RDX, RAX);
+        ALU32(jc, ALU_AND, RDX, RCX);
+        EmitTestByte(jc, RDX, JSVAL_INT);
+        at = EmitShortJump(jc, CC_NE);
+        MOV32(jc, RDX, RAX);
+        EmitAluImm(jc, JS_FALSE, ALU_AND, RDX, JSVAL_TAGMASK);
+        EmitAluImm(jc, JS_FALSE, ALU_CMP, RDX, JSVAL_BOOLEAN);
+        EXIT_IF(jc, CC_NE);
+        MOV32(jc, RDX, RCX);
+        EmitAluImm(jc, JS_FALSE, ALU_AND, RDX, JSVAL_TAGMASK);
+        EmitAluImm(jc, JS_FALSE, ALU_CMP, RDX, JSVAL_BOOLEAN);
+        EXIT_IF(jc, CC_NE);
+        BindShortJump(jc, at);
+        CMP64(jc, RAX, RCX);
+        EmitCompareResult(jc, pc,
+                          (op == JSOP_EQ || op == JSOP_NEW_EQ) ? CC_E : CC_NE);
+        break;
+
+      case JSOP_IFEQ:
+      case JSOP_IFEQX:
+        LOAD(jc, RAX, SP, -1 * (int32) sizeof(jsval));
+        EmitTruth(jc, falses);
+        LEA(jc, SP, SP, -1 * (int32) sizeof(jsval));
+        at = EmitShortJump(jc, CC_ALWAYS);
+        BindShortJumps(jc, falses);
+        LEA(jc, SP, SP, -1 * (int32) sizeof(jsval));
+        JUMP_TO(jc, CC_ALWAYS, JumpTarget(jc, pc));
+        BindShortJump(jc, at);
+        break;
+
+      case JSOP_IFNE:
+      case JSOP_IFNEX:
+        LOAD(jc, RAX, SP, -1 * (int32) sizeof(jsval));
+        EmitTruth(jc, falses);
+        LEA(jc, SP, SP, -1 * (int32) sizeof(jsval));
+        JUMP_TO(jc, CC_ALWAYS, JumpTarget(jc, pc));
+        BindShortJumps(jc, falses);
+        LEA(jc, SP, SP, -1 * (int32) sizeof(jsval));
+        break;
+
+      case JSOP_GOTO:
+      case JSOP_GOTOX:
+        JUMP_TO(jc, CC_ALWAYS, JumpTarget(jc, pc));
+        break;
+
+      default:
+        return JS_FALSE;
+    }
+    return JS_TRUE;
+}
+
+static JSJitScript *
+Compile(JSContext *cx, JSScript *script)
+{
+    JitCompiler jc;
+    JSJitScript *jit;
+    uint8 *compiled, *code;
+    jsbytecode *pc, *end;
+    uint32 off, n, dest, run;
+    uintN nops;
+    size_t size, pagesize;
+    JitFixup *fixup;
+
+    memset(&jc, 0, sizeof jc);
+    jc.cx = cx;
+    jc.script = script;
+    jc.ok = JS_TRUE;
+    jc.pcdisp = -(int32) (script->depth * sizeof(jsval));
+    jc.capacity = 256 + 32 * script->length;
+    jc.code = (uint8 *) malloc(jc.capacity);
+    jc.labels = (uint32 *) calloc(2 * script->length, sizeof(uint32));
+    jc.maxfixups = 16;
+    jc.fixups = (JitFixup *) malloc(jc.maxfixups * sizeof(JitFixup));
+    compiled = (uint8 *) calloc(script->length, 1);
+    jit = NULL;
+    if (!jc.code || !jc.labels || !jc.fixups || !compiled)
+        goto out;
+    jc.exits = jc.labels + script->length;
+
+    /* The prologue, called as a JSJitCode. */
+    EmitByte(&jc, 0x53);                                /* push rbx */
+    EmitByte(&jc, 0x55);                                /* push rbp */
+    EmitByte(&jc, 0x41); EmitByte(&jc, 0x54);           /* push r12 */
+    EmitByte(&jc, 0x41); EmitByte(&jc, 0x55);           /* push r13 */
+    EmitByte(&jc, 0x41); EmitByte(&jc, 0x56);           /* push r14 */
+    EmitByte(&jc, 0x41); EmitByte(&jc, 0x57);           /* push r15 */
+    MOV64(&jc, FP, RDI);
+    LOAD(&jc, SP, FP, offsetof(JSStackFrame, sp));
+    LOAD(&jc, VARS, FP, offsetof(JSStackFrame, vars));
+    LOAD(&jc, ARGV, FP, offsetof(JSStackFrame, argv));
+    EmitLoadImm(&jc, CODE, (jsword) script->code);
+    EmitLoadImm(&jc, RT, (jsword) cx->runtime);
+    EmitReg(&jc, JS_FALSE, 0xff, 4, RSI);               /* jmp rsi */
+
+    /* The epilogue, returning the pc in rax. */
+    jc.epilogue = jc.length;
+    STORE(&jc, FP, offsetof(JSStackFrame, sp), SP);
+    EmitByte(&jc, 0x41); EmitByte(&jc, 0x5f);           /* pop r15 */
+    EmitByte(&jc, 0x41); EmitByte(&jc, 0x5e);           /* pop r14 */
+    EmitByte(&jc, 0x41); EmitByte(&jc, 0x5d);           /* pop r13 */
+    EmitByte(&jc, 0x41); EmitByte(&jc, 0x5c);           /* pop r12 */
+    EmitByte(&jc, 0x5d);                                /* pop rbp */
+    EmitByte(&jc, 0x5b);                                /* pop rbx */
+    EmitByte(&jc, 0xc3);                                /* ret */
+
+    nops = 0;
+    end = script->code + script->length;
+    for (pc = script->code; pc < end; pc += OpLength(pc)) {
+        if (*pc == JSOP_TRAP)
+            goto out;
+        jc.off = PTRDIFF(pc, script->code, jsbytecode);
+        jc.labels[jc.off] = jc.length;
+        if (CompileOp(&jc, pc)) {
+            compiled[jc.off] = 1;
+            nops++;
+        } else {
+            EmitExit(&jc, jc.off);
+        }
+    }
+    if (nops == 0)
+        goto out;
+
+    /* Out of line exit stubs for the ops with guards. */
+    for (n = 0; n < jc.nfixups; n++) {
+        fixup = &jc.fixups[n];
+        if (fixup->exit && jc.exits[fixup->target] == 0) {
+            jc.exits[fixup->target] = jc.length;
+            EmitExit(&jc, fixup->target);
+        }
+    }
+    if (!jc.ok)
+        goto out;
+    for (n = 0; n < jc.nfixups; n++) {
+        fixup = &jc.fixups[n];
+        dest = fixup->exit ? jc.exits[fixup->target]
+                           : jc.labels[fixup->target];
+        JS_ASSERT(dest != 0);
+        off = dest - (fixup->at + 4);
+        memcpy(jc.code + fixup->at, &off, sizeof off);
+    }
+
+    pagesize = (size_t) sysconf(_SC_PAGESIZE);
+    size = (jc.length + pagesize - 1) & ~(pagesize - 1);
+    code = (uint8 *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == (uint8 *) MAP_FAILED)
+        goto out;
+    memcpy(code, jc.code, jc.length);
+    if (mprotect(code, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, size);
+        goto out;
+    }
+
+    jit = (JSJitScript *) malloc(offsetof(JSJitScript, entry) +
+                                 script->length * sizeof(uint32));
+    if (!jit) {
+        munmap(code, size);
+        goto out;
+    }
+    jit->code = code;
+    jit->size = size;
+
+    /*
+     * Enter native code only where it runs two ops or more, one op isn't
+     * worth the call.
+     */
+    run = 0;
+    off = script->length;
+    while (off-- != 0) {
+        jit->entry[off] = 0;
+        if (jc.labels[off] == 0)
+            continue;
+        run = compiled[off] ? run + 1 : 0;
+        if (run >= 2)
+            jit->entry[off] = jc.labels[off];
+    }
+
+  out:
+    free(jc.code);
+    free(jc.labels);
+    free(jc.fixups);
+    free(compiled);
+    return jit;
+}
+
+void
+js_CompileJit(JSContext *cx, JSScript *script)
+{
+    JSJitScript *jit;
+
+    jit = Compile(cx, script);
+    if (!jit)
+        return;
+    JS_LOCK_RUNTIME(cx->runtime);
+    if (!script->jit) {
+        script->jit = jit;
+        jit = NULL;
+    }
+    JS_UNLOCK_RUNTIME(cx->runtime);
+    if (jit) {
+        munmap(jit->code, jit->size);
+        free(jit);
+    }
+}
+
+void
+js_DestroyJit(JSContext *cx, JSScript *script)
+{
+    JSJitScript *jit;
+
+    jit = script->jit;
+    if (!jit)
+        return;
+    munmap(jit->code, jit->size);
+    free(jit);
+    script->jit = NULL;
+}
+
+#endif /* JS_HAS_JIT */
@@ -0,0 +1,108 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ * vim: set ts=8 sw=4 et tw=78:
+ *
+ * ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is Mozilla Communicator client code, released
+ * March 31, 1998.
+ *
+ * The Initial Developer of the Original Code is
+ * Netscape Communications Corporation.
+ * Portions created by the Initial Developer are Copyright (C) 1998
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either of the GNU General Public License Version 2 or later (the "GPL"),
+ * or the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef jsjit_h___
+#define jsjit_h___
+/*
+ * Baseline compiler from JS bytecode to x86-64 machine code.
+ */
+#include "jsprvtd.h"
+#include "jspubtd.h"
+
+JS_BEGIN_EXTERN_C
+
+/*
+ * Native code is generated for x86-64 with GCC only: the interpreter needs
+ * computed gotos (JS_THREADED_INTERP) to get back into native code after an
+ * op that native code left to it.
+ */
+#if defined __GNUC__ && defined __x86_64__ && defined XP_UNIX
+#define JS_HAS_JIT 1
+#else
+#define JS_HAS_JIT 0
+#endif
+
+/*
+ * A script is compiled once its calls and loop iterations add up to
+ * JIT_HOT_COUNT while run by a context with JSOPTION_JIT set.
+ */
+#define JIT_HOT_COUNT   1000
+
+/*
+ * Native code for a script.  It runs ops on the interpreter's operand stack
+ * with int and boolean operands, and returns the pc of the first op it can't
+ * run for the interpreter to run instead: an op not compiled, or one whose
+ * operands aren't of the types compiled for.  entry[off] is the offset in
+ * code of the op at script->code + off, or 0 if the interpreter shouldn't
+ * enter native code there.
+ */
+struct JSJitScript {
+    uint8           *code;          /* executable machine code */
+    size_t          size;           /* bytes mapped at code */
+    uint32          entry[1];       /* code offsets by bytecode offset */
+};
+
+typedef jsbytecode *(*JSJitCode)(JSStackFrame *fp, uint8 *target);
+
+/*
+ * Run native code from the op at bytecode offset off in fp, which must have
+ * its operand stack pointer saved in fp->sp.  Return the pc to continue
+ * interpreting at, fp->sp is updated.
+ */
+#define JS_RUN_JIT(jit, fp, off)                                              \
+    (((JSJitCode) (jit)->code)((fp), (jit)->code + (jit)->entry[off]))
+
+#if JS_HAS_JIT
+
+/*
+ * Compile script and set script->jit, unless another thread did.  A script
+ * that can't be compiled is left with a null script->jit.
+ */
+extern void
+js_CompileJit(JSContext *cx, JSScript *script);
+
+extern void
+js_DestroyJit(JSContext *cx, JSScript *script);
+
+#endif /* JS_HAS_JIT */
+
+JS_END_EXTERN_C
+
+#endif /* jsjit_h___ */
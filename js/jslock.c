@@ -375,7 +375,7 @@ ShareScope(JSRuntime *rt, JSScope *scope)
         JSString *str_ = JSVAL_TO_STRING(v);                                  \
         uint8 *flagp_ = js_GetGCThingFlags(str_);                             \
         if (*flagp_ & GCF_MUTABLE) {                                          \
-            if (JSSTRING_IS_DEPENDENT(str_) &&                                \
+            if ((JSSTRING_IS_DEPENDENT(str_) || JSSTRING_IS_ROPE(str_)) &&    \
                 !js_UndependString(NULL, str_)) {                             \
                 JS_RUNTIME_METER(rt, badUndependStrings);                     \
                 *vp = JSVAL_VOID;                                             \
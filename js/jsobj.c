@@ -83,15 +83,6 @@
 #include "jsxdrapi.h"
 #endif
 
-#ifdef JS_THREADSAFE
-#define NATIVE_DROP_PROPERTY js_DropProperty
-
-extern void
-js_DropProperty(JSContext *cx, JSObject *obj, JSProperty *prop);
-#else
-#define NATIVE_DROP_PROPERTY NULL
-#endif
-
 JS_FRIEND_DATA(JSObjectOps) js_ObjectOps = {
     js_NewObjectMap,        js_DestroyObjectMap,
     js_LookupProperty,      js_DefineProperty,
@@ -1274,6 +1265,10 @@ obj_eval(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         return JS_TRUE;
     }
 
+    /* The compiler reads the source characters directly. */
+    if (!JSSTRING_FLATTEN(cx, JSVAL_TO_STRING(argv[0])))
+        return JS_FALSE;
+
     /*
      * If the caller is a lightweight function and doesn't have a variables
      * object, then we need to provide one for the compiler to stick any
@@ -2340,6 +2335,21 @@ AllocSlots(JSContext *cx, jsval *slots, uint32 nslots)
     return ++newslots;
 }
 
+JSBool
+js_ReallocSlots(JSContext *cx, JSObject *obj, uint32 nslots)
+{
+    jsval *newslots;
+
+    JS_ASSERT(!MAP_IS_NATIVE(obj->map) ||
+              OBJ_SCOPE(obj)->object == obj);
+    newslots = AllocSlots(cx, obj->slots, nslots);
+    if (!newslots)
+        return JS_FALSE;
+    obj->map->nslots = nslots;
+    obj->slots = newslots;
+    return JS_TRUE;
+}
+
 static void
 FreeSlots(JSContext *cx, jsval *slots)
 {
@@ -2353,7 +2363,7 @@ FreeSlots(JSContext *cx, jsval *slots)
      */
     nbytes = (slots[-1] + 1) * sizeof(jsval);
     if (nbytes > GC_NBYTES_MAX)
-        JS_free(cx, slots - 1);
+        js_FreeLater(cx->runtime, slots - 1, nbytes);
 }
 
 extern JSBool
@@ -2433,6 +2443,7 @@ js_NewObject(JSContext *cx, JSClass *clasp, JSObject *proto, JSObject *parent)
      */
     if (proto &&
         (map = proto->map)->ops == ops &&
+        MAP_IS_NATIVE(map) &&
         ((protoclasp = OBJ_GET_CLASS(cx, proto)) == clasp ||
          (!((protoclasp->flags ^ clasp->flags) &
             (JSCLASS_HAS_PRIVATE |
@@ -3121,7 +3132,7 @@ Detecting(JSContext *cx, jsbytecode *pc)
     script = cx->fp->script;
     for (endpc = script->code + script->length; pc < endpc; pc++) {
         /* General case: a branch or equality op follows the access. */
-        op = (JSOp) *pc;
+        op = JS_UNFUSED_OP(*pc);
         if (js_CodeSpec[op].format & JOF_DETECTING)
             return JS_TRUE;
 
@@ -3130,8 +3141,10 @@ Detecting(JSContext *cx, jsbytecode *pc)
          * JS1.2's revision of the equality operators here.
          */
         if (op == JSOP_NULL) {
-            if (++pc < endpc)
-                return *pc == JSOP_EQ || *pc == JSOP_NE;
+            if (++pc < endpc) {
+                op = JS_UNFUSED_OP(*pc);
+                return op == JSOP_EQ || op == JSOP_NE;
+            }
             break;
         }
 
@@ -3144,7 +3157,7 @@ Detecting(JSContext *cx, jsbytecode *pc)
             atom = GET_ATOM(cx, script, pc);
             if (atom == cx->runtime->atomState.typeAtoms[JSTYPE_VOID] &&
                 (pc += js_CodeSpec[op].length) < endpc) {
-                op = (JSOp) *pc;
+                op = JS_UNFUSED_OP(*pc);
                 return op == JSOP_EQ || op == JSOP_NE ||
                        op == JSOP_NEW_EQ || op == JSOP_NEW_NE;
             }
@@ -3559,7 +3572,7 @@ js_GetProperty(JSContext *cx, JSObject *obj, jsid id, jsval *vp)
             uintN flags;
             JSString *str;
 
-            op = *pc;
+            op = JS_UNFUSED_OP(*pc);
             if (op == JSOP_GETXPROP || op == JSOP_GETXELEM) {
                 flags = JSREPORT_ERROR;
             } else {
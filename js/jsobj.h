@@ -394,6 +394,13 @@ js_FinalizeObject(JSContext *cx, JSObject *obj);
 extern JSBool
 js_AllocSlot(JSContext *cx, JSObject *obj, uint32 *slotp);
 
+/*
+ * Resize obj->slots to nslots and record the new length in obj->map, which
+ * must not be shared with any other object.
+ */
+extern JSBool
+js_ReallocSlots(JSContext *cx, JSObject *obj, uint32 nslots);
+
 extern void
 js_FreeSlot(JSContext *cx, JSObject *obj, uint32 slot);
 
@@ -579,6 +586,15 @@ js_Mark(JSContext *cx, JSObject *obj, void *arg);
 extern void
 js_Clear(JSContext *cx, JSObject *obj);
 
+#ifdef JS_THREADSAFE
+#define NATIVE_DROP_PROPERTY js_DropProperty
+
+extern void
+js_DropProperty(JSContext *cx, JSObject *obj, JSProperty *prop);
+#else
+#define NATIVE_DROP_PROPERTY NULL
+#endif
+
 extern jsval
 js_GetRequiredSlot(JSContext *cx, JSObject *obj, uint32 slot);
 
@@ -97,6 +97,30 @@ const JSCodeSpec FAR js_CodeSpec[] = {
 
 uintN js_NumCodeSpecs = sizeof (js_CodeSpec) / sizeof js_CodeSpec[0];
 
+/* The op overlaid by each superinstruction, see js_FuseBytecode. */
+const uint8 js_UnfusedOp[] = {
+    JSOP_SETVAR,                /* JSOP_SETVARPOP */
+    JSOP_INCVAR,                /* JSOP_INCVARPOP */
+    JSOP_DECVAR,                /* JSOP_DECVARPOP */
+    JSOP_VARINC,                /* JSOP_VARINCPOP */
+    JSOP_VARDEC,                /* JSOP_VARDECPOP */
+    JSOP_EQ,                    /* JSOP_EQBRANCH */
+    JSOP_NE,                    /* JSOP_NEBRANCH */
+    JSOP_LT,                    /* JSOP_LTBRANCH */
+    JSOP_LE,                    /* JSOP_LEBRANCH */
+    JSOP_GT,                    /* JSOP_GTBRANCH */
+    JSOP_GE,                    /* JSOP_GEBRANCH */
+    JSOP_NEW_EQ,                /* JSOP_NEW_EQBRANCH */
+    JSOP_NEW_NE,                /* JSOP_NEW_NEBRANCH */
+    JSOP_GETARG,                /* JSOP_GETARGPROP */
+    JSOP_GETVAR,                /* JSOP_GETVARPROP */
+    JSOP_THIS,                  /* JSOP_GETTHISPROP */
+    JSOP_NAME,                  /* JSOP_CALLNAME */
+    JSOP_GETMETHOD              /* JSOP_CALLMETHOD */
+};
+
+JS_STATIC_ASSERT(sizeof js_UnfusedOp == JSOP_LIMIT - JSOP_FUSED_FIRST);
+
 /************************************************************************/
 
 static ptrdiff_t
@@ -469,6 +493,8 @@ QuoteString(Sprinter *sp, JSString *str, uint32 quote)
         return NULL;
 
     /* Loop control variables: z points at end of string sentinel. */
+    if (!JSSTRING_FLATTEN(sp->context, str))
+        return NULL;
     s = JSSTRING_CHARS(str);
     z = s + JSSTRING_LENGTH(str);
     for (t = s; t < z; s = ++t) {
@@ -1155,7 +1181,8 @@ GetLocal(SprintStack *ss, jsint i)
 #if JS_HAS_DESTRUCTURING
 
 #define LOCAL_ASSERT(expr)  LOCAL_ASSERT_RV(expr, NULL)
-#define LOAD_OP_DATA(pc)    (oplen = (cs = &js_CodeSpec[op = *pc])->length)
+#define LOAD_OP_DATA(pc)                                                      \
+    (oplen = (cs = &js_CodeSpec[op = JS_UNFUSED_OP(*pc)])->length)
 
 static jsbytecode *
 DecompileDestructuring(SprintStack *ss, jsbytecode *pc, jsbytecode *endpc);
@@ -1622,7 +1649,7 @@ Decompile(SprintStack *ss, jsbytecode *pc, intN nb)
          * set to nop or otherwise mutated to suppress auto-parens.
          */
         lastop = saveop;
-        op = saveop = (JSOp) *pc;
+        op = saveop = JS_UNFUSED_OP(*pc);
         cs = &js_CodeSpec[saveop];
         len = oplen = cs->length;
 
@@ -4581,6 +4608,7 @@ js_DecompileValueGenerator(JSContext *cx, intN spindex, jsval v,
     op = (JSOp) *pc;
     if (op == JSOP_TRAP)
         op = JS_GetTrapOpcode(cx, script, pc);
+    op = JS_UNFUSED_OP(op);
 
     /* None of these stack-writing ops generates novel values. */
     JS_ASSERT(op != JSOP_CASE && op != JSOP_CASEX &&
@@ -4643,6 +4671,7 @@ js_DecompileValueGenerator(JSContext *cx, intN spindex, jsval v,
         op = (JSOp) *pc;
         if (op == JSOP_TRAP)
             op = JS_GetTrapOpcode(cx, script, pc);
+        op = JS_UNFUSED_OP(op);
         cs = &js_CodeSpec[op];
         oplen = cs->length;
 
@@ -238,6 +238,20 @@ extern const JSCodeSpec js_CodeSpec[];
 extern uintN            js_NumCodeSpecs;
 extern const jschar     js_EscapeMap[];
 
+/*
+ * Superinstructions are the last ops in jsopcode.tbl.  JS_UNFUSED_OP maps one
+ * to the op it overlays, and any other op to itself, for code that reads the
+ * bytecode and must see the ops the compiler emitted.
+ */
+#define JSOP_FUSED_FIRST        JSOP_SETVARPOP
+#define JSOP_IS_FUSED(op)       ((uintN)(op) - JSOP_FUSED_FIRST <             \
+                                 (uintN)(JSOP_LIMIT - JSOP_FUSED_FIRST))
+#define JS_UNFUSED_OP(op)       (JSOP_IS_FUSED(op)                            \
+                                 ? (JSOp) js_UnfusedOp[(op) - JSOP_FUSED_FIRST]\
+                                 : (JSOp) (op))
+
+extern const uint8      js_UnfusedOp[];
+
 /*
  * Return a GC'ed string containing the chars in str, with any non-printing
  * chars or quotes (' or " as specified by the quote argument) escaped, and
@@ -537,6 +537,16 @@ typedef JSBool
 (* JS_DLL_CALLBACK JSNative)(JSContext *cx, JSObject *obj, uintN argc,
                              jsval *argv, jsval *rval);
 
+/*
+ * Typedef for native functions using the fast calling convention, flagged by
+ * JSFUN_FAST_NATIVE in their JSFunctionSpec.  No stack frame is pushed for a
+ * call: vp[0] is the callee, vp[1] the already computed 'this' parameter and
+ * vp[2] .. vp[argc + 1] the arguments, followed by missing formals and local
+ * root slots.  The return value must be stored in vp[0] before returning.
+ */
+typedef JSBool
+(* JS_DLL_CALLBACK JSFastNative)(JSContext *cx, uintN argc, jsval *vp);
+
 /* Callbacks and their arguments. */
 
 typedef enum JSContextOp {
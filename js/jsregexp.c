@@ -3355,7 +3355,7 @@ js_ExecuteRegExp(JSContext *cx, JSRegExp *re, JSString *str, size_t *indexp,
         *rval = OBJECT_TO_JSVAL(obj);
 
 #define DEFVAL(val, id) {                                                     \
-    ok = js_DefineProperty(cx, obj, id, val,                                  \
+    ok = OBJ_DEFINE_PROPERTY(cx, obj, id, val,                                \
                            JS_PropertyStub, JS_PropertyStub,                  \
                            JSPROP_ENUMERATE, NULL);                           \
     if (!ok) {                                                                \
@@ -3421,9 +3421,9 @@ js_ExecuteRegExp(JSContext *cx, JSRegExp *re, JSString *str, size_t *indexp,
             if (test)
                 continue;
             if (parsub->index == -1) {
-                ok = js_DefineProperty(cx, obj, INT_TO_JSID(num + 1),
-                                       JSVAL_VOID, NULL, NULL,
-                                       JSPROP_ENUMERATE, NULL);
+                ok = OBJ_DEFINE_PROPERTY(cx, obj, INT_TO_JSID(num + 1),
+                                         JSVAL_VOID, NULL, NULL,
+                                         JSPROP_ENUMERATE, NULL);
             } else {
                 parstr = js_NewStringCopyN(cx, gData.cpbegin + parsub->index,
                                            parsub->length, 0);
@@ -3433,9 +3433,9 @@ js_ExecuteRegExp(JSContext *cx, JSRegExp *re, JSString *str, size_t *indexp,
                     ok = JS_FALSE;
                     goto out;
                 }
-                ok = js_DefineProperty(cx, obj, INT_TO_JSID(num + 1),
-                                       STRING_TO_JSVAL(parstr), NULL, NULL,
-                                       JSPROP_ENUMERATE, NULL);
+                ok = OBJ_DEFINE_PROPERTY(cx, obj, INT_TO_JSID(num + 1),
+                                         STRING_TO_JSVAL(parstr), NULL, NULL,
+                                         JSPROP_ENUMERATE, NULL);
             }
             if (!ok) {
                 cx->weakRoots.newborn[GCX_OBJECT] = NULL;
@@ -3652,6 +3652,8 @@ regexp_static_setProperty(JSContext *cx, JSObject *obj, jsval id, jsval *vp)
             return JS_FALSE;
         }
         res->input = JSVAL_TO_STRING(*vp);
+        if (!JSSTRING_FLATTEN(cx, res->input))
+            return JS_FALSE;
     } else if (JSVAL_TO_INT(id) == REGEXP_STATIC_MULTILINE) {
         if (!JSVAL_IS_BOOLEAN(*vp) &&
             !JS_ConvertValue(cx, *vp, JSTYPE_BOOLEAN, vp)) {
@@ -68,6 +68,7 @@
 #include "jsregexp.h"
 #include "jsscan.h"
 #include "jsscript.h"
+#include "jsstr.h"
 
 #if JS_HAS_XML_SUPPORT
 #include "jsparse.h"
@@ -264,6 +265,62 @@ js_NewFileTokenStream(JSContext *cx, const char *filename, FILE *defaultfp)
     return ts;
 }
 
+JS_FRIEND_API(JSTokenStream *)
+js_NewBytesTokenStream(JSContext *cx, const char *bytes, size_t length,
+                       const char *filename, uintN lineno,
+                       JSPrincipals *principals)
+{
+    jschar *base;
+    JSTokenStream *ts;
+
+    JS_ARENA_ALLOCATE_CAST(base, jschar *, &cx->tempPool,
+                           JS_LINE_LIMIT * sizeof(jschar));
+    if (!base) {
+        JS_ReportOutOfMemory(cx);
+        return NULL;
+    }
+    ts = js_NewTokenStream(cx, base, JS_LINE_LIMIT, filename, lineno,
+                           principals);
+    if (!ts)
+        return NULL;
+    ts->userbuf.ptr = ts->userbuf.limit;
+    ts->bytes = bytes;
+    ts->byteslimit = bytes + length;
+    return ts;
+}
+
+/*
+ * Find the length of the next line of byte input, ending it like js_fgets
+ * does: at a \n (kept), at a \r not followed by \n, or after size - 1 bytes.
+ */
+static ptrdiff_t
+GetBytesLine(JSTokenStream *ts, ptrdiff_t size)
+{
+    const char *bp, *limit;
+
+    bp = ts->bytes;
+    limit = ts->byteslimit;
+    if (limit - bp > size - 1)
+        limit = bp + size - 1;
+    while (bp < limit) {
+        if (*bp == '\n')
+            return bp + 1 - ts->bytes;
+        if (*bp++ == '\r' && (bp == ts->byteslimit || *bp != '\n'))
+            return bp - ts->bytes;
+    }
+
+#ifdef JS_C_STRINGS_ARE_UTF8
+    /* Don't split a multibyte character across two segments. */
+    if (bp < ts->byteslimit) {
+        while (bp > ts->bytes && (*bp & 0xC0) == 0x80)
+            bp--;
+        if (bp == ts->bytes)
+            bp = limit;
+    }
+#endif
+    return bp - ts->bytes;
+}
+
 JS_FRIEND_API(JSBool)
 js_CloseTokenStream(JSContext *cx, JSTokenStream *ts)
 {
@@ -307,6 +364,7 @@ GetChar(JSTokenStream *ts)
 {
     int32 c;
     ptrdiff_t i, j, len, olen;
+    size_t ulen;
     JSBool crflag;
     char cbuf[JS_LINE_LIMIT];
     jschar *ubuf, *nl;
@@ -317,7 +375,36 @@ GetChar(JSTokenStream *ts)
         do {
             if (ts->linebuf.ptr == ts->linebuf.limit) {
                 len = PTRDIFF(ts->userbuf.limit, ts->userbuf.ptr, jschar);
-                if (len <= 0) {
+                if (len <= 0 && ts->bytes) {
+                    /* Inflate the next line of byte input into userbuf. */
+                    crflag = (ts->flags & TSF_CRFLAG) != 0;
+                    len = GetBytesLine(ts, JS_LINE_LIMIT - crflag);
+                    if (len <= 0) {
+                        ts->flags |= TSF_EOF;
+                        return EOF;
+                    }
+                    ubuf = ts->userbuf.base;
+                    i = 0;
+                    if (crflag) {
+                        ts->flags &= ~TSF_CRFLAG;
+                        if (ts->bytes[0] != '\n') {
+                            ubuf[i++] = '\n';
+                            ts->linepos--;
+                        }
+                    }
+                    ulen = JS_LINE_LIMIT - i;
+                    if (!js_InflateStringToBuffer((JSContext *)
+                                                  ts->tokenbuf.data,
+                                                  ts->bytes, len,
+                                                  ubuf + i, &ulen)) {
+                        ts->flags |= TSF_ERROR | TSF_EOF;
+                        return EOF;
+                    }
+                    ts->bytes += len;
+                    len = i + ulen;
+                    ts->userbuf.limit = ubuf + len;
+                    ts->userbuf.ptr = ubuf;
+                } else if (len <= 0) {
                     if (!ts->file) {
                         ts->flags |= TSF_EOF;
                         return EOF;
@@ -406,7 +493,8 @@ GetChar(JSTokenStream *ts)
                              * storing a \n into linebuf.  This case matters
                              * only when we're reading from a file.
                              */
-                            if (nl + 1 == ts->userbuf.limit && ts->file) {
+                            if (nl + 1 == ts->userbuf.limit &&
+                                (ts->file || ts->bytes)) {
                                 len--;
                                 ts->flags |= TSF_CRFLAG; /* clear NLFLAG? */
                                 if (len == 0) {
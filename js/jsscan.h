@@ -243,6 +243,8 @@ struct JSTokenStream {
     JSStringBuffer      tokenbuf;       /* current token string buffer */
     const char          *filename;      /* input filename or null */
     FILE                *file;          /* stdio stream if reading from file */
+    const char          *bytes;         /* next unscanned byte of byte input */
+    const char          *byteslimit;    /* end of byte input, if any */
     JSPrincipals        *principals;    /* principals associated with source */
     JSSourceHandler     listener;       /* callback for source; eg debugger */
     void                *listenerData;  /* listener 'this' data */
@@ -316,6 +318,16 @@ js_NewBufferTokenStream(JSContext *cx, const jschar *base, size_t length);
 extern JS_FRIEND_API(JSTokenStream *)
 js_NewFileTokenStream(JSContext *cx, const char *filename, FILE *defaultfp);
 
+/*
+ * Create a token stream that scans length bytes, inflating them into jschars
+ * one line at a time as they are consumed, so no inflated copy of the whole
+ * source is made.  The bytes must remain valid until the stream is closed.
+ */
+extern JS_FRIEND_API(JSTokenStream *)
+js_NewBytesTokenStream(JSContext *cx, const char *bytes, size_t length,
+                       const char *filename, uintN lineno,
+                       JSPrincipals *principals);
+
 extern JS_FRIEND_API(JSBool)
 js_CloseTokenStream(JSContext *cx, JSTokenStream *ts);
 
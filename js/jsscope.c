@@ -191,7 +191,8 @@ js_DestroyScope(JSContext *cx, JSScope *scope)
     js_FinishLock(&scope->lock);
 #endif
     if (scope->table)
-        JS_free(cx, scope->table);
+        js_FreeLater(cx->runtime, scope->table,
+                     SCOPE_CAPACITY(scope) * sizeof(JSScopeProperty *));
 
 #ifdef DEBUG
     JS_LOCK_RUNTIME_VOID(cx->runtime,
@@ -1128,10 +1129,12 @@ js_AddScopeProperty(JSContext *cx, JSScope *scope, jsid id,
                  * If so, we're overwriting that nearly-matching sprop, so we
                  * can reuse its slot -- we don't need to allocate a new one.
                  * Callers should therefore pass SPROP_INVALID_SLOT for all
-                 * non-alias, unshared property adds.
+                 * non-alias, unshared property adds, except js_MakeArraySlow
+                 * that maps the elements a dense array already keeps in its
+                 * slots with a scope the array doesn't use yet.
                  */
                 if (slot != SPROP_INVALID_SLOT)
-                    JS_ASSERT(overwriting);
+                    JS_ASSERT(overwriting || scope->object->map != &scope->map);
                 else if (!js_AllocSlot(cx, scope->object, &slot))
                     goto fail_overwrite;
             }
@@ -1163,6 +1166,10 @@ js_AddScopeProperty(JSContext *cx, JSScope *scope, jsid id,
         if (!sprop)
             goto fail_overwrite;
 
+        /* See js_PrototypeHasIndexedProperties, in jsarray.c. */
+        if (JSID_IS_INT(id))
+            SCOPE_SET_INDEXED_PROPERTIES(scope);
+
         /* Store the tree node pointer in the table entry for id. */
         if (scope->table)
             SPROP_STORE_PRESERVING_COLLISION(spp, sprop);
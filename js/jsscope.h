@@ -231,6 +231,7 @@ struct JSScope {
 /* Scope flags and some macros to hide them from other files than jsscope.c. */
 #define SCOPE_MIDDLE_DELETE             0x0001
 #define SCOPE_SEALED                    0x0002
+#define SCOPE_INDEXED_PROPERTIES        0x0004
 
 #define SCOPE_HAD_MIDDLE_DELETE(scope)  ((scope)->flags & SCOPE_MIDDLE_DELETE)
 #define SCOPE_SET_MIDDLE_DELETE(scope)  ((scope)->flags |= SCOPE_MIDDLE_DELETE)
@@ -238,6 +239,12 @@ struct JSScope {
 
 #define SCOPE_IS_SEALED(scope)          ((scope)->flags & SCOPE_SEALED)
 #define SCOPE_SET_SEALED(scope)         ((scope)->flags |= SCOPE_SEALED)
+
+/* Sticky: set once an int-keyed property is added, never cleared. */
+#define SCOPE_HAS_INDEXED_PROPERTIES(scope)                                   \
+    ((scope)->flags & SCOPE_INDEXED_PROPERTIES)
+#define SCOPE_SET_INDEXED_PROPERTIES(scope)                                   \
+    ((scope)->flags |= SCOPE_INDEXED_PROPERTIES)
 #if 0
 /*
  * Don't define this, it can't be done safely because JS_LOCK_OBJ will avoid
@@ -54,6 +54,7 @@
 #include "jsemit.h"
 #include "jsfun.h"
 #include "jsinterp.h"
+#include "jsjit.h"
 #include "jslock.h"
 #include "jsnum.h"
 #include "jsopcode.h"
@@ -484,14 +485,16 @@ js_XDRScript(JSXDRState *xdr, JSScript **scriptp, JSBool *hasMagic)
      * evolved, and a few exceptions during active trunk development).  With
      * the addition of JSOP_STOP to support JS_THREADED_INTERP, we make a new
      * magic number (_5) so that we know to append JSOP_STOP to old scripts
-     * when deserializing.
+     * when deserializing.  Version _6 may contain the superinstructions that
+     * js_FuseBytecode overlays on pairs of ops, which older engines can't run,
+     * and older scripts get them when deserialized.
      */
     if (xdr->mode == JSXDR_ENCODE)
         magic = JSXDR_MAGIC_SCRIPT_CURRENT;
     if (!JS_XDRUint32(xdr, &magic))
         return JS_FALSE;
-    JS_ASSERT((uint32)JSXDR_MAGIC_SCRIPT_5 - (uint32)JSXDR_MAGIC_SCRIPT_1 == 4);
-    if (magic - (uint32)JSXDR_MAGIC_SCRIPT_1 > 4) {
+    JS_ASSERT((uint32)JSXDR_MAGIC_SCRIPT_6 - (uint32)JSXDR_MAGIC_SCRIPT_1 == 5);
+    if (magic - (uint32)JSXDR_MAGIC_SCRIPT_1 > 5) {
         if (!hasMagic) {
             JS_ReportErrorNumber(cx, js_GetErrorMessage, NULL,
                                  JSMSG_BAD_SCRIPT_MAGIC);
@@ -598,6 +601,9 @@ js_XDRScript(JSXDRState *xdr, JSScript **scriptp, JSBool *hasMagic)
         }
     }
 
+    if (magic < JSXDR_MAGIC_SCRIPT_6 && xdr->mode == JSXDR_DECODE)
+        js_FuseBytecode(script);
+
     if (!JS_XDRBytes(xdr, (char *)notes, nsrcnotes * sizeof(jssrcnote)) ||
         !JS_XDRCStringOrNull(xdr, (char **)&script->filename) ||
         !JS_XDRUint32(xdr, &lineno) ||
@@ -1388,6 +1394,7 @@ js_NewScriptFromCG(JSContext *cx, JSCodeGenerator *cg, JSFunction *fun)
     script->main += prologLength;
     memcpy(script->code, CG_PROLOG_BASE(cg), prologLength * sizeof(jsbytecode));
     memcpy(script->main, CG_BASE(cg), mainLength * sizeof(jsbytecode));
+    js_FuseBytecode(script);
     script->numGlobalVars = cg->treeContext.numGlobalVars;
     if (!js_InitAtomMap(cx, &script->atomMap, &cg->atomList))
         goto bad;
@@ -1464,6 +1471,9 @@ js_DestroyScript(JSContext *cx, JSScript *script)
     js_CallDestroyScriptHook(cx, script);
 
     JS_ClearScriptTraps(cx, script);
+#if JS_HAS_JIT
+    js_DestroyJit(cx, script);
+#endif
     js_FreeAtomMap(cx, &script->atomMap);
     if (script->principals)
         JSPRINCIPALS_DROP(cx, script->principals);
@@ -77,6 +77,8 @@ struct JSScript {
     JSTryNote    *trynotes;     /* exception table for this script */
     JSPrincipals *principals;   /* principals for this script */
     JSObject     *object;       /* optional Script-class object wrapper */
+    uint32       jitCount;      /* calls and loops run, up to JIT_HOT_COUNT */
+    JSJitScript  *jit;          /* native code, or null */
 };
 
 /* No need to store script->notes now that it is allocated right after code. */
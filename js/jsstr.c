@@ -72,6 +72,16 @@
 
 #define JSSTRDEP_RECURSION_LIMIT        100
 
+/*
+ * Concatenations shorter than JSSTRROPE_MIN_LENGTH are copied, longer ones
+ * make ropes.  Appending a short string to a rope whose near end is a short
+ * flat string copies into a new leaf of at most JSSTRROPE_LEAF_LENGTH chars
+ * instead, so building a string one char at a time doesn't make a rope node
+ * per char.
+ */
+#define JSSTRROPE_MIN_LENGTH            64
+#define JSSTRROPE_LEAF_LENGTH           256
+
 size_t
 js_MinimizeDependentStrings(JSString *str, int level, JSString **basep)
 {
@@ -118,28 +128,123 @@ js_GetDependentStringChars(JSString *str)
 jschar *
 js_GetStringChars(JSString *str)
 {
-    if (JSSTRING_IS_DEPENDENT(str) && !js_UndependString(NULL, str))
+    if ((JSSTRING_IS_DEPENDENT(str) || JSSTRING_IS_ROPE(str)) &&
+        !js_UndependString(NULL, str))
         return NULL;
 
     *js_GetGCThingFlags(str) &= ~GCF_MUTABLE;
     return str->chars;
 }
 
+static JSString *
+NewRope(JSContext *cx, JSString *left, JSString *right, size_t length)
+{
+    JSRopeNode *node;
+    JSString *str;
+
+    node = (JSRopeNode *) JS_malloc(cx, sizeof(JSRopeNode));
+    if (!node)
+        return NULL;
+    node->left = left;
+    node->right = right;
+
+    /* Ropes are mutable strings, so the GC marks their operands. */
+    str = (JSString *) js_NewGCThing(cx, GCX_MUTABLE_STRING, sizeof(JSString));
+    if (!str) {
+        JS_free(cx, node);
+        return NULL;
+    }
+    JSSTRROPE_SET(str, node, length);
+#ifdef DEBUG
+  {
+    JSRuntime *rt = cx->runtime;
+    JS_RUNTIME_METER(rt, liveStrings);
+    JS_RUNTIME_METER(rt, totalStrings);
+  }
+#endif
+    return str;
+}
+
+static JSString *
+ConcatFlatStrings(JSContext *cx, JSString *left, JSString *right);
+
 JSString *
 js_ConcatStrings(JSContext *cx, JSString *left, JSString *right)
+{
+    size_t ln, rn, n;
+    JSString *leaf;
+
+    rn = JSSTRING_LENGTH(right);
+    if (rn == 0)
+        return left;
+    ln = JSSTRING_LENGTH(left);
+    if (ln == 0)
+        return right;
+
+    /*
+     * Short results, and appends to a flat left operand that owns a buffer
+     * ConcatFlatStrings can realloc in place, are cheaper done eagerly.
+     */
+    n = ln + rn;
+    if (n < JSSTRROPE_MIN_LENGTH ||
+        (!JSSTRING_IS_DEPENDENT(left) && !JSSTRING_IS_ROPE(left) &&
+         !JSSTRING_IS_ROPE(right) &&
+         (*js_GetGCThingFlags(left) & GCF_MUTABLE))) {
+        return ConcatFlatStrings(cx, left, right);
+    }
+
+    if (n > JSSTRING_LENGTH_MASK) {
+        JS_ReportOutOfMemory(cx);
+        return NULL;
+    }
+
+    /*
+     * Fold short appends and prepends into the nearest leaf, the rope they
+     * come from keeps its own (untouched) leaf.  The short operand must be
+     * flat: ConcatFlatStrings flattens a rope operand, and that rope may be
+     * or contain the other operand, whose node we are about to read.
+     */
+    if (rn < JSSTRROPE_LEAF_LENGTH && JSSTRING_IS_ROPE(left) &&
+        !JSSTRING_IS_ROPE(right)) {
+        leaf = JSSTRROPE_RIGHT(left);
+        if (!JSSTRING_IS_ROPE(leaf) &&
+            JSSTRING_LENGTH(leaf) + rn <= JSSTRROPE_LEAF_LENGTH) {
+            leaf = ConcatFlatStrings(cx, leaf, right);
+            if (!leaf)
+                return NULL;
+            return NewRope(cx, JSSTRROPE_LEFT(left), leaf, n);
+        }
+    } else if (ln < JSSTRROPE_LEAF_LENGTH && JSSTRING_IS_ROPE(right) &&
+               !JSSTRING_IS_ROPE(left)) {
+        leaf = JSSTRROPE_LEFT(right);
+        if (!JSSTRING_IS_ROPE(leaf) &&
+            ln + JSSTRING_LENGTH(leaf) <= JSSTRROPE_LEAF_LENGTH) {
+            leaf = ConcatFlatStrings(cx, left, leaf);
+            if (!leaf)
+                return NULL;
+            return NewRope(cx, leaf, JSSTRROPE_RIGHT(right), n);
+        }
+    }
+
+    return NewRope(cx, left, right, n);
+}
+
+static JSString *
+ConcatFlatStrings(JSContext *cx, JSString *left, JSString *right)
 {
     size_t rn, ln, lrdist, n;
     jschar *rs, *ls, *s;
     JSDependentString *ldep;    /* non-null if left should become dependent */
     JSString *str;
 
-    if (JSSTRING_IS_DEPENDENT(right)) {
-        rn = JSSTRDEP_LENGTH(right);
-        rs = JSSTRDEP_CHARS(right);
-    } else {
-        rn = right->length;
-        rs = right->chars;
-    }
+    /* Flatten here so that running out of memory gets reported. */
+    if (!JSSTRING_FLATTEN(cx, right))
+        return NULL;
+    if (!JSSTRING_FLATTEN(cx, left))
+        return NULL;
+
+    rn = JSSTRING_LENGTH(right);
+    rs = JSSTRING_CHARS(right);
     if (rn == 0)
         return left;
 
@@ -207,6 +312,89 @@ js_ConcatStrings(JSContext *cx, JSString *left, JSString *right)
     return str;
 }
 
+/* A rope still to be copied into the flat buffer, at its offset there. */
+typedef struct FlattenFrame {
+    JSString        *str;
+    size_t          offset;
+} FlattenFrame;
+
+jschar *
+js_FlattenRope(JSContext *cx, JSString *str)
+{
+    size_t n, offset, length, top, size;
+    jschar *chars;
+    JSString *rope, *left, *right;
+    FlattenFrame *stack, *grown;
+
+    JS_ASSERT(JSSTRING_IS_ROPE(str));
+    JS_ASSERT(*js_GetGCThingFlags(str) & GCF_MUTABLE);
+    n = JSSTRROPE_LENGTH(str);
+    chars = (jschar *) (cx ? JS_malloc(cx, (n + 1) * sizeof(jschar))
+                           : malloc((n + 1) * sizeof(jschar)));
+    if (!chars)
+        return NULL;
+
+    /*
+     * Every leaf goes straight to its offset, so only ropes having ropes on
+     * both sides need a stack entry: ropes made by += or by prepending don't.
+     */
+    stack = NULL;
+    top = size = 0;
+    rope = str;
+    offset = 0;
+    for (;;) {
+        if (JSSTRING_IS_ROPE(rope)) {
+            left = JSSTRROPE_LEFT(rope);
+            right = JSSTRROPE_RIGHT(rope);
+            length = JSSTRING_LENGTH(left);
+            if (!JSSTRING_IS_ROPE(left)) {
+                js_strncpy(chars + offset, JSSTRING_CHARS(left), length);
+                offset += length;
+                rope = right;
+                continue;
+            }
+            if (JSSTRING_IS_ROPE(right)) {
+                if (top == size) {
+                    size = size ? size * 2 : 16;
+                    grown = (FlattenFrame *)
+                            realloc(stack, size * sizeof(FlattenFrame));
+                    if (!grown) {
+                        free(stack);
+                        free(chars);
+                        if (cx)
+                            JS_ReportOutOfMemory(cx);
+                        return NULL;
+                    }
+                    stack = grown;
+                }
+                stack[top].str = right;
+                stack[top].offset = offset + length;
+                top++;
+            } else {
+                js_strncpy(chars + offset + length, JSSTRING_CHARS(right),
+                           JSSTRING_LENGTH(right));
+            }
+            rope = left;
+            continue;
+        }
+
+        js_strncpy(chars + offset, JSSTRING_CHARS(rope), JSSTRING_LENGTH(rope));
+        if (top == 0)
+            break;
+        top--;
+        rope = stack[top].str;
+        offset = stack[top].offset;
+    }
+    free(stack);
+    chars[n] = 0;
+
+    /* The operands are left to the GC, str doesn't reference them anymore. */
+    free(JSSTRROPE(str)->node);
+    str->length = n;
+    str->chars = chars;
+    return chars;
+}
+
 /*
  * May be called with null cx by js_GetStringChars, above; and by the jslock.c
  * MAKE_STRING_IMMUTABLE file-local macro.
@@ -239,6 +427,9 @@ js_UndependString(JSContext *cx, JSString *str)
                  rt->strdepLengthSquaredSum -= (double)n * (double)n));
         }
 #endif
+    } else if (JSSTRING_IS_ROPE(str)) {
+        if (!js_FlattenRope(cx, str))
+            return NULL;
     }
 
     return str->chars;
@@ -506,12 +697,6 @@ enum string_tinyid {
     STRING_LENGTH = -1
 };
 
-static JSPropertySpec string_props[] = {
-    {js_length_str,     STRING_LENGTH,
-                        JSPROP_READONLY|JSPROP_PERMANENT|JSPROP_SHARED, 0,0},
-    {0,0,0,0,0}
-};
-
 static JSBool
 str_getProperty(JSContext *cx, JSObject *obj, jsval id, jsval *vp)
 {
@@ -541,6 +726,19 @@ str_getProperty(JSContext *cx, JSObject *obj, jsval id, jsval *vp)
     return JS_TRUE;
 }
 
+/*
+ * Only length needs str_getProperty, so make it length's own getter rather
+ * than the class getter.  Other properties of String objects, most of all
+ * String.prototype's methods, then get stub getters, which lets the
+ * interpreter's property cache hold them.
+ */
+static JSPropertySpec string_props[] = {
+    {js_length_str,     STRING_LENGTH,
+                        JSPROP_READONLY|JSPROP_PERMANENT|JSPROP_SHARED,
+                        str_getProperty, 0},
+    {0,0,0,0,0}
+};
+
 #define STRING_ELEMENT_ATTRS (JSPROP_ENUMERATE|JSPROP_READONLY|JSPROP_PERMANENT)
 
 static JSBool
@@ -602,7 +800,7 @@ JSClass js_StringClass = {
     js_String_str,
     JSCLASS_HAS_PRIVATE | JSCLASS_NEW_RESOLVE |
     JSCLASS_HAS_CACHED_PROTO(JSProto_String),
-    JS_PropertyStub,   JS_PropertyStub,   str_getProperty,   JS_PropertyStub,
+    JS_PropertyStub,   JS_PropertyStub,   JS_PropertyStub,   JS_PropertyStub,
     str_enumerate, (JSResolveOp)str_resolve, JS_ConvertStub, JS_FinalizeStub,
     JSCLASS_NO_OPTIONAL_MEMBERS
 };
@@ -614,9 +812,14 @@ JSClass js_StringClass = {
  * toSource, toString, and valueOf.
  */
 static JSBool
-str_quote(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_quote(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -626,18 +829,23 @@ str_quote(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     str = js_QuoteString(cx, str, '"');
     if (!str)
         return JS_FALSE;
-    *rval = STRING_TO_JSVAL(str);
+    *vp = STRING_TO_JSVAL(str);
     return JS_TRUE;
 }
 
 static JSBool
-str_toSource(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_toSource(JSContext *cx, uintN argc, jsval *vp)
 {
     jsval v;
     JSString *str;
     size_t i, j, k, n;
     char buf[16];
     jschar *s, *t;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     if (JSVAL_IS_STRING((jsval)obj)) {
         v = (jsval)obj;
@@ -646,7 +854,7 @@ str_toSource(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
             return JS_FALSE;
         v = OBJ_GET_SLOT(cx, obj, JSSLOT_PRIVATE);
         if (!JSVAL_IS_STRING(v))
-            return js_obj_toSource(cx, obj, argc, argv, rval);
+            return js_obj_toSource(cx, obj, argc, argv, vp);
     }
     str = js_QuoteString(cx, JSVAL_TO_STRING(v), '"');
     if (!str)
@@ -670,40 +878,51 @@ str_toSource(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         JS_free(cx, t);
         return JS_FALSE;
     }
-    *rval = STRING_TO_JSVAL(str);
+    *vp = STRING_TO_JSVAL(str);
     return JS_TRUE;
 }
 
 #endif /* JS_HAS_TOSOURCE */
 
 static JSBool
-str_toString(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_toString(JSContext *cx, uintN argc, jsval *vp)
 {
     jsval v;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     if (JSVAL_IS_STRING((jsval)obj)) {
-        *rval = (jsval)obj;
+        *vp = (jsval)obj;
         return JS_TRUE;
     }
     if (!JS_InstanceOf(cx, obj, &js_StringClass, argv))
         return JS_FALSE;
     v = OBJ_GET_SLOT(cx, obj, JSSLOT_PRIVATE);
     if (!JSVAL_IS_STRING(v))
-        return js_obj_toString(cx, obj, argc, argv, rval);
-    *rval = v;
+        return js_obj_toString(cx, obj, argc, argv, vp);
+    *vp = v;
     return JS_TRUE;
 }
 
 static JSBool
-str_valueOf(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_valueOf(JSContext *cx, uintN argc, jsval *vp)
 {
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
+
     if (JSVAL_IS_STRING((jsval)obj)) {
-        *rval = (jsval)obj;
+        *vp = (jsval)obj;
         return JS_TRUE;
     }
     if (!JS_InstanceOf(cx, obj, &js_StringClass, argv))
         return JS_FALSE;
-    *rval = OBJ_GET_SLOT(cx, obj, JSSLOT_PRIVATE);
+    *vp = OBJ_GET_SLOT(cx, obj, JSSLOT_PRIVATE);
     return JS_TRUE;
 }
 
@@ -711,12 +930,16 @@ str_valueOf(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
  * Java-like string native methods.
  */
 static JSBool
-str_substring(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-              jsval *rval)
+str_substring(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str;
     jsdouble d;
     jsdouble length, begin, end;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -756,17 +979,21 @@ str_substring(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
         if (!str)
             return JS_FALSE;
     }
-    *rval = STRING_TO_JSVAL(str);
+    *vp = STRING_TO_JSVAL(str);
     return JS_TRUE;
 }
 
 static JSBool
-str_toLowerCase(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-                jsval *rval)
+str_toLowerCase(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str;
     size_t i, n;
     jschar *s, *news;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -786,15 +1013,19 @@ str_toLowerCase(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
         JS_free(cx, news);
         return JS_FALSE;
     }
-    *rval = STRING_TO_JSVAL(str);
+    *vp = STRING_TO_JSVAL(str);
     return JS_TRUE;
 }
 
 static JSBool
-str_toLocaleLowerCase(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-                jsval *rval)
+str_toLocaleLowerCase(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     /*
      * Forcefully ignore the first (or any) argument and return toLowerCase(),
@@ -805,18 +1036,22 @@ str_toLocaleLowerCase(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
         if (!str)
             return JS_FALSE;
         argv[-1] = STRING_TO_JSVAL(str);
-        return cx->localeCallbacks->localeToLowerCase(cx, str, rval);
+        return cx->localeCallbacks->localeToLowerCase(cx, str, vp);
     }
-    return str_toLowerCase(cx, obj, 0, argv, rval);
+    return str_toLowerCase(cx, 0, vp);
 }
 
 static JSBool
-str_toUpperCase(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-                jsval *rval)
+str_toUpperCase(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str;
     size_t i, n;
     jschar *s, *news;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -836,15 +1071,19 @@ str_toUpperCase(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
         JS_free(cx, news);
         return JS_FALSE;
     }
-    *rval = STRING_TO_JSVAL(str);
+    *vp = STRING_TO_JSVAL(str);
     return JS_TRUE;
 }
 
 static JSBool
-str_toLocaleUpperCase(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-                jsval *rval)
+str_toLocaleUpperCase(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     /*
      * Forcefully ignore the first (or any) argument and return toUpperCase(),
@@ -855,16 +1094,20 @@ str_toLocaleUpperCase(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
         if (!str)
             return JS_FALSE;
         argv[-1] = STRING_TO_JSVAL(str);
-        return cx->localeCallbacks->localeToUpperCase(cx, str, rval);
+        return cx->localeCallbacks->localeToUpperCase(cx, str, vp);
     }
-    return str_toUpperCase(cx, obj, 0, argv, rval);
+    return str_toUpperCase(cx, 0, vp);
 }
 
 static JSBool
-str_localeCompare(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-                  jsval *rval)
+str_localeCompare(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str, *thatStr;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -872,26 +1115,31 @@ str_localeCompare(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
     argv[-1] = STRING_TO_JSVAL(str);
 
     if (argc == 0) {
-        *rval = JSVAL_ZERO;
+        *vp = JSVAL_ZERO;
     } else {
         thatStr = js_ValueToString(cx, argv[0]);
         if (!thatStr)
             return JS_FALSE;
         if (cx->localeCallbacks && cx->localeCallbacks->localeCompare) {
             argv[0] = STRING_TO_JSVAL(thatStr);
-            return cx->localeCallbacks->localeCompare(cx, str, thatStr, rval);
+            return cx->localeCallbacks->localeCompare(cx, str, thatStr, vp);
         }
-        *rval = INT_TO_JSVAL(js_CompareStrings(str, thatStr));
+        *vp = INT_TO_JSVAL(js_CompareStrings(str, thatStr));
     }
     return JS_TRUE;
 }
 
 static JSBool
-str_charAt(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_charAt(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str;
     jsdouble d;
     size_t index;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -907,24 +1155,28 @@ str_charAt(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     }
 
     if (d < 0 || JSSTRING_LENGTH(str) <= d) {
-        *rval = JS_GetEmptyStringValue(cx);
+        *vp = JS_GetEmptyStringValue(cx);
     } else {
         index = (size_t)d;
         str = js_NewDependentString(cx, str, index, 1, 0);
         if (!str)
             return JS_FALSE;
-        *rval = STRING_TO_JSVAL(str);
+        *vp = STRING_TO_JSVAL(str);
     }
     return JS_TRUE;
 }
 
 static JSBool
-str_charCodeAt(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-               jsval *rval)
+str_charCodeAt(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str;
     jsdouble d;
     size_t index;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -940,10 +1192,10 @@ str_charCodeAt(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
     }
 
     if (d < 0 || JSSTRING_LENGTH(str) <= d) {
-        *rval = JS_GetNaNValue(cx);
+        *vp = JS_GetNaNValue(cx);
     } else {
         index = (size_t)d;
-        *rval = INT_TO_JSVAL((jsint) JSSTRING_CHARS(str)[index]);
+        *vp = INT_TO_JSVAL((jsint) JSSTRING_CHARS(str)[index]);
     }
     return JS_TRUE;
 }
@@ -981,12 +1233,17 @@ js_BoyerMooreHorspool(const jschar *text, jsint textlen,
 }
 
 static JSBool
-str_indexOf(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_indexOf(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str, *str2;
     jsint i, j, index, textlen, patlen;
     const jschar *text, *pat;
     jsdouble d;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -1016,7 +1273,7 @@ str_indexOf(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         i = 0;
     }
     if (patlen == 0) {
-        *rval = INT_TO_JSVAL(i);
+        *vp = INT_TO_JSVAL(i);
         return JS_TRUE;
     }
 
@@ -1042,18 +1299,22 @@ str_indexOf(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     }
 
 out:
-    *rval = INT_TO_JSVAL(index);
+    *vp = INT_TO_JSVAL(index);
     return JS_TRUE;
 }
 
 static JSBool
-str_lastIndexOf(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-                  jsval *rval)
+str_lastIndexOf(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str, *str2;
     const jschar *text, *pat;
     jsint i, j, textlen, patlen;
     jsdouble d;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -1088,7 +1349,7 @@ str_lastIndexOf(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
     }
 
     if (patlen == 0) {
-        *rval = INT_TO_JSVAL(i);
+        *vp = INT_TO_JSVAL(i);
         return JS_TRUE;
     }
 
@@ -1103,7 +1364,7 @@ str_lastIndexOf(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
             j = 0;
         }
     }
-    *rval = INT_TO_JSVAL(i);
+    *vp = INT_TO_JSVAL(i);
     return JS_TRUE;
 }
 
@@ -1285,7 +1546,7 @@ match_glob(JSContext *cx, jsint count, GlobData *data)
     if (!matchstr)
         return JS_FALSE;
     v = STRING_TO_JSVAL(matchstr);
-    return js_SetProperty(cx, arrayobj, INT_TO_JSID(count), &v);
+    return OBJ_SET_PROPERTY(cx, arrayobj, INT_TO_JSID(count), &v);
 }
 
 static JSBool
@@ -1305,13 +1566,18 @@ str_match(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
 }
 
 static JSBool
-str_search(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_search(JSContext *cx, uintN argc, jsval *vp)
 {
     GlobData data;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     data.flags = MODE_SEARCH;
     data.optarg = 1;
-    return match_or_replace(cx, obj, argc, argv, NULL, &data, rval);
+    return match_or_replace(cx, obj, argc, argv, NULL, &data, vp);
 }
 
 typedef struct ReplaceData {
@@ -1587,7 +1853,7 @@ replace_glob(JSContext *cx, jsint count, GlobData *data)
 }
 
 static JSBool
-str_replace(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_replace(JSContext *cx, uintN argc, jsval *vp)
 {
     JSObject *lambda;
     JSString *repstr, *str;
@@ -1595,6 +1861,11 @@ str_replace(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     JSBool ok;
     jschar *chars;
     size_t leftlen, rightlen, length;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     if (JS_TypeOfValue(cx, argv[1]) == JSTYPE_FUNCTION) {
         lambda = JSVAL_TO_OBJECT(argv[1]);
@@ -1603,6 +1874,8 @@ str_replace(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         if (!JS_ConvertValue(cx, argv[1], JSTYPE_STRING, &argv[1]))
             return JS_FALSE;
         repstr = JSVAL_TO_STRING(argv[1]);
+        if (!JSSTRING_FLATTEN(cx, repstr))
+            return JS_FALSE;
         lambda = NULL;
     }
 
@@ -1628,14 +1901,14 @@ str_replace(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     rdata.index = 0;
     rdata.leftIndex = 0;
 
-    ok = match_or_replace(cx, obj, argc, argv, replace_glob, &rdata.base, rval);
+    ok = match_or_replace(cx, obj, argc, argv, replace_glob, &rdata.base, vp);
     if (!ok)
         return JS_FALSE;
 
     if (!rdata.chars) {
-        if ((rdata.base.flags & GLOBAL_REGEXP) || *rval != JSVAL_TRUE) {
+        if ((rdata.base.flags & GLOBAL_REGEXP) || *vp != JSVAL_TRUE) {
             /* Didn't match even once. */
-            *rval = STRING_TO_JSVAL(rdata.base.str);
+            *vp = STRING_TO_JSVAL(rdata.base.str);
             goto out;
         }
         leftlen = cx->regExpStatics.leftContext.length;
@@ -1673,7 +1946,7 @@ str_replace(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         ok = JS_FALSE;
         goto out;
     }
-    *rval = STRING_TO_JSVAL(str);
+    *vp = STRING_TO_JSVAL(str);
 
 out:
     /* If KEEP_REGEXP is still set, it's our job to destroy regexp now. */
@@ -1803,7 +2076,7 @@ find_split(JSContext *cx, JSString *str, JSRegExp *re, jsint *ip,
 }
 
 static JSBool
-str_split(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_split(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str, *sub;
     JSObject *arrayobj;
@@ -1814,6 +2087,11 @@ str_split(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     jsdouble d;
     jsint i, j;
     uint32 len, limit;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -1823,7 +2101,7 @@ str_split(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
     arrayobj = js_ConstructObject(cx, &js_ArrayClass, NULL, NULL, 0, NULL);
     if (!arrayobj)
         return JS_FALSE;
-    *rval = OBJECT_TO_JSVAL(arrayobj);
+    *vp = OBJECT_TO_JSVAL(arrayobj);
 
     if (argc == 0) {
         v = STRING_TO_JSVAL(str);
@@ -1920,11 +2198,16 @@ str_split(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
 
 #if JS_HAS_PERL_SUBSTR
 static JSBool
-str_substr(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_substr(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str;
     jsdouble d;
     jsdouble length, begin, end;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -1962,7 +2245,7 @@ str_substr(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         if (!str)
             return JS_FALSE;
     }
-    *rval = STRING_TO_JSVAL(str);
+    *vp = STRING_TO_JSVAL(str);
     return JS_TRUE;
 }
 #endif /* JS_HAS_PERL_SUBSTR */
@@ -1971,10 +2254,15 @@ str_substr(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
  * Python-esque sequence operations.
  */
 static JSBool
-str_concat(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_concat(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str, *str2;
     uintN i;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -1992,16 +2280,21 @@ str_concat(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
             return JS_FALSE;
     }
 
-    *rval = STRING_TO_JSVAL(str);
+    *vp = STRING_TO_JSVAL(str);
     return JS_TRUE;
 }
 
 static JSBool
-str_slice(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_slice(JSContext *cx, uintN argc, jsval *vp)
 {
     JSString *str;
     jsdouble d;
     jsdouble length, begin, end;
+    JSObject *obj;
+    jsval *argv;
+
+    obj = JS_THIS_OBJECT(cx, vp);
+    argv = JS_ARGV(cx, vp);
 
     str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
     if (!str)
@@ -2043,7 +2336,7 @@ str_slice(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
         if (!str)
             return JS_FALSE;
     }
-    *rval = STRING_TO_JSVAL(str);
+    *vp = STRING_TO_JSVAL(str);
     return JS_TRUE;
 }
 
@@ -2052,22 +2345,23 @@ str_slice(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
  * HTML composition aids.
  */
 static JSBool
-tagify(JSContext *cx, JSObject *obj, jsval *argv,
-       const char *begin, JSString *param, const char *end,
-       jsval *rval)
+tagify(JSContext *cx, jsval *vp,
+       const char *begin, JSString *param, const char *end)
 {
     JSString *str;
     jschar *tagbuf;
     size_t beglen, endlen, parlen, taglen;
     size_t i, j;
 
-    if (JSVAL_IS_STRING((jsval)obj)) {
-        str = JSVAL_TO_STRING((jsval)obj);
+    if (JSVAL_IS_STRING(vp[1])) {
+        str = JSVAL_TO_STRING(vp[1]);
+        if (!JSSTRING_FLATTEN(cx, str))
+            return JS_FALSE;
     } else {
-        str = js_ValueToString(cx, OBJECT_TO_JSVAL(obj));
+        str = js_ValueToString(cx, vp[1]);
         if (!str)
             return JS_FALSE;
-        argv[-1] = STRING_TO_JSVAL(str);
+        vp[1] = STRING_TO_JSVAL(str);
     }
 
     if (!end)
@@ -2119,175 +2413,164 @@ tagify(JSContext *cx, JSObject *obj, jsval *argv,
         free((char *)tagbuf);
         return JS_FALSE;
     }
-    *rval = STRING_TO_JSVAL(str);
+    *vp = STRING_TO_JSVAL(str);
     return JS_TRUE;
 }
 
 static JSBool
-tagify_value(JSContext *cx, JSObject *obj, jsval *argv,
-             const char *begin, const char *end,
-             jsval *rval)
+tagify_value(JSContext *cx, jsval *vp,
+             const char *begin, const char *end)
 {
     JSString *param;
 
-    param = js_ValueToString(cx, argv[0]);
+    param = js_ValueToString(cx, vp[2]);
     if (!param)
         return JS_FALSE;
-    argv[0] = STRING_TO_JSVAL(param);
-    return tagify(cx, obj, argv, begin, param, end, rval);
+    vp[2] = STRING_TO_JSVAL(param);
+    return tagify(cx, vp, begin, param, end);
 }
 
 static JSBool
-str_bold(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_bold(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify(cx, obj, argv, "b", NULL, NULL, rval);
+    return tagify(cx, vp, "b", NULL, NULL);
 }
 
 static JSBool
-str_italics(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_italics(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify(cx, obj, argv, "i", NULL, NULL, rval);
+    return tagify(cx, vp, "i", NULL, NULL);
 }
 
 static JSBool
-str_fixed(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_fixed(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify(cx, obj, argv, "tt", NULL, NULL, rval);
+    return tagify(cx, vp, "tt", NULL, NULL);
 }
 
 static JSBool
-str_fontsize(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_fontsize(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify_value(cx, obj, argv, "font size", "font", rval);
+    return tagify_value(cx, vp, "font size", "font");
 }
 
 static JSBool
-str_fontcolor(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-              jsval *rval)
+str_fontcolor(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify_value(cx, obj, argv, "font color", "font", rval);
+    return tagify_value(cx, vp, "font color", "font");
 }
 
 static JSBool
-str_link(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_link(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify_value(cx, obj, argv, "a href", "a", rval);
+    return tagify_value(cx, vp, "a href", "a");
 }
 
 static JSBool
-str_anchor(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_anchor(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify_value(cx, obj, argv, "a name", "a", rval);
+    return tagify_value(cx, vp, "a name", "a");
 }
 
 static JSBool
-str_strike(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_strike(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify(cx, obj, argv, "strike", NULL, NULL, rval);
+    return tagify(cx, vp, "strike", NULL, NULL);
 }
 
 static JSBool
-str_small(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_small(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify(cx, obj, argv, "small", NULL, NULL, rval);
+    return tagify(cx, vp, "small", NULL, NULL);
 }
 
 static JSBool
-str_big(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_big(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify(cx, obj, argv, "big", NULL, NULL, rval);
+    return tagify(cx, vp, "big", NULL, NULL);
 }
 
 static JSBool
-str_blink(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_blink(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify(cx, obj, argv, "blink", NULL, NULL, rval);
+    return tagify(cx, vp, "blink", NULL, NULL);
 }
 
 static JSBool
-str_sup(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_sup(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify(cx, obj, argv, "sup", NULL, NULL, rval);
+    return tagify(cx, vp, "sup", NULL, NULL);
 }
 
 static JSBool
-str_sub(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+str_sub(JSContext *cx, uintN argc, jsval *vp)
 {
-    return tagify(cx, obj, argv, "sub", NULL, NULL, rval);
+    return tagify(cx, vp, "sub", NULL, NULL);
 }
 #endif /* JS_HAS_STR_HTML_HELPERS */
 
+#define GENERIC           JSFUN_GENERIC_NATIVE
+#define PRIMITIVE         JSFUN_THISP_PRIMITIVE
+#define GENERIC_PRIMITIVE (GENERIC | PRIMITIVE)
+
 static JSFunctionSpec string_methods[] = {
 #if JS_HAS_TOSOURCE
-    {"quote",               str_quote,              0,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {js_toSource_str,       str_toSource,           0,JSFUN_THISP_STRING,0},
+    JS_FN("quote",             str_quote,             0,GENERIC_PRIMITIVE,0),
+    JS_FN(js_toSource_str,     str_toSource,          0,JSFUN_THISP_STRING,0),
 #endif
 
     /* Java-like methods. */
-    {js_toString_str,       str_toString,           0,JSFUN_THISP_STRING,0},
-    {js_valueOf_str,        str_valueOf,            0,JSFUN_THISP_STRING,0},
-    {"substring",           str_substring,          2,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"toLowerCase",         str_toLowerCase,        0,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"toUpperCase",         str_toUpperCase,        0,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"charAt",              str_charAt,             1,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"charCodeAt",          str_charCodeAt,         1,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"indexOf",             str_indexOf,            1,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"lastIndexOf",         str_lastIndexOf,        1,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"toLocaleLowerCase",   str_toLocaleLowerCase,  0,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"toLocaleUpperCase",   str_toLocaleUpperCase,  0,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"localeCompare",       str_localeCompare,      1,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
+    JS_FN(js_toString_str,     str_toString,          0,JSFUN_THISP_STRING,0),
+    JS_FN(js_valueOf_str,      str_valueOf,           0,JSFUN_THISP_STRING,0),
+    JS_FN("substring",         str_substring,         2,GENERIC_PRIMITIVE,0),
+    JS_FN("toLowerCase",       str_toLowerCase,       0,GENERIC_PRIMITIVE,0),
+    JS_FN("toUpperCase",       str_toUpperCase,       0,GENERIC_PRIMITIVE,0),
+    JS_FN("charAt",            str_charAt,            1,GENERIC_PRIMITIVE,0),
+    JS_FN("charCodeAt",        str_charCodeAt,        1,GENERIC_PRIMITIVE,0),
+    JS_FN("indexOf",           str_indexOf,           1,GENERIC_PRIMITIVE,0),
+    JS_FN("lastIndexOf",       str_lastIndexOf,       1,GENERIC_PRIMITIVE,0),
+    JS_FN("toLocaleLowerCase", str_toLocaleLowerCase, 0,GENERIC_PRIMITIVE,0),
+    JS_FN("toLocaleUpperCase", str_toLocaleUpperCase, 0,GENERIC_PRIMITIVE,0),
+    JS_FN("localeCompare",     str_localeCompare,     1,GENERIC_PRIMITIVE,0),
 
     /* Perl-ish methods (search is actually Python-esque). */
-    {"match",               str_match,              1,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,2},
-    {"search",              str_search,             1,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"replace",             str_replace,            2,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"split",               str_split,              2,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
+    /* match peeks at its caller's bytecode, so it needs a frame of its own. */
+    {"match",                  str_match,             1,GENERIC_PRIMITIVE,2},
+    JS_FN("search",            str_search,            1,GENERIC_PRIMITIVE,0),
+    JS_FN("replace",           str_replace,           2,GENERIC_PRIMITIVE,0),
+    JS_FN("split",             str_split,             2,GENERIC_PRIMITIVE,0),
 #if JS_HAS_PERL_SUBSTR
-    {"substr",              str_substr,             2,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
+    JS_FN("substr",            str_substr,            2,GENERIC_PRIMITIVE,0),
 #endif
 
     /* Python-esque sequence methods. */
-    {"concat",              str_concat,             0,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
-    {"slice",               str_slice,              0,JSFUN_GENERIC_NATIVE|
-                                                      JSFUN_THISP_PRIMITIVE,0},
+    JS_FN("concat",            str_concat,            0,GENERIC_PRIMITIVE,0),
+    JS_FN("slice",             str_slice,             0,GENERIC_PRIMITIVE,0),
 
     /* HTML string methods. */
 #if JS_HAS_STR_HTML_HELPERS
-    {"bold",                str_bold,               0,JSFUN_THISP_PRIMITIVE,0},
-    {"italics",             str_italics,            0,JSFUN_THISP_PRIMITIVE,0},
-    {"fixed",               str_fixed,              0,JSFUN_THISP_PRIMITIVE,0},
-    {"fontsize",            str_fontsize,           1,JSFUN_THISP_PRIMITIVE,0},
-    {"fontcolor",           str_fontcolor,          1,JSFUN_THISP_PRIMITIVE,0},
-    {"link",                str_link,               1,JSFUN_THISP_PRIMITIVE,0},
-    {"anchor",              str_anchor,             1,JSFUN_THISP_PRIMITIVE,0},
-    {"strike",              str_strike,             0,JSFUN_THISP_PRIMITIVE,0},
-    {"small",               str_small,              0,JSFUN_THISP_PRIMITIVE,0},
-    {"big",                 str_big,                0,JSFUN_THISP_PRIMITIVE,0},
-    {"blink",               str_blink,              0,JSFUN_THISP_PRIMITIVE,0},
-    {"sup",                 str_sup,                0,JSFUN_THISP_PRIMITIVE,0},
-    {"sub",                 str_sub,                0,JSFUN_THISP_PRIMITIVE,0},
+    JS_FN("bold",              str_bold,              0,PRIMITIVE,0),
+    JS_FN("italics",           str_italics,           0,PRIMITIVE,0),
+    JS_FN("fixed",             str_fixed,             0,PRIMITIVE,0),
+    JS_FN("fontsize",          str_fontsize,          1,PRIMITIVE,0),
+    JS_FN("fontcolor",         str_fontcolor,         1,PRIMITIVE,0),
+    JS_FN("link",              str_link,              1,PRIMITIVE,0),
+    JS_FN("anchor",            str_anchor,            1,PRIMITIVE,0),
+    JS_FN("strike",            str_strike,            0,PRIMITIVE,0),
+    JS_FN("small",             str_small,             0,PRIMITIVE,0),
+    JS_FN("big",               str_big,               0,PRIMITIVE,0),
+    JS_FN("blink",             str_blink,             0,PRIMITIVE,0),
+    JS_FN("sup",               str_sup,               0,PRIMITIVE,0),
+    JS_FN("sub",               str_sub,               0,PRIMITIVE,0),
 #endif
 
     {0,0,0,0,0}
 };
 
+#undef GENERIC
+#undef PRIMITIVE
+#undef GENERIC_PRIMITIVE
+
 static JSBool
 String(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
 {
@@ -2310,13 +2593,15 @@ String(JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
 }
 
 static JSBool
-str_fromCharCode(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
-                 jsval *rval)
+str_fromCharCode(JSContext *cx, uintN argc, jsval *vp)
 {
     jschar *chars;
     uintN i;
     uint16 code;
     JSString *str;
+    jsval *argv;
+
+    argv = JS_ARGV(cx, vp);
 
     JS_ASSERT(argc < ARRAY_INIT_LIMIT);
     chars = (jschar *) JS_malloc(cx, (argc + 1) * sizeof(jschar));
@@ -2335,12 +2620,12 @@ str_fromCharCode(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
         JS_free(cx, chars);
         return JS_FALSE;
     }
-    *rval = STRING_TO_JSVAL(str);
+    *vp = STRING_TO_JSVAL(str);
     return JS_TRUE;
 }
 
 static JSFunctionSpec string_static_methods[] = {
-    {"fromCharCode",    str_fromCharCode,       1,0,0},
+    JS_FN("fromCharCode", str_fromCharCode,  1,0,0),
     {0,0,0,0,0}
 };
 
@@ -2469,6 +2754,10 @@ js_NewDependentString(JSContext *cx, JSString *base, size_t start,
     if (start == 0 && length == JSSTRING_LENGTH(base))
         return base;
 
+    /* Dependent strings point into their base's chars, so it must be flat. */
+    if (!JSSTRING_FLATTEN(cx, base))
+        return NULL;
+
     if (start > JSSTRDEP_START_MASK ||
         (start != 0 && length > JSSTRDEP_LENGTH_MASK)) {
         return js_NewStringCopyN(cx, JSSTRING_CHARS(base) + start, length,
@@ -2625,11 +2914,16 @@ js_FinalizeStringRT(JSRuntime *rt, JSString *str)
         JS_ASSERT(JSSTRDEP_BASE(str));
         JS_RUNTIME_UNMETER(rt, liveDependentStrings);
         valid = JS_TRUE;
+    } else if (JSSTRING_IS_ROPE(str)) {
+        /* The operands are GC-things, only the node is owned by the rope. */
+        free(JSSTRROPE(str)->node);
+        valid = JS_TRUE;
     } else {
         /* A stillborn string has null chars, so is not valid. */
         valid = (str->chars != NULL);
         if (valid)
-            free(str->chars);
+            js_FreeLater(rt, str->chars,
+                         (JSSTRING_LENGTH(str) + 1) * sizeof(jschar));
     }
     if (valid) {
         js_PurgeDeflatedStringCache(rt, str);
@@ -2643,6 +2937,9 @@ js_StringToObject(JSContext *cx, JSString *str)
 {
     JSObject *obj;
 
+    /* String methods read the characters of the wrapped string. */
+    if (!JSSTRING_FLATTEN(cx, str))
+        return NULL;
     obj = js_NewObject(cx, &js_StringClass, NULL, NULL);
     if (!obj)
         return NULL;
@@ -2683,6 +2980,10 @@ js_ValueToString(JSContext *cx, jsval v)
     }
     if (JSVAL_IS_STRING(v)) {
         str = JSVAL_TO_STRING(v);
+
+        /* Callers read the characters, so flatten where we can report. */
+        if (!JSSTRING_FLATTEN(cx, str))
+            return NULL;
     } else if (JSVAL_IS_INT(v)) {
         str = js_NumberToString(cx, JSVAL_TO_INT(v));
     } else if (JSVAL_IS_DOUBLE(v)) {
@@ -3162,6 +3463,10 @@ js_GetStringBytes(JSRuntime *rt, JSString *str)
     JSHashNumber hash;
     JSHashEntry *he, **hep;
 
+    /* No cx to report with, JS_GetStringBytes returns "" then. */
+    if (!JSSTRING_FLATTEN(NULL, str))
+        return NULL;
+
     JS_ACQUIRE_LOCK(rt->deflatedStringCacheLock);
 
     cache = GetDeflatedStringCache(rt);
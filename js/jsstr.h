@@ -67,7 +67,9 @@ JS_BEGIN_EXTERN_C
  * native code that requires \u0000 termination.
  *
  * NB: Always use the JSSTRING_LENGTH and JSSTRING_CHARS accessor macros,
- * unless you guard str->member uses with !JSSTRING_IS_DEPENDENT(str).
+ * unless you guard str->member uses with !JSSTRING_IS_DEPENDENT(str) and
+ * !JSSTRING_IS_ROPE(str).  JSSTRING_CHARS needs a string that is not a rope,
+ * use JSSTRING_FLATTEN first on strings that may be one.
  */
 struct JSString {
     size_t          length;
@@ -88,12 +90,39 @@ struct JSDependentString {
     JSString        *base;
 };
 
+/*
+ * Overlay structure for a lazy concatenation of two strings, made by
+ * js_ConcatStrings so that building a long string with repeated += is linear
+ * instead of quadratic.  Distinguished by the JSSTRFLAG_PREFIX bit being set
+ * without JSSTRFLAG_DEPENDENT.  The left and right operands live in a node
+ * allocated from the malloc heap, length is the sum of their lengths, and the
+ * characters are only made by js_FlattenRope, which turns the rope into a flat
+ * string in place.  Flattening can run out of memory, so JSSTRING_CHARS never
+ * flattens: code that may get a rope calls JSSTRING_FLATTEN first, where it
+ * has a cx to report the failure.  js_ValueToString, js_StringToObject and
+ * js_AtomizeString hand out flat strings, so most natives never see a rope.
+ * Flattening does not allocate GC-things, so it can't run the GC.  Like the
+ * other in-place changes to a string it is only done to strings that have the
+ * GCF_MUTABLE flag, which js_FinishSharingScope clears (flattening the rope)
+ * before another thread can see the string.
+ */
+typedef struct JSRopeNode {
+    JSString        *left;
+    JSString        *right;
+} JSRopeNode;
+
+typedef struct JSRopeString {
+    size_t          length;
+    JSRopeNode      *node;
+} JSRopeString;
+
 /* Definitions for flags stored in the high order bits of JSString.length. */
 #define JSSTRFLAG_BITS              2
 #define JSSTRFLAG_SHIFT(flg)        ((size_t)(flg) << JSSTRING_LENGTH_BITS)
 #define JSSTRFLAG_MASK              JSSTRFLAG_SHIFT(JS_BITMASK(JSSTRFLAG_BITS))
 #define JSSTRFLAG_DEPENDENT         JSSTRFLAG_SHIFT(1)
 #define JSSTRFLAG_PREFIX            JSSTRFLAG_SHIFT(2)
+#define JSSTRFLAG_ROPE              JSSTRFLAG_PREFIX
 
 /* Universal JSString type inquiry and accessor macros. */
 #define JSSTRING_BIT(n)             ((size_t)1 << (n))
@@ -101,12 +130,17 @@ struct JSDependentString {
 #define JSSTRING_HAS_FLAG(str,flg)  ((str)->length & (flg))
 #define JSSTRING_IS_DEPENDENT(str)  JSSTRING_HAS_FLAG(str, JSSTRFLAG_DEPENDENT)
 #define JSSTRING_IS_PREFIX(str)     JSSTRING_HAS_FLAG(str, JSSTRFLAG_PREFIX)
+#define JSSTRING_IS_ROPE(str)       (((str)->length & JSSTRFLAG_MASK)         \
+                                     == JSSTRFLAG_ROPE)
 #define JSSTRING_CHARS(str)         (JSSTRING_IS_DEPENDENT(str)               \
                                      ? JSSTRDEP_CHARS(str)                    \
-                                     : (str)->chars)
+                                     : (JS_ASSERT(!JSSTRING_IS_ROPE(str)),    \
+                                        (str)->chars))
+#define JSSTRING_FLATTEN(cx,str)    (!JSSTRING_IS_ROPE(str) ||                \
+                                     js_FlattenRope(cx, str))
 #define JSSTRING_LENGTH(str)        (JSSTRING_IS_DEPENDENT(str)               \
                                      ? JSSTRDEP_LENGTH(str)                   \
-                                     : (str)->length)
+                                     : (str)->length & JSSTRING_LENGTH_MASK)
 #define JSSTRING_LENGTH_BITS        (sizeof(size_t) * JS_BITS_PER_BYTE        \
                                      - JSSTRFLAG_BITS)
 #define JSSTRING_LENGTH_MASK        JSSTRING_BITMASK(JSSTRING_LENGTH_BITS)
@@ -145,6 +179,15 @@ struct JSDependentString {
      ? js_GetDependentStringChars(str)                                        \
      : JSSTRDEP_BASE(str)->chars + JSSTRDEP_START(str))
 
+/* Specific JSRopeString accessor and mutator macros. */
+#define JSSTRROPE(str)              ((JSRopeString *)(str))
+#define JSSTRROPE_LENGTH(str)       (JSSTRROPE(str)->length & JSSTRING_LENGTH_MASK)
+#define JSSTRROPE_LEFT(str)         (JSSTRROPE(str)->node->left)
+#define JSSTRROPE_RIGHT(str)        (JSSTRROPE(str)->node->right)
+#define JSSTRROPE_SET(str,n,len)    (JSSTRROPE(str)->length = JSSTRFLAG_ROPE  \
+                                                            | (len),          \
+                                     JSSTRROPE(str)->node = (n))
+
 extern size_t
 js_MinimizeDependentStrings(JSString *str, int level, JSString **basep);
 
@@ -157,6 +200,9 @@ js_GetStringChars(JSString *str);
 extern JSString *
 js_ConcatStrings(JSContext *cx, JSString *left, JSString *right);
 
+extern jschar *
+js_FlattenRope(JSContext *cx, JSString *str);
+
 extern const jschar *
 js_UndependString(JSContext *cx, JSString *str);
 
@@ -386,7 +432,8 @@ js_HashString(JSString *str);
 
 /*
  * Return less than, equal to, or greater than zero depending on whether
- * str1 is less than, equal to, or greater than str2.
+ * str1 is less than, equal to, or greater than str2.  Like js_HashString and
+ * js_EqualStrings it has no cx, so ropes must be flattened before the call.
  */
 extern intN
 js_CompareStrings(JSString *str1, JSString *str2);
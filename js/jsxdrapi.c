@@ -48,6 +48,7 @@
 #include "jsprf.h"
 #include "jsapi.h"
 #include "jscntxt.h"
+#include "jslock.h"
 #include "jsnum.h"
 #include "jsobj.h"              /* js_XDRObject */
 #include "jsscript.h"           /* js_XDRScript */
@@ -446,8 +447,11 @@ JS_XDRString(JSXDRState *xdr, JSString **strp)
     uint32 nchars;
     jschar *chars;
 
-    if (xdr->mode == JSXDR_ENCODE)
+    if (xdr->mode == JSXDR_ENCODE) {
+        if (!JSSTRING_FLATTEN(xdr->cx, *strp))
+            return JS_FALSE;
         nchars = JSSTRING_LENGTH(*strp);
+    }
     if (!JS_XDRUint32(xdr, &nchars))
         return JS_FALSE;
 
@@ -725,7 +729,19 @@ js_XDRCStringAtom(JSXDRState *xdr, JSAtom **atomp)
 JS_PUBLIC_API(JSBool)
 JS_XDRScript(JSXDRState *xdr, JSScript **scriptp)
 {
-    if (!js_XDRScript(xdr, scriptp, NULL))
+    JSBool ok;
+
+    /*
+     * Atoms decoded into a script's atom map are reachable only from that
+     * map until the script runs, so keep them alive across any GC that the
+     * decoder's allocations might trigger.
+     */
+    if (xdr->mode == JSXDR_DECODE)
+        JS_KEEP_ATOMS(xdr->cx->runtime);
+    ok = js_XDRScript(xdr, scriptp, NULL);
+    if (xdr->mode == JSXDR_DECODE)
+        JS_UNKEEP_ATOMS(xdr->cx->runtime);
+    if (!ok)
         return JS_FALSE;
     if (xdr->mode == JSXDR_DECODE)
         js_CallNewScriptHook(xdr->cx, *scriptp, NULL);
@@ -522,7 +522,7 @@ qname_toString(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
             return JS_FALSE;
     }
     str = js_ConcatStrings(cx, str, qn->localName);
-    if (!str)
+    if (!str || !JSSTRING_FLATTEN(cx, str))
         return JS_FALSE;
 
     if (str && clasp == &js_AttributeNameClass) {
@@ -3041,8 +3041,12 @@ ToXMLString(JSContext *cx, jsval v)
     if (JSVAL_IS_BOOLEAN(v) || JSVAL_IS_NUMBER(v))
         return js_ValueToString(cx, v);
 
-    if (JSVAL_IS_STRING(v))
-        return EscapeElementValue(cx, NULL, JSVAL_TO_STRING(v));
+    if (JSVAL_IS_STRING(v)) {
+        str = JSVAL_TO_STRING(v);
+        if (!JSSTRING_FLATTEN(cx, str))
+            return NULL;
+        return EscapeElementValue(cx, NULL, str);
+    }
 
     obj = JSVAL_TO_OBJECT(v);
     if (!OBJECT_IS_XML(cx, obj)) {
@@ -3070,6 +3074,8 @@ ToAttributeName(JSContext *cx, jsval v)
 
     if (JSVAL_IS_STRING(v)) {
         name = JSVAL_TO_STRING(v);
+        if (!JSSTRING_FLATTEN(cx, name))
+            return NULL;
         uri = prefix = cx->runtime->emptyString;
     } else {
         if (JSVAL_IS_PRIMITIVE(v)) {
@@ -3128,6 +3134,8 @@ ToXMLName(JSContext *cx, jsval v, jsid *funidp)
 
     if (JSVAL_IS_STRING(v)) {
         name = JSVAL_TO_STRING(v);
+        if (!JSSTRING_FLATTEN(cx, name))
+            return NULL;
     } else {
         if (JSVAL_IS_PRIMITIVE(v)) {
             name = js_DecompileValueGenerator(cx, JSDVG_IGNORE_STACK, v, NULL);
@@ -4722,6 +4730,8 @@ PutProperty(JSContext *cx, JSObject *obj, jsval id, jsval *vp)
 
             /* 7(g). */
             attr->xml_value = JSVAL_TO_STRING(*vp);
+            if (!JSSTRING_FLATTEN(cx, attr->xml_value))
+                goto bad;
             goto out;
         }
 
@@ -4835,7 +4845,8 @@ PutProperty(JSContext *cx, JSObject *obj, jsval id, jsval *vp)
             /* 14(b-c). */
             /* XXXbe Erratum? redundant w.r.t. 7(b-c) else clause above */
             if (ok) {
-                ok = JS_ConvertValue(cx, *vp, JSTYPE_STRING, vp);
+                ok = JS_ConvertValue(cx, *vp, JSTYPE_STRING, vp) &&
+                     JSSTRING_FLATTEN(cx, JSVAL_TO_STRING(*vp));
                 if (ok && !IS_EMPTY(JSVAL_TO_STRING(*vp))) {
                     roots[VAL_ROOT] = *vp;
                     if ((JSXML *) XMLArrayCursorItem(&cursor) == kid)
@@ -5485,7 +5496,9 @@ xml_equality(JSContext *cx, JSObject *obj, jsval v, JSBool *bp)
                 if (!str) {
                     ok = JS_FALSE;
                 } else if (JSVAL_IS_STRING(v)) {
-                    *bp = js_EqualStrings(str, JSVAL_TO_STRING(v));
+                    ok = JSSTRING_FLATTEN(cx, JSVAL_TO_STRING(v));
+                    if (ok)
+                        *bp = js_EqualStrings(str, JSVAL_TO_STRING(v));
                 } else {
                     ok = js_ValueToNumber(cx, STRING_TO_JSVAL(str), &d);
                     if (ok) {
@@ -6590,7 +6603,7 @@ xml_normalize(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
                    (kid2 = XMLARRAY_MEMBER(&xml->xml_kids, i + 1, JSXML)) &&
                    kid2->xml_class == JSXML_CLASS_TEXT) {
                 str = js_ConcatStrings(cx, kid->xml_value, kid2->xml_value);
-                if (!str)
+                if (!str || !JSSTRING_FLATTEN(cx, str))
                     return JS_FALSE;
                 if (!NormalizingDelete(cx, obj, xml, INT_TO_JSVAL(i + 1)))
                     return JS_FALSE;
@@ -6935,6 +6948,8 @@ xml_setLocalName(JSContext *cx, JSObject *obj, uintN argc, jsval *argv,
             return JS_FALSE;
         name = argv[0];
         namestr = JSVAL_TO_STRING(name);
+        if (!JSSTRING_FLATTEN(cx, namestr))
+            return JS_FALSE;
     }
 
     xml = CHECK_COPY_ON_WRITE(cx, xml, obj);
@@ -7905,7 +7920,7 @@ js_AddAttributePart(JSContext *cx, JSBool isName, JSString *str, JSString *str2)
     size_t len, len2, newlen;
     jschar *chars;
 
-    if (JSSTRING_IS_DEPENDENT(str) ||
+    if (JSSTRING_IS_DEPENDENT(str) || JSSTRING_IS_ROPE(str) ||
         !(*js_GetGCThingFlags(str) & GCF_MUTABLE)) {
         str = js_NewStringCopyN(cx, JSSTRING_CHARS(str), JSSTRING_LENGTH(str),
                                 0);
@@ -0,0 +1,244 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#include "Cache.h"
+
+JSScript*
+Cache_load (JSContext* cx, const char* path, struct stat* info)
+{
+    char* cachePath = __Cache_getPath(cx, path);
+
+    if (!cachePath) {
+        return NULL;
+    }
+
+    FILE* fp = fopen(cachePath, "rb");
+    JS_free(cx, cachePath);
+
+    if (!fp) {
+        return NULL;
+    }
+
+    CacheHeader expected; __Cache_initHeader(&expected, path, info);
+    CacheHeader header;
+    struct stat entry;
+
+    /*
+     * The lengths come from the file, so a corrupt or truncated entry must
+     * not make us allocate or read more than the file holds.
+     */
+    if (fstat(fileno(fp), &entry) != 0
+     || fread(&header, sizeof(CacheHeader), 1, fp) != 1
+     || memcmp(&header, &expected, offsetof(CacheHeader, dataLength)) != 0
+     || header.dataLength == 0
+     || (uint64) entry.st_size != sizeof(CacheHeader) + (uint64) header.pathLength + header.dataLength) {
+        fclose(fp);
+        return NULL;
+    }
+
+    char* savedPath = JS_malloc(cx, header.pathLength);
+    if (!savedPath
+     || fread(savedPath, sizeof(char), header.pathLength, fp) != header.pathLength
+     || memcmp(savedPath, path, header.pathLength) != 0) {
+        if (savedPath) {
+            JS_free(cx, savedPath);
+        }
+
+        fclose(fp);
+        return NULL;
+    }
+    JS_free(cx, savedPath);
+
+    char* data = JS_malloc(cx, header.dataLength);
+    if (!data) {
+        fclose(fp);
+        return NULL;
+    }
+
+    if (fread(data, sizeof(char), header.dataLength, fp) != header.dataLength) {
+        JS_free(cx, data);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+
+    JSScript*   script = NULL;
+    JSXDRState* xdr    = JS_XDRNewMem(cx, JSXDR_DECODE);
+    JS_XDRMemSetData(xdr, data, header.dataLength);
+
+    if (!JS_XDRScript(xdr, &script)) {
+        // A broken cache entry isn't an error, the source will be compiled.
+        JS_ClearPendingException(cx);
+        script = NULL;
+    }
+
+    // The XDR state frees the data when destroyed.
+    JS_XDRDestroy(xdr);
+
+    #ifdef DEBUG
+    printf("(cache) %s %s\n", script ? "hit" : "broken", path);
+    #endif
+
+    return script;
+}
+
+void
+Cache_save (JSContext* cx, const char* path, struct stat* info, JSScript* script)
+{
+    char* cachePath = __Cache_getPath(cx, path);
+
+    if (!cachePath) {
+        return;
+    }
+
+    JSXDRState* xdr = JS_XDRNewMem(cx, JSXDR_ENCODE);
+
+    if (!JS_XDRScript(xdr, &script)) {
+        JS_ClearPendingException(cx);
+        JS_XDRDestroy(xdr);
+        JS_free(cx, cachePath);
+        return;
+    }
+
+    CacheHeader header; __Cache_initHeader(&header, path, info);
+    void* data = JS_XDRMemGetData(xdr, &header.dataLength);
+
+    /*
+     * Write to a temporary file and rename it over the old entry so a
+     * concurrent ljs never reads a half written file.
+     */
+    char* tmpPath = JS_malloc(cx, (strlen(cachePath)+32)*sizeof(char));
+    sprintf(tmpPath, "%s.%d", cachePath, getpid());
+
+    FILE* fp = fopen(tmpPath, "wb");
+
+    if (fp) {
+        JSBool ok = (fwrite(&header, sizeof(CacheHeader), 1, fp) == 1
+                  && fwrite(path, sizeof(char), header.pathLength, fp) == header.pathLength
+                  && fwrite(data, sizeof(char), header.dataLength, fp) == header.dataLength);
+
+        if (fclose(fp) == 0 && ok && rename(tmpPath, cachePath) == 0) {
+            #ifdef DEBUG
+            printf("(cache) saved %s\n", path);
+            #endif
+        }
+        else {
+            unlink(tmpPath);
+        }
+    }
+
+    JS_XDRDestroy(xdr);
+    JS_free(cx, tmpPath);
+    JS_free(cx, cachePath);
+}
+
+char*
+__Cache_getDirectory (JSContext* cx)
+{
+    char* directory;
+    char* env = getenv("JSCACHE");
+
+    /*
+     * JSCACHE sets the cache directory, if it's set but empty the cache is
+     * disabled, otherwise the cache is in ~/.lulzjs/cache.
+     */
+    if (env) {
+        if (strlen(env) == 0) {
+            return NULL;
+        }
+
+        directory = JS_strdup(cx, env);
+    }
+    else {
+        char* home = getenv("HOME");
+
+        if (!home) {
+            return NULL;
+        }
+
+        directory = JS_malloc(cx, (strlen(home)+strlen("/.lulzjs/cache")+1)*sizeof(char));
+        strcpy(directory, home);
+        strcat(directory, "/.lulzjs");
+        mkdir(directory, 0755);
+        strcat(directory, "/cache");
+    }
+
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        JS_free(cx, directory);
+        return NULL;
+    }
+
+    return directory;
+}
+
+char*
+__Cache_getPath (JSContext* cx, const char* path)
+{
+    static char* directory = NULL;
+    static JSBool checked  = JS_FALSE;
+
+    if (!checked) {
+        directory = __Cache_getDirectory(cx);
+        checked   = JS_TRUE;
+    }
+
+    if (!directory || path[0] != '/') {
+        return NULL;
+    }
+
+    /*
+     * The entry name is the absolute path of the source with the slashes
+     * replaced, the header keeps the real path to check for collisions.
+     */
+    char* cachePath = JS_malloc(cx, (strlen(directory)+strlen(path)+strlen("/.jsc")+1)*sizeof(char));
+    strcpy(cachePath, directory);
+    strcat(cachePath, "/");
+
+    char* name = cachePath + strlen(cachePath);
+    strcat(cachePath, path+1);
+    strcat(cachePath, ".jsc");
+
+    for (; *name; name++) {
+        if (*name == '/') {
+            *name = '%';
+        }
+    }
+
+    return cachePath;
+}
+
+void
+__Cache_initHeader (CacheHeader* header, const char* path, struct stat* info)
+{
+    memset(header, 0, sizeof(CacheHeader));
+
+    memcpy(header->magic, "LJSC", 4);
+    header->format = __CACHE_FORMAT__;
+    header->xdr    = JSXDR_MAGIC_SCRIPT_CURRENT;
+    strncpy(header->engine, JS_GetImplementationVersion(), sizeof(header->engine)-1);
+    strncpy(header->version, __LJS_VERSION__, sizeof(header->version)-1);
+
+    header->device = info->st_dev;
+    header->inode  = info->st_ino;
+    header->mtime     = info->st_mtim.tv_sec;
+    header->mtimeNsec = info->st_mtim.tv_nsec;
+    header->size      = info->st_size;
+
+    header->pathLength = strlen(path);
+}
+
@@ -0,0 +1,79 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include "lulzjs.h"
+#include "jsxdrapi.h"
+
+// Not cross platform
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "Misc.h"
+
+/*
+ * Bump this when the layout of the cache files changes, old files will be
+ * recompiled and overwritten.
+ */
+#define __CACHE_FORMAT__ 2
+
+typedef struct {
+    char   magic[4];
+    uint32 format;
+    uint32 xdr;
+    char   engine[64];
+    char   version[16];
+
+    uint64 device;
+    uint64 inode;
+    int64  mtime;
+    int64  mtimeNsec;
+    int64  size;
+
+    uint32 pathLength;
+    uint32 dataLength;
+} CacheHeader;
+
+/*
+ * Get the compiled script for the given source file from the cache, the
+ * cache entry is used only if it was made from a file with the same path,
+ * mtime (to the nanosecond, a file edited in the same second as the entry was
+ * written would look fresh otherwise) and size by the same engine and lulzJS
+ * version.
+ *
+ * RETURN:
+ *     JSScript* < The script or NULL if there's no valid entry.
+ */
+JSScript* Cache_load (JSContext* cx, const char* path, struct stat* info);
+
+/*
+ * Save the compiled script for the given source file in the cache, failures
+ * are silently ignored since the cache is only an optimization.
+ */
+void Cache_save (JSContext* cx, const char* path, struct stat* info, JSScript* script);
+
+char*  __Cache_getDirectory (JSContext* cx);
+char*  __Cache_getPath (JSContext* cx, const char* path);
+void   __Cache_initHeader (CacheHeader* header, const char* path, struct stat* info);
+
+#endif
@@ -18,6 +18,23 @@
 
 #include "Core.h"
 
+/*
+ * The canonical paths of the included files and the resolved paths keyed by
+ * the including script's directory and the requested name, the resolutions
+ * are valid as long as __PATH__ doesn't change.  The signature is only built
+ * again when __PATH__ is replaced or its hooks saw it change.
+ */
+static JSHashTable* included    = NULL;
+static JSHashTable* resolved    = NULL;
+static char*        signature   = NULL;
+static JSObject*    signedPath  = NULL;
+static JSBool       pathChanged = JS_TRUE;
+
+static JSHashAllocOps Core_tableOps = {
+    __Core_allocTable, __Core_freeTable,
+    __Core_allocEntry, __Core_freeEntry
+};
+
 JSObject*
 Core_initialize (JSContext *cx, const char* script)
 {
@@ -30,6 +47,10 @@ Core_initialize (JSContext *cx, const char* script)
     if (object && JS_InitStandardClasses(cx, object)) {
         JS_DefineFunctions(cx, object, Core_methods);
 
+        if (!EventLoop_initialize(cx, object) || !GC_initialize(cx, object)) {
+            return NULL;
+        }
+
         // Properties
         jsval property;
 
@@ -38,10 +59,17 @@ Core_initialize (JSContext *cx, const char* script)
             STRING_TO_JSVAL(JS_NewString(cx, rootPath, strlen(rootPath))),
             STRING_TO_JSVAL(JS_NewString(cx, JS_strdup(cx, __LJS_LIBRARY_PATH__), strlen(__LJS_LIBRARY_PATH__)))
         };
-        JSObject* path = JS_NewArrayObject(cx, 2, paths);
+        jsval array; JS_GetProperty(cx, object, "Array", &array);
+        jsval proto; JS_GetProperty(cx, JSVAL_TO_OBJECT(array), "prototype", &proto);
+
+        JSObject* path = JS_NewObject(cx, &Core_pathClass, JSVAL_TO_OBJECT(proto), NULL);
         property       = OBJECT_TO_JSVAL(path);
         JS_SetProperty(cx, object, "__PATH__", &property);
 
+        JS_DefineElement(cx, path, 0, paths[0], NULL, NULL, JSPROP_ENUMERATE);
+        JS_DefineElement(cx, path, 1, paths[1], NULL, NULL, JSPROP_ENUMERATE);
+        JS_DefineProperty(cx, path, "length", INT_TO_JSVAL(2), NULL, NULL, 0);
+
         property = STRING_TO_JSVAL(JS_NewString(cx, JS_strdup(cx, __LJS_VERSION__), strlen(__LJS_VERSION__)));
         JS_SetProperty(cx, object, "__VERSION__", &property);
 
@@ -144,14 +172,6 @@ Core_require (JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval
     return JS_TRUE;
 }
 
-JSBool
-Core_GC (JSContext* cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
-{
-    JS_MaybeGC(cx);
-
-    return JS_TRUE;
-}
-
 JSBool
 Core_die (JSContext *cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
 {
@@ -313,28 +333,72 @@ __Core_getScriptName (JSContext* cx)
 char*
 __Core_getPath (JSContext* cx, const char* fileName)
 {
+    jsval jsPath;
+    JS_GetProperty(cx, JS_GetGlobalObject(cx), "__PATH__", &jsPath);
+    JSObject* lPath = JSVAL_TO_OBJECT(jsPath);
+
+    /*
+     * Throw away the resolutions if __PATH__ changed since they were made,
+     * a __PATH__ that isn't the one Core made has no hooks to tell.
+     */
+    if (!resolved || pathChanged || lPath != signedPath || JS_GET_CLASS(cx, lPath) != &Core_pathClass) {
+        char* current = __Core_getPathSignature(cx, lPath);
+
+        if (!resolved || strcmp(current, signature) != 0) {
+            if (resolved) {
+                JS_HashTableDestroy(resolved);
+                free(signature);
+            }
+
+            resolved  = __Core_newTable();
+            signature = current;
+        }
+        else {
+            free(current);
+        }
+
+        signedPath  = lPath;
+        pathChanged = JS_FALSE;
+    }
+
     /*
-     * Getting the dirname of the file from the other file is included
-     * then copying it and getting the path to the dir.
+     * Getting the dirname of the file from the other file is included,
+     * the key is the dir and the name since relative names depend on it.
      */
     char* from = JS_strdup(cx, __Core_getScriptName(cx));
     char* dir  = dirname(from);
-    char* path = JS_malloc(cx, (strlen(dir)+2)*sizeof(char));
+    char* key  = malloc((strlen(dir)+strlen(fileName)+2)*sizeof(char));
 
-    strcpy(path, dir); strcat(path, "/"); JS_free(cx, from);
-    
+    strcpy(key, dir); strcat(key, "\n"); strcat(key, fileName);
+
+    // Not found resolutions are kept too, the path is the last one checked.
+    char* path = JS_HashTableLookup(resolved, key);
+
+    if (path) {
+        free(key);
+        JS_free(cx, from);
+
+        return JS_strdup(cx, path);
+    }
+
+    path = __Core_resolvePath(cx, lPath, dir, fileName);
+    JS_HashTableAdd(resolved, key, strdup(path));
+    JS_free(cx, from);
+
+    return path;
+}
+
+char*
+__Core_resolvePath (JSContext* cx, JSObject* lPath, const char* dir, const char* fileName)
+{
     /*
      * Copying the base to the path and then adding the relative path to
      * the file to import
      */
-    path = JS_realloc(cx, path, (strlen(path)+strlen(fileName)+1)*sizeof(char));
-    strcat(path, fileName);
+    char* path = JS_malloc(cx, (strlen(dir)+strlen(fileName)+2)*sizeof(char));
+    strcpy(path, dir); strcat(path, "/"); strcat(path, fileName);
 
     if (!fileExists(path)) {
-        jsval jsPath;
-        JS_GetProperty(cx, JS_GetGlobalObject(cx), "__PATH__", &jsPath);
-        JSObject* lPath = JSVAL_TO_OBJECT(jsPath);
-
         jsuint length;
         JS_GetArrayLength(cx, lPath, &length);
 
@@ -345,11 +409,9 @@ __Core_getPath (JSContext* cx, const char* fileName)
             jsval pathFile;
             JS_GetElement(cx, lPath, i, &pathFile);
 
-            path = JS_strdup(cx, JS_GetStringBytes(JSVAL_TO_STRING(pathFile)));
-            path = JS_realloc(cx, path, (strlen(path)+2)*sizeof(char));
-            strcat(path, "/");
-            path = JS_realloc(cx, path, (strlen(path)+strlen(fileName)+1)*sizeof(char));
-            strcat(path, fileName);
+            char* base = JS_GetStringBytes(JS_ValueToString(cx, pathFile));
+            path = JS_malloc(cx, (strlen(base)+strlen(fileName)+2)*sizeof(char));
+            strcpy(path, base); strcat(path, "/"); strcat(path, fileName);
 
             if (fileExists(path)) {
                 break;
@@ -360,23 +422,82 @@ __Core_getPath (JSContext* cx, const char* fileName)
     return path;
 }
 
+char*
+__Core_getPathSignature (JSContext* cx, JSObject* lPath)
+{
+    char*  signature = strdup("");
+    size_t length    = 0;
+
+    jsuint pathLength;
+    JS_GetArrayLength(cx, lPath, &pathLength);
+
+    size_t i;
+    for (i = 0; i < pathLength; i++) {
+        jsval pathFile;
+        JS_GetElement(cx, lPath, i, &pathFile);
+
+        char* base = JS_GetStringBytes(JS_ValueToString(cx, pathFile));
+        signature  = realloc(signature, (length+=strlen(base)+1)+1);
+        strcat(signature, base); strcat(signature, "\n");
+    }
+
+    return signature;
+}
+
+JSBool
+__Core_pathChanged (JSContext* cx, JSObject* obj, jsval id, jsval* vp)
+{
+    pathChanged = JS_TRUE;
+
+    return JS_TRUE;
+}
+
 JSBool
 __Core_include (JSContext* cx, const char* path)
 {
-    if (__Core_isIncluded(path)) {
+    // The same file reached through different paths must be included once.
+    char* id = realpath(path, NULL);
+
+    if (!id) {
+        #ifdef DEBUG
+        printf("%s not found.\n", path);
+        #endif
+
+        return JS_FALSE;
+    }
+
+    if (__Core_isIncluded(id)) {
         #ifdef DEBUG
         printf("(already included) %s\n", path);
         #endif
 
+        free(id);
         return JS_TRUE;
     }
 
+    if (!__Core_load(cx, path)) {
+        free(id);
+        return JS_FALSE;
+    }
+
+    if (!included) {
+        included = __Core_newTable();
+    }
+    JS_HashTableAdd(included, id, NULL);
+
+    return JS_TRUE;
+}
+
+JSBool
+__Core_load (JSContext* cx, const char* path)
+{
     if (strstr(path, ".js") == &path[strlen(path)-3]) {
         #ifdef DEBUG
         printf("(javascript) path: %s\n", path);
         #endif
 
-        if (!fileExists(path)) {
+        struct stat info;
+        if (stat(path, &info) != 0) {
             #ifdef DEBUG
             printf("(javascript) %s not found.\n", path);
             #endif
@@ -384,10 +505,46 @@ __Core_include (JSContext* cx, const char* path)
         }
 
         jsval rval;
-        char* sources = stripRemainder(cx, readFile(cx, path));
+        JSObject* global   = JS_GetGlobalObject(cx);
+        JSScript* script   = Snapshot_load(cx, path, &info);
+        JSBool    compiled = JS_FALSE;
+
+        if (!script) {
+            script = Cache_load(cx, path, &info);
+        }
+
+        if (!script) {
+            size_t length;
+            const char* sources = mapFile(path, &length);
+
+            if (!sources) {
+                return JS_FALSE;
+            }
 
-        JSBool result = (short) JS_EvaluateScript(cx, JS_GetGlobalObject(cx), sources, strlen(sources), path, 1, &rval);
-        JS_free(cx, sources);
+            size_t offset = skipShebang(sources, length);
+            script   = JS_CompileBytes(cx, global, &sources[offset], length-offset, path, 1);
+            compiled = JS_TRUE;
+            unmapFile(sources, length);
+        }
+
+        if (script) {
+            // Saving and executing can collect garbage, the script object keeps it alive.
+            JSObject* scriptObject = JS_NewScriptObject(cx, script);
+
+            if (!scriptObject) {
+                JS_DestroyScript(cx, script);
+                return JS_FALSE;
+            }
+
+            JS_AddNamedRoot(cx, &scriptObject, "Core.include");
+
+            if (compiled) {
+                Cache_save(cx, path, &info, script);
+            }
+
+            JS_ExecuteScript(cx, global, script, &rval);
+            JS_RemoveRoot(cx, &scriptObject);
+        }
 
         while (JS_IsExceptionPending(cx)) {
             JS_ReportPendingException(cx);
@@ -438,22 +595,54 @@ __Core_include (JSContext* cx, const char* path)
         JS_free(cx, newPath);
     }
 
-    included = JS_realloc(cx, included, ++includedNumber*sizeof(char*));
-    included[includedNumber-1] = JS_strdup(cx, path);
-
     return JS_TRUE;
 }
 
 JSBool
 __Core_isIncluded (const char* path)
 {
-    size_t i;
-    for (i = 0; i < includedNumber; i++) {
-        if (strcmp(included[i], path) == 0) {
-            return JS_TRUE;
-        }
-    }
+    return included && JS_HashTableRawLookup(included, JS_HashString(path), path)[0] != NULL;
+}
 
-    return JS_FALSE;
+JSHashTable*
+__Core_newTable (void)
+{
+    return JS_NewHashTable(64, JS_HashString, __Core_compareStrings, NULL, &Core_tableOps, NULL);
+}
+
+intN
+__Core_compareStrings (const void* a, const void* b)
+{
+    return strcmp((const char*) a, (const char*) b) == 0;
+}
+
+void*
+__Core_allocTable (void* pool, size_t size)
+{
+    return malloc(size);
+}
+
+void
+__Core_freeTable (void* pool, void* item)
+{
+    free(item);
+}
+
+JSHashEntry*
+__Core_allocEntry (void* pool, const void* key)
+{
+    return malloc(sizeof(JSHashEntry));
+}
+
+// Keys and values are strings owned by the tables.
+void
+__Core_freeEntry (void* pool, JSHashEntry* he, uintN flag)
+{
+    free(he->value);
+
+    if (flag == HT_FREE_ENTRY) {
+        free((void*) he->key);
+        free(he);
+    }
 }
 
@@ -21,6 +21,7 @@
 
 #include "lulzjs.h"
 #include "jsdbgapi.h"
+#include "jshash.h"
 
 // Not cross platform
 #include <libgen.h>
@@ -28,9 +29,10 @@
 #include <unistd.h>
 
 #include "Misc.h"
-
-static char** included       = NULL;
-static size_t includedNumber = 0;
+#include "Cache.h"
+#include "Snapshot.h"
+#include "EventLoop.h"
+#include "GC.h"
 
 static JSClass Core_class = {
     "Core", JSCLASS_GLOBAL_FLAGS|JSCLASS_HAS_PRIVATE,
@@ -39,11 +41,24 @@ static JSClass Core_class = {
     JSCLASS_NO_OPTIONAL_MEMBERS
 };
 
+JSBool __Core_pathChanged (JSContext* cx, JSObject* obj, jsval id, jsval* vp);
+
+/*
+ * __PATH__ is an array-like object with Array.prototype as prototype, the
+ * hooks let the include path resolutions know when an element or the length
+ * changes instead of checking the whole path on every include.
+ */
+static JSClass Core_pathClass = {
+    "Path", 0,
+    __Core_pathChanged, __Core_pathChanged, JS_PropertyStub, __Core_pathChanged,
+    JS_EnumerateStub, JS_ResolveStub, JS_ConvertStub, JS_FinalizeStub,
+    JSCLASS_NO_OPTIONAL_MEMBERS
+};
+
 extern JSObject* Core_initialize (JSContext* cx, const char* script);
 
 extern JSBool Core_include (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval); 
 extern JSBool Core_require (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval);
-extern JSBool Core_GC (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval);
 
 extern JSBool Core_die (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval);
 extern JSBool Core_exit (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval);
@@ -68,13 +83,22 @@ extern JSBool Core_print (JSContext* cx, JSObject* obj, uintN argc, jsval* argv,
 const char* __Core_getScriptName (JSContext* cx);
 char*       __Core_getRootPath (JSContext* cx, const char* fileName);
 char*       __Core_getPath (JSContext* cx, const char* fileName);
+char*       __Core_resolvePath (JSContext* cx, JSObject* lPath, const char* dir, const char* fileName);
+char*       __Core_getPathSignature (JSContext* cx, JSObject* lPath);
 JSBool      __Core_include (JSContext* cx, const char* path);
+JSBool      __Core_load (JSContext* cx, const char* path);
 JSBool      __Core_isIncluded (const char* path);
 
+JSHashTable* __Core_newTable (void);
+intN         __Core_compareStrings (const void* a, const void* b);
+void*        __Core_allocTable (void* pool, size_t size);
+void         __Core_freeTable (void* pool, void* item);
+JSHashEntry* __Core_allocEntry (void* pool, const void* key);
+void         __Core_freeEntry (void* pool, JSHashEntry* he, uintN flag);
+
 static JSFunctionSpec Core_methods[] = {
     {"include", Core_include, 0, 0, 0},
     {"require", Core_require, 0, 0, 0},
-    {"GC",      Core_GC,      0, 0, 0},
 
     {"die",  Core_die,  0, 0, 0},
     {"exit", Core_exit, 0, 0, 0},
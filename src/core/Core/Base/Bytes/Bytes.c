@@ -0,0 +1,384 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#include "Bytes.h"
+
+static JSObjectOps        Bytes_ops;
+static const JSObjectOps* Bytes_nativeOps;
+
+JSBool exec (JSContext* cx) { return Bytes_initialize(cx); }
+
+JSBool
+Bytes_initialize (JSContext* cx)
+{
+    JSObject* parent = JS_GetGlobalObject(cx);
+
+    // Everything but indexed access works like any other object.
+    Bytes_nativeOps       = JS_GetNativeObjectOps();
+    Bytes_ops             = *Bytes_nativeOps;
+    Bytes_ops.getProperty = Bytes_getProperty;
+    Bytes_ops.setProperty = Bytes_setProperty;
+
+    JSObject* object = JS_InitClass(
+        cx, parent, NULL, &Bytes_class,
+        Bytes_constructor, 1, Bytes_properties, Bytes_methods, NULL, Bytes_static_methods
+    );
+
+    if (object) {
+        // The prototype is an empty Bytes, so every Bytes object has its information.
+        unsigned char* data = JS_malloc(cx, 1);
+        __Bytes_set(cx, object, __Bytes_newStorage(cx, data), data, 0);
+
+        return JS_TRUE;
+    }
+
+    return JS_FALSE;
+}
+
+JSBool
+Bytes_constructor (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+{
+    unsigned char* data;
+    size_t length = 0;
+
+    if (!JS_IsConstructing(cx)) {
+        object = JS_NewObject(cx, &Bytes_class, NULL, NULL);
+        *rval  = OBJECT_TO_JSVAL(object);
+    }
+
+    if (argc < 1) {
+        data = JS_malloc(cx, 1);
+    }
+    else if (JSVAL_IS_NUMBER(argv[0])) {
+        int32 size;
+        if (!JS_ValueToInt32(cx, argv[0], &size) || size < 0) {
+            JS_ReportError(cx, "The size has to be a positive number.");
+            return JS_FALSE;
+        }
+
+        length = size;
+        data   = JS_malloc(cx, length ? length : 1);
+        memset(data, 0, length);
+    }
+    else if (JSVAL_IS_STRING(argv[0])) {
+        JSString*     string = JSVAL_TO_STRING(argv[0]);
+        const jschar* chars  = JS_UndependString(cx, string);
+
+        if (!chars) {
+            return JS_FALSE;
+        }
+
+        length = JS_GetStringLength(string);
+        data   = JS_malloc(cx, length ? length : 1);
+
+        size_t i;
+        for (i = 0; i < length; i++) {
+            data[i] = chars[i] & 0xFF;
+        }
+    }
+    else if (Bytes_get(cx, argv[0])) {
+        BytesInformation* bytes = Bytes_get(cx, argv[0]);
+
+        length = bytes->length;
+        data   = JS_malloc(cx, length ? length : 1);
+        memcpy(data, bytes->data, length);
+    }
+    else if (JSVAL_IS_OBJECT(argv[0]) && !JSVAL_IS_NULL(argv[0]) && JS_IsArrayObject(cx, JSVAL_TO_OBJECT(argv[0]))) {
+        JSObject* array = JSVAL_TO_OBJECT(argv[0]);
+
+        jsuint size;
+        JS_GetArrayLength(cx, array, &size);
+
+        length = size;
+        data   = JS_malloc(cx, length ? length : 1);
+
+        jsuint i;
+        for (i = 0; i < size; i++) {
+            jsval  element;
+            int32 byte;
+
+            if (!JS_GetElement(cx, array, i, &element) || !JS_ValueToInt32(cx, element, &byte)) {
+                JS_free(cx, data);
+                return JS_FALSE;
+            }
+
+            data[i] = byte & 0xFF;
+        }
+    }
+    else {
+        JS_ReportError(cx, "You have to pass a size, a string, an array or a Bytes object.");
+        return JS_FALSE;
+    }
+
+    __Bytes_set(cx, object, __Bytes_newStorage(cx, data), data, length);
+
+    return JS_TRUE;
+}
+
+void
+Bytes_finalize (JSContext* cx, JSObject* object)
+{
+    BytesInformation* data = JS_GetPrivate(cx, object);
+
+    if (data) {
+        JS_Lock(JS_GetRuntime(cx));
+        size_t references = --data->storage->references;
+        JS_Unlock(JS_GetRuntime(cx));
+
+        if (references == 0) {
+            JS_free(cx, data->storage->data);
+            JS_free(cx, data->storage);
+        }
+
+        JS_free(cx, data);
+    }
+}
+
+JSObjectOps*
+Bytes_getObjectOps (JSContext* cx, JSClass* clasp)
+{
+    return &Bytes_ops;
+}
+
+JSObject*
+Bytes_new (JSContext* cx, unsigned char* data, size_t length)
+{
+    JSObject* object = JS_NewObject(cx, &Bytes_class, NULL, NULL);
+
+    if (object) {
+        __Bytes_set(cx, object, __Bytes_newStorage(cx, data), data, length);
+    }
+
+    return object;
+}
+
+BytesInformation*
+Bytes_get (JSContext* cx, jsval value)
+{
+    if (!JSVAL_IS_OBJECT(value) || JSVAL_IS_NULL(value)) {
+        return NULL;
+    }
+
+    return JS_GetInstancePrivate(cx, JSVAL_TO_OBJECT(value), &Bytes_class, NULL);
+}
+
+JSBool
+Bytes_getProperty (JSContext* cx, JSObject* object, jsid id, jsval* vp)
+{
+    jsval key;
+
+    if (JS_IdToValue(cx, id, &key) && JSVAL_IS_INT(key) && JSVAL_TO_INT(key) >= 0) {
+        BytesInformation* data = JS_GetPrivate(cx, object);
+        size_t index           = JSVAL_TO_INT(key);
+
+        *vp = index < data->length ? INT_TO_JSVAL(data->data[index]) : JSVAL_VOID;
+        return JS_TRUE;
+    }
+
+    return Bytes_nativeOps->getProperty(cx, object, id, vp);
+}
+
+JSBool
+Bytes_setProperty (JSContext* cx, JSObject* object, jsid id, jsval* vp)
+{
+    jsval key;
+
+    if (JS_IdToValue(cx, id, &key) && JSVAL_IS_INT(key) && JSVAL_TO_INT(key) >= 0) {
+        BytesInformation* data = JS_GetPrivate(cx, object);
+        size_t index           = JSVAL_TO_INT(key);
+        int32 byte;
+
+        if (index >= data->length) {
+            JS_ReportError(cx, "Index out of range.");
+            return JS_FALSE;
+        }
+
+        if (!JS_ValueToInt32(cx, *vp, &byte)) {
+            return JS_FALSE;
+        }
+
+        data->data[index] = byte & 0xFF;
+        return JS_TRUE;
+    }
+
+    return Bytes_nativeOps->setProperty(cx, object, id, vp);
+}
+
+JSBool
+Bytes_length (JSContext* cx, JSObject* object, jsval id, jsval* vp)
+{
+    BytesInformation* data = JS_GetInstancePrivate(cx, object, &Bytes_class, NULL);
+
+    return JS_NewNumberValue(cx, data ? data->length : 0, vp);
+}
+
+JSBool
+Bytes_byteAt (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+{
+    int32 index;
+
+    if (argc < 1 || !JS_ValueToInt32(cx, argv[0], &index)) {
+        JS_ReportError(cx, "Not enough parameters.");
+        return JS_FALSE;
+    }
+
+    BytesInformation* data = JS_GetPrivate(cx, object);
+
+    if (index < 0 || (size_t) index >= data->length) {
+        JS_ReportError(cx, "Index out of range.");
+        return JS_FALSE;
+    }
+
+    *rval = INT_TO_JSVAL(data->data[index]);
+    return JS_TRUE;
+}
+
+JSBool
+Bytes_slice (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+{
+    BytesInformation* data = JS_GetPrivate(cx, object);
+
+    jsdouble length = data->length;
+    jsdouble start  = 0;
+    jsdouble end    = length;
+
+    if (argc > 0 && !JS_ValueToNumber(cx, argv[0], &start)) {
+        return JS_FALSE;
+    }
+
+    if (argc > 1 && !JSVAL_IS_VOID(argv[1]) && !JS_ValueToNumber(cx, argv[1], &end)) {
+        return JS_FALSE;
+    }
+
+    // Negative positions count from the end, like Array.prototype.slice.
+    start = (start < 0) ? ((start + length < 0) ? 0 : start + length) : ((start > length) ? length : start);
+    end   = (end < 0)   ? ((end + length < 0)   ? 0 : end + length)   : ((end > length)   ? length : end);
+
+    if (end < start) {
+        end = start;
+    }
+
+    JSObject* slice = JS_NewObject(cx, &Bytes_class, NULL, NULL);
+
+    if (!slice) {
+        return JS_FALSE;
+    }
+
+    JS_Lock(JS_GetRuntime(cx));
+    data->storage->references++;
+    JS_Unlock(JS_GetRuntime(cx));
+    __Bytes_set(cx, slice, data->storage, data->data + (size_t) start, (size_t) end - (size_t) start);
+
+    *rval = OBJECT_TO_JSVAL(slice);
+    return JS_TRUE;
+}
+
+JSBool
+Bytes_copy (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+{
+    BytesInformation* data = JS_GetPrivate(cx, object);
+
+    unsigned char* copy = JS_malloc(cx, data->length ? data->length : 1);
+    memcpy(copy, data->data, data->length);
+
+    JSObject* bytes = Bytes_new(cx, copy, data->length);
+
+    if (!bytes) {
+        return JS_FALSE;
+    }
+
+    *rval = OBJECT_TO_JSVAL(bytes);
+    return JS_TRUE;
+}
+
+JSBool
+Bytes_toArray (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+{
+    BytesInformation* data = JS_GetPrivate(cx, object);
+
+    jsval* vector = JS_malloc(cx, (data->length ? data->length : 1)*sizeof(jsval));
+
+    size_t i;
+    for (i = 0; i < data->length; i++) {
+        vector[i] = INT_TO_JSVAL(data->data[i]);
+    }
+
+    JSObject* array = JS_NewArrayObject(cx, data->length, vector);
+    JS_free(cx, vector);
+
+    if (!array) {
+        return JS_FALSE;
+    }
+
+    *rval = OBJECT_TO_JSVAL(array);
+    return JS_TRUE;
+}
+
+JSBool
+Bytes_toText (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+{
+    BytesInformation* data = JS_GetPrivate(cx, object);
+
+    JSString* string = JS_NewStringCopyN(cx, (char*) data->data, data->length);
+
+    if (!string) {
+        return JS_FALSE;
+    }
+
+    *rval = STRING_TO_JSVAL(string);
+    return JS_TRUE;
+}
+
+JSBool
+Bytes_toString (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+{
+    BytesInformation* data = JS_GetPrivate(cx, object);
+
+    char* string = JS_malloc(cx, data->length*4+1);
+
+    size_t i;
+    for (i = 0; i < data->length; i++) {
+        sprintf(&string[i*4], "\\x%02x", data->data[i]);
+    }
+    string[data->length*4] = '\0';
+
+    *rval = STRING_TO_JSVAL(JS_NewString(cx, string, data->length*4));
+    return JS_TRUE;
+}
+
+BytesStorage*
+__Bytes_newStorage (JSContext* cx, unsigned char* data)
+{
+    BytesStorage* storage = JS_malloc(cx, sizeof(BytesStorage));
+    storage->data         = data;
+    storage->references   = 1;
+
+    return storage;
+}
+
+void
+__Bytes_set (JSContext* cx, JSObject* object, BytesStorage* storage, unsigned char* data, size_t length)
+{
+    BytesInformation* information = JS_malloc(cx, sizeof(BytesInformation));
+    information->storage = storage;
+    information->data    = data;
+    information->length  = length;
+
+    JS_SetPrivate(cx, object, information);
+}
+
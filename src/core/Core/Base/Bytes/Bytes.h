@@ -0,0 +1,91 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#ifndef _CORE_BYTES_H
+#define _CORE_BYTES_H
+
+#include "jsapi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern JSBool exec (JSContext* cx);
+extern JSBool Bytes_initialize (JSContext* cx);
+
+extern JSBool Bytes_constructor (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern void   Bytes_finalize (JSContext* cx, JSObject* object);
+
+/*
+ * Indexed access goes through the object ops so reading or writing a byte
+ * never adds a property to the object.
+ */
+extern JSObjectOps* Bytes_getObjectOps (JSContext* cx, JSClass* clasp);
+
+static JSClass Bytes_class = {
+    "Bytes", JSCLASS_HAS_PRIVATE,
+    JS_PropertyStub, JS_PropertyStub, JS_PropertyStub, JS_PropertyStub,
+    JS_EnumerateStub, JS_ResolveStub, JS_ConvertStub, Bytes_finalize,
+    Bytes_getObjectOps
+};
+
+#include "private.h"
+
+extern JSBool Bytes_getProperty (JSContext* cx, JSObject* object, jsid id, jsval* vp);
+extern JSBool Bytes_setProperty (JSContext* cx, JSObject* object, jsid id, jsval* vp);
+
+extern JSBool Bytes_length (JSContext* cx, JSObject* object, jsval id, jsval* vp);
+
+extern JSBool Bytes_byteAt (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+
+/*
+ * Get the bytes between start and end without copying them, changing the
+ * slice changes the original too, use copy to get a new buffer.
+ */
+extern JSBool Bytes_slice (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool Bytes_copy (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+
+extern JSBool Bytes_toArray (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool Bytes_toText (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool Bytes_toString (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+
+BytesStorage* __Bytes_newStorage (JSContext* cx, unsigned char* data);
+void          __Bytes_set (JSContext* cx, JSObject* object, BytesStorage* storage, unsigned char* data, size_t length);
+
+static JSPropertySpec Bytes_properties[] = {
+    {"length", 0, JSPROP_READONLY|JSPROP_PERMANENT|JSPROP_SHARED, Bytes_length, NULL},
+    {NULL}
+};
+
+static JSFunctionSpec Bytes_methods[] = {
+    {"byteAt", Bytes_byteAt, 0, 0, 0},
+
+    {"slice", Bytes_slice, 0, 0, 0},
+    {"copy",  Bytes_copy,  0, 0, 0},
+
+    {"toArray",  Bytes_toArray,  0, 0, 0},
+    {"toText",   Bytes_toText,   0, 0, 0},
+    {"toString", Bytes_toString, 0, 0, 0},
+    {NULL}
+};
+
+static JSFunctionSpec Bytes_static_methods[] = {
+    {NULL}
+};
+
+#endif
@@ -0,0 +1,51 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#ifndef _CORE_BYTES_PRIVATE_H
+#define _CORE_BYTES_PRIVATE_H
+
+/*
+ * The bytes are shared by a Bytes and all the slices taken from it, the
+ * storage is freed when the last of them is finalized.  Slices can be taken
+ * on any thread, so the references are counted under the runtime lock.
+ */
+typedef struct {
+    unsigned char* data;
+    size_t         references;
+} BytesStorage;
+
+typedef struct {
+    BytesStorage*  storage;
+    unsigned char* data;
+    size_t         length;
+} BytesInformation;
+
+/*
+ * Create a Bytes object owning the given JS_malloc'd buffer.
+ */
+extern JSObject* Bytes_new (JSContext* cx, unsigned char* data, size_t length);
+
+/*
+ * Get the bytes of a Bytes object.
+ *
+ * RETURN:
+ *     The information or NULL if the value isn't a Bytes object.
+ */
+extern BytesInformation* Bytes_get (JSContext* cx, jsval value);
+
+#endif
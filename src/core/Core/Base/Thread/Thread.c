@@ -88,8 +88,8 @@ Thread_start (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* r
     pthread_t* thread = JS_GetPrivate(cx, object);
 
     ThreadData* data = malloc(sizeof(ThreadData));
-    data->cx = JS_NewContext(JS_GetRuntime(cx), 8192);
-    JS_SetOptions(data->cx, JSOPTION_VAROBJFIX);
+    data->cx = JS_NewContext(JS_GetRuntime(cx), options.stackSize);
+    Options_applyContext(data->cx);
     JS_SetErrorReporter(data->cx, reportError);
     JS_SetGlobalObject(data->cx, JS_GetGlobalObject(cx));
 
@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "Options.h"
+
 extern JSBool exec (JSContext* cx);
 extern void reportError (JSContext *cx, const char *message, JSErrorReport *report);
 
@@ -17,19 +17,3 @@
 ****************************************************************************/
 
 require("Thread.so");
-
-Program.setTimeout = function (expression, timeout) {
-
-};
-
-Program.clearTimeout = function (id) {
-
-};
-
-Program.setInterval = function (expression, interval) {
-
-};
-
-Program.clearInterval = function (id) {
-
-};
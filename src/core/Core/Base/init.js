@@ -16,6 +16,6 @@
 * along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
 ****************************************************************************/
 
-require("Bytes.js");
+require("Bytes");
 require("Thread");
 
@@ -0,0 +1,508 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#include "EventLoop.h"
+
+static EventLoop loop = { 0, -1, -1, NULL, 0, 0, NULL, 0, 0, NULL };
+
+JSBool
+EventLoop_initialize (JSContext* cx, JSObject* global)
+{
+    if (loop.epoll < 0) {
+        loop.thread = pthread_self();
+        loop.epoll  = epoll_create(1);
+        loop.timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC);
+
+        if (loop.epoll < 0 || loop.timer < 0) {
+            return JS_FALSE;
+        }
+
+        struct epoll_event event;
+        event.events   = EPOLLIN;
+        event.data.ptr = NULL;
+
+        if (epoll_ctl(loop.epoll, EPOLL_CTL_ADD, loop.timer, &event) != 0) {
+            return JS_FALSE;
+        }
+
+        loop.timers = JS_NewHashTable(64, __EventLoop_hashId, JS_CompareValues, NULL, NULL, NULL);
+    }
+
+    return JS_DefineFunctions(cx, global, EventLoop_methods);
+}
+
+JSBool
+EventLoop_run (JSContext* cx)
+{
+    while (loop.length > 0 || loop.sources > 0) {
+        // Report the collections that happened during the last callback.
+        GC_notify(cx);
+
+        if (loop.length > 0 && loop.heap[0]->when <= __EventLoop_now()) {
+            __EventLoop_fire(cx, loop.heap[0]);
+            continue;
+        }
+
+        if (!__EventLoop_wait(cx)) {
+            return JS_FALSE;
+        }
+    }
+
+    GC_notify(cx);
+
+    return JS_TRUE;
+}
+
+EventLoopSource*
+EventLoop_watch (int fd, uint32 events, EventLoopHandler handler, void* data)
+{
+    EventLoopSource* source = malloc(sizeof(EventLoopSource));
+    source->fd      = fd;
+    source->handler = handler;
+    source->data    = data;
+    source->removed = JS_FALSE;
+    source->next    = NULL;
+
+    struct epoll_event event;
+    event.events   = events;
+    event.data.ptr = source;
+
+    if (epoll_ctl(loop.epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+        free(source);
+        return NULL;
+    }
+
+    loop.sources++;
+
+    return source;
+}
+
+void
+EventLoop_unwatch (EventLoopSource* source)
+{
+    if (source->removed) {
+        return;
+    }
+
+    epoll_ctl(loop.epoll, EPOLL_CTL_DEL, source->fd, NULL);
+    loop.sources--;
+
+    // Events for it could still be pending in the current batch.
+    source->removed = JS_TRUE;
+    source->next    = loop.garbage;
+    loop.garbage    = source;
+}
+
+JSBool
+EventLoop_setTimeout (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval)
+{
+    return __EventLoop_addTimer(cx, argc, argv, rval, JS_FALSE);
+}
+
+JSBool
+EventLoop_clearTimeout (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval)
+{
+    return __EventLoop_clearTimer(cx, argc, argv);
+}
+
+JSBool
+EventLoop_setInterval (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval)
+{
+    return __EventLoop_addTimer(cx, argc, argv, rval, JS_TRUE);
+}
+
+JSBool
+EventLoop_clearInterval (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval)
+{
+    return __EventLoop_clearTimer(cx, argc, argv);
+}
+
+uint64
+__EventLoop_now (void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+JSBool
+__EventLoop_wait (JSContext* cx)
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+
+    // A zeroed spec disarms the timer when only descriptors are left.
+    if (loop.length > 0) {
+        uint64 when = loop.heap[0]->when;
+
+        spec.it_value.tv_sec  = when / 1000000000ULL;
+        spec.it_value.tv_nsec = when % 1000000000ULL;
+    }
+
+    if (timerfd_settime(loop.timer, TFD_TIMER_ABSTIME, &spec, NULL) != 0) {
+        return JS_FALSE;
+    }
+
+    /*
+     * When enough garbage piled up run a full collection now, unless the last
+     * one took longer than the time left before the next timer, so the pause
+     * lands here instead of in the middle of the next callback.  It is not
+     * incremental and can still overrun the timer.  In the alloc GC mode only
+     * allocating collects.
+     */
+    struct epoll_event events[64];
+    int ready = 0;
+
+    if (options.idleGC) {
+        uint32 budget = (uint32) -1;
+
+        if (loop.length > 0) {
+            uint64 now  = __EventLoop_now();
+            uint64 when = loop.heap[0]->when;
+
+            budget = (when > now) ? (uint32) ((when - now) / 1000000ULL) : 0;
+        }
+
+        // Only look for ready descriptors when there's a collection to skip.
+        if (JS_WantIdleGC(cx, budget)) {
+            ready = epoll_wait(loop.epoll, events, 64, 0);
+
+            /*
+             * Go around the loop once more, it reports the collection right
+             * away instead of whenever the loop wakes up next, and the
+             * listener could have set a timer that's due earlier.
+             */
+            if (ready == 0) {
+                JS_GC(cx);
+                return JS_TRUE;
+            }
+        }
+    }
+
+    if (ready == 0) {
+        /*
+         * Sleep in the kernel until the timer or a watched descriptor is ready,
+         * or until empty heap chunks are old enough to give back, in that case
+         * nothing is ready and the next wait decommits them.
+         */
+        ready = epoll_wait(loop.epoll, events, 64, JS_DecommitGCChunks(cx));
+    }
+
+    if (ready < 0) {
+        return errno == EINTR;
+    }
+
+    int i;
+    for (i = 0; i < ready; i++) {
+        EventLoopSource* source = events[i].data.ptr;
+
+        if (!source) {
+            uint64 expirations;
+            while (read(loop.timer, &expirations, sizeof(expirations)) > 0);
+
+            continue;
+        }
+
+        if (!source->removed) {
+            source->handler(cx, source->fd, events[i].events, source->data);
+        }
+    }
+
+    __EventLoop_collect();
+
+    return JS_TRUE;
+}
+
+void
+__EventLoop_collect (void)
+{
+    while (loop.garbage) {
+        EventLoopSource* source = loop.garbage;
+        loop.garbage = source->next;
+
+        free(source);
+    }
+}
+
+JSBool
+__EventLoop_fire (JSContext* cx, Timer* timer)
+{
+    JSObject* global  = JS_GetGlobalObject(cx);
+    JSObject* closure = JSVAL_TO_OBJECT(timer->closure);
+
+    jsuint length;
+    JS_GetArrayLength(cx, closure, &length);
+
+    jsval callback;
+    JS_GetElement(cx, closure, 0, &callback);
+
+    /*
+     * Timeouts are forgotten before being called, intervals are moved to
+     * their next expiration after the call unless they got cleared by it.
+     */
+    __EventLoop_heapRemove(timer);
+
+    if (!timer->interval) {
+        JS_HashTableRemove(loop.timers, (void*) (jsword) timer->id);
+    }
+
+    jsval  rval;
+    JSBool ok;
+
+    if (JSVAL_IS_STRING(callback)) {
+        JSString*     string = JSVAL_TO_STRING(callback);
+        const jschar* chars  = JS_UndependString(cx, string);
+
+        ok = chars && JS_EvaluateUCScript(cx, global,
+            chars, JS_GetStringLength(string), "Timer", 1, &rval);
+    }
+    else {
+        jsval* argv = JS_malloc(cx, (length > 1 ? length-1 : 1)*sizeof(jsval));
+
+        jsuint i;
+        for (i = 1; i < length; i++) {
+            JS_GetElement(cx, closure, i, &argv[i-1]);
+        }
+
+        ok = JS_CallFunctionValue(cx, global, callback, length > 1 ? length-1 : 0, argv, &rval);
+        JS_free(cx, argv);
+    }
+
+    if (!ok && JS_IsExceptionPending(cx)) {
+        JS_ReportPendingException(cx);
+        JS_ClearPendingException(cx);
+    }
+
+    if (timer->interval && !timer->cleared) {
+        // Don't try to catch up if the callback took longer than the interval.
+        uint64 now  = __EventLoop_now();
+        timer->when = (timer->when + timer->interval > now) ? timer->when + timer->interval : now;
+
+        __EventLoop_heapPush(timer);
+    }
+    else {
+        __EventLoop_freeTimer(cx, timer);
+    }
+
+    return ok;
+}
+
+JSBool
+__EventLoop_isOwner (JSContext* cx)
+{
+    if (!pthread_equal(loop.thread, pthread_self())) {
+        JS_ReportError(cx, "Timers can only be used from the main thread.");
+        return JS_FALSE;
+    }
+
+    return JS_TRUE;
+}
+
+JSBool
+__EventLoop_addTimer (JSContext* cx, uintN argc, jsval* argv, jsval* rval, JSBool repeat)
+{
+    jsdouble delay = 0;
+
+    if (!__EventLoop_isOwner(cx)) {
+        return JS_FALSE;
+    }
+
+    if (argc < 1 || (!JSVAL_IS_STRING(argv[0]) && !JS_ObjectIsFunction(cx, JSVAL_IS_OBJECT(argv[0]) ? JSVAL_TO_OBJECT(argv[0]) : NULL))) {
+        JS_ReportError(cx, "You have to pass a function or a string to evaluate.");
+        return JS_FALSE;
+    }
+
+    if (argc > 1 && !JS_ValueToNumber(cx, argv[1], &delay)) {
+        return JS_FALSE;
+    }
+
+    // Negative and NaN delays mean as soon as possible, too long ones (even infinite) are capped.
+    if (!(delay > 0)) {
+        delay = 0;
+    }
+    else if (delay > __EVENTLOOP_MAX_DELAY__) {
+        delay = __EVENTLOOP_MAX_DELAY__;
+    }
+
+    // The callback and its arguments, the delay isn't part of it.
+    JSObject* closure;
+    if (argc > 1) {
+        argv[1] = argv[0];
+        closure = JS_NewArrayObject(cx, argc-1, &argv[1]);
+    }
+    else {
+        closure = JS_NewArrayObject(cx, 1, argv);
+    }
+
+    if (!closure) {
+        return JS_FALSE;
+    }
+
+    Timer* timer = JS_malloc(cx, sizeof(Timer));
+    timer->id       = ++loop.lastId;
+    timer->interval = repeat ? (uint64) (delay * 1000000) : 0;
+    timer->when     = __EventLoop_now() + (uint64) (delay * 1000000);
+    timer->cleared  = JS_FALSE;
+    timer->closure  = OBJECT_TO_JSVAL(closure);
+
+    // Intervals of 0 would never let anything else happen.
+    if (repeat && timer->interval == 0) {
+        timer->interval = 1000000;
+    }
+
+    JS_AddNamedRoot(cx, &timer->closure, "Timer");
+    JS_HashTableAdd(loop.timers, (void*) (jsword) timer->id, timer);
+    __EventLoop_heapPush(timer);
+
+    return JS_NewNumberValue(cx, timer->id, rval);
+}
+
+JSBool
+__EventLoop_clearTimer (JSContext* cx, uintN argc, jsval* argv)
+{
+    jsdouble id;
+
+    if (!__EventLoop_isOwner(cx)) {
+        return JS_FALSE;
+    }
+
+    if (argc < 1 || !JS_ValueToNumber(cx, argv[0], &id) || !(id > 0) || id > (uint32) -1) {
+        return JS_TRUE;
+    }
+
+    Timer* timer = JS_HashTableLookup(loop.timers, (void*) (jsword) (uint32) id);
+
+    if (!timer) {
+        return JS_TRUE;
+    }
+
+    JS_HashTableRemove(loop.timers, (void*) (jsword) timer->id);
+    timer->cleared = JS_TRUE;
+
+    // An interval clearing itself from its callback is freed after the call.
+    if (timer->index < loop.length && loop.heap[timer->index] == timer) {
+        __EventLoop_heapRemove(timer);
+        __EventLoop_freeTimer(cx, timer);
+    }
+
+    return JS_TRUE;
+}
+
+void
+__EventLoop_freeTimer (JSContext* cx, Timer* timer)
+{
+    JS_RemoveRoot(cx, &timer->closure);
+    JS_free(cx, timer);
+}
+
+void
+__EventLoop_heapPush (Timer* timer)
+{
+    if (loop.length == loop.size) {
+        loop.size = loop.size ? loop.size * 2 : 64;
+        loop.heap = realloc(loop.heap, loop.size*sizeof(Timer*));
+    }
+
+    timer->index = loop.length;
+    loop.heap[loop.length++] = timer;
+
+    __EventLoop_heapUp(timer->index);
+}
+
+void
+__EventLoop_heapRemove (Timer* timer)
+{
+    size_t index = timer->index;
+    Timer* last  = loop.heap[--loop.length];
+
+    timer->index = (size_t) -1;
+
+    if (last == timer) {
+        return;
+    }
+
+    loop.heap[index] = last;
+    last->index      = index;
+
+    __EventLoop_heapUp(index);
+    __EventLoop_heapDown(last->index);
+}
+
+void
+__EventLoop_heapUp (size_t index)
+{
+    Timer* timer = loop.heap[index];
+
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+
+        if (!__EventLoop_heapLess(timer, loop.heap[parent])) {
+            break;
+        }
+
+        loop.heap[index] = loop.heap[parent];
+        loop.heap[index]->index = index;
+        index = parent;
+    }
+
+    loop.heap[index] = timer;
+    timer->index     = index;
+}
+
+void
+__EventLoop_heapDown (size_t index)
+{
+    Timer* timer = loop.heap[index];
+
+    while (1) {
+        size_t child = index * 2 + 1;
+
+        if (child >= loop.length) {
+            break;
+        }
+
+        if (child + 1 < loop.length && __EventLoop_heapLess(loop.heap[child+1], loop.heap[child])) {
+            child++;
+        }
+
+        if (!__EventLoop_heapLess(loop.heap[child], timer)) {
+            break;
+        }
+
+        loop.heap[index] = loop.heap[child];
+        loop.heap[index]->index = index;
+        index = child;
+    }
+
+    loop.heap[index] = timer;
+    timer->index     = index;
+}
+
+JSBool
+__EventLoop_heapLess (Timer* a, Timer* b)
+{
+    return a->when < b->when || (a->when == b->when && a->id < b->id);
+}
+
+JSHashNumber
+__EventLoop_hashId (const void* key)
+{
+    return (JSHashNumber) (jsword) key;
+}
+
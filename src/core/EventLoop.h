@@ -0,0 +1,159 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#ifndef _EVENTLOOP_H
+#define _EVENTLOOP_H
+
+#include "lulzjs.h"
+#include "jshash.h"
+
+// Not cross platform
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <pthread.h>
+
+#include "Options.h"
+#include "GC.h"
+
+// The longest timer delay in milliseconds, the same limit browsers have (about 24.8 days).
+#define __EVENTLOOP_MAX_DELAY__ 2147483647
+
+/*
+ * A pending timer, the closure is an array with the callback (a function or
+ * a string to evaluate) followed by the arguments to pass to it.
+ */
+typedef struct {
+    uint32 id;
+    uint64 when;
+    uint64 interval;
+    size_t index;
+    JSBool cleared;
+    jsval  closure;
+} Timer;
+
+/*
+ * A file descriptor watched by the loop, the handler is called with the
+ * context running the loop when the descriptor is ready.
+ */
+typedef void (*EventLoopHandler)(JSContext* cx, int fd, uint32 events, void* data);
+
+typedef struct _EventLoopSource {
+    int              fd;
+    EventLoopHandler handler;
+    void*            data;
+    JSBool           removed;
+
+    struct _EventLoopSource* next;
+} EventLoopSource;
+
+/*
+ * The timers are kept in a binary heap ordered by expiration (and id, so
+ * timers expiring together fire in the order they were set), each timer
+ * knows its position in the heap so clearing it is O(log n) too.
+ *
+ * There's no lock, the loop belongs to the thread that created it (the main
+ * one) and only that thread can set or clear timers and watch descriptors.
+ * Threads share the global object, so the timer functions check it.
+ */
+typedef struct {
+    pthread_t    thread;
+
+    int          epoll;
+    int          timer;
+
+    Timer**      heap;
+    size_t       length;
+    size_t       size;
+
+    JSHashTable* timers;
+    uint32       lastId;
+
+    size_t           sources;
+    EventLoopSource* garbage;
+} EventLoop;
+
+extern JSBool EventLoop_initialize (JSContext* cx, JSObject* global);
+
+/*
+ * Run the loop until there's nothing left to wait for, it's called by ljs
+ * after the main script has been executed.
+ */
+extern JSBool EventLoop_run (JSContext* cx);
+
+/*
+ * Watch a file descriptor for the given epoll events, the loop keeps running
+ * as long as there are watched descriptors, so native modules can plug their
+ * own readiness notifications in it.
+ *
+ * RETURN:
+ *     The source to pass to EventLoop_unwatch, or NULL on failure.
+ */
+extern EventLoopSource* EventLoop_watch (int fd, uint32 events, EventLoopHandler handler, void* data);
+
+/*
+ * Stop watching the descriptor, it's safe to do it from a handler.
+ */
+extern void EventLoop_unwatch (EventLoopSource* source);
+
+/*
+ * Execute a function or evaluate a string after the given milliseconds,
+ * the other parameters are passed to the function.
+ *
+ * RETURN:
+ *     Number < The id of the timer to use with clearTimeout.
+ */
+extern JSBool EventLoop_setTimeout (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval);
+extern JSBool EventLoop_clearTimeout (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval);
+
+/*
+ * Like setTimeout but the function is executed every given milliseconds
+ * until the interval is cleared.
+ */
+extern JSBool EventLoop_setInterval (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval);
+extern JSBool EventLoop_clearInterval (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval);
+
+uint64 __EventLoop_now (void);
+JSBool __EventLoop_wait (JSContext* cx);
+void   __EventLoop_collect (void);
+JSBool __EventLoop_fire (JSContext* cx, Timer* timer);
+JSBool __EventLoop_isOwner (JSContext* cx);
+
+JSBool __EventLoop_addTimer (JSContext* cx, uintN argc, jsval* argv, jsval* rval, JSBool repeat);
+JSBool __EventLoop_clearTimer (JSContext* cx, uintN argc, jsval* argv);
+void   __EventLoop_freeTimer (JSContext* cx, Timer* timer);
+
+void   __EventLoop_heapPush (Timer* timer);
+void   __EventLoop_heapRemove (Timer* timer);
+void   __EventLoop_heapUp (size_t index);
+void   __EventLoop_heapDown (size_t index);
+JSBool __EventLoop_heapLess (Timer* a, Timer* b);
+
+JSHashNumber __EventLoop_hashId (const void* key);
+
+static JSFunctionSpec EventLoop_methods[] = {
+    {"setTimeout",    EventLoop_setTimeout,    0, 0, 0},
+    {"clearTimeout",  EventLoop_clearTimeout,  0, 0, 0},
+    {"setInterval",   EventLoop_setInterval,   0, 0, 0},
+    {"clearInterval", EventLoop_clearInterval, 0, 0, 0},
+    {NULL}
+};
+
+#endif
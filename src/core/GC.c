@@ -0,0 +1,225 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#include "GC.h"
+
+// Indexed like JSGCInfo.kinds and its per-type arrays.
+static const char* GC_kinds[JSGC_INFO_NKINDS] = {
+    "normal", "shutdown", "allocation"
+};
+
+static const char* GC_types[JSGC_INFO_NTYPES] = {
+    "object", "string", "double", "mutableString", "private",
+    "namespace", "qname", "xml", "externalString"
+};
+
+static JSGCCallback previous = NULL;
+
+/*
+ * The collections not yet reported, the last __GC_PENDING__ are kept when
+ * the listener falls behind.
+ */
+static struct {
+    GCRecord records[__GC_PENDING__];
+    uint32   recorded;
+    uint32   reported;
+    JSBool   notifying;
+} pending;
+
+JSBool
+GC_initialize (JSContext* cx, JSObject* global)
+{
+    JSFunction* function = JS_DefineFunction(cx, global, "GC", GC_collect, 0, 0);
+
+    if (!function || !JS_DefineFunctions(cx, JS_GetFunctionObject(function), GC_methods)) {
+        return JS_FALSE;
+    }
+
+    previous = JS_SetGCCallback(cx, __GC_callback);
+
+    return JS_TRUE;
+}
+
+JSBool
+GC_collect (JSContext* cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+{
+    JS_MaybeGC(cx);
+    GC_notify(cx);
+
+    return JS_TRUE;
+}
+
+JSBool
+GC_stats (JSContext* cx, JSObject *obj, uintN argc, jsval *argv, jsval *rval)
+{
+    JSGCInfo info;
+    JS_GetGCInfo(JS_GetRuntime(cx), &info);
+
+    JSObject* stats = JS_NewObject(cx, NULL, NULL, NULL);
+    if (!stats) {
+        return JS_FALSE;
+    }
+    *rval = OBJECT_TO_JSVAL(stats);
+
+    __GC_setNumber(cx, stats, "number", info.number);
+
+    JSObject* kinds = JS_NewObject(cx, NULL, NULL, NULL);
+    if (!kinds) {
+        return JS_FALSE;
+    }
+    jsval property  = OBJECT_TO_JSVAL(kinds);
+    JS_SetProperty(cx, stats, "kinds", &property);
+
+    int i;
+    for (i = 0; i < JSGC_INFO_NKINDS; i++) {
+        __GC_setNumber(cx, kinds, GC_kinds[i], info.kinds[i]);
+    }
+
+    JSObject* pause = JS_NewObject(cx, NULL, NULL, NULL);
+    if (!pause) {
+        return JS_FALSE;
+    }
+    property        = OBJECT_TO_JSVAL(pause);
+    JS_SetProperty(cx, stats, "pause", &property);
+
+    __GC_setNumber(cx, pause, "last",   info.lastPause / 1000.0);
+    __GC_setNumber(cx, pause, "median", info.pauseMedian / 1000.0);
+    __GC_setNumber(cx, pause, "p90",    info.pause90 / 1000.0);
+    __GC_setNumber(cx, pause, "p99",    info.pause99 / 1000.0);
+    __GC_setNumber(cx, pause, "max",    info.pauseMax / 1000.0);
+    __GC_setNumber(cx, pause, "total",  info.pauseTotal / 1000.0);
+
+    JSObject* types = JS_NewObject(cx, NULL, NULL, NULL);
+    if (!types) {
+        return JS_FALSE;
+    }
+    property        = OBJECT_TO_JSVAL(types);
+    JS_SetProperty(cx, stats, "types", &property);
+
+    for (i = 0; i < JSGC_INFO_NTYPES; i++) {
+        JSObject* type = JS_NewObject(cx, NULL, NULL, NULL);
+        if (!type) {
+            return JS_FALSE;
+        }
+        property       = OBJECT_TO_JSVAL(type);
+        JS_SetProperty(cx, types, GC_types[i], &property);
+
+        __GC_setNumber(cx, type, "allocated", info.allocBytes[i]);
+        __GC_setNumber(cx, type, "freed",     info.freedBytes[i]);
+        __GC_setNumber(cx, type, "live",      info.liveBytes[i]);
+    }
+
+    __GC_setNumber(cx, stats, "arenas",        info.arenas);
+    __GC_setNumber(cx, stats, "heap",          info.heapBytes);
+    __GC_setNumber(cx, stats, "trigger",       info.triggerBytes);
+    __GC_setNumber(cx, stats, "malloc",        info.mallocBytes);
+    __GC_setNumber(cx, stats, "mallocTrigger", info.mallocTrigger);
+
+    return JS_TRUE;
+}
+
+void
+GC_notify (JSContext* cx)
+{
+    if (pending.notifying || pending.reported == pending.recorded) {
+        return;
+    }
+
+    JSObject* global = JS_GetGlobalObject(cx);
+    jsval     listener = JSVAL_VOID;
+    jsval     function;
+
+    if (JS_GetProperty(cx, global, "GC", &function) && JSVAL_IS_OBJECT(function) && !JSVAL_IS_NULL(function)) {
+        JS_GetProperty(cx, JSVAL_TO_OBJECT(function), "onCollect", &listener);
+    }
+
+    if (!JSVAL_IS_OBJECT(listener) || JSVAL_IS_NULL(listener) || !JS_ObjectIsFunction(cx, JSVAL_TO_OBJECT(listener))) {
+        pending.reported = pending.recorded;
+        return;
+    }
+
+    jsval argv = JSVAL_NULL;
+    JS_AddNamedRoot(cx, &argv, "GC.onCollect");
+    JS_AddNamedRoot(cx, &listener, "GC.onCollect");
+
+    // The listener can allocate and cause more collections, they're reported in this loop too.
+    pending.notifying = JS_TRUE;
+    while (pending.reported != pending.recorded) {
+        if (pending.recorded - pending.reported > __GC_PENDING__) {
+            pending.reported = pending.recorded - __GC_PENDING__;
+        }
+
+        GCRecord record = pending.records[pending.reported % __GC_PENDING__];
+        pending.reported++;
+
+        JSObject* info = JS_NewObject(cx, NULL, NULL, NULL);
+        if (!info) {
+            break;
+        }
+        argv = OBJECT_TO_JSVAL(info);
+
+        __GC_setNumber(cx, info, "number", record.number);
+
+        jsval kind = STRING_TO_JSVAL(JS_NewStringCopyZ(cx, GC_kinds[record.kind]));
+        JS_SetProperty(cx, info, "kind", &kind);
+
+        __GC_setNumber(cx, info, "pause",   record.pause / 1000.0);
+        __GC_setNumber(cx, info, "heap",    record.heap);
+        __GC_setNumber(cx, info, "trigger", record.trigger);
+
+        jsval rval;
+        if (!JS_CallFunctionValue(cx, global, listener, 1, &argv, &rval) && JS_IsExceptionPending(cx)) {
+            JS_ReportPendingException(cx);
+            JS_ClearPendingException(cx);
+        }
+    }
+    pending.notifying = JS_FALSE;
+
+    JS_RemoveRoot(cx, &listener);
+    JS_RemoveRoot(cx, &argv);
+}
+
+JSBool
+__GC_callback (JSContext* cx, JSGCStatus status)
+{
+    if (status == JSGC_END) {
+        JSGCInfo info;
+        JS_GetGCInfo(JS_GetRuntime(cx), &info);
+
+        GCRecord* record = &pending.records[pending.recorded % __GC_PENDING__];
+        record->number  = info.number;
+        record->kind    = info.lastKind;
+        record->pause   = info.lastPause;
+        record->heap    = info.heapBytes;
+        record->trigger = info.triggerBytes;
+
+        pending.recorded++;
+    }
+
+    return previous ? previous(cx, status) : JS_TRUE;
+}
+
+void
+__GC_setNumber (JSContext* cx, JSObject* object, const char* name, jsdouble number)
+{
+    jsval property;
+
+    if (JS_NewNumberValue(cx, number, &property)) {
+        JS_SetProperty(cx, object, name, &property);
+    }
+}
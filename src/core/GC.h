@@ -0,0 +1,72 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#ifndef _GC_H
+#define _GC_H
+
+#include "lulzjs.h"
+
+/*
+ * A collection waiting to be reported to Program.GC.onCollect, the GC
+ * callback only records it since running scripts in the middle of an
+ * allocation isn't safe.
+ */
+typedef struct {
+    uint32 number;
+    uint32 kind;
+    uint32 pause;
+    uint32 heap;
+    uint32 trigger;
+} GCRecord;
+
+#define __GC_PENDING__ 64
+
+extern JSBool GC_initialize (JSContext* cx, JSObject* global);
+
+/*
+ * Run the GC if enough has been allocated since the last one, then report
+ * the pending collections.
+ */
+extern JSBool GC_collect (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval);
+
+/*
+ * Get the GC statistics kept by the engine.
+ *
+ * RETURN:
+ *     Object < The number of collections by kind, the pause times in
+ *              milliseconds, the bytes allocated, freed and alive by type,
+ *              the heap and the thresholds of the next collection.
+ */
+extern JSBool GC_stats (JSContext* cx, JSObject* obj, uintN argc, jsval* argv, jsval* rval);
+
+/*
+ * Call Program.GC.onCollect, if it's a function, with an object describing
+ * each collection since the last call.  It's called by the event loop and
+ * by Program.GC, so the listener never runs inside a collection.
+ */
+extern void GC_notify (JSContext* cx);
+
+JSBool __GC_callback (JSContext* cx, JSGCStatus status);
+void   __GC_setNumber (JSContext* cx, JSObject* object, const char* name, jsdouble number);
+
+static JSFunctionSpec GC_methods[] = {
+    {"stats", GC_stats, 0, 0, 0},
+    {NULL}
+};
+
+#endif
@@ -32,72 +32,68 @@ JS_strdup (JSContext* cx, const char* string)
     return new;
 }
 
+short
+fileExists (const char* file)
+{
+    return access(file, F_OK) == 0;
+}
+
 const char*
-readFile (JSContext* cx, const char* file)
+mapFile (const char* file, size_t* length)
 {
-    FILE*  fp     = fopen(file, "r");
-    char*  text   = NULL;
-    size_t length = 0;
-    size_t read   = 0;
+    int fd = open(file, O_RDONLY);
+    struct stat info;
 
-    if (!fp) {
+    if (fd < 0) {
         return NULL;
     }
 
-    while (1) {
-        text = JS_realloc(cx, text, length+=256);
-        read = fread(text+(length-256), sizeof(char), 256, fp);
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return NULL;
+    }
 
-        if (read < 256) {
-            text = JS_realloc(cx, text, length-=(256-read));
-            break;
-        }
+    *length = info.st_size;
+
+    // mmap doesn't like empty files.
+    if (*length == 0) {
+        close(fd);
+        return "";
+    }
+
+    void* text = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (text == MAP_FAILED) {
+        return NULL;
     }
-    text[length-1] = '\0';
 
-    fclose(fp);
+    madvise(text, *length, MADV_SEQUENTIAL);
 
     return text;
 }
 
-short
-fileExists (const char* file)
+void
+unmapFile (const char* text, size_t length)
 {
-    FILE* check = fopen(file, "r");
-
-    if (check) {
-        fclose(check);
-        return 1;
-    }
-    else {
-        return 0;
+    if (length > 0) {
+        munmap((void*) text, length);
     }
 }
 
-const char*
-stripRemainder (JSContext* cx, char* text)
+size_t
+skipShebang (const char* text, size_t length)
 {
-    char* stripped = NULL;
-    short strip = 0;
+    size_t position = 0;
+    short  strip    = 0;
 
-    size_t position;
-    if (text[0] == '#') {
-        for (position = 0; text[position] != '\n'; position++) {
+    if (length > 0 && text[0] == '#') {
+        for (; position < length && text[position] != '\n'; position++) {
             if (text[position] == '!') {
                 strip = 1;
             }
         }
     }
 
-    if (strip) {
-        stripped = JS_malloc(cx, (strlen(&text[position])+1)*sizeof(char));
-        strcpy(stripped, &text[position]);
-        JS_free(cx, text);
-    }
-    else {
-        stripped = text;
-    }
-
-    return stripped;
+    return strip ? position : 0;
 }
-
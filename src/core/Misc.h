@@ -21,10 +21,29 @@
 
 #include "lulzjs.h"
 
+// Not cross platform
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 char* JS_strdup (JSContext* cx, const char* string);
 
-const char* readFile (JSContext* cx, const char* file);
-      short fileExists (const char* file);
-const char* stripRemained (JSContext* cx, char* text);
+short fileExists (const char* file);
+
+/*
+ * Map a file in memory read only, the length is set to the size of the file.
+ *
+ * RETURN:
+ *     const char* < The mapped file or NULL if it couldn't be mapped.
+ */
+const char* mapFile (const char* file, size_t* length);
+       void unmapFile (const char* text, size_t length);
+
+/*
+ * Get the offset of the code in a script skipping the shebang line, the
+ * newline is kept so line numbers don't change.
+ */
+size_t skipShebang (const char* text, size_t length);
 
 #endif
@@ -0,0 +1,184 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#include "Options.h"
+
+Options options = {
+    8L * 1024L * 1024L, // heapSize
+    0,                  // mallocSize, same as heapSize
+    0,                  // triggerFactor, the engine's default
+    -1,                 // helperThreads, the engine's default
+    JS_TRUE,            // idleGC
+    8192,               // stackSize
+    JS_FALSE            // jit
+};
+
+JSBool
+Options_set (char flag, const char* value)
+{
+    uint32 number;
+
+    switch (flag) {
+        case 'm':
+        if (!__Options_parseSize(value, &number) || number == 0) {
+            return JS_FALSE;
+        }
+        options.heapSize = number;
+        break;
+
+        case 'M':
+        if (!__Options_parseSize(value, &number) || number == 0) {
+            return JS_FALSE;
+        }
+        options.mallocSize = number;
+        break;
+
+        case 'f':
+        if (!__Options_parseSize(value, &number) || number < 100) {
+            return JS_FALSE;
+        }
+        options.triggerFactor = number;
+        break;
+
+        case 't':
+        if (!__Options_parseSize(value, &number) || number > 1) {
+            return JS_FALSE;
+        }
+        options.helperThreads = number;
+        break;
+
+        case 'g':
+        if (strcmp(value, "idle") == 0) {
+            options.idleGC = JS_TRUE;
+        }
+        else if (strcmp(value, "alloc") == 0) {
+            options.idleGC = JS_FALSE;
+        }
+        else {
+            return JS_FALSE;
+        }
+        break;
+
+        case 's':
+        if (!__Options_parseSize(value, &number) || number < 1024) {
+            return JS_FALSE;
+        }
+        options.stackSize = number;
+        break;
+
+        case 'j':
+        if (strcmp(value, "on") == 0) {
+            options.jit = JS_TRUE;
+        }
+        else if (strcmp(value, "off") == 0) {
+            options.jit = JS_FALSE;
+        }
+        else {
+            return JS_FALSE;
+        }
+        break;
+
+        default:
+        return JS_FALSE;
+    }
+
+    return JS_TRUE;
+}
+
+void
+Options_fromEnvironment (void)
+{
+    static const struct {
+        char        flag;
+        const char* name;
+    } variables[] = {
+        {'m', "JSHEAP"},
+        {'M', "JSMALLOC"},
+        {'f', "JSGCFACTOR"},
+        {'t', "JSGCTHREADS"},
+        {'g', "JSGC"},
+        {'s', "JSSTACK"},
+        {'j', "JSJIT"},
+        {'\0'}
+    };
+
+    int i;
+    for (i = 0; variables[i].flag; i++) {
+        char* value = getenv(variables[i].name);
+
+        if (value && strlen(value) > 0 && !Options_set(variables[i].flag, value)) {
+            fprintf(stderr, "Ignoring the invalid value of %s: %s\n", variables[i].name, value);
+        }
+    }
+}
+
+void
+Options_apply (JSRuntime* rt)
+{
+    if (options.mallocSize) {
+        JS_SetGCParameter(rt, JSGC_MAX_MALLOC_BYTES, options.mallocSize);
+    }
+
+    if (options.triggerFactor) {
+        JS_SetGCParameter(rt, JSGC_TRIGGER_FACTOR, options.triggerFactor);
+    }
+
+    if (options.helperThreads >= 0) {
+        JS_SetGCParameter(rt, JSGC_HELPER_THREADS, options.helperThreads);
+    }
+}
+
+void
+Options_applyContext (JSContext* cx)
+{
+    JS_SetOptions(cx, JSOPTION_VAROBJFIX | (options.jit ? JSOPTION_JIT : 0));
+}
+
+JSBool
+__Options_parseSize (const char* value, uint32* size)
+{
+    char* end;
+    unsigned long long number;
+
+    if (!isdigit(value[0])) {
+        return JS_FALSE;
+    }
+
+    number = strtoull(value, &end, 10);
+
+    if (number > 0xFFFFFFFFULL) {
+        return JS_FALSE;
+    }
+
+    switch (tolower(*end)) {
+        case 'g': number *= 1024;
+        case 'm': number *= 1024;
+        case 'k': number *= 1024; end++;
+        case '\0': break;
+
+        default:
+        return JS_FALSE;
+    }
+
+    if (*end != '\0' || number > 0xFFFFFFFFULL) {
+        return JS_FALSE;
+    }
+
+    *size = (uint32) number;
+    return JS_TRUE;
+}
@@ -0,0 +1,82 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#ifndef _OPTIONS_H
+#define _OPTIONS_H
+
+#include "lulzjs.h"
+
+/*
+ * How the engine is set up, the defaults can be changed with environment
+ * variables and those with the ljs command line options.
+ *
+ *     heapSize      JSHEAP      -m  GC heap limit (JSGC_MAX_BYTES)
+ *     mallocSize    JSMALLOC    -M  least JS_malloc bytes between two GCs
+ *                                   (JSGC_MAX_MALLOC_BYTES)
+ *     triggerFactor JSGCFACTOR  -f  heap growth before the next GC, in
+ *                                   percent of what survived the last one
+ *     helperThreads JSGCTHREADS -t  threads freeing the memory released by
+ *                                   the GC, 0 or 1
+ *     idleGC        JSGC        -g  "idle" to also collect while the event
+ *                                   loop waits, "alloc" to collect only when
+ *                                   allocating
+ *     stackSize     JSSTACK     -s  stack chunk size of every context
+ *     jit           JSJIT       -j  "on" to compile hot scripts to native code
+ *                                   where the engine can, "off" by default
+ *
+ * Sizes are in bytes and can have a k, m or g suffix.
+ */
+typedef struct {
+    uint32 heapSize;
+    uint32 mallocSize;
+    uint32 triggerFactor;
+    int32  helperThreads;
+    JSBool idleGC;
+    size_t stackSize;
+    JSBool jit;
+} Options;
+
+extern Options options;
+
+/*
+ * Set an option from its command line flag or environment variable value.
+ *
+ * RETURN:
+ *     JSBool < False if the value is not valid for the option.
+ */
+extern JSBool Options_set (char flag, const char* value);
+
+/*
+ * Read the options from the environment, the invalid ones are reported and
+ * ignored.
+ */
+extern void Options_fromEnvironment (void);
+
+/*
+ * Apply the GC options to a new runtime.
+ */
+extern void Options_apply (JSRuntime* rt);
+
+/*
+ * Set the engine options of a new context.
+ */
+extern void Options_applyContext (JSContext* cx);
+
+JSBool __Options_parseSize (const char* value, uint32* size);
+
+#endif
@@ -0,0 +1,71 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#include "Snapshot.h"
+
+JSScript*
+Snapshot_load (JSContext* cx, const char* path, struct stat* info)
+{
+    static short valid = -1;
+
+    if (valid < 0) {
+        valid = (Snapshot_xdr == JSXDR_MAGIC_SCRIPT_CURRENT
+              && strcmp(Snapshot_engine, JS_GetImplementationVersion()) == 0);
+    }
+
+    if (!valid || strncmp(path, __LJS_LIBRARY_PATH__ "/", strlen(__LJS_LIBRARY_PATH__ "/")) != 0) {
+        return NULL;
+    }
+
+    SnapshotEntry key; key.path = &path[strlen(__LJS_LIBRARY_PATH__ "/")];
+    const SnapshotEntry* entry = bsearch(&key, Snapshot_entries, Snapshot_length, sizeof(SnapshotEntry), __Snapshot_compare);
+
+    if (!entry || entry->mtime != info->st_mtime || entry->size != info->st_size) {
+        #ifdef DEBUG
+        if (entry) printf("(snapshot) stale %s\n", path);
+        #endif
+
+        return NULL;
+    }
+
+    JSScript*   script = NULL;
+    JSXDRState* xdr    = JS_XDRNewMem(cx, JSXDR_DECODE);
+    JS_XDRMemSetData(xdr, (void*) &Snapshot_data[entry->offset], entry->length);
+
+    if (!JS_XDRScript(xdr, &script)) {
+        JS_ClearPendingException(cx);
+        script = NULL;
+    }
+
+    // The data is static so it must not be freed with the XDR state.
+    JS_XDRMemSetData(xdr, NULL, 0);
+    JS_XDRDestroy(xdr);
+
+    #ifdef DEBUG
+    printf("(snapshot) %s %s\n", script ? "hit" : "broken", path);
+    #endif
+
+    return script;
+}
+
+int
+__Snapshot_compare (const void* a, const void* b)
+{
+    return strcmp(((const SnapshotEntry*) a)->path, ((const SnapshotEntry*) b)->path);
+}
+
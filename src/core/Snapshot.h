@@ -0,0 +1,67 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include "lulzjs.h"
+#include "jsxdrapi.h"
+
+// Not cross platform
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/*
+ * A compiled Core library file, the path is relative to the library path
+ * and the data is the XDR encoded script, the mtime and size are the ones
+ * of the source file the script was compiled from.
+ */
+typedef struct {
+    const char* path;
+    int64       mtime;
+    int64       size;
+    uint32      offset;
+    uint32      length;
+} SnapshotEntry;
+
+/*
+ * These are defined in the SnapshotImage.c generated at build time by the
+ * snapshot generator, the entries are sorted by path.
+ */
+extern const char*          Snapshot_engine;
+extern const uint32         Snapshot_xdr;
+extern const SnapshotEntry  Snapshot_entries[];
+extern const size_t         Snapshot_length;
+extern const unsigned char  Snapshot_data[];
+
+/*
+ * Get the precompiled script for a file in the library path from the image
+ * linked in the interpreter, it's used only if the installed file has the
+ * same mtime and size of the file the image was built from.
+ *
+ * The image isn't loaded as a whole, each script is decoded when the file is
+ * included, after the include has found and stat'ed it as usual.
+ *
+ * RETURN:
+ *     JSScript* < The script or NULL if the file isn't in the image or it's stale.
+ */
+JSScript* Snapshot_load (JSContext* cx, const char* path, struct stat* info);
+
+int __Snapshot_compare (const void* a, const void* b);
+
+#endif
@@ -0,0 +1,222 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+/*
+ * Build time tool that compiles the Core library and writes a C source with
+ * the XDR encoded scripts, it's linked in ljs so the Core library doesn't
+ * have to be read and compiled at every start.
+ *
+ * USAGE:
+ *     SnapshotGenerator <library path> <base dir> <dir>
+ *
+ * Every .js file under <base dir>/<dir> is compiled with the file name it
+ * will have once installed in <library path>.
+ */
+
+#define _XOPEN_SOURCE 500
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ftw.h>
+#include "jsapi.h"
+
+#include "Misc.h"
+#include "Snapshot.h"
+
+typedef struct {
+    char*  path;
+    int64  mtime;
+    int64  size;
+    char*  data;
+    uint32 length;
+} GeneratorEntry;
+
+static JSContext*      cx;
+static JSObject*       global;
+static const char*     libraryPath;
+static size_t          baseLength;
+static GeneratorEntry* entries = NULL;
+static size_t          entriesNumber = 0;
+
+static JSClass Generator_class = {
+    "Generator", JSCLASS_GLOBAL_FLAGS,
+    JS_PropertyStub, JS_PropertyStub, JS_PropertyStub, JS_PropertyStub,
+    JS_EnumerateStub, JS_ResolveStub, JS_ConvertStub, JS_FinalizeStub,
+    JSCLASS_NO_OPTIONAL_MEMBERS
+};
+
+void
+reportError (JSContext *cx, const char *message, JSErrorReport *report)
+{
+    fprintf(stderr, "%s:%u > %s\n",
+        report->filename ? report->filename : "SnapshotGenerator",
+        (unsigned int) report->lineno,
+        message
+    );
+}
+
+int
+compare (const void* a, const void* b)
+{
+    return strcmp(((const GeneratorEntry*) a)->path, ((const GeneratorEntry*) b)->path);
+}
+
+int
+compile (const char* file, const struct stat* info, int flag, struct FTW* ftw)
+{
+    if (flag != FTW_F || strlen(file) < 3 || strcmp(&file[strlen(file)-3], ".js") != 0) {
+        return 0;
+    }
+
+    const char* relative = &file[baseLength];
+
+    // The scripts get the name they will have once installed.
+    char* name = JS_malloc(cx, (strlen(libraryPath)+strlen(relative)+2)*sizeof(char));
+    sprintf(name, "%s/%s", libraryPath, relative);
+
+    size_t length;
+    const char* sources = mapFile(file, &length);
+
+    if (!sources) {
+        fprintf(stderr, "%s couldn't be read.\n", file);
+        return 1;
+    }
+
+    size_t offset = skipShebang(sources, length);
+    JSScript* script = JS_CompileBytes(cx, global, &sources[offset], length-offset, name, 1);
+    unmapFile(sources, length);
+
+    if (!script) {
+        if (JS_IsExceptionPending(cx)) {
+            JS_ReportPendingException(cx);
+        }
+
+        fprintf(stderr, "%s couldn't be compiled.\n", file);
+        return 1;
+    }
+
+    JSXDRState* xdr = JS_XDRNewMem(cx, JSXDR_ENCODE);
+    if (!JS_XDRScript(xdr, &script)) {
+        fprintf(stderr, "%s couldn't be serialized.\n", file);
+        return 1;
+    }
+
+    entries = JS_realloc(cx, entries, ++entriesNumber*sizeof(GeneratorEntry));
+    GeneratorEntry* entry = &entries[entriesNumber-1];
+
+    entry->path  = JS_strdup(cx, relative);
+    entry->mtime = info->st_mtime;
+    entry->size  = info->st_size;
+
+    char* data    = JS_XDRMemGetData(xdr, &entry->length);
+    entry->data   = JS_malloc(cx, entry->length);
+    memcpy(entry->data, data, entry->length);
+
+    JS_XDRDestroy(xdr);
+    JS_DestroyScript(cx, script);
+    JS_free(cx, name);
+
+    return 0;
+}
+
+void
+output (void)
+{
+    size_t i;
+    uint32 j;
+    uint32 offset = 0;
+
+    puts("/* Generated by SnapshotGenerator, do not edit. */\n");
+    puts("#include \"Snapshot.h\"\n");
+
+    printf("const char* Snapshot_engine = \"%s\";\n", JS_GetImplementationVersion());
+    printf("const uint32 Snapshot_xdr = 0x%x;\n\n", JSXDR_MAGIC_SCRIPT_CURRENT);
+
+    puts("const unsigned char Snapshot_data[] = {");
+    for (i = 0; i < entriesNumber; i++) {
+        printf("    /* %s */", entries[i].path);
+
+        for (j = 0; j < entries[i].length; j++) {
+            if (j % 16 == 0) {
+                printf("\n    ");
+            }
+            printf("0x%02x,", (unsigned char) entries[i].data[j]);
+        }
+        puts("");
+    }
+    puts("    0x00\n};\n");
+
+    puts("const SnapshotEntry Snapshot_entries[] = {");
+    for (i = 0; i < entriesNumber; i++) {
+        printf("    {\"%s\", %lldLL, %lldLL, %u, %u},\n",
+            entries[i].path, (long long) entries[i].mtime, (long long) entries[i].size,
+            offset, entries[i].length);
+
+        offset += entries[i].length;
+    }
+    puts("    {NULL, 0, 0, 0, 0}\n};\n");
+
+    printf("const size_t Snapshot_length = %lu;\n", (unsigned long) entriesNumber);
+}
+
+int
+main (int argc, char *argv[])
+{
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <library path> <base dir> <dir>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    libraryPath = argv[1];
+    baseLength  = strlen(argv[2]) + 1;
+
+    char* root = malloc((strlen(argv[2])+strlen(argv[3])+2)*sizeof(char));
+    sprintf(root, "%s/%s", argv[2], argv[3]);
+
+    JSRuntime* runtime = JS_NewRuntime(8L * 1024L * 1024L);
+    if (!runtime || !(cx = JS_NewContext(runtime, 8192))) {
+        fprintf(stderr, "An error occurred while initializing the engine.\n");
+        return EXIT_FAILURE;
+    }
+
+    // Same version and options used by Core_initialize.
+    JS_SetVersion(cx, 180);
+    JS_SetOptions(cx, JSOPTION_VAROBJFIX);
+    JS_SetErrorReporter(cx, reportError);
+
+    global = JS_NewObject(cx, &Generator_class, NULL, NULL);
+    if (!global || !JS_InitStandardClasses(cx, global)) {
+        fprintf(stderr, "An error occurred while initializing the engine.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (nftw(root, compile, 16, FTW_PHYS) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    qsort(entries, entriesNumber, sizeof(GeneratorEntry), compare);
+    output();
+
+    JS_DestroyContext(cx);
+    JS_DestroyRuntime(runtime);
+    JS_ShutDown();
+    free(root);
+
+    return EXIT_SUCCESS;
+}
+
@@ -23,6 +23,7 @@
 #include "Misc.h"
 
 #include "Core.h"
+#include "Options.h"
 
 #include "Interactive.h"
 
@@ -31,6 +32,22 @@ char USAGE[] = {
     "\n"
     "    -v        Get lulzJS version.\n"
     "    -h        Read this help.\n"
+    "    -e code   Execute the given code.\n"
+    "\n"
+    "    -m size   GC heap limit (JSHEAP, 8m by default).\n"
+    "    -M size   Least JS_malloc bytes between two GCs (JSMALLOC, the heap\n"
+    "              limit by default).\n"
+    "    -f factor Heap growth before the next GC, in percent of what survived\n"
+    "              the last one (JSGCFACTOR, 300 by default).\n"
+    "    -t count  Threads freeing the memory released by the GC, 0 or 1\n"
+    "              (JSGCTHREADS, 1 on multiprocessors by default).\n"
+    "    -g mode   GC mode (JSGC): idle to also collect while waiting for\n"
+    "              events (default), alloc to collect only when allocating.\n"
+    "    -s size   Stack chunk size of the contexts (JSSTACK, 8192 by default).\n"
+    "    -j mode   Native code (JSJIT): on to compile hot scripts on x86-64,\n"
+    "              off by default.\n"
+    "\n"
+    "    Sizes are in bytes and can end with k, m or g.\n"
 };
 
 typedef struct {
@@ -60,26 +77,25 @@ main (int argc, char *argv[])
     char* oneliner = NULL;
     int stopAt = argc;
 
+    Options_fromEnvironment();
+
     // Fix the options to let a script get all the real arguments.
     if (argc > 1) {
         int i;
         char prev = '\0';
         for (i = 1; i < argc; i++) {
-            if (argv[i][0] != '-' && prev != 'e') {
+            if (argv[i][0] != '-' && !(prev && strchr("emMftgsj", prev))) {
                 stopAt = i;
                 break;
             }
 
-            if (strlen(argv[i]) >= 2) {
-                if (argv[i][0] == '-') {
-                    prev = argv[i][1];
-                }
-            }
+            // Only an option alone takes the next argument as its value.
+            prev = (argv[i][0] == '-' && strlen(argv[i]) == 2) ? argv[i][1] : '\0';
         }
     }
 
     int cmd;
-    while ((cmd = getopt(stopAt, argv, "vVhe:")) != -1) {
+    while ((cmd = getopt(stopAt, argv, "vVhe:m:M:f:t:g:s:j:")) != -1) {
         switch (cmd) {
             case 'V':
             puts("lulzJS " __LJS_VERSION__);
@@ -90,24 +106,33 @@ main (int argc, char *argv[])
             oneliner = optarg;
             break;
 
+            case 'm': case 'M': case 'f': case 't': case 'g': case 's': case 'j':
+            if (!Options_set(cmd, optarg)) {
+                fprintf(stderr, "Invalid value for -%c: %s\n", cmd, optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+
             default:
             puts(USAGE);
             return 0;
         }
     }
+
+    JSBool interactive = (!oneliner && optind >= argc);
     
     /*
      * Engine initialization, 0 because the Program.name will be ljs or the name
      * of the interpreter on the system, if instead it's executing a file it passes
      * optind because it will be the script name.
      */
-    Engine engine = initEngine(argc, (argc == 1 || oneliner ? 0 : optind), argv);
+    Engine engine = initEngine(argc, (interactive || oneliner ? 0 : optind), argv);
     if (engine.error) {
         fprintf(stderr, "An error occurred while initializing the system.\n");
         return 1;
     }
 
-    if (argc == 1) {
+    if (interactive) {
         Interactive(engine.context, engine.core);
     }
     else if (oneliner) {
@@ -132,6 +157,11 @@ main (int argc, char *argv[])
             return EXIT_FAILURE;
         }
     }
+
+    if (!interactive && !EventLoop_run(engine.context)) {
+        fprintf(stderr, "The event loop failed.\n");
+        return EXIT_FAILURE;
+    }
     
     JS_DestroyContext(engine.context);
     JS_DestroyRuntime(engine.runtime);
@@ -147,9 +177,11 @@ initEngine (int argc, int offset, char *argv[])
     Engine engine;
     engine.error = JS_TRUE;
 
-    if (engine.runtime = JS_NewRuntime(8L * 1024L * 1024L)) {
-        if (engine.context = JS_NewContext(engine.runtime, 8192)) {
-            JS_SetOptions(engine.context, JSOPTION_VAROBJFIX);
+    if (engine.runtime = JS_NewRuntime(options.heapSize)) {
+        Options_apply(engine.runtime);
+
+        if (engine.context = JS_NewContext(engine.runtime, options.stackSize)) {
+            Options_applyContext(engine.context);
             JS_SetErrorReporter(engine.context, reportError);
 
             if (engine.core = Core_initialize(engine.context, argv[offset])) {
@@ -185,9 +217,32 @@ executeScript (JSContext* cx, const char* file)
     jsval     rval;
     JSObject* global = JS_GetGlobalObject(cx);
 
-    char* sources = stripRemainder(cx, readFile(cx, file));
-    returnValue = JS_EvaluateScript(cx, global, sources, strlen(sources), file, 1, &rval);
-    JS_free(cx, sources);
+    size_t length;
+    const char* sources = mapFile(file, &length);
+
+    if (!sources) {
+        return JS_FALSE;
+    }
+
+    size_t    offset = skipShebang(sources, length);
+    JSScript* script = JS_CompileBytes(cx, global, &sources[offset], length-offset, file, 1);
+    unmapFile(sources, length);
+
+    if (!script) {
+        return JS_FALSE;
+    }
+
+    // The script object keeps the script alive if executing collects garbage.
+    JSObject* scriptObject = JS_NewScriptObject(cx, script);
+
+    if (!scriptObject) {
+        JS_DestroyScript(cx, script);
+        return JS_FALSE;
+    }
+
+    JS_AddNamedRoot(cx, &scriptObject, "main");
+    returnValue = JS_ExecuteScript(cx, global, script, &rval);
+    JS_RemoveRoot(cx, &scriptObject);
 
     return returnValue;
 }
@@ -237,14 +237,16 @@ void __SHA1_final(SHA1_ctx* ctx)
 }
 
 JSBool
-SHA1_toString (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+SHA1_toString (JSContext* cx, uintN argc, jsval* vp)
 {
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+
     char* string   = JS_malloc(cx, 41*sizeof(char));
     SHA1_ctx* data = JS_GetPrivate(cx, object);
 
     __SHA1_toString(data, string);
     
-    *rval = STRING_TO_JSVAL(JS_NewString(cx, string, 40));
+    JS_SET_RVAL(cx, vp, STRING_TO_JSVAL(JS_NewString(cx, string, 40)));
     return JS_TRUE;
 }
 
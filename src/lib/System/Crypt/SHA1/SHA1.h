@@ -42,11 +42,11 @@ void __SHA1_init (SHA1_ctx *ctx);
 void __SHA1_update (SHA1_ctx *ctx, uint8_t *data, const unsigned int len);
 void __SHA1_final (SHA1_ctx *ctx);
 
-extern JSBool SHA1_toString (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool SHA1_toString (JSContext* cx, uintN argc, jsval* vp);
 void __SHA1_toString (SHA1_ctx *ctx, char out[41]);
 
 static JSFunctionSpec SHA1_methods[] = {
-    {"toString", SHA1_toString, 0, 0, 0},
+    JS_FN("toString", SHA1_toString, 0, 0, 0),
     {NULL}
 };
 
@@ -90,8 +90,11 @@ File_finalize (JSContext* cx, JSObject* object)
 }
 
 JSBool
-File_write (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+File_write (JSContext* cx, uintN argc, jsval* vp)
 {
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
     char* string;
 
     if (argc != 1 || !JS_ConvertArguments(cx, argc, argv, "s", &string)) {
@@ -106,12 +109,16 @@ File_write (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rva
         offset += fwrite((string+offset), sizeof(char), strlen(string)-offset, data->stream->descriptor);
     }
 
+    JS_SET_RVAL(cx, vp, JSVAL_VOID);
     return JS_TRUE;
 }
 
 JSBool
-File_read (JSContext *cx, JSObject *object, uintN argc, jsval *argv, jsval *rval)
+File_read (JSContext* cx, uintN argc, jsval* vp)
 {
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
     const unsigned size;
 
     if (argc != 1 || !JS_ConvertArguments(cx, argc, argv, "u", &size)) {
@@ -122,7 +129,7 @@ File_read (JSContext *cx, JSObject *object, uintN argc, jsval *argv, jsval *rval
     FileInformation* data = JS_GetPrivate(cx, object);
 
     if (feof(data->stream->descriptor)) {
-        *rval = JSVAL_FALSE;
+        JS_SET_RVAL(cx, vp, JSVAL_FALSE);
         return JS_TRUE;
     }
 
@@ -130,51 +137,49 @@ File_read (JSContext *cx, JSObject *object, uintN argc, jsval *argv, jsval *rval
     memset(string, 0, size+1);
     fread(string, sizeof(char), size, data->stream->descriptor);
 
-    *rval = STRING_TO_JSVAL(JS_NewString(cx, string, size));
+    JS_SET_RVAL(cx, vp, STRING_TO_JSVAL(JS_NewString(cx, string, size)));
 
     return JS_TRUE;
 }
 
 JSBool
-File_writeBytes (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+File_writeBytes (JSContext* cx, uintN argc, jsval* vp)
 {
-    JSObject* obj;
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
 
-    if (argc != 1 || !JS_ConvertArguments(cx, argc, argv, "o", &obj)) {
-        JS_ReportError(cx, "Not enough parameters.");
+    BytesInformation* bytes;
+
+    if (argc != 1 || !(bytes = Bytes_get(cx, argv[0]))) {
+        JS_ReportError(cx, "You have to pass a Bytes object.");
         return JS_FALSE;
     }
 
     FileInformation* data = JS_GetPrivate(cx, object);
 
-    unsigned char* string;
-
-    jsval ret; JS_CallFunctionName(cx, obj, "toArray", 0, NULL, &ret);
-    JSObject* array = JSVAL_TO_OBJECT(ret);
+    size_t offset = 0;
+    while (offset < bytes->length) {
+        size_t written = fwrite(bytes->data+offset, sizeof(char), bytes->length-offset, data->stream->descriptor);
 
-    jsuint length; JS_GetArrayLength(cx, array, &length);
-    string = JS_malloc(cx, length*sizeof(char));
+        if (written == 0) {
+            JS_ReportError(cx, "Couldn't write to the file.");
+            return JS_FALSE;
+        }
 
-    jsuint i;
-    for (i = 0; i < length; i++) {
-        jsval val; JS_GetElement(cx, array, i, &val);
-        string[i] = (unsigned char) JSVAL_TO_INT(val);
-    }
-
-    unsigned offset = 0;
-    while (offset < length) {
-        offset += fwrite((string-offset), sizeof(char), length-offset, data->stream->descriptor);
+        offset += written;
     }
 
+    JS_SET_RVAL(cx, vp, JSVAL_VOID);
     return JS_TRUE;
 }
 
 JSBool
-File_readBytes (JSContext *cx, JSObject *object, uintN argc, jsval *argv, jsval *rval)
+File_readBytes (JSContext* cx, uintN argc, jsval* vp)
 {
-    const unsigned size;
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
 
-    JS_BeginRequest(cx);
+    unsigned size;
 
     if (argc != 1 || !JS_ConvertArguments(cx, argc, argv, "u", &size)) {
         JS_ReportError(cx, "Not enough parameters.");
@@ -184,52 +189,40 @@ File_readBytes (JSContext *cx, JSObject *object, uintN argc, jsval *argv, jsval
     FileInformation* data = JS_GetPrivate(cx, object);
 
     if (feof(data->stream->descriptor)) {
-        *rval = JSVAL_FALSE;
+        JS_SET_RVAL(cx, vp, JSVAL_FALSE);
         return JS_TRUE;
     }
 
-    unsigned char* string = JS_malloc(cx, (size+1)*sizeof(char));
-    memset(string, 0, size+1);
-    fread(string, sizeof(char), size, data->stream->descriptor);
+    unsigned char* bytes = JS_malloc(cx, size ? size : 1);
+    size_t read          = fread(bytes, sizeof(char), size, data->stream->descriptor);
 
-    JSObject* array = JS_NewArrayObject(cx, 0, NULL);
+    JSObject* result = Bytes_new(cx, bytes, read);
 
-    unsigned i;
-    for (i = 0; i < size; i++) {
-        jsval val = INT_TO_JSVAL(string[i]);
-        JS_SetElement(cx, array, i, &val);
+    if (!result) {
+        return JS_FALSE;
     }
 
-    jsval newArgv[] = {OBJECT_TO_JSVAL(array)};
-
-    jsval property; JS_GetProperty(cx, JS_GetGlobalObject(cx), "Bytes", &property);
-    JSObject* Bytes = JSVAL_TO_OBJECT(property);
-
-    jsval jsProto; JS_GetProperty(cx, Bytes, "prototype", &jsProto);
-    JSObject* proto = JSVAL_TO_OBJECT(jsProto);
-
-    JSObject* bytes = JS_ConstructObject(cx, NULL, proto, NULL);
-    jsval ret;
-    JS_CallFunctionValue(cx, bytes, OBJECT_TO_JSVAL(Bytes), 1, newArgv, &ret);
-
-    *rval = OBJECT_TO_JSVAL(bytes);
-    JS_EndRequest(cx);
+    JS_SET_RVAL(cx, vp, OBJECT_TO_JSVAL(result));
     return JS_TRUE;
 }
 
 
 JSBool
-File_isEnd (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+File_isEnd (JSContext* cx, uintN argc, jsval* vp)
 {
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+
     FileInformation* data = JS_GetPrivate(cx, object);
 
-    *rval = BOOLEAN_TO_JSVAL(feof(data->stream->descriptor));
+    JS_SET_RVAL(cx, vp, BOOLEAN_TO_JSVAL(feof(data->stream->descriptor)));
     return JS_TRUE;
 }
 
 JSBool
-File_static_exists (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+File_static_exists (JSContext* cx, uintN argc, jsval* vp)
 {
+    jsval* argv = JS_ARGV(cx, vp);
+
     const char* path;
 
     if (argc != 1 || !JS_ConvertArguments(cx, argc, argv, "s", &path)) {
@@ -239,11 +232,11 @@ File_static_exists (JSContext* cx, JSObject* object, uintN argc, jsval* argv, js
 
     FILE* file = fopen(path, "r");
     if (file) {
-        *rval = JSVAL_TRUE;
+        JS_SET_RVAL(cx, vp, JSVAL_TRUE);
         fclose(file);
     }
     else {
-        *rval = JSVAL_FALSE;
+        JS_SET_RVAL(cx, vp, JSVAL_FALSE);
     }
 
     return JS_TRUE;
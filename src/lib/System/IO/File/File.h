@@ -20,6 +20,7 @@
 #define _SYSTEM_IO_FILE_H
 
 #include "lulzjs.h"
+#include "Core/Base/Bytes/private.h"
 
 extern JSBool exec (JSContext* cx);
 extern JSBool File_initialize (JSContext* cx);
@@ -35,29 +36,29 @@ static JSClass File_class = {
 
 #include "private.h"
 
-extern JSBool File_write (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
-extern JSBool File_read (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool File_write (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool File_read (JSContext* cx, uintN argc, jsval* vp);
 
-extern JSBool File_writeBytes (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
-extern JSBool File_readBytes (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool File_writeBytes (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool File_readBytes (JSContext* cx, uintN argc, jsval* vp);
 
-extern JSBool File_isEnd (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool File_isEnd (JSContext* cx, uintN argc, jsval* vp);
 
-extern JSBool File_static_exists (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool File_static_exists (JSContext* cx, uintN argc, jsval* vp);
 
 static JSFunctionSpec File_methods[] = {
-    {"write", File_write, 0, 0, 0},
-    {"read",  File_read,  0, 0, 0},
+    JS_FN("write", File_write, 0, 0, 0),
+    JS_FN("read",  File_read,  0, 0, 0),
 
-    {"writeBytes", File_writeBytes, 0, 0, 0},
-    {"readBytes",  File_readBytes,  0, 0, 0},
+    JS_FN("writeBytes", File_writeBytes, 0, 0, 0),
+    JS_FN("readBytes",  File_readBytes,  0, 0, 0),
 
-    {"isEnd", File_isEnd, 0, 0, 0},
+    JS_FN("isEnd", File_isEnd, 0, 0, 0),
     {NULL}
 };
 
 static JSFunctionSpec File_static_methods[] = {
-    {"exists", File_static_exists, 0, 0, 0},
+    JS_FN("exists", File_static_exists, 0, 0, 0),
     {NULL}
 };
 
@@ -77,8 +77,11 @@ Stream_initialize (JSContext* cx)
 }
 
 JSBool
-Stream_write (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+Stream_write (JSContext* cx, uintN argc, jsval* vp)
 {
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
     char* string;
 
     if (argc != 1 || !JS_ConvertArguments(cx, argc, argv, "s", &string)) {
@@ -87,14 +90,17 @@ Stream_write (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* r
     }
 
     StreamInformation* data = JS_GetPrivate(cx, object);
-    *rval = INT_TO_JSVAL(fwrite(string, sizeof(*string), strlen(string), data->descriptor));
+    JS_SET_RVAL(cx, vp, INT_TO_JSVAL(fwrite(string, sizeof(*string), strlen(string), data->descriptor)));
 
     return JS_TRUE;
 }
 
 JSBool
-Stream_read (JSContext *cx, JSObject *object, uintN argc, jsval *argv, jsval *rval)
+Stream_read (JSContext* cx, uintN argc, jsval* vp)
 {
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
     const unsigned int size;
 
     if (argc != 1 || !JS_ConvertArguments(cx, argc, argv, "u", &size)) {
@@ -105,14 +111,14 @@ Stream_read (JSContext *cx, JSObject *object, uintN argc, jsval *argv, jsval *rv
     StreamInformation* data = (StreamInformation*) JS_GetPrivate(cx, object);
 
     if (feof(data->descriptor)) {
-        *rval = JSVAL_NULL;
+        JS_SET_RVAL(cx, vp, JSVAL_NULL);
         return JS_TRUE;
     }
 
     char* string = JS_malloc(cx, size*sizeof(char));
     fread(string, sizeof(char), size, data->descriptor);
 
-    *rval = STRING_TO_JSVAL(JS_NewString(cx, string, size));
+    JS_SET_RVAL(cx, vp, STRING_TO_JSVAL(JS_NewString(cx, string, size)));
     return JS_TRUE;
 }
 
@@ -32,12 +32,12 @@ static JSClass Stream_class = {
 
 #include "private.h"
 
-extern JSBool Stream_read (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
-extern JSBool Stream_write (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool Stream_read (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool Stream_write (JSContext* cx, uintN argc, jsval* vp);
 
 static JSFunctionSpec Stream_methods[] = {
-    {"read",   Stream_read,  0, 0, 0},
-    {"write",  Stream_write, 0, 0, 0},
+    JS_FN("read",   Stream_read,  0, 0, 0),
+    JS_FN("write",  Stream_write, 0, 0, 0),
     {NULL}
 };
 
@@ -0,0 +1,396 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#include "Poller.h"
+
+JSBool exec (JSContext* cx) { return Poller_initialize(cx); }
+
+JSBool
+Poller_initialize (JSContext* cx)
+{
+    jsval jsParent;
+    JS_GetProperty(cx, JS_GetGlobalObject(cx), "System", &jsParent);
+    JS_GetProperty(cx, JSVAL_TO_OBJECT(jsParent), "Net", &jsParent);
+    JSObject* parent = JSVAL_TO_OBJECT(jsParent);
+
+    JSObject* object = JS_InitClass(
+        cx, parent, NULL, &Poller_class,
+        Poller_constructor, 0, NULL, Poller_methods, NULL, Poller_static_methods
+    );
+
+    if (object) {
+        // Default properties, on the constructor so they're Poller.READ and so on.
+        jsval property;
+        JSObject* constructor = JS_GetConstructor(cx, object);
+
+        // Events.
+        property = INT_TO_JSVAL(EPOLLIN);
+        JS_SetProperty(cx, constructor, "READ", &property);
+        property = INT_TO_JSVAL(EPOLLOUT);
+        JS_SetProperty(cx, constructor, "WRITE", &property);
+        property = INT_TO_JSVAL(EPOLLERR);
+        JS_SetProperty(cx, constructor, "ERROR", &property);
+        property = INT_TO_JSVAL(EPOLLHUP);
+        JS_SetProperty(cx, constructor, "HANGUP", &property);
+
+        return JS_TRUE;
+    }
+
+    return JS_FALSE;
+}
+
+JSBool
+Poller_constructor (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+{
+    PollerInformation* data = JS_malloc(cx, sizeof(PollerInformation));
+    JS_SetPrivate(cx, object, data);
+
+    data->epoll   = epoll_create(1);
+    data->watches = JS_NewHashTable(64, __Poller_hashObject, JS_CompareValues, NULL, NULL, NULL);
+    data->length  = 0;
+    data->self    = OBJECT_TO_JSVAL(object);
+    data->source  = NULL;
+    data->garbage = NULL;
+    data->dispatching = 0;
+
+    if (data->epoll < 0) {
+        JS_ReportError(cx, "Couldn't create the poller.");
+        return JS_FALSE;
+    }
+
+    return JS_TRUE;
+}
+
+void
+Poller_finalize (JSContext* cx, JSObject* object)
+{
+    PollerInformation* data = JS_GetPrivate(cx, object);
+
+    // The poller is rooted while it watches something, so here it's empty.
+    if (data) {
+        if (data->epoll >= 0) {
+            close(data->epoll);
+        }
+
+        JS_HashTableDestroy(data->watches);
+        JS_free(cx, data);
+    }
+}
+
+JSBool
+Poller_add (JSContext* cx, uintN argc, jsval* vp)
+{
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
+    int32 events;
+
+    if (argc < 3 || !JS_ValueToInt32(cx, argv[1], &events)) {
+        JS_ReportError(cx, "Not enough parameters.");
+        return JS_FALSE;
+    }
+
+    PollerInformation* data   = JS_GetPrivate(cx, object);
+    SocketInformation* socket = __Poller_getSocket(cx, argv[0]);
+
+    if (!socket) {
+        return JS_FALSE;
+    }
+
+    if (!JS_ObjectIsFunction(cx, JSVAL_IS_OBJECT(argv[2]) ? JSVAL_TO_OBJECT(argv[2]) : NULL)) {
+        JS_ReportError(cx, "The callback has to be a function.");
+        return JS_FALSE;
+    }
+
+    if (socket->watch) {
+        JS_ReportError(cx, "The socket is already watched.");
+        return JS_FALSE;
+    }
+
+    // Keep the poller in the event loop while it has sockets.
+    if (data->length == 0) {
+        data->source = EventLoop_watch(data->epoll, EPOLLIN, __Poller_handler, data);
+
+        if (!data->source) {
+            JS_ReportOutOfMemory(cx);
+            return JS_FALSE;
+        }
+    }
+
+    PollerWatch* watch = JS_malloc(cx, sizeof(PollerWatch));
+
+    if (!watch) {
+        __Poller_leaveLoop(data);
+        return JS_FALSE;
+    }
+
+    watch->fd       = socket->socket;
+    watch->socket   = argv[0];
+    watch->callback = argv[2];
+    watch->removed  = JS_FALSE;
+    watch->poller   = data;
+    watch->next     = NULL;
+
+    struct epoll_event event;
+    event.events   = events;
+    event.data.ptr = watch;
+
+    if (epoll_ctl(data->epoll, EPOLL_CTL_ADD, watch->fd, &event) != 0) {
+        JS_free(cx, watch);
+        __Poller_leaveLoop(data);
+        JS_ReportError(cx, "Couldn't watch the socket: %s.", strerror(errno));
+        return JS_FALSE;
+    }
+
+    JS_AddNamedRoot(cx, &watch->socket, "Poller.socket");
+    JS_AddNamedRoot(cx, &watch->callback, "Poller.callback");
+    JS_HashTableAdd(data->watches, JSVAL_TO_OBJECT(argv[0]), watch);
+
+    socket->watch   = watch;
+    socket->unwatch = __Poller_unwatch;
+
+    // And alive, its callbacks are only reachable from here.
+    if (data->length++ == 0) {
+        JS_AddNamedRoot(cx, &data->self, "Poller");
+    }
+
+    JS_SET_RVAL(cx, vp, JSVAL_VOID);
+    return JS_TRUE;
+}
+
+JSBool
+Poller_modify (JSContext* cx, uintN argc, jsval* vp)
+{
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
+    int32 events;
+
+    if (argc < 2 || !JSVAL_IS_OBJECT(argv[0]) || JSVAL_IS_NULL(argv[0]) || !JS_ValueToInt32(cx, argv[1], &events)) {
+        JS_ReportError(cx, "Not enough parameters.");
+        return JS_FALSE;
+    }
+
+    PollerInformation* data = JS_GetPrivate(cx, object);
+    PollerWatch* watch      = JS_HashTableLookup(data->watches, JSVAL_TO_OBJECT(argv[0]));
+
+    if (!watch) {
+        JS_ReportError(cx, "The socket isn't watched.");
+        return JS_FALSE;
+    }
+
+    if (argc > 2) {
+        if (!JS_ObjectIsFunction(cx, JSVAL_IS_OBJECT(argv[2]) ? JSVAL_TO_OBJECT(argv[2]) : NULL)) {
+            JS_ReportError(cx, "The callback has to be a function.");
+            return JS_FALSE;
+        }
+
+        watch->callback = argv[2];
+    }
+
+    struct epoll_event event;
+    event.events   = events;
+    event.data.ptr = watch;
+
+    if (epoll_ctl(data->epoll, EPOLL_CTL_MOD, watch->fd, &event) != 0) {
+        JS_ReportError(cx, "Couldn't modify the watched events: %s.", strerror(errno));
+        return JS_FALSE;
+    }
+
+    JS_SET_RVAL(cx, vp, JSVAL_VOID);
+    return JS_TRUE;
+}
+
+JSBool
+Poller_remove (JSContext* cx, uintN argc, jsval* vp)
+{
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
+    if (argc < 1 || !JSVAL_IS_OBJECT(argv[0]) || JSVAL_IS_NULL(argv[0])) {
+        JS_ReportError(cx, "Not enough parameters.");
+        return JS_FALSE;
+    }
+
+    PollerInformation* data = JS_GetPrivate(cx, object);
+    PollerWatch* watch      = JS_HashTableLookup(data->watches, JSVAL_TO_OBJECT(argv[0]));
+
+    if (!watch) {
+        JS_SET_RVAL(cx, vp, JSVAL_FALSE);
+        return JS_TRUE;
+    }
+
+    __Poller_unwatch(cx, watch);
+
+    JS_SET_RVAL(cx, vp, JSVAL_TRUE);
+    return JS_TRUE;
+}
+
+JSBool
+Poller_wait (JSContext* cx, uintN argc, jsval* vp)
+{
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
+    int32 timeout = -1;
+
+    if (argc > 0 && !JS_ValueToInt32(cx, argv[0], &timeout)) {
+        return JS_FALSE;
+    }
+
+    PollerInformation* data = JS_GetPrivate(cx, object);
+
+    JS_SET_RVAL(cx, vp, INT_TO_JSVAL(__Poller_dispatch(cx, data, timeout)));
+    return JS_TRUE;
+}
+
+SocketInformation*
+__Poller_getSocket (JSContext* cx, jsval socket)
+{
+    if (JSVAL_IS_OBJECT(socket) && !JSVAL_IS_NULL(socket)) {
+        JSClass* class = JS_GET_CLASS(cx, JSVAL_TO_OBJECT(socket));
+
+        if (class && strcmp(class->name, "Socket") == 0) {
+            SocketInformation* data = JS_GetPrivate(cx, JSVAL_TO_OBJECT(socket));
+
+            if (data && data->socket >= 0) {
+                return data;
+            }
+        }
+    }
+
+    JS_ReportError(cx, "You have to pass an open Socket.");
+    return NULL;
+}
+
+int
+__Poller_dispatch (JSContext* cx, PollerInformation* data, int timeout)
+{
+    struct epoll_event events[256];
+    int ready;
+
+    // Only a blocking wait is worth letting the GC run meanwhile.
+    if (timeout != 0) {
+        jsrefcount req = JS_SuspendRequest(cx);
+        ready = epoll_wait(data->epoll, events, 256, timeout);
+        JS_ResumeRequest(cx, req);
+    }
+    else {
+        ready = epoll_wait(data->epoll, events, 256, 0);
+    }
+
+    data->dispatching++;
+
+    int i;
+    for (i = 0; i < ready; i++) {
+        PollerWatch* watch = events[i].data.ptr;
+
+        if (watch->removed) {
+            continue;
+        }
+
+        jsval argv[] = { watch->socket, INT_TO_JSVAL(events[i].events) };
+        jsval rval;
+
+        if (!JS_CallFunctionValue(cx, JSVAL_TO_OBJECT(watch->socket), watch->callback, 2, argv, &rval)) {
+            if (JS_IsExceptionPending(cx)) {
+                JS_ReportPendingException(cx);
+                JS_ClearPendingException(cx);
+            }
+        }
+    }
+
+    // A callback could have waited on the poller, the outer batch still needs them.
+    if (--data->dispatching > 0) {
+        return ready > 0 ? ready : 0;
+    }
+
+    while (data->garbage) {
+        PollerWatch* watch = data->garbage;
+        data->garbage = watch->next;
+
+        __Poller_freeWatch(cx, watch);
+    }
+
+    return ready > 0 ? ready : 0;
+}
+
+void
+__Poller_handler (JSContext* cx, int fd, uint32 events, void* data)
+{
+    PollerInformation* poller = data;
+
+    // The callbacks could remove every socket and let the poller be collected.
+    jsval self = poller->self;
+    JS_AddNamedRoot(cx, &self, "Poller.dispatch");
+    __Poller_dispatch(cx, poller, 0);
+    JS_RemoveRoot(cx, &self);
+}
+
+void
+__Poller_unwatch (JSContext* cx, void* data)
+{
+    PollerWatch*       watch  = data;
+    PollerInformation* poller = watch->poller;
+    SocketInformation* socket = JS_GetPrivate(cx, JSVAL_TO_OBJECT(watch->socket));
+
+    epoll_ctl(poller->epoll, EPOLL_CTL_DEL, watch->fd, NULL);
+    JS_HashTableRemove(poller->watches, JSVAL_TO_OBJECT(watch->socket));
+
+    socket->watch   = NULL;
+    socket->unwatch = NULL;
+
+    // Events for it could still be pending in the batch being dispatched.
+    if (poller->dispatching) {
+        watch->removed  = JS_TRUE;
+        watch->next     = poller->garbage;
+        poller->garbage = watch;
+    }
+    else {
+        __Poller_freeWatch(cx, watch);
+    }
+
+    if (--poller->length == 0) {
+        __Poller_leaveLoop(poller);
+        JS_RemoveRoot(cx, &poller->self);
+    }
+}
+
+void
+__Poller_leaveLoop (PollerInformation* data)
+{
+    if (data->length == 0 && data->source) {
+        EventLoop_unwatch(data->source);
+        data->source = NULL;
+    }
+}
+
+void
+__Poller_freeWatch (JSContext* cx, PollerWatch* watch)
+{
+    JS_RemoveRoot(cx, &watch->socket);
+    JS_RemoveRoot(cx, &watch->callback);
+    JS_free(cx, watch);
+}
+
+JSHashNumber
+__Poller_hashObject (const void* key)
+{
+    return (JSHashNumber) ((jsword) key >> JSVAL_TAGBITS);
+}
+
@@ -0,0 +1,113 @@
+/****************************************************************************
+* This file is part of lulzJS                                               *
+* Copyleft meh.                                                             *
+*                                                                           *
+* lulzJS is free software: you can redistribute it and/or modify            *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation, either version 3 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* lulzJS is distributed in the hope that it will be useful.                 *
+* but WITHOUT ANY WARRANTY; without even the implied warranty o.            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See th.             *
+* GNU General Public License for more details.                              *
+*                                                                           *
+* You should have received a copy of the GNU General Public License         *
+* along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
+****************************************************************************/
+
+#ifndef _SYSTEM_NET_POLLER_H
+#define _SYSTEM_NET_POLLER_H
+
+#include "lulzjs.h"
+#include "jshash.h"
+#include "EventLoop.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "System/Net/Socket/private.h"
+
+extern JSBool exec (JSContext* cx);
+extern JSBool Poller_initialize (JSContext* cx);
+
+extern JSBool Poller_constructor (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern void  Poller_finalize (JSContext* cx, JSObject* object);
+
+static JSClass Poller_class = {
+    "Poller", JSCLASS_HAS_PRIVATE,
+    JS_PropertyStub, JS_PropertyStub, JS_PropertyStub, JS_PropertyStub,
+    JS_EnumerateStub, JS_ResolveStub, JS_ConvertStub, Poller_finalize
+};
+
+/*
+ * A watched socket, the socket object and the callback are rooted until the
+ * watch is removed or the socket is closed.
+ */
+typedef struct _PollerWatch {
+    int    fd;
+    jsval  socket;
+    jsval  callback;
+    JSBool removed;
+
+    struct _PollerInformation* poller;
+    struct _PollerWatch*       next;
+} PollerWatch;
+
+typedef struct _PollerInformation {
+    int          epoll;
+    JSHashTable* watches;
+    size_t       length;
+
+    jsval            self;
+    EventLoopSource* source;
+    PollerWatch*     garbage;
+    int              dispatching;
+} PollerInformation;
+
+/*
+ * Call the callback with the socket and the ready events every time the
+ * socket is ready, the poller is plugged in the main event loop as long as
+ * it has something to watch. A socket can be in one poller at a time and
+ * closing it removes it from the poller.
+ */
+extern JSBool Poller_add (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool Poller_modify (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool Poller_remove (JSContext* cx, uintN argc, jsval* vp);
+
+/*
+ * Wait for events for the given milliseconds (forever if not given) and
+ * dispatch them, to use the poller without the event loop.
+ *
+ * RETURN:
+ *     Number < The number of dispatched events.
+ */
+extern JSBool Poller_wait (JSContext* cx, uintN argc, jsval* vp);
+
+SocketInformation* __Poller_getSocket (JSContext* cx, jsval socket);
+int                __Poller_dispatch (JSContext* cx, PollerInformation* data, int timeout);
+void               __Poller_handler (JSContext* cx, int fd, uint32 events, void* data);
+void               __Poller_unwatch (JSContext* cx, void* watch);
+void               __Poller_leaveLoop (PollerInformation* data);
+void               __Poller_freeWatch (JSContext* cx, PollerWatch* watch);
+
+JSHashNumber __Poller_hashObject (const void* key);
+
+static JSFunctionSpec Poller_methods[] = {
+    JS_FN("add",    Poller_add,    0, 0, 0),
+    JS_FN("modify", Poller_modify, 0, 0, 0),
+    JS_FN("remove", Poller_remove, 0, 0, 0),
+
+    JS_FN("wait", Poller_wait, 0, 0, 0),
+
+    {NULL}
+};
+
+static JSFunctionSpec Poller_static_methods[] = {
+    {NULL}
+};
+
+#endif
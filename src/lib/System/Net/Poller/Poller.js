@@ -16,49 +16,30 @@
 * along with lulzJS.  If not, see <http://www.gnu.org/licenses/>.           *
 ****************************************************************************/
 
-Program.Bytes = Class.create({
-    initialize: function (base) {
-        if (!Object.is(base, Array)) {
-            throw "You have to pass an array.";
-        }
-
-        this.array = base;
+Object.extend(System.Net.Poller.prototype, {
+    listen: function (socket, callback) {
+        socket.setBlocking(false);
+
+        this.add(socket, System.Net.Poller.READ, function (socket) {
+            var client;
+            while (client = socket.accept()) {
+                callback(client);
+            }
+        });
     },
 
-    get length() {
-        return (this.array) ? this.array.length : 0;
-    },
+    connect: function (socket, host, port, callback) {
+        socket.setBlocking(false);
 
-    byteAt: function (index) {
-        if (index >= this.array.length) {
-            throw "Index out of range.";
+        if (!socket.connect(host, port)) {
+            callback(socket, false);
+            return;
         }
 
-        return this.array[index];
-    },
-
-    toArray: function () {
-        return this.array;
-    },
-
-    toText: function () {
-        var str = new String;
-
-        for (var i = 0; i < this.array.length; i++) {
-            str += String.fromCharCode(this.array[i]);
-        }
-
-        return str;
-    },
-    
-    toString: function () {
-        var str = new String;
-
-        for (var i = 0; i < this.array.length; i++) {
-            str += "\\x"+this.array[i].toPaddedString(2, 16);
-        }
-
-        return str;
+        var poller = this;
+        this.add(socket, System.Net.Poller.WRITE, function (socket) {
+            poller.remove(socket);
+            callback(socket, socket.getError() == 0);
+        });
     }
 });
-
@@ -87,6 +87,16 @@ Socket_constructor (JSContext* cx, JSObject* object, uintN argc, jsval* argv, js
     data->type      = type;
     data->protocol  = protocol;
     data->connected = JS_FALSE;
+    data->blocking  = JS_TRUE;
+    data->addr      = NULL;
+
+    data->buffer      = NULL;
+    data->bufferSize  = 0;
+    data->bufferStart = 0;
+    data->bufferEnd   = 0;
+
+    data->watch   = NULL;
+    data->unwatch = NULL;
 
     return JS_TRUE;
 }
@@ -101,14 +111,24 @@ Socket_finalize (JSContext* cx, JSObject* object)
             JS_free(cx, data->addr);
         }
 
-        close(data->socket);
+        if (data->socket >= 0) {
+            close(data->socket);
+        }
+
+        if (data->buffer) {
+            JS_free(cx, data->buffer);
+        }
+
         JS_free(cx, data);
     }
 }
 
 JSBool
-Socket_connect (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+Socket_connect (JSContext* cx, uintN argc, jsval* vp)
 {
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
     char* host;
     int port;
 
@@ -131,34 +151,45 @@ Socket_connect (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval*
         const char* ip = __Socket_getHostByName(cx, host);
 
         if (!ip) {
-            *rval = JSVAL_FALSE;
+            JS_SET_RVAL(cx, vp, JSVAL_FALSE);
             return JS_TRUE;
         }
 
         addrin->sin_addr.s_addr = inet_addr(ip);
     }
 
-    if (connect(data->socket, (struct sockaddr*) addrin, sizeof(struct sockaddr_in)) < 0) {
+    /*
+     * A non-blocking connect is in progress when it returns, the socket gets
+     * writable when it's done and getError tells if it failed.
+     */
+    if (connect(data->socket, (struct sockaddr*) addrin, sizeof(struct sockaddr_in)) < 0 && (data->blocking || errno != EINPROGRESS)) {
         data->connected = JS_FALSE;
     }
     else {
         data->connected = JS_TRUE;
     }
 
+    if (data->addr) {
+        JS_free(cx, data->addr);
+    }
+
     data->addr = (struct sockaddr*) addrin;
 
-    *rval = BOOLEAN_TO_JSVAL(data->connected);
+    JS_SET_RVAL(cx, vp, BOOLEAN_TO_JSVAL(data->connected));
 
     return JS_TRUE;
 }
 
 JSBool
-Socket_listen (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+Socket_listen (JSContext* cx, uintN argc, jsval* vp)
 {
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
     int port;
     int maxconn = 255;
 
-    if (argc != 2) {
+    if (argc < 2) {
         JS_ReportError(cx, "Not enough parameters.");
         return JS_FALSE;
     }
@@ -204,41 +235,82 @@ Socket_listen (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval*
 
     data->addr = (struct sockaddr*) addrin;
 
+    JS_SET_RVAL(cx, vp, JSVAL_VOID);
     return JS_TRUE;
 }
 
 JSBool
-Socket_accept (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+Socket_accept (JSContext* cx, uintN argc, jsval* vp)
 {
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+
     SocketInformation* data = JS_GetPrivate(cx, object);
 
-    JSObject* sock = JS_NewObject(cx, &Socket_class, JS_GetPrototype(cx, object), NULL);
+    struct sockaddr_in* addrin = JS_malloc(cx, sizeof(struct sockaddr_in));
+    socklen_t size             = sizeof(struct sockaddr_in);
+
+    jsrefcount req = JS_SuspendRequest(cx);
+    int socket     = accept(data->socket, (struct sockaddr*) addrin, &size);
+    JS_ResumeRequest(cx, req);
+
+    if (socket < 0) {
+        JS_free(cx, addrin);
+
+        // Nothing to accept yet on a non-blocking socket.
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            JS_SET_RVAL(cx, vp, JSVAL_NULL);
+            return JS_TRUE;
+        }
 
-    int size = sizeof(struct sockaddr);
+        JS_ReportError(cx, "Accept failed.");
+        return JS_FALSE;
+    }
+
+    // The accepted socket is in the same mode as the listening one.
+    if (!data->blocking) {
+        fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+    }
+
+    JSObject* sock = JS_NewObject(cx, &Socket_class, JS_GetPrototype(cx, object), NULL);
 
     SocketInformation* newData = JS_malloc(cx, sizeof(SocketInformation));
-    newData->addr     = JS_malloc(cx, sizeof(struct sockaddr*));
-    newData->socket   = accept(data->socket, newData->addr, &size);
-    newData->family   = ((struct sockaddr_in*)newData->addr)->sin_family;
+    newData->socket    = socket;
+    newData->family    = addrin->sin_family;
+    newData->type      = data->type;
+    newData->protocol  = data->protocol;
+    newData->connected = JS_TRUE;
+    newData->blocking  = data->blocking;
+    newData->addr      = (struct sockaddr*) addrin;
+
+    newData->buffer      = NULL;
+    newData->bufferSize  = 0;
+    newData->bufferStart = 0;
+    newData->bufferEnd   = 0;
+
+    newData->watch   = NULL;
+    newData->unwatch = NULL;
     JS_SetPrivate(cx, sock, newData);
 
-    *rval = OBJECT_TO_JSVAL(sock);
+    JS_SET_RVAL(cx, vp, OBJECT_TO_JSVAL(sock));
     return JS_TRUE;
 }
 
 JSBool
-Socket_send (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+Socket_send (JSContext* cx, uintN argc, jsval* vp)
 {
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
     char* string;
     unsigned flags = 0;
 
-    JS_BeginRequest(cx);
-
     if (argc < 1) {
         JS_ReportError(cx, "Not enough parameters.");
         return JS_FALSE;
     }
 
+    JS_BeginRequest(cx);
+
     switch (argc) {
         case 2: JS_ValueToInt32(cx, argv[1], &flags);
         case 1: string = JS_GetStringBytes(JS_ValueToString(cx, argv[0]));
@@ -248,32 +320,43 @@ Socket_send (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rv
 
     if (!data->connected) {
         JS_ReportError(cx, "The socket isn't connected.");
+        JS_EndRequest(cx);
         return JS_FALSE;
     }
 
-    JS_EndRequest(cx);
+    jsrefcount req = JS_SuspendRequest(cx);
+    ssize_t sent   = __Socket_send(data, string, strlen(string), flags);
+    JS_ResumeRequest(cx, req);
 
-    unsigned offset = 0;
-    while (offset < strlen(string)) {
-        offset += send(data->socket, (string+offset), (strlen(string)-offset)*sizeof(char), flags);
+    if (sent < 0) {
+        JS_ReportError(cx, "Send failed: %s.", strerror(errno));
+        JS_EndRequest(cx);
+        return JS_FALSE;
     }
 
+    // On a non-blocking socket it can be less than the string length.
+    JS_SET_RVAL(cx, vp, INT_TO_JSVAL(sent));
+
+    JS_EndRequest(cx);
     return JS_TRUE;
 }
 
 JSBool
-Socket_receive (JSContext *cx, JSObject *object, uintN argc, jsval *argv, jsval *rval)
+Socket_receive (JSContext* cx, uintN argc, jsval* vp)
 {
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
     unsigned size;
     unsigned flags = 0;
 
-    JS_BeginRequest(cx);
-
     if (argc < 1) {
         JS_ReportError(cx, "Not enough parameters.");
         return JS_FALSE;
     }
 
+    JS_BeginRequest(cx);
+
     switch (argc) {
         case 2: JS_ValueToInt32(cx, argv[1], &flags);
         case 1: JS_ValueToInt32(cx, argv[0], &size);
@@ -283,85 +366,347 @@ Socket_receive (JSContext *cx, JSObject *object, uintN argc, jsval *argv, jsval
 
     if (!data->connected) {
         JS_ReportError(cx, "The socket isn't connected.");
+        JS_EndRequest(cx);
         return JS_FALSE;
     }
 
     char* string = JS_malloc(cx, (size+1)*sizeof(char));
 
-    jsrefcount req = JS_SuspendRequest(cx);
-    unsigned offset = 0;
-    while (offset < size) {
-        offset += recv(data->socket, (string+offset), sizeof(char)*(size-offset), flags);
-    }
-    string[size] = '\0';
+    jsrefcount req   = JS_SuspendRequest(cx);
+    ssize_t received = __Socket_receive(data, string, size, flags);
     JS_ResumeRequest(cx, req);
 
-    *rval = STRING_TO_JSVAL(JS_NewString(cx, string, sizeof(char)*strlen(string)));
+    if (received < 0) {
+        JS_free(cx, string);
+
+        // Nothing to read yet on a non-blocking socket.
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            JS_SET_RVAL(cx, vp, JSVAL_NULL);
+            JS_EndRequest(cx);
+            return JS_TRUE;
+        }
+
+        JS_ReportError(cx, "Receive failed: %s.", strerror(errno));
+        JS_EndRequest(cx);
+        return JS_FALSE;
+    }
+
+    // Less than requested (or an empty string) means the peer closed the connection.
+    string[received] = '\0';
+    JS_SET_RVAL(cx, vp, STRING_TO_JSVAL(JS_NewString(cx, string, received)));
 
     JS_EndRequest(cx);
     return JS_TRUE;
 }
 
 JSBool
-Socket_sendBytes (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+Socket_readLine (JSContext* cx, uintN argc, jsval* vp)
 {
-    JSObject* obj;
-    unsigned flags = 0;
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
 
     JS_BeginRequest(cx);
 
+    JSString* separator = NULL;
+    SocketInformation* data = JS_GetPrivate(cx, object);
+
+    // Filling the buffer can collect garbage, keep the separator in argv.
+    if (argc > 0) {
+        if (!(separator = JS_ValueToString(cx, argv[0]))) {
+            JS_EndRequest(cx);
+            return JS_FALSE;
+        }
+
+        argv[0] = STRING_TO_JSVAL(separator);
+    }
+
+    if (!data->connected) {
+        JS_ReportError(cx, "The socket isn't connected.");
+        JS_EndRequest(cx);
+        return JS_FALSE;
+    }
+
+    JSBool result = separator
+        ? __Socket_readUntil(cx, data, JS_GetStringBytes(separator), JS_GetStringLength(separator), JS_TRUE, vp)
+        : __Socket_readUntil(cx, data, "\r\n", 2, JS_TRUE, vp);
+
+    JS_EndRequest(cx);
+    return result;
+}
+
+JSBool
+Socket_readUntil (JSContext* cx, uintN argc, jsval* vp)
+{
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
     if (argc < 1) {
         JS_ReportError(cx, "Not enough parameters.");
         return JS_FALSE;
     }
 
-    switch (argc) {
-        case 2: JS_ValueToInt32(cx, argv[1], &flags);
-        case 1: JS_ValueToObject(cx, argv[0], &obj);
+    JS_BeginRequest(cx);
+
+    JSString* delimiter     = JS_ValueToString(cx, argv[0]);
+    SocketInformation* data = JS_GetPrivate(cx, object);
+
+    if (!delimiter) {
+        JS_EndRequest(cx);
+        return JS_FALSE;
+    }
+
+    argv[0] = STRING_TO_JSVAL(delimiter);
+
+    if (!data->connected) {
+        JS_ReportError(cx, "The socket isn't connected.");
+        JS_EndRequest(cx);
+        return JS_FALSE;
     }
 
+    JSBool result = __Socket_readUntil(cx, data, JS_GetStringBytes(delimiter), JS_GetStringLength(delimiter), JS_FALSE, vp);
+
+    JS_EndRequest(cx);
+    return result;
+}
+
+JSBool
+Socket_readExactly (JSContext* cx, uintN argc, jsval* vp)
+{
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
+    int32 size;
+
+    if (argc < 1 || !JS_ValueToInt32(cx, argv[0], &size) || size < 0) {
+        JS_ReportError(cx, "Not enough parameters.");
+        return JS_FALSE;
+    }
+
+    JS_BeginRequest(cx);
+
     SocketInformation* data = JS_GetPrivate(cx, object);
 
     if (!data->connected) {
         JS_ReportError(cx, "The socket isn't connected.");
+        JS_EndRequest(cx);
         return JS_FALSE;
     }
 
-    unsigned char* string;
-    jsval ret; JS_CallFunctionName(cx, obj, "toArray", 0, NULL, &ret);
-    JSObject* array = JSVAL_TO_OBJECT(ret);
+    while (data->bufferEnd - data->bufferStart < (size_t) size) {
+        ssize_t received = __Socket_fill(cx, data);
 
-    jsuint length; JS_GetArrayLength(cx, array, &length);
-    string = JS_malloc(cx, (length+1)*sizeof(char));
+        // The peer closed the connection, what's left is all there is.
+        if (received == 0) {
+            size = data->bufferEnd - data->bufferStart;
 
-    jsuint i;
-    for (i = 0; i < length; i++) {
-        jsval val; JS_GetElement(cx, array, i, &val);
-        string[i] = (unsigned char) JSVAL_TO_INT(val);
+            if (size == 0) {
+                JSBool result = __Socket_readEnded(cx, data, vp);
+                JS_EndRequest(cx);
+                return result;
+            }
+
+            break;
+        }
+
+        if (received < 0) {
+            JSBool result = __Socket_readFailed(cx, data, received, vp);
+            JS_EndRequest(cx);
+            return result;
+        }
     }
-    string[length] = '\0';
-    
+
+    JS_SET_RVAL(cx, vp, STRING_TO_JSVAL(JS_NewStringCopyN(cx, data->buffer + data->bufferStart, size)));
+    data->bufferStart += size;
+
     JS_EndRequest(cx);
+    return JS_TRUE;
+}
+
+JSBool
+Socket_peek (JSContext* cx, uintN argc, jsval* vp)
+{
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
+    int32 size = -1;
+
+    if (argc > 0 && !JS_ValueToInt32(cx, argv[0], &size)) {
+        return JS_FALSE;
+    }
+
+    JS_BeginRequest(cx);
+
+    SocketInformation* data = JS_GetPrivate(cx, object);
+
+    if (!data->connected) {
+        JS_ReportError(cx, "The socket isn't connected.");
+        JS_EndRequest(cx);
+        return JS_FALSE;
+    }
 
-    *rval = INT_TO_JSVAL(send(data->socket, string, sizeof(char)*strlen(string), flags));
+    if (data->bufferEnd == data->bufferStart) {
+        ssize_t received = __Socket_fill(cx, data);
+
+        if (received == 0) {
+            JSBool result = __Socket_readEnded(cx, data, vp);
+            JS_EndRequest(cx);
+            return result;
+        }
+
+        if (received < 0) {
+            JSBool result = __Socket_readFailed(cx, data, received, vp);
+            JS_EndRequest(cx);
+            return result;
+        }
+    }
+
+    size_t buffered = data->bufferEnd - data->bufferStart;
+    if (size < 0 || (size_t) size > buffered) {
+        size = buffered;
+    }
+
+    JS_SET_RVAL(cx, vp, STRING_TO_JSVAL(JS_NewStringCopyN(cx, data->buffer + data->bufferStart, size)));
+
+    JS_EndRequest(cx);
     return JS_TRUE;
 }
 
 JSBool
-Socket_receiveBytes (JSContext *cx, JSObject *object, uintN argc, jsval *argv, jsval *rval)
+Socket_close (JSContext* cx, uintN argc, jsval* vp)
 {
-    unsigned size;
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+
+    SocketInformation* data = JS_GetPrivate(cx, object);
+
+    // A watched socket would keep itself and its poller alive forever.
+    if (data->unwatch) {
+        data->unwatch(cx, data->watch);
+    }
+
+    if (data->socket >= 0) {
+        close(data->socket);
+        data->socket = -1;
+    }
+
+    data->connected = JS_FALSE;
+
+    JS_SET_RVAL(cx, vp, JSVAL_VOID);
+    return JS_TRUE;
+}
+
+JSBool
+Socket_setBlocking (JSContext* cx, uintN argc, jsval* vp)
+{
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
+    JSBool blocking;
+
+    if (argc != 1 || !JS_ConvertArguments(cx, argc, argv, "b", &blocking)) {
+        JS_ReportError(cx, "Not enough parameters.");
+        return JS_FALSE;
+    }
+
+    SocketInformation* data = JS_GetPrivate(cx, object);
+
+    int flags = fcntl(data->socket, F_GETFL);
+    flags     = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+
+    if (fcntl(data->socket, F_SETFL, flags) < 0) {
+        JS_ReportError(cx, "Couldn't change the blocking mode.");
+        return JS_FALSE;
+    }
+
+    data->blocking = blocking;
+
+    JS_SET_RVAL(cx, vp, JSVAL_VOID);
+    return JS_TRUE;
+}
+
+JSBool
+Socket_getError (JSContext* cx, uintN argc, jsval* vp)
+{
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+
+    SocketInformation* data = JS_GetPrivate(cx, object);
+
+    int error        = 0;
+    socklen_t length = sizeof(error);
+
+    getsockopt(data->socket, SOL_SOCKET, SO_ERROR, &error, &length);
+
+    if (error) {
+        data->connected = JS_FALSE;
+    }
+
+    JS_SET_RVAL(cx, vp, INT_TO_JSVAL(error));
+    return JS_TRUE;
+}
+
+JSBool
+Socket_sendBytes (JSContext* cx, uintN argc, jsval* vp)
+{
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
     unsigned flags = 0;
 
+    if (argc < 1) {
+        JS_ReportError(cx, "Not enough parameters.");
+        return JS_FALSE;
+    }
+
+    if (argc > 1) {
+        JS_ValueToInt32(cx, argv[1], &flags);
+    }
+
+    BytesInformation* bytes = Bytes_get(cx, argv[0]);
+
+    if (!bytes) {
+        JS_ReportError(cx, "You have to pass a Bytes object.");
+        return JS_FALSE;
+    }
+
+    SocketInformation* data = JS_GetPrivate(cx, object);
+
+    if (!data->connected) {
+        JS_ReportError(cx, "The socket isn't connected.");
+        return JS_FALSE;
+    }
+
     JS_BeginRequest(cx);
+    jsrefcount req = JS_SuspendRequest(cx);
+    ssize_t sent   = __Socket_send(data, (char*) bytes->data, bytes->length, flags);
+    JS_ResumeRequest(cx, req);
+    JS_EndRequest(cx);
+
+    if (sent < 0) {
+        JS_ReportError(cx, "Send failed: %s.", strerror(errno));
+        return JS_FALSE;
+    }
+
+    JS_SET_RVAL(cx, vp, INT_TO_JSVAL(sent));
+    return JS_TRUE;
+}
+
+JSBool
+Socket_receiveBytes (JSContext* cx, uintN argc, jsval* vp)
+{
+    JSObject* object = JS_THIS_OBJECT(cx, vp);
+    jsval* argv = JS_ARGV(cx, vp);
+
+    unsigned size;
+    unsigned flags = 0;
 
     if (argc < 1) {
         JS_ReportError(cx, "Not enough parameters.");
         return JS_FALSE;
     }
 
+    JS_BeginRequest(cx);
+
     switch (argc) {
-        case 2: JS_ValueToInt32(cx, argv[2], &flags);
+        case 2: JS_ValueToInt32(cx, argv[1], &flags);
         case 1: JS_ValueToInt32(cx, argv[0], &size);
     }
 
@@ -369,48 +714,256 @@ Socket_receiveBytes (JSContext *cx, JSObject *object, uintN argc, jsval *argv, j
 
     if (!data->connected) {
         JS_ReportError(cx, "The socket isn't connected.");
+        JS_EndRequest(cx);
         return JS_FALSE;
     }
 
-    unsigned char* string = JS_malloc(cx, (size+1)*sizeof(char));
+    unsigned char* bytes = JS_malloc(cx, size ? size : 1);
 
-    jsrefcount req = JS_SuspendRequest(cx);
-    unsigned offset = 0;
-    while (offset < size) {
-        offset += recv(data->socket, (string+offset), sizeof(char)*(size-offset), flags);
-    }
-    string[size] = '\0';
+    jsrefcount req   = JS_SuspendRequest(cx);
+    ssize_t received = __Socket_receive(data, (char*) bytes, size, flags);
     JS_ResumeRequest(cx, req);
 
-    JSObject* array = JS_NewArrayObject(cx, 0, NULL);
+    if (received < 0) {
+        JS_free(cx, bytes);
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            JS_SET_RVAL(cx, vp, JSVAL_NULL);
+            JS_EndRequest(cx);
+            return JS_TRUE;
+        }
 
-    unsigned i;
-    for (i = 0; i < size; i++) {
-        jsval val = INT_TO_JSVAL(string[i]);
-        JS_SetElement(cx, array, i, &val);
+        JS_ReportError(cx, "Receive failed: %s.", strerror(errno));
+        JS_EndRequest(cx);
+        return JS_FALSE;
     }
 
-    jsval newArgv[] = {OBJECT_TO_JSVAL(array)};
+    // The received bytes are handed to the Bytes object as they are.
+    JSObject* result = Bytes_new(cx, bytes, received);
+    JS_EndRequest(cx);
 
-    jsval property; JS_GetProperty(cx, JS_GetGlobalObject(cx), "Bytes", &property);
-    JSObject* Bytes = JSVAL_TO_OBJECT(property);
+    if (!result) {
+        return JS_FALSE;
+    }
 
-    jsval jsProto; JS_GetProperty(cx, Bytes, "prototype", &jsProto);
-    JSObject* proto = JSVAL_TO_OBJECT(jsProto);
+    JS_SET_RVAL(cx, vp, OBJECT_TO_JSVAL(result));
+    return JS_TRUE;
+}
 
-    JSObject* bytes = JS_ConstructObject(cx, NULL, proto, NULL);
-    jsval ret;
-    JS_CallFunctionValue(cx, bytes, OBJECT_TO_JSVAL(Bytes), 1, newArgv, &ret);
-    JS_EndRequest(cx);
 
-    *rval = OBJECT_TO_JSVAL(bytes);
+ssize_t
+__Socket_send (SocketInformation* data, const char* buffer, size_t length, int flags)
+{
+    size_t offset = 0;
+
+    while (offset < length) {
+        ssize_t sent = send(data->socket, buffer+offset, length-offset, flags|MSG_NOSIGNAL);
+
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            // A full buffer on a non-blocking socket isn't an error, the caller retries.
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            return offset > 0 ? offset : -1;
+        }
+
+        offset += sent;
+    }
+
+    return offset;
+}
+
+ssize_t
+__Socket_receive (SocketInformation* data, char* buffer, size_t length, int flags)
+{
+    size_t offset = 0;
+
+    // What the buffered reads already got comes first.
+    if (data->bufferEnd > data->bufferStart) {
+        offset = data->bufferEnd - data->bufferStart;
+
+        if (offset > length) {
+            offset = length;
+        }
+
+        memcpy(buffer, data->buffer + data->bufferStart, offset);
+
+        if (!(flags & MSG_PEEK)) {
+            data->bufferStart += offset;
+        }
+    }
+
+    while (offset < length) {
+        ssize_t received = recv(data->socket, buffer+offset, length-offset, flags);
+
+        if (received == 0) {
+            break;
+        }
+
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (offset > 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+
+            return offset > 0 ? offset : -1;
+        }
+
+        offset += received;
+    }
+
+    return offset;
+}
+ssize_t
+__Socket_fill (JSContext* cx, SocketInformation* data)
+{
+    if (data->bufferStart == data->bufferEnd) {
+        data->bufferStart = data->bufferEnd = 0;
+    }
+
+    // Make room at the end, moving the unread data back or growing the buffer.
+    if (data->bufferEnd == data->bufferSize) {
+        if (data->bufferStart > 0) {
+            memmove(data->buffer, data->buffer + data->bufferStart, data->bufferEnd - data->bufferStart);
+            data->bufferEnd  -= data->bufferStart;
+            data->bufferStart = 0;
+        }
+        else {
+            size_t size = data->bufferSize ? data->bufferSize * 2 : __SOCKET_BUFFER_SIZE__;
+            char*  buffer = JS_realloc(cx, data->buffer, size);
+
+            if (!buffer) {
+                errno = ENOMEM;
+                return -1;
+            }
+
+            data->buffer     = buffer;
+            data->bufferSize = size;
+        }
+    }
+
+    ssize_t received;
+
+    jsrefcount req = JS_SuspendRequest(cx);
+    do {
+        received = recv(data->socket, data->buffer + data->bufferEnd, data->bufferSize - data->bufferEnd, 0);
+    } while (received < 0 && errno == EINTR);
+    JS_ResumeRequest(cx, req);
+
+    if (received > 0) {
+        data->bufferEnd += received;
+    }
+
+    return received;
+}
+
+JSBool
+__Socket_readUntil (JSContext* cx, SocketInformation* data, const char* delimiter, size_t length, JSBool strip, jsval* rval)
+{
+    // Bytes after the read position already searched, relative because filling moves the data.
+    size_t searched = 0;
+
+    while (1) {
+        size_t buffered = data->bufferEnd - data->bufferStart;
+        char*  start    = data->buffer + data->bufferStart;
+        char*  found    = length > 0 ? __Socket_find(start + searched, buffered - searched, delimiter, length) : start;
+
+        if (found) {
+            size_t line = found - start;
+
+            *rval = STRING_TO_JSVAL(JS_NewStringCopyN(cx, start, strip ? line : line + length));
+            data->bufferStart += line + length;
+
+            return JS_TRUE;
+        }
+
+        // Don't let a peer that never sends the delimiter make us buffer forever.
+        if (buffered >= __SOCKET_MAX_LINE__) {
+            JS_ReportError(cx, "The line is longer than %d bytes.", __SOCKET_MAX_LINE__);
+            return JS_FALSE;
+        }
+
+        // The delimiter could be split between what's buffered and what's coming.
+        searched = buffered >= length ? buffered - length + 1 : 0;
+
+        ssize_t received = __Socket_fill(cx, data);
+
+        // The peer closed the connection, the last line has no delimiter.
+        if (received == 0) {
+            if (buffered == 0) {
+                return __Socket_readEnded(cx, data, rval);
+            }
+
+            *rval = STRING_TO_JSVAL(JS_NewStringCopyN(cx, data->buffer + data->bufferStart, buffered));
+            data->bufferStart += buffered;
+
+            return JS_TRUE;
+        }
+
+        if (received < 0) {
+            return __Socket_readFailed(cx, data, received, rval);
+        }
+    }
+}
+
+JSBool
+__Socket_readFailed (JSContext* cx, SocketInformation* data, ssize_t received, jsval* rval)
+{
+    // Not enough data yet on a non-blocking socket, what's there stays buffered.
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        *rval = JSVAL_NULL;
+        return JS_TRUE;
+    }
+
+    JS_ReportError(cx, "Receive failed: %s.", strerror(errno));
+    return JS_FALSE;
+}
+
+JSBool
+__Socket_readEnded (JSContext* cx, SocketInformation* data, jsval* rval)
+{
+    // Nothing left to read, false tells it apart from an empty line and null.
+    data->connected = JS_FALSE;
+
+    *rval = JSVAL_FALSE;
     return JS_TRUE;
 }
 
+char*
+__Socket_find (char* buffer, size_t length, const char* delimiter, size_t delimiterLength)
+{
+    char* end = buffer + length;
+
+    while (buffer + delimiterLength <= end) {
+        char* found = memchr(buffer, delimiter[0], end - buffer - delimiterLength + 1);
+
+        if (!found) {
+            return NULL;
+        }
+
+        if (memcmp(found + 1, delimiter + 1, delimiterLength - 1) == 0) {
+            return found;
+        }
+
+        buffer = found + 1;
+    }
+
+    return NULL;
+}
 
 JSBool
-Socket_static_getHostByName (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+Socket_static_getHostByName (JSContext* cx, uintN argc, jsval* vp)
 {
+    jsval* argv = JS_ARGV(cx, vp);
+
     const char* host;
 
     if (argc != 1 || !JS_ConvertArguments(cx, argc, argv, "s", &host)) {
@@ -425,7 +978,7 @@ Socket_static_getHostByName (JSContext* cx, JSObject* object, uintN argc, jsval*
         return JS_FALSE;
     }
 
-    *rval = STRING_TO_JSVAL(JS_NewString(cx, rHost, strlen(rHost)));
+    JS_SET_RVAL(cx, vp, STRING_TO_JSVAL(JS_NewString(cx, rHost, strlen(rHost))));
     return JS_TRUE;
 }
 
@@ -451,8 +1004,10 @@ __Socket_getHostByName (JSContext* cx, const char* host)
 }
 
 JSBool
-Socket_static_isIPv4 (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval)
+Socket_static_isIPv4 (JSContext* cx, uintN argc, jsval* vp)
 {
+    jsval* argv = JS_ARGV(cx, vp);
+
     const char* host;
 
     if (argc != 1 || !JS_ConvertArguments(cx, argc, argv, "s", &host)) {
@@ -460,7 +1015,7 @@ Socket_static_isIPv4 (JSContext* cx, JSObject* object, uintN argc, jsval* argv,
         return JS_FALSE;
     }
 
-    *rval = BOOLEAN_TO_JSVAL(__Socket_isIPv4(host));
+    JS_SET_RVAL(cx, vp, BOOLEAN_TO_JSVAL(__Socket_isIPv4(host)));
     return JS_TRUE;
 }
 
@@ -20,6 +20,7 @@
 #define _SYSTEM_NET_SOCKET_H
 
 #include "lulzjs.h"
+#include "Core/Base/Bytes/private.h"
 
 #include <netinet/in.h>
 #include <sys/types.h>
@@ -28,6 +29,10 @@
 #include <netdb.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <unistd.h>
+
+#define __SOCKET_BUFFER_SIZE__ 16384
+#define __SOCKET_MAX_LINE__    1048576
 
 extern JSBool exec (JSContext* cx);
 extern JSBool Socket_initialize (JSContext* cx);
@@ -43,41 +48,79 @@ static JSClass Socket_class = {
 
 #include "private.h"
 
-extern JSBool Socket_connect (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool Socket_connect (JSContext* cx, uintN argc, jsval* vp);
+
+extern JSBool Socket_listen (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool Socket_accept (JSContext* cx, uintN argc, jsval* vp);
+
+extern JSBool Socket_send (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool Socket_receive (JSContext* cx, uintN argc, jsval* vp);
+
+/*
+ * Buffered reads, the socket is read in big chunks and the data is kept in
+ * the socket until it's asked for. On a non-blocking socket they return null
+ * when there isn't enough data yet, so keep reading until they do because
+ * the poller doesn't know about what's already buffered. Once the peer has
+ * closed the connection and everything buffered has been read they return
+ * false and the socket isn't connected anymore. readLine and readUntil throw
+ * when more than __SOCKET_MAX_LINE__ bytes come without the delimiter.
+ */
+extern JSBool Socket_readLine (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool Socket_readUntil (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool Socket_readExactly (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool Socket_peek (JSContext* cx, uintN argc, jsval* vp);
+
+extern JSBool Socket_close (JSContext* cx, uintN argc, jsval* vp);
 
-extern JSBool Socket_listen (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
-extern JSBool Socket_accept (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool Socket_setBlocking (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool Socket_getError (JSContext* cx, uintN argc, jsval* vp);
 
-extern JSBool Socket_send (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
-extern JSBool Socket_receive (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool Socket_sendBytes (JSContext* cx, uintN argc, jsval* vp);
+extern JSBool Socket_receiveBytes (JSContext* cx, uintN argc, jsval* vp);
 
-extern JSBool Socket_sendBytes (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
-extern JSBool Socket_receiveBytes (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool Socket_static_getHostByName (JSContext* cx, uintN argc, jsval* vp);
+ssize_t __Socket_send (SocketInformation* data, const char* buffer, size_t length, int flags);
+ssize_t __Socket_receive (SocketInformation* data, char* buffer, size_t length, int flags);
+
+ssize_t __Socket_fill (JSContext* cx, SocketInformation* data);
+JSBool  __Socket_readUntil (JSContext* cx, SocketInformation* data, const char* delimiter, size_t length, JSBool strip, jsval* rval);
+JSBool  __Socket_readFailed (JSContext* cx, SocketInformation* data, ssize_t received, jsval* rval);
+JSBool  __Socket_readEnded (JSContext* cx, SocketInformation* data, jsval* rval);
+char*   __Socket_find (char* buffer, size_t length, const char* delimiter, size_t delimiterLength);
 
-extern JSBool Socket_static_getHostByName (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
 const char* __Socket_getHostByName (JSContext* cx, const char* host);
 
-extern JSBool Socket_static_isIPv4 (JSContext* cx, JSObject* object, uintN argc, jsval* argv, jsval* rval);
+extern JSBool Socket_static_isIPv4 (JSContext* cx, uintN argc, jsval* vp);
 JSBool __Socket_isIPv4 (const char* host);
 
 static JSFunctionSpec Socket_methods[] = {
-    {"connect", Socket_connect, 0, 0, 0},
+    JS_FN("connect", Socket_connect, 0, 0, 0),
+
+    JS_FN("listen", Socket_listen, 0, 0, 0),
+    JS_FN("accept", Socket_accept, 0, 0, 0),
+
+    JS_FN("send",    Socket_send,    0, 0, 0),
+    JS_FN("receive", Socket_receive, 0, 0, 0),
+
+    JS_FN("readLine",    Socket_readLine,    0, 0, 0),
+    JS_FN("readUntil",   Socket_readUntil,   0, 0, 0),
+    JS_FN("readExactly", Socket_readExactly, 0, 0, 0),
+    JS_FN("peek",        Socket_peek,        0, 0, 0),
 
-    {"listen", Socket_listen, 0, 0, 0},
-    {"accept", Socket_accept, 0, 0, 0},
+    JS_FN("close", Socket_close, 0, 0, 0),
 
-    {"send",    Socket_send,    0, 0, 0},
-    {"receive", Socket_receive, 0, 0, 0},
+    JS_FN("setBlocking", Socket_setBlocking, 0, 0, 0),
+    JS_FN("getError",    Socket_getError,    0, 0, 0),
 
-    {"sendBytes",    Socket_sendBytes,    0, 0, 0},
-    {"receiveBytes", Socket_receiveBytes, 0, 0, 0},
+    JS_FN("sendBytes",    Socket_sendBytes,    0, 0, 0),
+    JS_FN("receiveBytes", Socket_receiveBytes, 0, 0, 0),
 
     {NULL}
 };
 
 static JSFunctionSpec Socket_static_methods[] = {
-    {"getHostByName", Socket_static_getHostByName, 0, 0, 0},
-    {"isIPv4",        Socket_static_isIPv4,        0, 0, 0},
+    JS_FN("getHostByName", Socket_static_getHostByName, 0, 0, 0),
+    JS_FN("isIPv4",        Socket_static_isIPv4,        0, 0, 0),
 
     {NULL}
 };
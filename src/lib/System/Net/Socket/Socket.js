@@ -36,28 +36,17 @@ Object.extend(System.Net.Socket.prototype, {
 
         var times     = options.times     || 1;
         var separator = options.separator || "\r\n";
-        var flags     = options.flags     || 0;
 
         var str = "";
         for (var i = 0; i < times; i++) {
-            var position = 0;
-            var ch;
-            while (ch = this.receive(1, flags)) {
-                if (ch == separator[position]) {
-                    position++;
+            var line = this.readLine(separator);
 
-                    if (position == separator.length)
-                        break;
-
-                    continue;
-                }
-                else if (position > 0) {
-                    str += separator.substr(0, position+1);
-                    position = 0;
-                }
-
-                str += ch;
+            // Not there yet or the connection is closed.
+            if (typeof line != "string") {
+                return i == 0 ? line : str;
             }
+
+            str += line;
         }
 
         return str;
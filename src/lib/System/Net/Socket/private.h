@@ -25,7 +25,17 @@ typedef struct {
     unsigned type;
     unsigned protocol;
     JSBool connected;
+    JSBool blocking;
     struct sockaddr* addr;
+
+    char*  buffer;
+    size_t bufferSize;
+    size_t bufferStart;
+    size_t bufferEnd;
+
+    // Set by the poller watching the socket, so closing it drops the watch.
+    void* watch;
+    void  (*unwatch) (JSContext* cx, void* watch);
 } SocketInformation;
 
 #endif
@@ -22,6 +22,8 @@ require("Net.so");
 
 require(["Socket/Socket.so", "Socket/Socket.js"]);
 
+require(["Poller/Poller.so", "Poller/Poller.js"]);
+
 require("Ports/Ports.js");
 
 Program.Net = Program.System.Net;
@@ -0,0 +1,28 @@
+#! /usr/bin/env ljs
+require("System/Console");
+require("System/Net/Poller");
+
+// Echo server, every client is served by the same thread.
+var poller = new Poller;
+var server = new Socket;
+server.listen(null, 2707);
+
+poller.listen(server, function (client) {
+    poller.add(client, Poller.READ, function (client) {
+        var data = client.receive(4096);
+
+        if (data === null) {
+            return;
+        }
+
+        if (data.length == 0) {
+            poller.remove(client);
+            client.close();
+            return;
+        }
+
+        client.send(data);
+    });
+});
+
+Console.writeLine("Listening on 2707.");
@@ -0,0 +1,29 @@
+#! /usr/bin/env ljs
+require("System/Console");
+
+var ticks    = 0;
+var interval = setInterval(function () {
+    Console.writeLine("tick "+(++ticks));
+
+    if (ticks == 3) {
+        clearInterval(interval);
+    }
+}, 100);
+
+var cleared = setTimeout(function () {
+    Console.writeLine("This should never be shown.");
+}, 200);
+clearTimeout(cleared);
+
+setTimeout(function (name) {
+    Console.writeLine("Hello "+name+"!");
+}, 500, "timers");
+
+(function () {
+    Console.writeLine("Delayed by Function#delay.");
+}).delay(0.2);
+
+var executer = new PeriodicalExecuter(function (pe) {
+    Console.writeLine("PeriodicalExecuter");
+    pe.stop();
+}, 0.05);